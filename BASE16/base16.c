@@ -0,0 +1,379 @@
+/*
+ * base16.c
+ * 实现文件
+ */
+
+#include "base16.h"
+
+/* ============================================================
+ * 平台检测：决定编译哪些 SIMD 内核
+ * ============================================================ */
+#if !defined(BASE16_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define BASE16_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if !defined(BASE16_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define BASE16_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Hex 字符映射表
+static const char base16_table_upper[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+static const char base16_table_lower[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+// 解码反向查找表：ASCII -> 4bit 值，0xFF 表示非法字符
+// 与 base64 相同，用 256 字节换 O(1) 查找；下标 128-255 全部为非法
+static const uint8_t decoding_table[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 0-15
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 16-31
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 32-47
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 48-63 (0-9)
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 64-79 (A-F)
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 80-95
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 96-111 (a-f)
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 112-127
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 128-255
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/* ============================================================
+ * 加速内核
+ * 约定：内核只处理整块数据，返回已消耗的输入长度，剩余尾部交给标量代码。
+ *      解码内核遇到非法字符时停在该块之前，由标量代码负责报错。
+ * ============================================================ */
+
+typedef size_t (*base16_enc_kernel_t)(const uint8_t *src, size_t src_len, char *dst, const char *table);
+typedef size_t (*base16_dec_kernel_t)(const char *src, size_t src_len, uint8_t *dst);
+
+static size_t base16_encode_none(const uint8_t *src, size_t src_len, char *dst, const char *table)
+{
+    (void)src;
+    (void)src_len;
+    (void)dst;
+    (void)table;
+    return 0;
+}
+
+static size_t base16_decode_none(const char *src, size_t src_len, uint8_t *dst)
+{
+    (void)src;
+    (void)src_len;
+    (void)dst;
+    return 0;
+}
+
+#ifdef BASE16_HAVE_X86
+
+/* SSSE3：每次 16 字节 -> 32 字符 */
+__attribute__((target("ssse3"))) static size_t base16_encode_ssse3(const uint8_t *src, size_t src_len, char *dst, const char *table)
+{
+    const __m128i lut = _mm_loadu_si128((const __m128i *)table);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 16 <= src_len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        // 拆分高低半字节 (epi16 右移后需要再次屏蔽，防止相邻字节的位混入)
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i lo = _mm_and_si128(v, mask);
+        // pshufb 一次查 16 个字符
+        hi = _mm_shuffle_epi8(lut, hi);
+        lo = _mm_shuffle_epi8(lut, lo);
+        // 高半字节在前，交错输出
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+/* SSSE3：每次 32 字符 -> 16 字节 */
+__attribute__((target("ssse3"))) static size_t base16_decode_ssse3(const char *src, size_t src_len, uint8_t *dst)
+{
+    const __m128i c0 = _mm_set1_epi8('0');
+    const __m128i ca = _mm_set1_epi8('a');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i five = _mm_set1_epi8(5);
+    const __m128i ten = _mm_set1_epi8(10);
+    const __m128i weights = _mm_set1_epi16(0x0110); // 每对字节: hi * 16 + lo * 1
+    size_t i = 0;
+
+    for (; i + 32 <= src_len; i += 32)
+    {
+        __m128i out[2];
+        int k;
+        for (k = 0; k < 2; k++)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i *)(src + i + 16 * k));
+            // '0'~'9' -> 0~9
+            __m128i d = _mm_sub_epi8(c, c0);
+            __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+            // 'a'~'f' / 'A'~'F' -> 0~5 (先统一为小写)
+            __m128i l = _mm_sub_epi8(_mm_or_si128(c, case_bit), ca);
+            __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, five), l);
+
+            if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xFFFF)
+                return i; // 含非法字符，交给标量代码定位
+
+            __m128i val = _mm_or_si128(_mm_and_si128(is_digit, d),
+                                       _mm_and_si128(is_alpha, _mm_add_epi8(l, ten)));
+            // 相邻两个半字节合成 1 字节，结果暂存在 16 位通道中
+            out[k] = _mm_maddubs_epi16(val, weights);
+        }
+        _mm_storeu_si128((__m128i *)(dst + i / 2), _mm_packus_epi16(out[0], out[1]));
+    }
+    return i;
+}
+
+/* AVX2：每次 32 字节 -> 64 字符 */
+__attribute__((target("avx2"))) static size_t base16_encode_avx2(const uint8_t *src, size_t src_len, char *dst, const char *table)
+{
+    const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 32 <= src_len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+        // unpack 只在 128 位通道内交错，需要再按通道重排
+        __m256i a = _mm256_unpacklo_epi8(hi, lo); // [0-7 | 16-23]
+        __m256i b = _mm256_unpackhi_epi8(hi, lo); // [8-15 | 24-31]
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+/* AVX2：每次 64 字符 -> 32 字节 */
+__attribute__((target("avx2"))) static size_t base16_decode_avx2(const char *src, size_t src_len, uint8_t *dst)
+{
+    const __m256i c0 = _mm256_set1_epi8('0');
+    const __m256i ca = _mm256_set1_epi8('a');
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i five = _mm256_set1_epi8(5);
+    const __m256i ten = _mm256_set1_epi8(10);
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+
+    for (; i + 64 <= src_len; i += 64)
+    {
+        __m256i out[2];
+        int k;
+        for (k = 0; k < 2; k++)
+        {
+            __m256i c = _mm256_loadu_si256((const __m256i *)(src + i + 32 * k));
+            __m256i d = _mm256_sub_epi8(c, c0);
+            __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d);
+            __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, case_bit), ca);
+            __m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(l, five), l);
+
+            if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != -1)
+                return i;
+
+            __m256i val = _mm256_or_si256(_mm256_and_si256(is_digit, d),
+                                          _mm256_and_si256(is_alpha, _mm256_add_epi8(l, ten)));
+            out[k] = _mm256_maddubs_epi16(val, weights);
+        }
+        // packus 同样按通道工作，打包后用 permute4x64 恢复顺序
+        __m256i packed = _mm256_packus_epi16(out[0], out[1]);
+        _mm256_storeu_si256((__m256i *)(dst + i / 2), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return i;
+}
+
+#endif /* BASE16_HAVE_X86 */
+
+#ifdef BASE16_HAVE_NEON
+
+/* NEON：每次 16 字节 -> 32 字符 */
+static size_t base16_encode_neon(const uint8_t *src, size_t src_len, char *dst, const char *table)
+{
+    const uint8x16_t lut = vld1q_u8((const uint8_t *)table);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    size_t i = 0;
+
+    for (; i + 16 <= src_len; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16x2_t out;
+        out.val[0] = vqtbl1q_u8(lut, vshrq_n_u8(v, 4));
+        out.val[1] = vqtbl1q_u8(lut, vandq_u8(v, mask));
+        // vst2 自带交错存储：hi0 lo0 hi1 lo1 ...
+        vst2q_u8((uint8_t *)(dst + 2 * i), out);
+    }
+    return i;
+}
+
+/* NEON：每次 32 字符 -> 16 字节 */
+static size_t base16_decode_neon(const char *src, size_t src_len, uint8_t *dst)
+{
+    const uint8x16_t c0 = vdupq_n_u8('0');
+    const uint8x16_t ca = vdupq_n_u8('a');
+    const uint8x16_t case_bit = vdupq_n_u8(0x20);
+    const uint8x16_t nine = vdupq_n_u8(9);
+    const uint8x16_t five = vdupq_n_u8(5);
+    const uint8x16_t ten = vdupq_n_u8(10);
+    size_t i = 0;
+
+    for (; i + 32 <= src_len; i += 32)
+    {
+        // vld2 自带反交错：val[0] 为高半字节字符，val[1] 为低半字节字符
+        uint8x16x2_t c = vld2q_u8((const uint8_t *)(src + i));
+        uint8x16_t nib[2];
+        int k;
+        for (k = 0; k < 2; k++)
+        {
+            uint8x16_t d = vsubq_u8(c.val[k], c0);
+            uint8x16_t is_digit = vcleq_u8(d, nine);
+            uint8x16_t l = vsubq_u8(vorrq_u8(c.val[k], case_bit), ca);
+            uint8x16_t is_alpha = vcleq_u8(l, five);
+
+            if (vminvq_u8(vorrq_u8(is_digit, is_alpha)) != 0xFF)
+                return i;
+
+            nib[k] = vorrq_u8(vandq_u8(is_digit, d), vandq_u8(is_alpha, vaddq_u8(l, ten)));
+        }
+        vst1q_u8(dst + i / 2, vorrq_u8(vshlq_n_u8(nib[0], 4), nib[1]));
+    }
+    return i;
+}
+
+#endif /* BASE16_HAVE_NEON */
+
+/* ============================================================
+ * 运行时分发
+ * 内核组合是只读的常量表，只有 x86 需要在首次调用时按 CPU 特性选择：
+ * 选择结果以一个指针发布 (__atomic 获取/释放)，多个线程同时首次调用时各自算出同一个表，
+ * 重复写入同一个值，不需要加锁。其他平台在编译时确定，没有可写的全局状态。
+ * ============================================================ */
+
+typedef struct
+{
+    base16_enc_kernel_t enc;
+    base16_dec_kernel_t dec;
+    const char *name;
+} base16_kernels_t;
+
+static const base16_kernels_t base16_kernels_scalar = {base16_encode_none, base16_decode_none, "scalar"};
+
+#if defined(BASE16_HAVE_X86)
+static const base16_kernels_t base16_kernels_avx2 = {base16_encode_avx2, base16_decode_avx2, "avx2"};
+static const base16_kernels_t base16_kernels_ssse3 = {base16_encode_ssse3, base16_decode_ssse3, "ssse3"};
+
+static const base16_kernels_t *base16_kernels(void)
+{
+    static const base16_kernels_t *selected = NULL;
+
+    const base16_kernels_t *k = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (k == NULL)
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            k = &base16_kernels_avx2;
+        else if (__builtin_cpu_supports("ssse3"))
+            k = &base16_kernels_ssse3;
+        else
+            k = &base16_kernels_scalar;
+        __atomic_store_n(&selected, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+#elif defined(BASE16_HAVE_NEON)
+static const base16_kernels_t base16_kernels_neon = {base16_encode_neon, base16_decode_neon, "neon"};
+
+static const base16_kernels_t *base16_kernels(void)
+{
+    return &base16_kernels_neon;
+}
+#else
+static const base16_kernels_t *base16_kernels(void)
+{
+    return &base16_kernels_scalar;
+}
+#endif
+
+const char *base16_kernel_name(void)
+{
+    return base16_kernels()->name;
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+static int base16_encode_table(const uint8_t *src, size_t src_len, char *dst, size_t dst_size, const char *table)
+{
+    size_t needed_len = BASE16_ENCODE_OUT_SIZE(src_len);
+    if (dst_size < needed_len)
+    {
+        return -1; // 缓冲区不足
+    }
+
+    // 先由加速内核处理整块，剩余不足一块的尾部走标量
+    size_t i = base16_kernels()->enc(src, src_len, dst, table);
+    size_t j = i * 2;
+
+    for (; i < src_len; i++)
+    {
+        dst[j++] = table[src[i] >> 4];
+        dst[j++] = table[src[i] & 0x0F];
+    }
+
+    dst[j] = '\0'; // 始终添加 null 结尾
+    return (int)j;
+}
+
+int base16_encode(const uint8_t *src, size_t src_len, char *dst, size_t dst_size)
+{
+    return base16_encode_table(src, src_len, dst, dst_size, base16_table_upper);
+}
+
+int base16_encode_lower(const uint8_t *src, size_t src_len, char *dst, size_t dst_size)
+{
+    return base16_encode_table(src, src_len, dst, dst_size, base16_table_lower);
+}
+
+int base16_decode(const char *src, size_t src_len, uint8_t *dst, size_t dst_size)
+{
+    // 长度检查：Hex 字符串长度必须是 2 的倍数
+    if (src_len % 2 != 0)
+    {
+        return -1;
+    }
+
+    if (dst_size < BASE16_DECODE_OUT_SIZE(src_len))
+    {
+        return -1; // 缓冲区不足
+    }
+
+    size_t i = base16_kernels()->dec(src, src_len, dst);
+    size_t j = i / 2;
+
+    while (i < src_len)
+    {
+        uint8_t hi = decoding_table[(uint8_t)src[i++]];
+        uint8_t lo = decoding_table[(uint8_t)src[i++]];
+
+        // 非法字符
+        if (hi == 0xFF || lo == 0xFF)
+            return -1;
+
+        dst[j++] = (uint8_t)((hi << 4) | lo);
+    }
+
+    return (int)j;
+}
@@ -0,0 +1,76 @@
+/*
+ * base16.h
+ * 无动态内存分配的 Base16 (Hex) 编解码库 (C99)
+ * 标量实现 + SSSE3 / AVX2 / NEON 加速内核，运行时自动选择
+ */
+
+#ifndef BASE16_H
+#define BASE16_H
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint8_t
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * === 辅助宏：计算缓冲区大小 ===
+ * 用于在声明数组时确定所需的最小长度。
+ */
+
+// 计算编码 N 字节数据所需的缓冲区大小 (包含结尾的 NULL)
+// 公式: 2 * N + 1
+#define BASE16_ENCODE_OUT_SIZE(n) ((n) * 2 + 1)
+
+// 计算解码 N 字节 Hex 字符串所需的最大缓冲区大小
+// 公式: N / 2
+#define BASE16_DECODE_OUT_SIZE(n) ((n) / 2)
+
+/*
+ * === 编译开关 ===
+ * 定义 BASE16_NO_SIMD 可强制只使用标量实现 (例如调试或对比性能时)。
+ */
+
+/*
+ * === API 函数声明 ===
+ */
+
+/**
+ * @brief Base16 编码 (大写，RFC 4648 标准字母表 "0123456789ABCDEF")
+ * * @param src       [in] 输入的二进制数据
+ * @param src_len   [in] 输入数据的长度 (字节数)
+ * @param dst       [out] 输出缓冲区 (必须足够大)
+ * @param dst_size  [in] 输出缓冲区的大小 (使用 BASE16_ENCODE_OUT_SIZE 计算)
+ * @return int      成功返回编码后的字符串长度(不含NULL)，失败返回 -1 (缓冲区不足)
+ */
+int base16_encode(const uint8_t *src, size_t src_len, char *dst, size_t dst_size);
+
+/**
+ * @brief Base16 编码 (小写 "0123456789abcdef"，常用于哈希值显示)
+ * @note 参数与返回值同 base16_encode
+ */
+int base16_encode_lower(const uint8_t *src, size_t src_len, char *dst, size_t dst_size);
+
+/**
+ * @brief Base16 解码 (大小写均可识别)
+ * * @param src       [in] 输入的 Hex 字符串
+ * @param src_len   [in] 输入字符串的长度 (必须是 2 的倍数)
+ * @param dst       [out] 输出缓冲区 (用于存放二进制数据)
+ * @param dst_size  [in] 输出缓冲区的大小 (使用 BASE16_DECODE_OUT_SIZE 计算)
+ * @return int      成功返回解码后的字节数，失败返回 -1 (格式错误或缓冲区不足)
+ */
+int base16_decode(const char *src, size_t src_len, uint8_t *dst, size_t dst_size);
+
+/**
+ * @brief 查询当前运行时选中的加速内核名称
+ * @return "avx2" / "ssse3" / "neon" / "scalar"
+ */
+const char *base16_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BASE16_H
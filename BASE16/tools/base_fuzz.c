@@ -0,0 +1,362 @@
+/* ============================================================
+ * base_fuzz：BASE16 / BASE32 / BASE64 编解码的模糊测试与往返性质测试 (三个模块共用)
+ * 每个输入都做两件事：
+ *   1. 往返：把输入当作二进制数据编码再解码，必须得到原数据；编码长度等于 *_ENCODE_OUT_SIZE - 1，
+ *      输出缓冲区少 1 字节时必须返回 -1。
+ *   2. 非法输入：把输入当作字符串直接解码，BASE16 / BASE32 的结果 (返回值与字节) 必须与本文件的
+ *      标量参考实现一致 —— SIMD 内核在块内遇到非法字符时要交回标量代码报错，这里覆盖这条路径；
+ *      BASE64 只检查不越界、返回值不超过 BASE64_DECODE_OUT_SIZE。
+ * 所有缓冲区都按精确大小在堆上分配，越界读写由 ASan 报告。
+ *
+ * 用法：
+ *   base_fuzz [-r n] file|dir ...       逐个回放输入 (崩溃复现、AFL)，-r 重复 n 遍
+ *   base_fuzz -p n [-S seed]            随机性质测试：随机长度的数据往返，并在编码结果中随机改写字符后解码，共 n 轮
+ *
+ * 编译 (在仓库根目录下)：
+ *   gcc -std=c99 -O1 -g -fsanitize=address,undefined BASE16/tools/base_fuzz.c \
+ *       BASE16/base16.c BASE32/base32.c BASE64/base64.c -o base_fuzz
+ *   加 -DBASE16_NO_SIMD -DBASE32_NO_SIMD 测试标量路径。
+ *   libFuzzer：clang -O1 -g -fsanitize=fuzzer,address,undefined -DBASE_FUZZ_LIBFUZZER <同上源文件> -o base_fuzz_lf
+ *   AFL++：用 afl-clang-fast 按 gcc 命令编译，afl-fuzz -i seeds -o findings -- ./base_fuzz @@
+ * ============================================================ */
+#define _POSIX_C_SOURCE 200809L
+#include "../base16.h"
+#include "../../BASE32/base32.h"
+#include "../../BASE64/base64.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef BASE_FUZZ_LIBFUZZER
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/* 单个输入的最大长度 (更长的部分被忽略) */
+#define FUZZ_MAX_INPUT 65536
+
+/* 断言失败时直接 abort，libFuzzer / AFL 按崩溃记录该输入 */
+#define FUZZ_CHECK(cond)                                                              \
+    do                                                                                \
+    {                                                                                 \
+        if (!(cond))                                                                  \
+        {                                                                             \
+            fprintf(stderr, "base_fuzz: check failed at line %d: %s\n", __LINE__, #cond); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+/* --------------------------------------------------------------------------
+ * 标量参考实现 (按头文件中的规则逐字符解码，不追求速度)
+ * -------------------------------------------------------------------------- */
+
+static int FuzzHexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/* BASE16：长度为偶数，大小写均可 */
+static int FuzzRefDecode16(const char *src, size_t len, uint8_t *dst)
+{
+    if (len % 2 != 0)
+        return -1;
+    for (size_t i = 0; i < len; i += 2)
+    {
+        int hi = FuzzHexValue(src[i]);
+        int lo = FuzzHexValue(src[i + 1]);
+        if (hi < 0 || lo < 0)
+            return -1;
+        dst[i / 2] = (uint8_t)((hi << 4) | lo);
+    }
+    return (int)(len / 2);
+}
+
+static int FuzzBase32Value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a';
+    if (c >= '2' && c <= '7')
+        return c - '2' + 26;
+    return -1;
+}
+
+/* BASE32：长度为 8 的倍数；'=' 只能出现在最后一组并连续到组尾；每组有效字符数为 2/4/5/7/8 */
+static int FuzzRefDecode32(const char *src, size_t len, uint8_t *dst)
+{
+    static const int bytesForChars[9] = {-1, -1, 1, -1, 2, 3, -1, 4, 5};
+    size_t out = 0;
+
+    if (len % 8 != 0)
+        return -1;
+    for (size_t i = 0; i < len; i += 8)
+    {
+        uint64_t group = 0;
+        size_t valid = 0;
+        while (valid < 8 && src[i + valid] != '=')
+        {
+            int v = FuzzBase32Value(src[i + valid]);
+            if (v < 0)
+                return -1;
+            group = (group << 5) | (uint64_t)v;
+            valid++;
+        }
+        for (size_t k = valid; k < 8; k++)
+        {
+            if (src[i + k] != '=')
+                return -1;
+        }
+        if (valid < 8 && i + 8 != len)
+            return -1;
+        if (bytesForChars[valid] < 0)
+            return -1;
+
+        group <<= 5 * (8 - valid);
+        for (int k = 0; k < bytesForChars[valid]; k++)
+            dst[out++] = (uint8_t)(group >> (32 - 8 * k));
+    }
+    return (int)out;
+}
+
+/* --------------------------------------------------------------------------
+ * 单个输入
+ * -------------------------------------------------------------------------- */
+
+typedef int (*FuzzEncodeFn)(const uint8_t *src, size_t len, char *dst, size_t size);
+typedef int (*FuzzDecodeFn)(const char *src, size_t len, uint8_t *dst, size_t size);
+
+/* 往返：编码到精确大小的缓冲区，再解码到精确大小的缓冲区 */
+static void FuzzRoundTrip(const uint8_t *data, size_t len, FuzzEncodeFn enc, FuzzDecodeFn dec, size_t encSize,
+                          size_t (*decSize)(size_t))
+{
+    char *text = malloc(encSize);
+    FUZZ_CHECK(text != NULL);
+
+    int n = enc(data, len, text, encSize);
+    FUZZ_CHECK(n >= 0 && (size_t)n == encSize - 1 && text[n] == '\0');
+    FUZZ_CHECK(enc(data, len, text, encSize - 1) == -1);
+
+    size_t outSize = decSize((size_t)n);
+    uint8_t *out = malloc(outSize ? outSize : 1);
+    FUZZ_CHECK(out != NULL);
+    int m = dec(text, (size_t)n, out, outSize);
+    FUZZ_CHECK(m >= 0 && (size_t)m == len && memcmp(out, data, len) == 0);
+
+    free(out);
+    free(text);
+}
+
+static size_t FuzzDecSize16(size_t n) { return BASE16_DECODE_OUT_SIZE(n); }
+static size_t FuzzDecSize32(size_t n) { return BASE32_DECODE_OUT_SIZE(n); }
+static size_t FuzzDecSize64(size_t n) { return BASE64_DECODE_OUT_SIZE(n); }
+
+/* 把输入当作字符串解码，与参考实现比较 (ref 为 NULL 时只检查返回值范围) */
+static void FuzzDecodeText(const char *text, size_t len, FuzzDecodeFn dec, int (*ref)(const char *, size_t, uint8_t *),
+                           size_t outSize)
+{
+    uint8_t *out = malloc(outSize ? outSize : 1);
+    uint8_t *expect = malloc(outSize ? outSize : 1);
+    FUZZ_CHECK(out != NULL && expect != NULL);
+
+    int m = dec(text, len, out, outSize);
+    FUZZ_CHECK(m >= -1 && (m < 0 || (size_t)m <= outSize));
+    if (ref)
+    {
+        int r = ref(text, len, expect);
+        FUZZ_CHECK(m == r);
+        FUZZ_CHECK(m <= 0 || memcmp(out, expect, (size_t)m) == 0);
+    }
+
+    /* 输出缓冲区不足时必须拒绝，不能写出界 */
+    if (outSize > 0)
+        FUZZ_CHECK(dec(text, len, out, outSize - 1) == -1);
+
+    free(expect);
+    free(out);
+}
+
+/* 模糊测试入口 (libFuzzer 约定) */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size > FUZZ_MAX_INPUT)
+        size = FUZZ_MAX_INPUT;
+
+    /* 拷贝到精确大小的堆内存，越界读由 ASan 报告 */
+    uint8_t *body = malloc(size ? size : 1);
+    FUZZ_CHECK(body != NULL);
+    memcpy(body, data, size);
+
+    FuzzRoundTrip(body, size, base16_encode, base16_decode, BASE16_ENCODE_OUT_SIZE(size), FuzzDecSize16);
+    FuzzRoundTrip(body, size, base16_encode_lower, base16_decode, BASE16_ENCODE_OUT_SIZE(size), FuzzDecSize16);
+    FuzzRoundTrip(body, size, base32_encode, base32_decode, BASE32_ENCODE_OUT_SIZE(size), FuzzDecSize32);
+    if (size > 0) /* BASE64 把空字符串视为格式错误 */
+        FuzzRoundTrip(body, size, base64_encode, base64_decode, BASE64_ENCODE_OUT_SIZE(size), FuzzDecSize64);
+
+    const char *text = (const char *)body;
+    FuzzDecodeText(text, size, base16_decode, FuzzRefDecode16, BASE16_DECODE_OUT_SIZE(size));
+    FuzzDecodeText(text, size, base32_decode, FuzzRefDecode32, BASE32_DECODE_OUT_SIZE(size));
+    FuzzDecodeText(text, size, base64_decode, NULL, BASE64_DECODE_OUT_SIZE(size));
+
+    free(body);
+    return 0;
+}
+
+#ifndef BASE_FUZZ_LIBFUZZER
+
+/* --------------------------------------------------------------------------
+ * 随机性质测试
+ * -------------------------------------------------------------------------- */
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t FuzzRand(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (uint32_t)(g_rng >> 32);
+}
+
+/* 合法编码文本中随机改写 1~3 个字符 (非法字符、另一种大小写、'='、其他合法字符)，位置覆盖 SIMD 块内部 */
+static void FuzzMutate(char *text, size_t len)
+{
+    static const char pool[] = "=0189afAFgzGZ27/+\x80\xff \n";
+    uint32_t edits = 1 + FuzzRand() % 3;
+    for (uint32_t e = 0; e < edits && len > 0; e++)
+        text[FuzzRand() % len] = pool[FuzzRand() % (sizeof(pool) - 1)];
+}
+
+static int FuzzProperties(uint32_t rounds)
+{
+    static uint8_t data[4096];
+    static char text[BASE16_ENCODE_OUT_SIZE(4096)];
+    uint32_t rejected16 = 0, rejected32 = 0;
+
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        /* 多数是 SIMD 块大小附近的短数据，少数是长数据 */
+        size_t len = (FuzzRand() % 8 == 0) ? FuzzRand() % sizeof(data) : FuzzRand() % 160;
+        for (size_t i = 0; i < len; i++)
+            data[i] = (uint8_t)FuzzRand();
+        LLVMFuzzerTestOneInput(data, len);
+
+        int n = base16_encode_lower(data, len, text, sizeof(text));
+        FuzzMutate(text, (size_t)n);
+        FuzzDecodeText(text, (size_t)n, base16_decode, FuzzRefDecode16, BASE16_DECODE_OUT_SIZE((size_t)n));
+        rejected16 += FuzzRefDecode16(text, (size_t)n, data) < 0;
+
+        n = base32_encode(data, len, text, sizeof(text));
+        FuzzMutate(text, (size_t)n);
+        FuzzDecodeText(text, (size_t)n, base32_decode, FuzzRefDecode32, BASE32_DECODE_OUT_SIZE((size_t)n));
+        rejected32 += FuzzRefDecode32(text, (size_t)n, data) < 0;
+    }
+
+    printf("properties: %u rounds ok (kernels base16=%s base32=%s; mutated text rejected %u / %u)\n", rounds,
+           base16_kernel_name(), base32_kernel_name(), rejected16, rejected32);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * 回放
+ * -------------------------------------------------------------------------- */
+
+static uint32_t g_inputs;
+
+static bool FuzzRunFile(const char *path, uint32_t rounds)
+{
+    static uint8_t buf[FUZZ_MAX_INPUT];
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+
+    for (uint32_t r = 0; r < rounds; r++)
+        LLVMFuzzerTestOneInput(buf, n);
+    g_inputs++;
+    return true;
+}
+
+static bool FuzzRunPath(const char *path, uint32_t rounds)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    if (!S_ISDIR(st.st_mode))
+        return FuzzRunFile(path, rounds);
+
+    DIR *dir = opendir(path);
+    if (!dir)
+        return false;
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL)
+    {
+        char full[1024];
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(full, sizeof(full), "%s/%s", path, e->d_name);
+        if (stat(full, &st) == 0 && S_ISREG(st.st_mode) && !FuzzRunFile(full, rounds))
+        {
+            closedir(dir);
+            return false;
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+static void FuzzUsage(const char *prog)
+{
+    printf("usage: %s [-r n] file|dir ...   replay inputs\n"
+           "       %s -p n [-S seed]         random round-trip / mutated-text properties\n",
+           prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = 1;
+    uint32_t props = 0;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rounds = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            props = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+            g_rng ^= (uint64_t)strtoull(argv[++i], NULL, 0) * 0xD1B54A32D192ED03ull;
+        else
+        {
+            FuzzUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (props > 0)
+        return FuzzProperties(props);
+    if (i >= argc)
+    {
+        FuzzUsage(argv[0]);
+        return 1;
+    }
+    for (; i < argc; i++)
+    {
+        if (!FuzzRunPath(argv[i], rounds ? rounds : 1))
+        {
+            fprintf(stderr, "base_fuzz: cannot read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    printf("replayed %u inputs x %u\n", g_inputs, rounds ? rounds : 1);
+    return 0;
+}
+
+#endif /* BASE_FUZZ_LIBFUZZER */
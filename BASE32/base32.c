@@ -0,0 +1,476 @@
+/*
+ * base32.c
+ * 实现文件
+ */
+
+#include "base32.h"
+#include <string.h> // 用于 memcpy
+
+/* ============================================================
+ * 平台检测：决定编译哪些 SIMD 内核
+ * ============================================================ */
+#if !defined(BASE32_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define BASE32_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if !defined(BASE32_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define BASE32_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Base32 字符映射表 (RFC 4648)
+static const char base32_table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "234567";
+
+// 解码反向查找表：ASCII -> 5bit 值，0xFF 表示非法字符 ('=' 单独判断)
+static const uint8_t decoding_table[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 0-15
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 16-31
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 32-47
+    0xFF, 0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 48-63 (2-7)
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, // 64-79 (A-O)
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 80-95 (P-Z)
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, // 96-111 (a-o)
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 112-127 (p-z)
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 128-255
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/* ============================================================
+ * 加速内核
+ * 5 字节 (40 bit) 为一组，对应 8 个字符。第 k 个字符取自 bit [5k, 5k+5)，
+ * 这 5 位一定落在第 floor(5k/8) 和其后一个字节拼成的 16 位大端字里，
+ * 因此 SIMD 的做法是：先用 shuffle 拼出 8 个 16 位字，再按通道右移并取低 5 位。
+ *
+ * 约定：内核只处理整块数据，返回已消耗的输入长度，剩余尾部交给标量代码。
+ *      解码内核遇到非法字符时停在该块之前，由标量代码负责报错。
+ * ============================================================ */
+
+typedef size_t (*base32_enc_kernel_t)(const uint8_t *src, size_t src_len, char *dst);
+typedef size_t (*base32_dec_kernel_t)(const char *src, size_t src_len, uint8_t *dst);
+
+static size_t base32_encode_none(const uint8_t *src, size_t src_len, char *dst)
+{
+    (void)src;
+    (void)src_len;
+    (void)dst;
+    return 0;
+}
+
+static size_t base32_decode_none(const char *src, size_t src_len, uint8_t *dst)
+{
+    (void)src;
+    (void)src_len;
+    (void)dst;
+    return 0;
+}
+
+#ifdef BASE32_HAVE_X86
+
+/* 右移量 s = [11,6,9,4,7,10,5,8]，用 mulhi(w, 2^(16-s)) 实现按通道可变右移 */
+#define BASE32_X86_MULTIPLIERS 32, 1024, 128, 4096, 512, 64, 2048, 256
+
+/* 每个 16 位通道 = (低字节 src[j+1], 高字节 src[j])，j = [0,0,1,1,2,3,3,4] */
+#define BASE32_X86_SHUFFLE(o)                                  \
+    (char)((o) + 1), (char)((o) + 0), (char)((o) + 1), (char)((o) + 0), \
+    (char)((o) + 2), (char)((o) + 1), (char)((o) + 2), (char)((o) + 1), \
+    (char)((o) + 3), (char)((o) + 2), (char)((o) + 4), (char)((o) + 3), \
+    (char)((o) + 4), (char)((o) + 3), (char)((o) + 5), (char)((o) + 4)
+
+/* 40 bit 结果按大端顺序取出：每个 64 位通道的字节 4,3,2,1,0 */
+#define BASE32_X86_GATHER 4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1
+
+/* SSSE3：5bit 索引 -> ASCII */
+__attribute__((target("ssse3"))) static inline __m128i base32_ascii_ssse3(__m128i idx)
+{
+    // idx < 26 -> 'A' + idx;  idx >= 26 -> '2' + (idx - 26) = idx + 24
+    __m128i fix = _mm_and_si128(_mm_cmpgt_epi8(idx, _mm_set1_epi8(25)), _mm_set1_epi8('A' - 24));
+    return _mm_sub_epi8(_mm_add_epi8(idx, _mm_set1_epi8('A')), fix);
+}
+
+/* SSSE3：ASCII -> 5bit 值，非法字符时返回 0 */
+__attribute__((target("ssse3"))) static inline int base32_value_ssse3(__m128i c, __m128i *val)
+{
+    __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(25)), l);
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('2'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(5)), d);
+
+    if (_mm_movemask_epi8(_mm_or_si128(is_alpha, is_digit)) != 0xFFFF)
+        return 0;
+
+    *val = _mm_or_si128(_mm_and_si128(is_alpha, l),
+                        _mm_and_si128(is_digit, _mm_add_epi8(d, _mm_set1_epi8(26))));
+    return 1;
+}
+
+/* SSSE3：16 个 5bit 值 -> 两个 64 位通道中各一个 40 bit 整数，再按大端取出 10 字节 */
+__attribute__((target("ssse3"))) static inline __m128i base32_pack_ssse3(__m128i val)
+{
+    // 相邻两个值合成 10 bit: v0 * 32 + v1
+    __m128i w = _mm_maddubs_epi16(val, _mm_set1_epi16(0x0120));
+    // 相邻两个 10 bit 合成 20 bit: w0 * 1024 + w1
+    __m128i d = _mm_madd_epi16(w, _mm_set1_epi32(0x00010400));
+    // 每个 64 位通道: (d0 << 20) | d1
+    __m128i hi = _mm_and_si128(_mm_slli_epi64(d, 20), _mm_set1_epi64x(0xFFFFF00000LL));
+    __m128i x = _mm_or_si128(hi, _mm_srli_epi64(d, 32));
+    return _mm_shuffle_epi8(x, _mm_setr_epi8(BASE32_X86_GATHER));
+}
+
+/* SSSE3：每次 10 字节 -> 16 字符 (需要可读 16 字节) */
+__attribute__((target("ssse3"))) static size_t base32_encode_ssse3(const uint8_t *src, size_t src_len, char *dst)
+{
+    const __m128i shuf0 = _mm_setr_epi8(BASE32_X86_SHUFFLE(0));
+    const __m128i shuf1 = _mm_setr_epi8(BASE32_X86_SHUFFLE(5));
+    const __m128i mul = _mm_setr_epi16(BASE32_X86_MULTIPLIERS);
+    const __m128i mask = _mm_set1_epi16(0x1F);
+    size_t i = 0, j = 0;
+
+    for (; i + 16 <= src_len; i += 10, j += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i a = _mm_and_si128(_mm_mulhi_epu16(_mm_shuffle_epi8(v, shuf0), mul), mask);
+        __m128i b = _mm_and_si128(_mm_mulhi_epu16(_mm_shuffle_epi8(v, shuf1), mul), mask);
+        _mm_storeu_si128((__m128i *)(dst + j), base32_ascii_ssse3(_mm_packus_epi16(a, b)));
+    }
+    return i;
+}
+
+/* SSSE3：每次 16 字符 -> 10 字节 */
+__attribute__((target("ssse3"))) static size_t base32_decode_ssse3(const char *src, size_t src_len, uint8_t *dst)
+{
+    size_t i = 0, j = 0;
+
+    for (; i + 16 <= src_len; i += 16, j += 10)
+    {
+        __m128i val;
+        if (!base32_value_ssse3(_mm_loadu_si128((const __m128i *)(src + i)), &val))
+            break;
+
+        __m128i out = base32_pack_ssse3(val);
+        // 精确写入 10 字节，避免越过调用者的缓冲区
+        uint16_t tail = (uint16_t)_mm_extract_epi16(out, 4);
+        _mm_storel_epi64((__m128i *)(dst + j), out);
+        memcpy(dst + j + 8, &tail, 2);
+    }
+    return i;
+}
+
+/* AVX2：每次 20 字节 -> 32 字符 (需要可读 26 字节) */
+__attribute__((target("avx2"))) static size_t base32_encode_avx2(const uint8_t *src, size_t src_len, char *dst)
+{
+    const __m256i shuf0 = _mm256_setr_epi8(BASE32_X86_SHUFFLE(0), BASE32_X86_SHUFFLE(0));
+    const __m256i shuf1 = _mm256_setr_epi8(BASE32_X86_SHUFFLE(5), BASE32_X86_SHUFFLE(5));
+    const __m256i mul = _mm256_setr_epi16(BASE32_X86_MULTIPLIERS, BASE32_X86_MULTIPLIERS);
+    const __m256i mask = _mm256_set1_epi16(0x1F);
+    size_t i = 0, j = 0;
+
+    for (; i + 26 <= src_len; i += 20, j += 32)
+    {
+        // 低通道处理第 0~9 字节，高通道处理第 10~19 字节
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + i))),
+            _mm_loadu_si128((const __m128i *)(src + i + 10)), 1);
+        __m256i a = _mm256_and_si256(_mm256_mulhi_epu16(_mm256_shuffle_epi8(v, shuf0), mul), mask);
+        __m256i b = _mm256_and_si256(_mm256_mulhi_epu16(_mm256_shuffle_epi8(v, shuf1), mul), mask);
+        __m256i idx = _mm256_packus_epi16(a, b);
+
+        __m256i fix = _mm256_and_si256(_mm256_cmpgt_epi8(idx, _mm256_set1_epi8(25)), _mm256_set1_epi8('A' - 24));
+        _mm256_storeu_si256((__m256i *)(dst + j),
+                            _mm256_sub_epi8(_mm256_add_epi8(idx, _mm256_set1_epi8('A')), fix));
+    }
+    return i;
+}
+
+/* AVX2：每次 32 字符 -> 20 字节 */
+__attribute__((target("avx2"))) static size_t base32_decode_avx2(const char *src, size_t src_len, uint8_t *dst)
+{
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    size_t i = 0, j = 0;
+
+    for (; i + 32 <= src_len; i += 32, j += 20)
+    {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, lower), _mm256_set1_epi8('a'));
+        __m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(25)), l);
+        __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('2'));
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(5)), d);
+
+        if (_mm256_movemask_epi8(_mm256_or_si256(is_alpha, is_digit)) != -1)
+            break;
+
+        __m256i val = _mm256_or_si256(_mm256_and_si256(is_alpha, l),
+                                      _mm256_and_si256(is_digit, _mm256_add_epi8(d, _mm256_set1_epi8(26))));
+        __m256i w = _mm256_maddubs_epi16(val, _mm256_set1_epi16(0x0120));
+        __m256i dw = _mm256_madd_epi16(w, _mm256_set1_epi32(0x00010400));
+        __m256i hi = _mm256_and_si256(_mm256_slli_epi64(dw, 20), _mm256_set1_epi64x(0xFFFFF00000LL));
+        __m256i x = _mm256_or_si256(hi, _mm256_srli_epi64(dw, 32));
+        __m256i out = _mm256_shuffle_epi8(x, _mm256_setr_epi8(BASE32_X86_GATHER, BASE32_X86_GATHER));
+
+        // 每个 128 位通道前 10 字节有效
+        __m128i lo = _mm256_castsi256_si128(out);
+        __m128i hi128 = _mm256_extracti128_si256(out, 1);
+        uint16_t tail = (uint16_t)_mm_extract_epi16(hi128, 4);
+        _mm_storeu_si128((__m128i *)(dst + j), lo); // 后 6 字节会被下一条写覆盖
+        _mm_storel_epi64((__m128i *)(dst + j + 10), hi128);
+        memcpy(dst + j + 18, &tail, 2);
+    }
+    return i;
+}
+
+#endif /* BASE32_HAVE_X86 */
+
+#ifdef BASE32_HAVE_NEON
+
+/* NEON：每次 10 字节 -> 16 字符 (需要可读 16 字节) */
+static size_t base32_encode_neon(const uint8_t *src, size_t src_len, char *dst)
+{
+    static const uint8_t shuf[2][16] = {
+        {1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, 5, 4},
+        {6, 5, 6, 5, 7, 6, 7, 6, 8, 7, 9, 8, 9, 8, 10, 9}};
+    // NEON 支持按通道可变移位，负数表示右移
+    static const int16_t shift[8] = {-11, -6, -9, -4, -7, -10, -5, -8};
+    const uint8x16_t shuf0 = vld1q_u8(shuf[0]);
+    const uint8x16_t shuf1 = vld1q_u8(shuf[1]);
+    const int16x8_t sh = vld1q_s16(shift);
+    const uint16x8_t mask = vdupq_n_u16(0x1F);
+    size_t i = 0, j = 0;
+
+    for (; i + 16 <= src_len; i += 10, j += 16)
+    {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t a = vandq_u16(vshlq_u16(vreinterpretq_u16_u8(vqtbl1q_u8(v, shuf0)), sh), mask);
+        uint16x8_t b = vandq_u16(vshlq_u16(vreinterpretq_u16_u8(vqtbl1q_u8(v, shuf1)), sh), mask);
+        uint8x16_t idx = vcombine_u8(vmovn_u16(a), vmovn_u16(b));
+        uint8x16_t fix = vandq_u8(vcgtq_u8(idx, vdupq_n_u8(25)), vdupq_n_u8('A' - 24));
+        vst1q_u8((uint8_t *)(dst + j), vsubq_u8(vaddq_u8(idx, vdupq_n_u8('A')), fix));
+    }
+    return i;
+}
+
+/* NEON：每次 16 字符 -> 10 字节 */
+static size_t base32_decode_neon(const char *src, size_t src_len, uint8_t *dst)
+{
+    static const uint8_t gather[16] = {4, 3, 2, 1, 0, 12, 11, 10, 9, 8, 255, 255, 255, 255, 255, 255};
+    const uint8x16_t g = vld1q_u8(gather);
+    size_t i = 0, j = 0;
+
+    for (; i + 16 <= src_len; i += 16, j += 10)
+    {
+        uint8x16_t c = vld1q_u8((const uint8_t *)(src + i));
+        uint8x16_t l = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+        uint8x16_t is_alpha = vcleq_u8(l, vdupq_n_u8(25));
+        uint8x16_t d = vsubq_u8(c, vdupq_n_u8('2'));
+        uint8x16_t is_digit = vcleq_u8(d, vdupq_n_u8(5));
+
+        if (vminvq_u8(vorrq_u8(is_alpha, is_digit)) != 0xFF)
+            break;
+
+        uint8x16_t val = vorrq_u8(vandq_u8(is_alpha, l), vandq_u8(is_digit, vaddq_u8(d, vdupq_n_u8(26))));
+        // 逐级合并：5bit x2 -> 10bit，10bit x2 -> 20bit，20bit x2 -> 40bit
+        uint16x8_t w = vreinterpretq_u16_u8(val);
+        w = vorrq_u16(vshlq_n_u16(vandq_u16(w, vdupq_n_u16(0xFF)), 5), vshrq_n_u16(w, 8));
+        uint32x4_t dw = vreinterpretq_u32_u16(w);
+        dw = vorrq_u32(vshlq_n_u32(vandq_u32(dw, vdupq_n_u32(0xFFFF)), 10), vshrq_n_u32(dw, 16));
+        uint64x2_t x = vreinterpretq_u64_u32(dw);
+        x = vorrq_u64(vshlq_n_u64(vandq_u64(x, vdupq_n_u64(0xFFFFFFFFULL)), 20), vshrq_n_u64(x, 32));
+        uint8x16_t out = vqtbl1q_u8(vreinterpretq_u8_u64(x), g);
+
+        uint16_t tail = vgetq_lane_u16(vreinterpretq_u16_u8(out), 4);
+        vst1_u8(dst + j, vget_low_u8(out));
+        memcpy(dst + j + 8, &tail, 2);
+    }
+    return i;
+}
+
+#endif /* BASE32_HAVE_NEON */
+
+/* ============================================================
+ * 运行时分发
+ * 内核组合是只读的常量表，只有 x86 需要在首次调用时按 CPU 特性选择：
+ * 选择结果以一个指针发布 (__atomic 获取/释放)，多个线程同时首次调用时各自算出同一个表，
+ * 重复写入同一个值，不需要加锁。其他平台在编译时确定，没有可写的全局状态。
+ * ============================================================ */
+
+typedef struct
+{
+    base32_enc_kernel_t enc;
+    base32_dec_kernel_t dec;
+    const char *name;
+} base32_kernels_t;
+
+static const base32_kernels_t base32_kernels_scalar = {base32_encode_none, base32_decode_none, "scalar"};
+
+#if defined(BASE32_HAVE_X86)
+static const base32_kernels_t base32_kernels_avx2 = {base32_encode_avx2, base32_decode_avx2, "avx2"};
+static const base32_kernels_t base32_kernels_ssse3 = {base32_encode_ssse3, base32_decode_ssse3, "ssse3"};
+
+static const base32_kernels_t *base32_kernels(void)
+{
+    static const base32_kernels_t *selected = NULL;
+
+    const base32_kernels_t *k = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (k == NULL)
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            k = &base32_kernels_avx2;
+        else if (__builtin_cpu_supports("ssse3"))
+            k = &base32_kernels_ssse3;
+        else
+            k = &base32_kernels_scalar;
+        __atomic_store_n(&selected, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+#elif defined(BASE32_HAVE_NEON)
+static const base32_kernels_t base32_kernels_neon = {base32_encode_neon, base32_decode_neon, "neon"};
+
+static const base32_kernels_t *base32_kernels(void)
+{
+    return &base32_kernels_neon;
+}
+#else
+static const base32_kernels_t *base32_kernels(void)
+{
+    return &base32_kernels_scalar;
+}
+#endif
+
+const char *base32_kernel_name(void)
+{
+    return base32_kernels()->name;
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+int base32_encode(const uint8_t *src, size_t src_len, char *dst, size_t dst_size)
+{
+    size_t needed_len = BASE32_ENCODE_OUT_SIZE(src_len);
+    if (dst_size < needed_len)
+    {
+        return -1; // 缓冲区不足
+    }
+
+    // 加速内核处理的长度总是 5 的倍数，输出刚好是整组字符
+    size_t i = base32_kernels()->enc(src, src_len, dst);
+    size_t j = (i / 5) * 8;
+
+    // 每次处理 5 个字节
+    while (i + 4 < src_len)
+    {
+        uint64_t group = ((uint64_t)src[i] << 32) | ((uint64_t)src[i + 1] << 24) |
+                         ((uint64_t)src[i + 2] << 16) | ((uint64_t)src[i + 3] << 8) |
+                         (uint64_t)src[i + 4];
+        int k;
+        for (k = 0; k < 8; k++)
+            dst[j++] = base32_table[(group >> (35 - 5 * k)) & 0x1F];
+        i += 5;
+    }
+
+    // 处理剩余的字节 (1~4 个)
+    if (i < src_len)
+    {
+        // 剩余 1/2/3/4 字节分别输出 2/4/5/7 个有效字符，其余补 '='
+        static const uint8_t chars_for_rest[5] = {0, 2, 4, 5, 7};
+        size_t rest = src_len - i;
+        uint64_t group = 0;
+        size_t k;
+
+        for (k = 0; k < 5; k++)
+        {
+            group <<= 8;
+            if (k < rest)
+                group |= src[i + k];
+        }
+
+        for (k = 0; k < 8; k++)
+        {
+            if (k < chars_for_rest[rest])
+                dst[j++] = base32_table[(group >> (35 - 5 * k)) & 0x1F];
+            else
+                dst[j++] = '=';
+        }
+    }
+
+    dst[j] = '\0'; // 始终添加 null 结尾
+    return (int)j;
+}
+
+int base32_decode(const char *src, size_t src_len, uint8_t *dst, size_t dst_size)
+{
+    // 长度检查：Base32 编码后的长度必须是 8 的倍数
+    if (src_len % 8 != 0)
+    {
+        return -1;
+    }
+
+    if (dst_size < BASE32_DECODE_OUT_SIZE(src_len))
+    {
+        return -1; // 缓冲区可能不足
+    }
+
+    if (src_len == 0)
+        return 0;
+
+    // 最后一组可能带 '=' 填充，不交给加速内核
+    size_t i = base32_kernels()->dec(src, src_len - 8, dst);
+    size_t j = (i / 8) * 5;
+
+    while (i < src_len)
+    {
+        uint64_t group = 0;
+        size_t valid = 0;
+        size_t k;
+
+        // 读取 8 个字符，遇到 '=' 即视为填充开始
+        for (k = 0; k < 8; k++)
+        {
+            uint8_t c = (uint8_t)src[i + k];
+            if (c == '=')
+                break;
+            uint8_t v = decoding_table[c];
+            if (v == 0xFF)
+                return -1;
+            group = (group << 5) | v;
+            valid++;
+        }
+
+        if (valid < 8)
+        {
+            // 填充只能出现在最后一组，且必须连续到组尾
+            if (i + 8 != src_len)
+                return -1;
+            for (k = valid; k < 8; k++)
+            {
+                if (src[i + k] != '=')
+                    return -1;
+            }
+        }
+
+        // 有效字符数 -> 字节数 (2->1, 4->2, 5->3, 7->4, 8->5)，其他数量非法
+        static const int8_t bytes_for_chars[9] = {-1, -1, 1, -1, 2, 3, -1, 4, 5};
+        int8_t nbytes = bytes_for_chars[valid];
+        if (nbytes < 0)
+            return -1;
+
+        group <<= 5 * (8 - valid); // 左对齐到 40 bit
+        for (k = 0; k < (size_t)nbytes; k++)
+            dst[j++] = (uint8_t)(group >> (32 - 8 * k));
+
+        i += 8;
+    }
+
+    return (int)j;
+}
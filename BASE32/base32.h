@@ -0,0 +1,70 @@
+/*
+ * base32.h
+ * 无动态内存分配的 Base32 编解码库 (C99)
+ * 标量实现 + SSSE3 / AVX2 / NEON 加速内核，运行时自动选择
+ */
+
+#ifndef BASE32_H
+#define BASE32_H
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint8_t
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * === 辅助宏：计算缓冲区大小 ===
+ * 用于在声明数组时确定所需的最小长度。
+ */
+
+// 计算编码 N 字节数据所需的缓冲区大小 (包含结尾的 NULL)
+// 公式: 8 * ceil(N / 5) + 1
+#define BASE32_ENCODE_OUT_SIZE(n) ((((n) + 4) / 5) * 8 + 1)
+
+// 计算解码 N 字节 Base32 字符串所需的最大缓冲区大小
+// 公式: 5 * (N / 8)
+#define BASE32_DECODE_OUT_SIZE(n) (((n) / 8) * 5)
+
+/*
+ * === 编译开关 ===
+ * 定义 BASE32_NO_SIMD 可强制只使用标量实现 (例如调试或对比性能时)。
+ */
+
+/*
+ * === API 函数声明 ===
+ */
+
+/**
+ * @brief Base32 编码 (RFC 4648 标准字母表 "A-Z2-7"，不足 8 字符用 '=' 补齐)
+ * * @param src       [in] 输入的二进制数据
+ * @param src_len   [in] 输入数据的长度 (字节数)
+ * @param dst       [out] 输出缓冲区 (必须足够大)
+ * @param dst_size  [in] 输出缓冲区的大小 (使用 BASE32_ENCODE_OUT_SIZE 计算)
+ * @return int      成功返回编码后的字符串长度(不含NULL)，失败返回 -1 (缓冲区不足)
+ */
+int base32_encode(const uint8_t *src, size_t src_len, char *dst, size_t dst_size);
+
+/**
+ * @brief Base32 解码 (字母大小写均可识别，便于人工输入的配网码)
+ * * @param src       [in] 输入的 Base32 字符串
+ * @param src_len   [in] 输入字符串的长度 (必须是 8 的倍数)
+ * @param dst       [out] 输出缓冲区 (用于存放二进制数据)
+ * @param dst_size  [in] 输出缓冲区的大小 (使用 BASE32_DECODE_OUT_SIZE 计算)
+ * @return int      成功返回解码后的字节数，失败返回 -1 (格式错误或缓冲区不足)
+ */
+int base32_decode(const char *src, size_t src_len, uint8_t *dst, size_t dst_size);
+
+/**
+ * @brief 查询当前运行时选中的加速内核名称
+ * @return "avx2" / "ssse3" / "neon" / "scalar"
+ */
+const char *base32_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BASE32_H
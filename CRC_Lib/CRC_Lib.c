@@ -103,8 +103,13 @@ uint8_t CRC8_Cal(const uint8_t *pchMsg, uint16_t wDataLen)
 
 uint16_t Modbus_CRC16_Cal(const uint8_t *pchMsg, uint16_t wDataLen)
 {
-    uint8_t chCRCHi = 0xFF; // Modbus 初始值 0xFFFF
-    uint8_t chCRCLo = 0xFF;
+    return Modbus_CRC16_Update(0xFFFF, pchMsg, wDataLen); // Modbus 初始值 0xFFFF
+}
+
+uint16_t Modbus_CRC16_Update(uint16_t wCRC, const uint8_t *pchMsg, uint16_t wDataLen)
+{
+    uint8_t chCRCHi = (uint8_t)(wCRC >> 8); // 从上一段的结果继续
+    uint8_t chCRCLo = (uint8_t)wCRC;
     uint16_t wIndex;
 
     while (wDataLen--)
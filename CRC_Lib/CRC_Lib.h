@@ -27,6 +27,15 @@ uint8_t CRC8_Cal(const uint8_t *pchMsg, uint16_t wDataLen);
     */
 uint16_t Modbus_CRC16_Cal(const uint8_t *pchMsg, uint16_t wDataLen);
 
+/* * ============================================================
+    * Modbus CRC16 分段计算
+    * ============================================================
+    * 在上一段的结果 wCRC 上继续计算 (首段传入 0xFFFF)，
+    * 用于数据分散在多个缓冲区中的场景 (如报文头 + 数据体)
+    * Modbus_CRC16_Cal(p, n) 等价于 Modbus_CRC16_Update(0xFFFF, p, n)
+    */
+uint16_t Modbus_CRC16_Update(uint16_t wCRC, const uint8_t *pchMsg, uint16_t wDataLen);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,523 @@
+/**
+ * @file cbor.c
+ * @brief CBOR 子集流式编解码逻辑实现
+ */
+
+#include "cbor.h"
+#include <string.h> /* 用于 memcpy / strlen */
+#include <float.h>  /* 用于 FLT_MAX / DBL_MAX */
+
+/* 主类型 (初始字节高 3 位) */
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NEGINT 1
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+
+/* 主类型 7 的附加信息 */
+#define CBOR_SIMPLE_FALSE 20
+#define CBOR_SIMPLE_TRUE 21
+#define CBOR_SIMPLE_NULL 22
+#define CBOR_AI_HALF 25
+#define CBOR_AI_FLOAT 26
+#define CBOR_AI_DOUBLE 27
+#define CBOR_AI_INDEFINITE 31
+
+/* 半精度 NaN */
+#define CBOR_HALF_NAN 0x7E00
+
+/* ==========================================
+ * 编码
+ * ========================================== */
+
+/**
+ * @brief 内部函数：预留 n 字节，不足时置 overflow 并返回 NULL
+ */
+static inline uint8_t *_cbor_reserve(cbor_writer_t *w, size_t n)
+{
+    if (w->overflow || w->size - w->len < n)
+    {
+        w->overflow = true;
+        return NULL;
+    }
+    uint8_t *p = &w->buf[w->len];
+    w->len += n;
+    return p;
+}
+
+/**
+ * @brief 内部函数：按最短形式写入 主类型 + 参数 (整数值、长度、个数、标签号)
+ */
+static bool _cbor_head(cbor_writer_t *w, uint8_t major, uint64_t v)
+{
+    uint8_t *p;
+    major = (uint8_t)(major << 5);
+
+    if (v < 24)
+    {
+        if ((p = _cbor_reserve(w, 1)) == NULL)
+            return false;
+        p[0] = (uint8_t)(major | v);
+    }
+    else if (v <= 0xFF)
+    {
+        if ((p = _cbor_reserve(w, 2)) == NULL)
+            return false;
+        p[0] = major | 24;
+        p[1] = (uint8_t)v;
+    }
+    else if (v <= 0xFFFF)
+    {
+        if ((p = _cbor_reserve(w, 3)) == NULL)
+            return false;
+        p[0] = major | 25;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)v;
+    }
+    else if (v <= 0xFFFFFFFFu)
+    {
+        if ((p = _cbor_reserve(w, 5)) == NULL)
+            return false;
+        p[0] = major | 26;
+        for (int i = 0; i < 4; i++)
+            p[1 + i] = (uint8_t)(v >> (24 - 8 * i));
+    }
+    else
+    {
+        if ((p = _cbor_reserve(w, 9)) == NULL)
+            return false;
+        p[0] = major | 27;
+        for (int i = 0; i < 8; i++)
+            p[1 + i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+    return true;
+}
+
+/**
+ * @brief 内部函数：写入头部 + 原始内容 (字节串 / 字符串)
+ */
+static bool _cbor_string(cbor_writer_t *w, uint8_t major, const void *data, size_t len)
+{
+    if (!_cbor_head(w, major, len))
+        return false;
+    uint8_t *p = _cbor_reserve(w, len);
+    if (!p)
+        return false;
+    if (len > 0)
+        memcpy(p, data, len);
+    return true;
+}
+
+/**
+ * @brief 内部函数：单精度位模式能否无损表示为半精度
+ * @note  半精度：1 位符号、5 位指数 (偏移 15)、10 位尾数，指数 -14 以下为非规格化数
+ */
+static bool _cbor_float_to_half(uint32_t f, uint16_t *h)
+{
+    uint16_t sign = (uint16_t)((f >> 16) & 0x8000);
+    int32_t exp = (int32_t)((f >> 23) & 0xFF);
+    uint32_t mant = f & 0x7FFFFF;
+
+    if (exp == 0xFF) /* 无穷大 / NaN */
+    {
+        *h = mant ? CBOR_HALF_NAN : (uint16_t)(sign | 0x7C00);
+        return true;
+    }
+    if (exp == 0) /* 0 (单精度非规格化数小于半精度的最小值) */
+    {
+        *h = sign;
+        return mant == 0;
+    }
+
+    int32_t e = exp - 127;
+    if (e > 15 || e < -24)
+        return false;
+
+    if (e >= -14) /* 半精度规格化数：尾数低 13 位必须为 0 */
+    {
+        if (mant & 0x1FFF)
+            return false;
+        *h = (uint16_t)(sign | ((uint32_t)(e + 15) << 10) | (mant >> 13));
+        return true;
+    }
+
+    /* 半精度非规格化数：值 = m * 2^-24，移出的位必须为 0 */
+    uint32_t full = mant | 0x800000;
+    uint32_t shift = (uint32_t)(-(e + 1));
+    if (full & ((1u << shift) - 1))
+        return false;
+    *h = (uint16_t)(sign | (full >> shift));
+    return true;
+}
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = buf ? size : 0;
+    w->len = 0;
+    w->overflow = false;
+}
+
+bool cbor_put_uint(cbor_writer_t *w, uint64_t v)
+{
+    return _cbor_head(w, CBOR_MAJOR_UINT, v);
+}
+
+bool cbor_put_int(cbor_writer_t *w, int64_t v)
+{
+    /* 负数 n 编码为 -1 - n，INT64_MIN 也不会溢出 */
+    if (v < 0)
+        return _cbor_head(w, CBOR_MAJOR_NEGINT, (uint64_t)(-1 - v));
+    return _cbor_head(w, CBOR_MAJOR_UINT, (uint64_t)v);
+}
+
+bool cbor_put_bytes(cbor_writer_t *w, const void *data, size_t len)
+{
+    return _cbor_string(w, CBOR_MAJOR_BYTES, data, len);
+}
+
+bool cbor_put_text(cbor_writer_t *w, const char *s, size_t len)
+{
+    return _cbor_string(w, CBOR_MAJOR_TEXT, s, len);
+}
+
+bool cbor_put_str(cbor_writer_t *w, const char *s)
+{
+    return _cbor_string(w, CBOR_MAJOR_TEXT, s, strlen(s));
+}
+
+bool cbor_put_bool(cbor_writer_t *w, bool v)
+{
+    return _cbor_head(w, CBOR_MAJOR_SIMPLE, v ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+}
+
+bool cbor_put_null(cbor_writer_t *w)
+{
+    return _cbor_head(w, CBOR_MAJOR_SIMPLE, CBOR_SIMPLE_NULL);
+}
+
+bool cbor_put_tag(cbor_writer_t *w, uint64_t tag)
+{
+    return _cbor_head(w, CBOR_MAJOR_TAG, tag);
+}
+
+bool cbor_put_float(cbor_writer_t *w, float v)
+{
+    uint32_t bits;
+    uint16_t half;
+    uint8_t *p;
+    memcpy(&bits, &v, sizeof(bits));
+
+    if (_cbor_float_to_half(bits, &half))
+    {
+        if ((p = _cbor_reserve(w, 3)) == NULL)
+            return false;
+        p[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_AI_HALF;
+        p[1] = (uint8_t)(half >> 8);
+        p[2] = (uint8_t)half;
+        return true;
+    }
+
+    if ((p = _cbor_reserve(w, 5)) == NULL)
+        return false;
+    p[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_AI_FLOAT;
+    for (int i = 0; i < 4; i++)
+        p[1 + i] = (uint8_t)(bits >> (24 - 8 * i));
+    return true;
+}
+
+bool cbor_put_double(cbor_writer_t *w, double v)
+{
+    /* NaN、无穷大、以及转换为单精度后不丢精度的值 (先判断范围，超出 float 范围的有限值转换是未定义行为) */
+    if (v != v || v > DBL_MAX || v < -DBL_MAX)
+        return cbor_put_float(w, (float)v);
+    if (v <= FLT_MAX && v >= -FLT_MAX && (double)(float)v == v)
+        return cbor_put_float(w, (float)v);
+
+    uint64_t bits;
+    uint8_t *p;
+    memcpy(&bits, &v, sizeof(bits));
+    if ((p = _cbor_reserve(w, 9)) == NULL)
+        return false;
+    p[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_AI_DOUBLE;
+    for (int i = 0; i < 8; i++)
+        p[1 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    return true;
+}
+
+bool cbor_put_array(cbor_writer_t *w, uint32_t count)
+{
+    return _cbor_head(w, CBOR_MAJOR_ARRAY, count);
+}
+
+bool cbor_put_map(cbor_writer_t *w, uint32_t count)
+{
+    return _cbor_head(w, CBOR_MAJOR_MAP, count);
+}
+
+/* ==========================================
+ * 解码
+ * ========================================== */
+
+/**
+ * @brief 内部函数：半精度转双精度
+ */
+static double _cbor_half_to_double(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F;
+    uint32_t mant = h & 0x3FF;
+    uint32_t bits;
+    float f;
+
+    if (exp == 0) /* 0 与非规格化数：m * 2^-24，双精度可精确表示 */
+    {
+        double v = (double)mant / 16777216.0;
+        return sign ? -v : v;
+    }
+    if (exp == 31) /* 无穷大 / NaN */
+        bits = sign | 0x7F800000 | (mant << 13);
+    else
+        bits = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void cbor_reader_init(cbor_reader_t *r, const uint8_t *buf, size_t len)
+{
+    r->buf = buf;
+    r->len = buf ? len : 0;
+    r->pos = 0;
+}
+
+int cbor_next(cbor_reader_t *r, cbor_item_t *item)
+{
+    if (r->pos >= r->len)
+        return CBOR_END;
+
+    const uint8_t *p = &r->buf[r->pos];
+    size_t avail = r->len - r->pos;
+    uint8_t major = p[0] >> 5;
+    uint8_t ai = p[0] & 0x1F;
+    uint64_t v;
+    size_t n = 1;
+
+    // 1. 参数：附加信息 < 24 直接为值，24~27 后跟 1/2/4/8 字节大端整数
+    if (ai < 24)
+    {
+        v = ai;
+    }
+    else if (ai <= 27)
+    {
+        size_t width = (size_t)1 << (ai - 24);
+        if (avail - 1 < width)
+            return CBOR_ERR_MALFORMED;
+        v = 0;
+        for (size_t i = 0; i < width; i++)
+            v = (v << 8) | p[1 + i];
+        n += width;
+    }
+    else if (ai == CBOR_AI_INDEFINITE && major >= CBOR_MAJOR_BYTES && major <= CBOR_MAJOR_MAP)
+    {
+        return CBOR_ERR_UNSUPPORTED;
+    }
+    else
+    {
+        return CBOR_ERR_MALFORMED; /* 28~30 保留；31 对其他主类型无意义 (含单独出现的 break) */
+    }
+
+    item->value = v;
+    item->data = NULL;
+    item->f = 0.0;
+
+    // 2. 按主类型解释参数
+    switch (major)
+    {
+    case CBOR_MAJOR_UINT:
+        item->type = CBOR_TYPE_UINT;
+        break;
+    case CBOR_MAJOR_NEGINT:
+        item->type = CBOR_TYPE_NEGINT;
+        break;
+    case CBOR_MAJOR_BYTES:
+    case CBOR_MAJOR_TEXT:
+        if (v > avail - n)
+            return CBOR_ERR_MALFORMED;
+        item->type = (major == CBOR_MAJOR_BYTES) ? CBOR_TYPE_BYTES : CBOR_TYPE_TEXT;
+        item->data = p + n;
+        n += (size_t)v;
+        break;
+    case CBOR_MAJOR_ARRAY:
+        item->type = CBOR_TYPE_ARRAY;
+        break;
+    case CBOR_MAJOR_MAP:
+        item->type = CBOR_TYPE_MAP;
+        break;
+    case CBOR_MAJOR_TAG:
+        item->type = CBOR_TYPE_TAG;
+        break;
+    default: /* CBOR_MAJOR_SIMPLE */
+        if (ai == CBOR_AI_HALF)
+        {
+            item->type = CBOR_TYPE_FLOAT;
+            item->f = _cbor_half_to_double((uint16_t)v);
+        }
+        else if (ai == CBOR_AI_FLOAT)
+        {
+            uint32_t bits = (uint32_t)v;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            item->type = CBOR_TYPE_FLOAT;
+            item->f = f;
+        }
+        else if (ai == CBOR_AI_DOUBLE)
+        {
+            item->type = CBOR_TYPE_FLOAT;
+            memcpy(&item->f, &v, sizeof(item->f));
+        }
+        else if (ai == 24 && v < 32)
+        {
+            return CBOR_ERR_MALFORMED; /* 两字节形式的简单值必须 >= 32 */
+        }
+        else if (v == CBOR_SIMPLE_FALSE || v == CBOR_SIMPLE_TRUE)
+        {
+            item->type = CBOR_TYPE_BOOL;
+            item->value = (v == CBOR_SIMPLE_TRUE);
+        }
+        else if (v == CBOR_SIMPLE_NULL)
+        {
+            item->type = CBOR_TYPE_NULL;
+        }
+        else
+        {
+            item->type = CBOR_TYPE_SIMPLE;
+        }
+        break;
+    }
+
+    r->pos += n;
+    return CBOR_OK;
+}
+
+int cbor_skip(cbor_reader_t *r, const cbor_item_t *item)
+{
+    // 待读取的子项数：数组 n 个、映射 2n 个、标签 1 个，读到容器时累加它的子项
+    uint64_t pending;
+    switch (item->type)
+    {
+    case CBOR_TYPE_ARRAY:
+        pending = item->value;
+        break;
+    case CBOR_TYPE_MAP:
+        if (item->value > r->len)
+            return CBOR_ERR_MALFORMED;
+        pending = item->value * 2;
+        break;
+    case CBOR_TYPE_TAG:
+        pending = 1;
+        break;
+    default:
+        return CBOR_OK;
+    }
+
+    while (pending > 0)
+    {
+        /* 每个数据项至少 1 字节，剩余数据不够时提前判定为截断 (也防止伪造的巨大个数) */
+        if (pending > r->len - r->pos)
+            return CBOR_ERR_MALFORMED;
+
+        cbor_item_t child;
+        int rc = cbor_next(r, &child);
+        if (rc != CBOR_OK)
+            return (rc == CBOR_END) ? CBOR_ERR_MALFORMED : rc;
+        pending--;
+
+        if (child.type == CBOR_TYPE_ARRAY || child.type == CBOR_TYPE_MAP)
+        {
+            if (child.value > r->len)
+                return CBOR_ERR_MALFORMED;
+            pending += (child.type == CBOR_TYPE_MAP) ? child.value * 2 : child.value;
+        }
+        else if (child.type == CBOR_TYPE_TAG)
+        {
+            pending++;
+        }
+    }
+    return CBOR_OK;
+}
+
+int cbor_map_find(const cbor_reader_t *r, const cbor_item_t *map, const char *key,
+                  cbor_item_t *value, cbor_reader_t *after)
+{
+    if (map->type != CBOR_TYPE_MAP)
+        return CBOR_ERR_MALFORMED;
+
+    cbor_reader_t m = *r;
+    for (uint64_t i = 0; i < map->value; i++)
+    {
+        cbor_item_t k;
+        int rc = cbor_next(&m, &k);
+        if (rc == CBOR_OK)
+            rc = cbor_skip(&m, &k);
+        if (rc == CBOR_OK)
+            rc = cbor_next(&m, value);
+        if (rc != CBOR_OK)
+            return (rc == CBOR_END) ? CBOR_ERR_MALFORMED : rc;
+
+        if (cbor_text_equals(&k, key))
+        {
+            if (after)
+                *after = m;
+            return CBOR_OK;
+        }
+
+        if ((rc = cbor_skip(&m, value)) != CBOR_OK)
+            return rc;
+    }
+    return CBOR_END;
+}
+
+bool cbor_get_int(const cbor_item_t *item, int64_t *v)
+{
+    if ((item->type != CBOR_TYPE_UINT && item->type != CBOR_TYPE_NEGINT) || item->value > (uint64_t)INT64_MAX)
+        return false;
+    *v = (item->type == CBOR_TYPE_UINT) ? (int64_t)item->value : -1 - (int64_t)item->value;
+    return true;
+}
+
+bool cbor_get_double(const cbor_item_t *item, double *v)
+{
+    switch (item->type)
+    {
+    case CBOR_TYPE_FLOAT:
+        *v = item->f;
+        return true;
+    case CBOR_TYPE_UINT:
+        *v = (double)item->value;
+        return true;
+    case CBOR_TYPE_NEGINT:
+        *v = -1.0 - (double)item->value;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool cbor_text_equals(const cbor_item_t *item, const char *s)
+{
+    if (item->type != CBOR_TYPE_TEXT)
+        return false;
+
+    /* 逐字节比较，第一个不同的字节即返回 (按键名分派时多数比较在首字节结束) */
+    size_t len = (size_t)item->value;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (s[i] == '\0' || (uint8_t)s[i] != item->data[i])
+            return false;
+    }
+    return s[len] == '\0';
+}
@@ -0,0 +1,183 @@
+/**
+ * @file cbor.h
+ * @brief CBOR (RFC 8949) 子集流式编解码对外接口头文件 (C99标准)
+ * @details 核心特性：
+ * 1. 编码器直接写入调用者提供的缓冲区 (MQTT 发布模板的 Payload 区、环形缓冲区的连续空间等)，不分配内存。
+ * 2. 解码器是一个游标：每次 cbor_next 读出一个数据项的头部，字符串/字节串指向原缓冲区，不复制、不建树。
+ * 3. 整数、长度按最短形式编码；浮点数在不丢精度时自动缩短为半精度 / 单精度。
+ * 4. 只支持定长的字符串、数组和映射 (不支持不定长编码)，足以覆盖遥测类 Payload。
+ */
+
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdint.h>  // 包含 uint64_t 等类型
+#include <stdbool.h> // 包含 bool 类型
+#include <stddef.h>  // 包含 size_t 定义
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================
+ * 返回值
+ * ========================================== */
+
+#define CBOR_OK 0                /* 成功 */
+#define CBOR_END (-1)            /* 已读到数据末尾 */
+#define CBOR_ERR_MALFORMED (-2)  /* 格式错误或数据被截断 */
+#define CBOR_ERR_UNSUPPORTED (-3) /* 不支持的编码 (不定长字符串、数组、映射) */
+
+/* ==========================================
+ * 类型定义
+ * ========================================== */
+
+/**
+ * @brief 编码器 (写入过程中出错后不再写入，最后检查一次 overflow 即可)
+ */
+typedef struct
+{
+    uint8_t *buf;  /* 输出缓冲区 */
+    size_t size;   /* 缓冲区大小 */
+    size_t len;    /* 已写入的字节数 */
+    bool overflow; /* 缓冲区不足 (之后的写入全部被忽略) */
+} cbor_writer_t;
+
+/**
+ * @brief 数据项类型
+ */
+typedef enum
+{
+    CBOR_TYPE_UINT,   /* 非负整数：value */
+    CBOR_TYPE_NEGINT, /* 负整数：实际值为 -1 - value */
+    CBOR_TYPE_BYTES,  /* 字节串：data / value 为长度 */
+    CBOR_TYPE_TEXT,   /* UTF-8 字符串：data / value 为长度 (不以 0 结尾，未校验 UTF-8) */
+    CBOR_TYPE_ARRAY,  /* 数组：value 为元素个数，元素紧随其后 */
+    CBOR_TYPE_MAP,    /* 映射：value 为键值对个数，键、值交替紧随其后 */
+    CBOR_TYPE_TAG,    /* 标签：value 为标签号，被标记的数据项紧随其后 */
+    CBOR_TYPE_BOOL,   /* 布尔：value 为 0 / 1 */
+    CBOR_TYPE_NULL,   /* null */
+    CBOR_TYPE_SIMPLE, /* 其他简单值 (含 undefined)：value 为简单值编号 */
+    CBOR_TYPE_FLOAT   /* 半精度 / 单精度 / 双精度浮点数：f */
+} cbor_type_t;
+
+/**
+ * @brief 一个数据项的头部 (cbor_next 填充)
+ */
+typedef struct
+{
+    cbor_type_t type;
+    uint64_t value;      /* 整数值、长度、元素个数、标签号或简单值，见 cbor_type_t */
+    const uint8_t *data; /* 字节串 / 字符串内容 (指向输入缓冲区) */
+    double f;            /* 浮点数值 */
+} cbor_item_t;
+
+/**
+ * @brief 解码游标
+ */
+typedef struct
+{
+    const uint8_t *buf; /* 输入数据 */
+    size_t len;         /* 数据长度 */
+    size_t pos;         /* 下一个数据项的位置 */
+} cbor_reader_t;
+
+/* ==========================================
+ * 编码
+ * ========================================== */
+
+/**
+ * @brief 初始化编码器
+ * @param w [出参] 编码器
+ * @param buf [入参] 输出缓冲区 (可以是发布模板的 Payload 区或环形缓冲区的连续空间)
+ * @param size [入参] 缓冲区大小
+ */
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size);
+
+/* 以下写入函数返回 false 表示缓冲区不足 (此后的写入都会失败) */
+
+bool cbor_put_uint(cbor_writer_t *w, uint64_t v);
+bool cbor_put_int(cbor_writer_t *w, int64_t v);
+bool cbor_put_bytes(cbor_writer_t *w, const void *data, size_t len);
+bool cbor_put_text(cbor_writer_t *w, const char *s, size_t len);
+bool cbor_put_str(cbor_writer_t *w, const char *s); /* 以 0 结尾的字符串 */
+bool cbor_put_bool(cbor_writer_t *w, bool v);
+bool cbor_put_null(cbor_writer_t *w);
+bool cbor_put_tag(cbor_writer_t *w, uint64_t tag); /* 之后写入被标记的数据项 */
+
+/**
+ * @brief 写入浮点数：能无损表示为半精度时写 3 字节，否则写 5 字节单精度 (NaN 统一为半精度 NaN)
+ */
+bool cbor_put_float(cbor_writer_t *w, float v);
+
+/**
+ * @brief 写入双精度浮点数：能无损缩短时按 cbor_put_float 写入，否则写 9 字节
+ */
+bool cbor_put_double(cbor_writer_t *w, double v);
+
+/**
+ * @brief 写入数组头，之后依次写入 count 个元素
+ */
+bool cbor_put_array(cbor_writer_t *w, uint32_t count);
+
+/**
+ * @brief 写入映射头，之后依次写入 count 组 键、值
+ */
+bool cbor_put_map(cbor_writer_t *w, uint32_t count);
+
+/* ==========================================
+ * 解码
+ * ========================================== */
+
+/**
+ * @brief 初始化解码游标
+ */
+void cbor_reader_init(cbor_reader_t *r, const uint8_t *buf, size_t len);
+
+/**
+ * @brief 读出下一个数据项的头部
+ * @note  字符串 / 字节串的内容一并跳过；数组、映射、标签只读出头部，游标停在其第一个子项上
+ * @return CBOR_OK / CBOR_END / CBOR_ERR_MALFORMED / CBOR_ERR_UNSUPPORTED
+ */
+int cbor_next(cbor_reader_t *r, cbor_item_t *item);
+
+/**
+ * @brief 跳过刚读出的数据项的全部子项 (数组、映射、标签)，其他类型不移动游标
+ * @note  迭代实现，不递归，嵌套深度不受栈限制
+ * @return CBOR_OK / CBOR_ERR_MALFORMED / CBOR_ERR_UNSUPPORTED
+ */
+int cbor_skip(cbor_reader_t *r, const cbor_item_t *item);
+
+/**
+ * @brief 在映射中按字符串键查找值
+ * @param r [入参] 游标，位于映射头之后 (刚对映射调用过 cbor_next)；本函数不移动它
+ * @param map [入参] 映射头
+ * @param key [入参] 以 0 结尾的键
+ * @param value [出参] 值的头部
+ * @param after [出参] 可为 NULL：位于值的头部之后的游标 (值为数组、映射时可继续读取其子项)
+ * @return CBOR_OK; CBOR_END 未找到; 其他为格式错误
+ */
+int cbor_map_find(const cbor_reader_t *r, const cbor_item_t *map, const char *key,
+                  cbor_item_t *value, cbor_reader_t *after);
+
+/**
+ * @brief 取整数值 (UINT / NEGINT，超出 int64_t 范围时返回 false)
+ */
+bool cbor_get_int(const cbor_item_t *item, int64_t *v);
+
+/**
+ * @brief 取数值 (FLOAT / UINT / NEGINT)
+ */
+bool cbor_get_double(const cbor_item_t *item, double *v);
+
+/**
+ * @brief 判断数据项是否为与 s 相同的字符串
+ */
+bool cbor_text_equals(const cbor_item_t *item, const char *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CBOR_H
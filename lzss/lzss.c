@@ -0,0 +1,466 @@
+/**
+ * @file lzss.c
+ * @brief LZSS 流式压缩/解压逻辑实现
+ */
+
+#include "lzss.h"
+#include <string.h> /* 用于 memcpy / memmove / memset */
+
+/* 哈希链中的空位置 */
+#define LZSS_NIL 0xFFFF
+
+/**
+ * @brief 内部函数：检查窗口与最长匹配位数
+ */
+static bool _lzss_check_bits(uint8_t windowBits, uint8_t lookaheadBits)
+{
+    return windowBits >= LZSS_WINDOW_MIN && windowBits <= LZSS_WINDOW_MAX &&
+           lookaheadBits >= LZSS_LOOKAHEAD_MIN && lookaheadBits < windowBits;
+}
+
+/* ==========================================
+ * 编码
+ * ========================================== */
+
+/**
+ * @brief 内部函数：以 pos 开始的 2 字节计算哈希值 (windowBits 位)
+ */
+static inline uint32_t _lzss_hash(const lzss_encoder_t *enc, uint32_t pos)
+{
+    uint32_t v = ((uint32_t)enc->buf[pos] << 8) | enc->buf[pos + 1];
+    return (v * 0x9E3779B1u) >> (32 - enc->windowBits);
+}
+
+/**
+ * @brief 内部函数：把位置 pos 加入哈希链 (需要 pos 之后至少还有 1 字节)
+ */
+static inline void _lzss_insert(lzss_encoder_t *enc, uint32_t pos)
+{
+    uint32_t h = _lzss_hash(enc, pos);
+    enc->prev[pos] = enc->head[h];
+    enc->head[h] = (uint16_t)pos;
+}
+
+/**
+ * @brief 内部函数：数据区前移一个窗口，哈希链中的位置同步减去 N，移出窗口的置空
+ */
+static void _lzss_slide(lzss_encoder_t *enc)
+{
+    uint32_t n = 1u << enc->windowBits;
+
+    memmove(enc->buf, enc->buf + n, enc->fill - n);
+    enc->fill -= n;
+    enc->pos -= n;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint16_t v = enc->head[i];
+        enc->head[i] = (v != LZSS_NIL && v >= n) ? (uint16_t)(v - n) : LZSS_NIL;
+    }
+    /* 后半区的位置尚未插入，前驱不会被读取，只需平移前半区 */
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint16_t v = enc->prev[i + n];
+        enc->prev[i] = (v != LZSS_NIL && v >= n) ? (uint16_t)(v - n) : LZSS_NIL;
+    }
+}
+
+/**
+ * @brief 内部函数：在窗口中查找 pos 处的最长匹配
+ * @return 匹配长度 (小于 LZSS_MIN_MATCH 表示没有可用的匹配)
+ */
+static uint32_t _lzss_find(const lzss_encoder_t *enc, uint32_t maxLen, uint32_t *dist)
+{
+    uint32_t pos = enc->pos;
+    uint32_t n = 1u << enc->windowBits;
+    uint32_t limit = (pos > n) ? pos - n : 0;
+    const uint8_t *cur = enc->buf + pos;
+    uint32_t best = 0;
+
+    if (maxLen < LZSS_MIN_MATCH)
+        return 0;
+
+    uint16_t cand = enc->head[_lzss_hash(enc, pos)];
+    for (uint16_t chain = enc->maxChain; cand != LZSS_NIL && cand >= limit && chain > 0; chain--)
+    {
+        const uint8_t *p = enc->buf + cand;
+        /* 先比较当前最优长度处的字节，不可能更长的候选直接跳过 */
+        if (p[best] == cur[best] && p[0] == cur[0])
+        {
+            uint32_t len = 1;
+            while (len < maxLen && p[len] == cur[len])
+                len++;
+            if (len > best)
+            {
+                best = len;
+                *dist = pos - cand;
+                if (len == maxLen)
+                    break;
+            }
+        }
+        cand = enc->prev[cand];
+    }
+    return best;
+}
+
+/**
+ * @brief 内部函数：追加 count 位 (调用前未写出的位不足 8 位，count 不超过 24)
+ */
+static inline void _lzss_put_bits(lzss_encoder_t *enc, uint32_t value, uint8_t count)
+{
+    enc->bits = (enc->bits << count) | value;
+    enc->bitCount += count;
+}
+
+int lzss_enc_init(lzss_encoder_t *enc, void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits)
+{
+    if (!enc || !work || !_lzss_check_bits(windowBits, lookaheadBits) ||
+        workSize < LZSS_ENC_WORK_SIZE(windowBits) || ((uintptr_t)work & 1) != 0)
+        return LZSS_ERR_PARAM;
+
+    uint32_t n = 1u << windowBits;
+    memset(enc, 0, sizeof(lzss_encoder_t));
+    enc->head = (uint16_t *)work;
+    enc->prev = enc->head + n;
+    enc->buf = (uint8_t *)(enc->prev + 2 * n);
+    enc->windowBits = windowBits;
+    enc->lookaheadBits = lookaheadBits;
+    enc->maxChain = LZSS_DEFAULT_CHAIN;
+    memset(enc->head, 0xFF, n * sizeof(uint16_t));
+    return LZSS_OK;
+}
+
+int lzss_enc_set_dict(lzss_encoder_t *enc, const void *dict, size_t len)
+{
+    uint32_t n = 1u << enc->windowBits;
+    if (enc->fill != 0 || enc->done)
+        return LZSS_ERR_PARAM;
+
+    /* 字典作为已编码的数据放在窗口中，只保留最后 N 字节 */
+    if (len > n)
+    {
+        dict = (const uint8_t *)dict + (len - n);
+        len = n;
+    }
+    if (len > 0)
+        memcpy(enc->buf, dict, len);
+    enc->fill = enc->pos = (uint32_t)len;
+    for (uint32_t i = 0; i + 1 < len; i++)
+        _lzss_insert(enc, i);
+    return LZSS_OK;
+}
+
+int lzss_enc_process(lzss_encoder_t *enc, const uint8_t *in, size_t inLen, size_t *consumed,
+                     uint8_t *out, size_t outSize, size_t *produced, bool finish)
+{
+    uint32_t cap = 2u << enc->windowBits;
+    uint32_t maxMatch = (1u << enc->lookaheadBits) + LZSS_MIN_MATCH - 1;
+    /* 回溯比同样长度的字面量 (每字节 9 位) 更短时才使用，保证输出不超过 LZSS_COMPRESS_BOUND */
+    uint32_t minMatch = (1u + enc->windowBits + enc->lookaheadBits) / 9 + 1;
+    size_t ip = 0;
+    size_t op = 0;
+    int ret;
+
+    for (;;)
+    {
+        /* 1. 先写出完整的字节，输出满时返回 */
+        while (enc->bitCount >= 8)
+        {
+            if (op == outSize)
+            {
+                ret = LZSS_MORE;
+                goto out;
+            }
+            enc->bitCount -= 8;
+            out[op++] = (uint8_t)(enc->bits >> enc->bitCount);
+        }
+
+        if (enc->done)
+        {
+            ret = LZSS_DONE;
+            goto out;
+        }
+
+        /* 2. 读入输入，数据区满且待编码数据不足一个最长匹配时前移一个窗口 */
+        if (ip < inLen && enc->fill < cap)
+        {
+            size_t take = cap - enc->fill;
+            if (take > inLen - ip)
+                take = inLen - ip;
+            memcpy(enc->buf + enc->fill, in + ip, take);
+            enc->fill += (uint32_t)take;
+            ip += take;
+        }
+        if (enc->fill == cap && enc->fill - enc->pos < maxMatch)
+        {
+            _lzss_slide(enc);
+            continue;
+        }
+
+        /* 3. 待编码数据不足一个最长匹配：还有输入时等待，最后一段则继续编码到末尾 */
+        uint32_t avail = enc->fill - enc->pos;
+        bool last = finish && ip == inLen;
+        if (avail == 0 || (avail < maxMatch && !last))
+        {
+            if (!last)
+            {
+                ret = LZSS_OK;
+                goto out;
+            }
+            /* 末尾不足 1 字节的部分补 0 */
+            if (enc->bitCount > 0)
+            {
+                if (op == outSize)
+                {
+                    ret = LZSS_MORE;
+                    goto out;
+                }
+                out[op++] = (uint8_t)(enc->bits << (8 - enc->bitCount));
+                enc->bitCount = 0;
+            }
+            enc->done = true;
+            ret = LZSS_DONE;
+            goto out;
+        }
+
+        /* 4. 编码一个字面量或回溯 */
+        uint32_t maxLen = (avail < maxMatch) ? avail : maxMatch;
+        uint32_t dist = 0;
+        uint32_t len = _lzss_find(enc, maxLen, &dist);
+
+        if (len >= minMatch)
+        {
+            _lzss_put_bits(enc, 0, 1);
+            _lzss_put_bits(enc, ((dist - 1) << enc->lookaheadBits) | (len - LZSS_MIN_MATCH),
+                           (uint8_t)(enc->windowBits + enc->lookaheadBits));
+        }
+        else
+        {
+            len = 1;
+            _lzss_put_bits(enc, 0x100u | enc->buf[enc->pos], 9);
+        }
+
+        /* 匹配覆盖的每个位置都加入哈希链 (最后 1 字节无法计算哈希，跳过) */
+        for (uint32_t end = enc->pos + len; enc->pos < end; enc->pos++)
+        {
+            if (enc->pos + 1 < enc->fill)
+                _lzss_insert(enc, enc->pos);
+        }
+    }
+
+out:
+    if (consumed)
+        *consumed = ip;
+    if (produced)
+        *produced = op;
+    return ret;
+}
+
+/* ==========================================
+ * 解码
+ * ========================================== */
+
+int lzss_dec_init(lzss_decoder_t *dec, void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits)
+{
+    if (!dec || !work || !_lzss_check_bits(windowBits, lookaheadBits) || workSize < LZSS_DEC_WORK_SIZE(windowBits))
+        return LZSS_ERR_PARAM;
+
+    memset(dec, 0, sizeof(lzss_decoder_t));
+    dec->window = (uint8_t *)work;
+    dec->windowBits = windowBits;
+    dec->lookaheadBits = lookaheadBits;
+    return LZSS_OK;
+}
+
+int lzss_dec_set_dict(lzss_decoder_t *dec, const void *dict, size_t len)
+{
+    uint32_t n = 1u << dec->windowBits;
+    if (dec->filled != 0 || dec->bitCount != 0)
+        return LZSS_ERR_PARAM;
+
+    if (len > n)
+    {
+        dict = (const uint8_t *)dict + (len - n);
+        len = n;
+    }
+    if (len > 0)
+        memcpy(dec->window, dict, len);
+    dec->wpos = (uint16_t)(len & (n - 1));
+    dec->filled = (uint16_t)len;
+    return LZSS_OK;
+}
+
+int lzss_dec_process(lzss_decoder_t *dec, const uint8_t *in, size_t inLen, size_t *consumed,
+                     uint8_t *out, size_t outSize, size_t *produced)
+{
+    uint32_t mask = (1u << dec->windowBits) - 1;
+    uint8_t refBits = (uint8_t)(1 + dec->windowBits + dec->lookaheadBits);
+    size_t ip = 0;
+    size_t op = 0;
+    int ret;
+
+    for (;;)
+    {
+        /* 1. 继续输出未完成的回溯 */
+        while (dec->copyLeft > 0)
+        {
+            if (op == outSize)
+            {
+                ret = LZSS_MORE;
+                goto out;
+            }
+            uint8_t b = dec->window[(dec->wpos - dec->copyDist) & mask];
+            dec->window[dec->wpos] = b;
+            dec->wpos = (uint16_t)((dec->wpos + 1) & mask);
+            out[op++] = b;
+            dec->copyLeft--;
+            if (dec->filled <= mask)
+                dec->filled++;
+        }
+
+        /* 2. 读入足够的位：标志位为 1 时需要 9 位，为 0 时需要 1 + 距离 + 长度 */
+        if (dec->bitCount == 0)
+        {
+            if (ip == inLen)
+            {
+                ret = LZSS_OK;
+                goto out;
+            }
+            dec->bits = in[ip++];
+            dec->bitCount = 8;
+        }
+        bool literal = ((dec->bits >> (dec->bitCount - 1)) & 1) != 0;
+        uint8_t need = literal ? 9 : refBits;
+        while (dec->bitCount < need)
+        {
+            if (ip == inLen)
+            {
+                ret = LZSS_OK;
+                goto out;
+            }
+            dec->bits = (dec->bits << 8) | in[ip++];
+            dec->bitCount += 8;
+        }
+
+        uint32_t field = (dec->bits >> (dec->bitCount - need)) & ((1u << (need - 1)) - 1);
+        if (literal)
+        {
+            if (op == outSize)
+            {
+                ret = LZSS_MORE;
+                goto out;
+            }
+            dec->window[dec->wpos] = (uint8_t)field;
+            dec->wpos = (uint16_t)((dec->wpos + 1) & mask);
+            out[op++] = (uint8_t)field;
+            if (dec->filled <= mask)
+                dec->filled++;
+        }
+        else
+        {
+            uint32_t dist = (field >> dec->lookaheadBits) + 1;
+            if (dist > dec->filled)
+            {
+                ret = LZSS_ERR_MALFORMED;
+                goto out;
+            }
+            dec->copyDist = (uint16_t)dist;
+            dec->copyLeft = (uint16_t)((field & ((1u << dec->lookaheadBits) - 1)) + LZSS_MIN_MATCH);
+        }
+        dec->bitCount -= need;
+    }
+
+out:
+    if (consumed)
+        *consumed = ip;
+    if (produced)
+        *produced = op;
+    return ret;
+}
+
+/* ==========================================
+ * 整块接口
+ * ========================================== */
+
+size_t lzss_compress(void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits, const void *dict,
+                     size_t dictLen, const void *in, size_t inLen, uint8_t *out, size_t outSize)
+{
+    lzss_encoder_t enc;
+    size_t produced = 0;
+
+    if (lzss_enc_init(&enc, work, workSize, windowBits, lookaheadBits) != LZSS_OK)
+        return 0;
+    if (dict)
+        lzss_enc_set_dict(&enc, dict, dictLen);
+    if (lzss_enc_process(&enc, (const uint8_t *)in, inLen, NULL, out, outSize, &produced, true) != LZSS_DONE)
+        return 0;
+    return produced;
+}
+
+int lzss_decompress(uint8_t windowBits, uint8_t lookaheadBits, const void *dict, size_t dictLen,
+                    const uint8_t *in, size_t inLen, uint8_t *out, size_t outLen)
+{
+    if (!_lzss_check_bits(windowBits, lookaheadBits))
+        return LZSS_ERR_PARAM;
+
+    /* 与编码端相同，只有字典的最后 N 字节在窗口中 */
+    const uint8_t *d = (const uint8_t *)dict;
+    size_t n = (size_t)1 << windowBits;
+    if (!d)
+        dictLen = 0;
+    if (dictLen > n)
+    {
+        d += dictLen - n;
+        dictLen = n;
+    }
+
+    uint8_t refBits = (uint8_t)(1 + windowBits + lookaheadBits);
+    uint32_t lenMask = (1u << lookaheadBits) - 1;
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    size_t ip = 0;
+    size_t op = 0;
+
+    /* 输出缓冲区即窗口：回溯直接从已输出的数据中复制 */
+    while (op < outLen)
+    {
+        if (bitCount == 0)
+        {
+            if (ip == inLen)
+                return LZSS_ERR_MALFORMED;
+            bits = in[ip++];
+            bitCount = 8;
+        }
+        bool literal = ((bits >> (bitCount - 1)) & 1) != 0;
+        uint8_t need = literal ? 9 : refBits;
+        while (bitCount < need)
+        {
+            if (ip == inLen)
+                return LZSS_ERR_MALFORMED;
+            bits = (bits << 8) | in[ip++];
+            bitCount += 8;
+        }
+        uint32_t field = (bits >> (bitCount - need)) & ((1u << (need - 1)) - 1);
+        bitCount -= need;
+
+        if (literal)
+        {
+            out[op++] = (uint8_t)field;
+            continue;
+        }
+
+        size_t dist = (field >> lookaheadBits) + 1;
+        size_t len = (field & lenMask) + LZSS_MIN_MATCH;
+        if (dist > op + dictLen || len > outLen - op)
+            return LZSS_ERR_MALFORMED;
+        /* 距离小于长度时源与目标重叠 (如连续的重复字节)，必须逐字节复制；超出已输出数据的部分取自字典 */
+        size_t i = 0;
+        for (; i < len && dist > op + i; i++)
+            out[op + i] = d[dictLen - (dist - op - i)];
+        const uint8_t *src = out + op - dist;
+        for (; i < len; i++)
+            out[op + i] = src[i];
+        op += len;
+    }
+    return LZSS_OK;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file lzss.h
+ * @brief LZSS 流式压缩/解压对外接口头文件 (C99标准)
+ * @details 核心特性：
+ * 1. 滑动窗口 2^windowBits 字节 (256 B ~ 4 KB)，最长匹配 2^lookaheadBits + 1 字节，两者在初始化时指定。
+ * 2. 工作内存由调用者提供，大小只取决于窗口：编码 8 × 窗口，解码 1 × 窗口，不分配内存。
+ * 3. 流式：输入、输出都可以分段给出，每次调用处理到输入用完或输出写满为止，适合边接收边处理。
+ * 4. 编码器用哈希链查找匹配，链长可调，在压缩率与速度之间权衡。
+ * 5. 可选预置字典：两端事先约定一段样本数据 (如一条典型消息) 放入窗口，短消息也能引用其中的重复内容。
+ *
+ * 码流格式 (按位，高位在前)：
+ *   字面量  1 + 8 位字节
+ *   回溯    0 + windowBits 位 (距离 - 1) + lookaheadBits 位 (长度 - 2)
+ * 码流没有结束标记，末尾不足 1 字节的部分补 0，原始长度需由上层记录。
+ */
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdint.h>  // 包含 uint32_t 等类型
+#include <stdbool.h> // 包含 bool 类型
+#include <stddef.h>  // 包含 size_t 定义
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================
+ * 配置
+ * ========================================== */
+
+/* 窗口位数范围 */
+#define LZSS_WINDOW_MIN 8
+#define LZSS_WINDOW_MAX 12
+
+/* 最长匹配位数的下限 (上限为 windowBits - 1) */
+#define LZSS_LOOKAHEAD_MIN 3
+
+/* 最短匹配长度 (更短的重复按字面量编码) */
+#define LZSS_MIN_MATCH 2
+
+/* 编码器默认的哈希链查找深度 (初始化后可修改 maxChain) */
+#ifndef LZSS_DEFAULT_CHAIN
+#define LZSS_DEFAULT_CHAIN 16
+#endif
+
+/* 工作内存大小：编码器为 [链表头 2N][前驱 4N][数据 2N]，解码器为 [窗口 N] (N = 2^windowBits) */
+#define LZSS_ENC_WORK_SIZE(windowBits) ((size_t)8 << (windowBits))
+#define LZSS_DEC_WORK_SIZE(windowBits) ((size_t)1 << (windowBits))
+
+/* 压缩结果的最大长度 (全部为字面量时每字节 9 位) */
+#define LZSS_COMPRESS_BOUND(n) ((size_t)(n) + ((size_t)(n) + 7) / 8)
+
+/* ==========================================
+ * 返回值
+ * ========================================== */
+
+#define LZSS_OK 0              /* 输入已全部处理，可以继续给出输入 */
+#define LZSS_MORE 1            /* 输出缓冲区已满，取走输出后再次调用 (未处理的输入需重新给出) */
+#define LZSS_DONE 2            /* 编码结束 (finish)，全部输出已写出 */
+#define LZSS_ERR_PARAM (-1)    /* 参数错误 (窗口位数超出范围、工作内存不足或未 2 字节对齐) */
+#define LZSS_ERR_MALFORMED (-2) /* 码流错误 (回溯距离超出已输出的数据或数据被截断) */
+
+/* ==========================================
+ * 类型定义
+ * ========================================== */
+
+/**
+ * @brief 编码器 (内部字段不要直接修改，maxChain 除外)
+ */
+typedef struct
+{
+    uint16_t *head;        /* 哈希链表头：每个哈希值最近出现的位置 */
+    uint16_t *prev;        /* 哈希链：每个位置上一次出现同一哈希值的位置 */
+    uint8_t *buf;          /* 数据区 (2N)：前半为已编码的窗口，后半为待编码数据 */
+    uint8_t windowBits;    /* 窗口位数 */
+    uint8_t lookaheadBits; /* 最长匹配位数 */
+    uint16_t maxChain;     /* 每个位置最多比较的候选数 (越大压缩率越高、越慢) */
+    uint32_t fill;         /* 数据区已填入的字节数 */
+    uint32_t pos;          /* 下一个待编码的位置 */
+    uint32_t bits;         /* 尚未写出的位 */
+    uint8_t bitCount;      /* 尚未写出的位数 */
+    bool done;             /* 已输出全部数据 */
+} lzss_encoder_t;
+
+/**
+ * @brief 解码器
+ */
+typedef struct
+{
+    uint8_t *window;       /* 窗口 (N)，环形使用 */
+    uint8_t windowBits;    /* 窗口位数 (需与编码端相同) */
+    uint8_t lookaheadBits; /* 最长匹配位数 (需与编码端相同) */
+    uint16_t wpos;         /* 窗口中下一个写入位置 */
+    uint16_t filled;       /* 窗口中有效的字节数 (最多 N) */
+    uint16_t copyDist;     /* 正在复制的回溯距离 */
+    uint16_t copyLeft;     /* 回溯剩余未输出的字节数 */
+    uint32_t bits;         /* 已读入、尚未解码的位 */
+    uint8_t bitCount;      /* 已读入、尚未解码的位数 */
+} lzss_decoder_t;
+
+/* ==========================================
+ * 流式接口
+ * ========================================== */
+
+/**
+ * @brief 初始化编码器 (每个独立的数据流都需要重新初始化)
+ * @param work [入参] 工作内存，至少 LZSS_ENC_WORK_SIZE(windowBits) 字节，2 字节对齐
+ * @param windowBits [入参] 窗口位数 (LZSS_WINDOW_MIN ~ LZSS_WINDOW_MAX)
+ * @param lookaheadBits [入参] 最长匹配位数 (LZSS_LOOKAHEAD_MIN ~ windowBits - 1)
+ * @return LZSS_OK 成功; LZSS_ERR_PARAM 参数错误
+ */
+int lzss_enc_init(lzss_encoder_t *enc, void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits);
+
+/**
+ * @brief 设置预置字典 (初始化后、第一次 lzss_enc_process 之前调用，解码端需使用相同的字典)
+ * @note  只有字典的最后 2^windowBits 字节生效；字典被复制到工作内存中
+ * @return LZSS_OK 成功; LZSS_ERR_PARAM 已开始编码
+ */
+int lzss_enc_set_dict(lzss_encoder_t *enc, const void *dict, size_t len);
+
+/**
+ * @brief 压缩一段数据
+ * @param in [入参] 输入数据 (可为 NULL，此时 inLen 为 0)
+ * @param consumed [出参] 本次读取的输入字节数
+ * @param produced [出参] 本次写出的字节数
+ * @param finish [入参] 本次给出的是最后一段输入：全部编码并补齐最后一个字节
+ * @return LZSS_OK 输入已用完 (finish 为 false 时); LZSS_MORE 输出已满; LZSS_DONE 结束 (finish 为 true 时)
+ */
+int lzss_enc_process(lzss_encoder_t *enc, const uint8_t *in, size_t inLen, size_t *consumed,
+                     uint8_t *out, size_t outSize, size_t *produced, bool finish);
+
+/**
+ * @brief 初始化解码器
+ * @param work [入参] 窗口内存，至少 LZSS_DEC_WORK_SIZE(windowBits) 字节
+ * @return LZSS_OK 成功; LZSS_ERR_PARAM 参数错误
+ */
+int lzss_dec_init(lzss_decoder_t *dec, void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits);
+
+/**
+ * @brief 设置预置字典 (初始化后、第一次 lzss_dec_process 之前调用)
+ * @return LZSS_OK 成功; LZSS_ERR_PARAM 已开始解码
+ */
+int lzss_dec_set_dict(lzss_decoder_t *dec, const void *dict, size_t len);
+
+/**
+ * @brief 解压一段码流
+ * @note  码流没有结束标记：调用者按原始长度判断何时结束，末尾的填充位留在解码器中
+ * @return LZSS_OK 输入已用完; LZSS_MORE 输出已满; LZSS_ERR_MALFORMED 码流错误
+ */
+int lzss_dec_process(lzss_decoder_t *dec, const uint8_t *in, size_t inLen, size_t *consumed,
+                     uint8_t *out, size_t outSize, size_t *produced);
+
+/* ==========================================
+ * 整块接口
+ * ========================================== */
+
+/**
+ * @brief 整块压缩
+ * @param work [入参] 编码器工作内存，至少 LZSS_ENC_WORK_SIZE(windowBits) 字节
+ * @param dict [入参] 预置字典 (可为 NULL)
+ * @return 压缩后的长度；输出缓冲区不足或参数错误时返回 0 (空输入同样返回 0)
+ */
+size_t lzss_compress(void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits, const void *dict,
+                     size_t dictLen, const void *in, size_t inLen, uint8_t *out, size_t outSize);
+
+/**
+ * @brief 整块解压：恰好还原 outLen 字节，直接以输出缓冲区作为窗口，不需要工作内存
+ * @param dict [入参] 预置字典 (可为 NULL)，与编码端相同
+ * @return LZSS_OK 成功; LZSS_ERR_MALFORMED 码流错误或数据不足; LZSS_ERR_PARAM 参数错误
+ */
+int lzss_decompress(uint8_t windowBits, uint8_t lookaheadBits, const void *dict, size_t dictLen,
+                    const uint8_t *in, size_t inLen, uint8_t *out, size_t outLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LZSS_H
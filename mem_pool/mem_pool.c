@@ -0,0 +1,257 @@
+/**
+ * @file mem_pool.c
+ * @brief 定长块内存池逻辑实现
+ */
+
+#include "mem_pool.h"
+#include <string.h> /* 用于 memset */
+
+/* 弱定义属性 (移植层可重写临界区函数) */
+#if defined(__GNUC__) || defined(__clang__) || defined(__ICCARM__) || defined(__CC_ARM) || defined(__ARMCC_VERSION)
+#define MP_WEAK __attribute__((weak))
+#else
+#define MP_WEAK
+#endif
+
+/* 链表头的低 16 位为块编号 + 1 (0 表示空)，高 16 位为版本号，每次出栈/入栈加 1 */
+#define MP_INDEX_MASK 0xFFFFu
+#define MP_TAG_STEP 0x10000u
+
+/* ==========================================
+ * 原子操作 (MP_USE_ATOMIC 为 0 时改用 hal_mp_lock 临界区)
+ * ========================================== */
+
+#if MP_USE_ATOMIC
+static inline uint32_t _mp_load(volatile uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline bool _mp_cas(volatile uint32_t *p, uint32_t *expect, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(p, expect, desired, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t _mp_add(volatile uint32_t *p, uint32_t v)
+{
+    return __atomic_add_fetch(p, v, __ATOMIC_RELAXED);
+}
+#endif
+
+/**
+ * @brief 内部函数：空闲块中存放的下一块编号
+ */
+static inline volatile uint32_t *_mp_link(const mp_class_t *c, uint32_t index)
+{
+    return (volatile uint32_t *)(c->base + (index - 1) * c->blockSize);
+}
+
+/**
+ * @brief 内部函数：从等级的空闲链表取出一块并更新统计
+ */
+static void *_mp_pop(mp_class_t *c)
+{
+#if MP_USE_ATOMIC
+    uint32_t old = _mp_load(&c->head);
+    for (;;)
+    {
+        uint32_t index = old & MP_INDEX_MASK;
+        if (index == 0)
+        {
+            _mp_add(&c->fails, 1);
+            return NULL;
+        }
+
+        /* 读取 next 时该块可能已被其他线程取走，此时版本号已变化，CAS 会失败并重试 */
+        uint32_t next = *_mp_link(c, index) & MP_INDEX_MASK;
+        uint32_t desired = ((old + MP_TAG_STEP) & ~MP_INDEX_MASK) | next;
+        if (_mp_cas(&c->head, &old, desired))
+        {
+            uint32_t used = _mp_add(&c->used, 1);
+            uint32_t high = _mp_load(&c->highWater);
+            while (used > high && !_mp_cas(&c->highWater, &high, used))
+                ;
+            _mp_add(&c->allocs, 1);
+            return (void *)_mp_link(c, index);
+        }
+    }
+#else
+    hal_mp_lock();
+    uint32_t index = c->head & MP_INDEX_MASK;
+    if (index == 0)
+    {
+        c->fails++;
+        hal_mp_unlock();
+        return NULL;
+    }
+    c->head = *_mp_link(c, index) & MP_INDEX_MASK;
+    if (++c->used > c->highWater)
+        c->highWater = c->used;
+    c->allocs++;
+    hal_mp_unlock();
+    return (void *)_mp_link(c, index);
+#endif
+}
+
+/**
+ * @brief 内部函数：把块放回等级的空闲链表
+ */
+static void _mp_push(mp_class_t *c, uint32_t index)
+{
+#if MP_USE_ATOMIC
+    uint32_t old = _mp_load(&c->head);
+    do
+    {
+        *_mp_link(c, index) = old & MP_INDEX_MASK;
+    } while (!_mp_cas(&c->head, &old, ((old + MP_TAG_STEP) & ~MP_INDEX_MASK) | index));
+    _mp_add(&c->used, (uint32_t)-1);
+#else
+    hal_mp_lock();
+    *_mp_link(c, index) = c->head;
+    c->head = index;
+    c->used--;
+    hal_mp_unlock();
+#endif
+}
+
+/**
+ * @brief 内部函数：查找 ptr 所属的等级，并给出块编号 (从 1 开始)
+ */
+static const mp_class_t *_mp_owner(const mem_pool_t *mp, const void *ptr, uint32_t *index)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+
+    for (uint8_t i = 0; i < mp->count; i++)
+    {
+        const mp_class_t *c = &mp->classes[i];
+        if (p < c->base || p >= c->base + (size_t)c->blocks * c->blockSize)
+            continue;
+
+        size_t off = (size_t)(p - c->base);
+        if (off % c->blockSize != 0)
+            return NULL; /* 不是块的起始地址 */
+        *index = (uint32_t)(off / c->blockSize) + 1;
+        return c;
+    }
+    return NULL;
+}
+
+/* ==========================================
+ * 接口实现
+ * ========================================== */
+
+int mp_init(mem_pool_t *mp, void *arena, size_t size)
+{
+    if (!mp || !arena)
+        return -1;
+
+    // 起始地址按 MP_ALIGN 对齐
+    uintptr_t base = (uintptr_t)arena;
+    uintptr_t aligned = (base + MP_ALIGN - 1) & ~(uintptr_t)(MP_ALIGN - 1);
+    if (size < (size_t)(aligned - base))
+        return -1;
+
+    memset(mp, 0, sizeof(mem_pool_t));
+    mp->arena = (uint8_t *)aligned;
+    mp->size = size - (size_t)(aligned - base);
+    return 0;
+}
+
+int mp_add_class(mem_pool_t *mp, uint32_t blockSize, uint32_t blocks)
+{
+    if (!mp || !mp->arena || mp->count >= MP_MAX_CLASSES || blocks == 0 || blocks > MP_INDEX_MASK)
+        return -1;
+
+    // 1. 块大小至少能存放链表的下一块编号，并按 MP_ALIGN 对齐
+    if (blockSize < sizeof(uint32_t))
+        blockSize = sizeof(uint32_t);
+    if (blockSize > UINT32_MAX - MP_ALIGN)
+        return -1;
+    blockSize = (blockSize + MP_ALIGN - 1) & ~(uint32_t)(MP_ALIGN - 1);
+
+    // 2. 等级按块大小严格升序，mp_alloc 才能从小到大查找
+    if (mp->count > 0 && blockSize <= mp->classes[mp->count - 1].blockSize)
+        return -1;
+
+    size_t bytes = (size_t)blockSize * blocks;
+    if (bytes / blocks != blockSize || bytes > mp->size - mp->offset)
+        return -1;
+
+    // 3. 划分内存并串成空闲链表：块 i 指向块 i+1 (编号从 1 开始，0 表示链表结束)
+    mp_class_t *c = &mp->classes[mp->count];
+    memset(c, 0, sizeof(mp_class_t));
+    c->base = mp->arena + mp->offset;
+    c->blockSize = blockSize;
+    c->blocks = blocks;
+    for (uint32_t i = 1; i <= blocks; i++)
+        *_mp_link(c, i) = (i < blocks) ? i + 1 : 0;
+    c->head = 1;
+
+    mp->offset += bytes;
+    mp->count++;
+    return 0;
+}
+
+void *mp_alloc(mem_pool_t *mp, uint32_t size)
+{
+    if (!mp)
+        return NULL;
+
+    // 从能容纳 size 的最小等级开始，已满时借用更大的等级
+    for (uint8_t i = 0; i < mp->count; i++)
+    {
+        mp_class_t *c = &mp->classes[i];
+        if (c->blockSize < size)
+            continue;
+
+        void *p = _mp_pop(c);
+        if (p)
+            return p;
+    }
+    return NULL;
+}
+
+void mp_free(mem_pool_t *mp, void *ptr)
+{
+    if (!mp || !ptr)
+        return;
+
+    uint32_t index = 0;
+    mp_class_t *c = (mp_class_t *)_mp_owner(mp, ptr, &index);
+    if (c)
+        _mp_push(c, index);
+}
+
+uint32_t mp_block_size(const mem_pool_t *mp, const void *ptr)
+{
+    uint32_t index = 0;
+    const mp_class_t *c = (mp && ptr) ? _mp_owner(mp, ptr, &index) : NULL;
+    return c ? c->blockSize : 0;
+}
+
+int mp_get_stats(const mem_pool_t *mp, uint8_t cls, mp_stats_t *stats)
+{
+    if (!mp || !stats || cls >= mp->count)
+        return -1;
+
+    const mp_class_t *c = &mp->classes[cls];
+    stats->blockSize = c->blockSize;
+    stats->blocks = c->blocks;
+    stats->used = c->used;
+    stats->highWater = c->highWater;
+    stats->allocs = c->allocs;
+    stats->fails = c->fails;
+    return 0;
+}
+
+/* ==========================================
+ * 临界区 (弱定义)
+ * ========================================== */
+
+MP_WEAK void hal_mp_lock(void)
+{
+}
+
+MP_WEAK void hal_mp_unlock(void)
+{
+}
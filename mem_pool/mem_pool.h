@@ -0,0 +1,154 @@
+/**
+ * @file mem_pool.h
+ * @brief 定长块内存池对外接口头文件 (C99标准)
+ * @details 核心特性：
+ * 1. 若干个大小等级 (size class)，每个等级是一组等长的块，全部从用户提供的一块内存中划分，之后不再申请内存。
+ * 2. 每个等级的空闲块组成单链表 (下一块的编号存放在空闲块自身中)，申请/释放 O(1)。
+ * 3. 链表头为 [16 位版本号][16 位块编号]，用比较交换 (CAS) 更新，无锁且可避免 ABA 问题；
+ *    中断、多任务、多核均可并发调用。没有 32 位 CAS 指令的内核 (如 Cortex-M0) 改用临界区。
+ * 4. 每个等级记录当前占用、历史最高占用 (high-water) 与申请失败次数，用于按实际负载调整配置。
+ */
+
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stdint.h>  // 包含 uint32_t 等类型
+#include <stdbool.h> // 包含 bool 类型
+#include <stddef.h>  // 包含 size_t 定义
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================
+ * 配置
+ * ========================================== */
+
+/* 大小等级数量上限 (可在编译选项中覆盖) */
+#ifndef MP_MAX_CLASSES
+#define MP_MAX_CLASSES 8
+#endif
+
+/* 块对齐 (字节，2 的幂)，块内可直接存放指针和 64 位整数 */
+#ifndef MP_ALIGN
+#define MP_ALIGN 8
+#endif
+
+/* 是否使用 CAS 原子指令：编译器声明支持原生 32 位 CAS 时默认开启，否则使用 hal_mp_lock / hal_mp_unlock */
+#ifndef MP_USE_ATOMIC
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+#define MP_USE_ATOMIC 1
+#else
+#define MP_USE_ATOMIC 0
+#endif
+#endif
+
+/* 估算内存大小：count 个 size 字节的块 (含对齐余量)，多个等级相加即可 */
+#define MP_CLASS_BYTES(size, count) \
+    ((((size_t)(size) + MP_ALIGN - 1) & ~(size_t)(MP_ALIGN - 1)) * (size_t)(count))
+#define MP_ARENA_SIZE(bytes) ((size_t)(bytes) + MP_ALIGN)
+
+/* ==========================================
+ * 类型定义
+ * ========================================== */
+
+/**
+ * @brief 大小等级的统计 (并发更新，读取时为近似值)
+ */
+typedef struct
+{
+    uint32_t blockSize; /* 块大小 (对齐后) */
+    uint32_t blocks;    /* 块总数 */
+    uint32_t used;      /* 当前占用的块数 */
+    uint32_t highWater; /* 历史最高占用 */
+    uint32_t allocs;    /* 从本等级分配成功的次数 */
+    uint32_t fails;     /* 本等级已满的次数 (可能已转由更大的等级分配) */
+} mp_stats_t;
+
+/**
+ * @brief 一个大小等级
+ */
+typedef struct
+{
+    uint8_t *base;               /* 第一个块的地址 */
+    uint32_t blockSize;          /* 块大小 (对齐后) */
+    uint32_t blocks;             /* 块总数 (最多 65535) */
+    volatile uint32_t head;      /* 空闲链表头：[版本号 16 位][块编号 + 1，0 表示空] */
+    volatile uint32_t used;      /* 当前占用 */
+    volatile uint32_t highWater; /* 历史最高占用 */
+    volatile uint32_t allocs;    /* 分配成功次数 */
+    volatile uint32_t fails;     /* 已满次数 */
+} mp_class_t;
+
+/**
+ * @brief 内存池控制块
+ */
+typedef struct
+{
+    mp_class_t classes[MP_MAX_CLASSES]; /* 按块大小升序排列 */
+    uint8_t count;                      /* 已添加的等级数 */
+    uint8_t *arena;                     /* 用户提供的内存 (已对齐) */
+    size_t size;                        /* 可用字节数 */
+    size_t offset;                      /* 已划分的字节数 */
+} mem_pool_t;
+
+/* ==========================================
+ * 函数声明
+ * ========================================== */
+
+/**
+ * @brief 初始化内存池 (只记录内存，块由 mp_add_class 划分)
+ * @param mp [出参] 控制块指针
+ * @param arena [入参] 用户提供的内存 (静态数组即可，可用 MP_ARENA_SIZE 估算)
+ * @param size [入参] 内存大小
+ * @return 0: 成功, -1: 参数错误
+ */
+int mp_init(mem_pool_t *mp, void *arena, size_t size);
+
+/**
+ * @brief 添加一个大小等级 (必须在任何 mp_alloc 之前、按块大小升序添加)
+ * @param blockSize [入参] 块大小 (向上对齐到 MP_ALIGN，至少 4 字节)
+ * @param blocks [入参] 块数量 (1 ~ 65535)
+ * @return 0: 成功, -1: 参数错误 / 等级已满 / 块大小不大于上一个等级 / 内存不足
+ */
+int mp_add_class(mem_pool_t *mp, uint32_t blockSize, uint32_t blocks);
+
+/**
+ * @brief 申请一块至少 size 字节的内存
+ * @note  从能容纳 size 的最小等级分配，该等级已满时依次尝试更大的等级。无锁，可在中断中调用。
+ * @return 块地址 (按 MP_ALIGN 对齐)；没有合适的空闲块时返回 NULL
+ */
+void *mp_alloc(mem_pool_t *mp, uint32_t size);
+
+/**
+ * @brief 释放 mp_alloc 得到的块 (NULL 被忽略)
+ * @note  按地址范围找到所属等级，O(等级数)。无锁，可在中断中调用。
+ */
+void mp_free(mem_pool_t *mp, void *ptr);
+
+/**
+ * @brief 查询块的实际大小 (可用于就地追加数据)
+ * @return 块大小；ptr 不属于该内存池时返回 0
+ */
+uint32_t mp_block_size(const mem_pool_t *mp, const void *ptr);
+
+/**
+ * @brief 读取某个等级的统计
+ * @param cls [入参] 等级下标 (添加顺序，0 ~ count-1)
+ * @return 0: 成功, -1: 下标越界
+ */
+int mp_get_stats(const mem_pool_t *mp, uint8_t cls, mp_stats_t *stats);
+
+/**
+ * @brief 临界区 (仅 MP_USE_ATOMIC 为 0 时使用，弱定义为空，需要时在移植层重写)
+ * @note  裸机可关中断，RTOS 可使用 taskENTER_CRITICAL / taskEXIT_CRITICAL
+ */
+void hal_mp_lock(void);
+void hal_mp_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_POOL_H
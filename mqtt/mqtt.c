@@ -1,4 +1,7 @@
 #include "mqtt.h"
+#if MQTT_ENABLE_CHANNEL
+#include "mqtt_channel.h"
+#endif
 
 /* ============================================================
  * 静态函数前置声明 (防止编译器报警)
@@ -6,14 +9,93 @@
 
 static void MQTT_EncodeLength(uint32_t length, uint8_t *encoded, uint8_t *encodedLen);
 static int MQTT_DecodeLength(const uint8_t *encoded, size_t rxlen, uint8_t *encodedLen, uint32_t *length, uint32_t maxLength);
-static void MQTT_HandleIncoming(MQTT_Client *client, size_t len);
-static void MQTT_SendPingRaw(void);
+static void MQTT_HandleIncoming(MQTT_Client *client, const uint8_t *pkt, size_t len);
+static void MQTT_SendPingRaw(MQTT_Client *client);
 static void MQTT_MaintainKeepAlive(MQTT_Client *client);
+static bool MQTT_NeedsAck(MQTT_Operation op, uint8_t qos);
+static MQTT_Request *MQTT_FindWaiting(MQTT_Client *client, MQTT_Operation op, uint16_t packetId, bool matchId);
+static bool MQTT_SendRequest(MQTT_Client *client, MQTT_Request *req, uint8_t dup);
+static void MQTT_CompleteRequest(MQTT_Client *client, MQTT_Request *req, MQTT_Result result);
+static void MQTT_TimerInsert(MQTT_Client *client, MQTT_Request *req, uint32_t deadline);
+static void MQTT_TimerRemove(MQTT_Client *client, MQTT_Request *req);
+static void MQTT_ExpireRequest(MQTT_Client *client, MQTT_Request *req);
+static void MQTT_BatchFlush(MQTT_Client *client, MQTT_FlushReason reason);
+static void MQTT_KeepAliveTimeout(MQTT_Client *client);
+static void MQTT_KeepAliveRestart(MQTT_Client *client);
+static void MQTT_RateDrain(MQTT_Client *client);
+static void MQTT_PrioRemove(MQTT_Client *client, MQTT_Request *req);
+#if MQTT_ENABLE_STORE
+static void MQTT_StoreCallback(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx);
+#endif
+static void MQTT_SessionLease(MQTT_Client *client, uint16_t packetId);
+static void MQTT_SessionLogDone(MQTT_Client *client, MQTT_Request *req);
+static bool MQTT_SubmitRequest(MQTT_Client *client, MQTT_Operation op, const char *topic, size_t topicLen,
+                               const MQTT_IoVec *iov, size_t iovCnt, uint8_t qos, uint8_t retain,
+                               MQTT_Callback cb, void *ctx);
 
 /* --------------------------------------------------------------------------
  * 内部辅助函数
  * -------------------------------------------------------------------------- */
 
+/* 收发统一入口：客户端设置了传输层则使用传输层，否则使用全局 HAL 接口
+ * 发送一律在 HAL_MQTT_Lock 内进行：发送统计与限速令牌由它保护，逐段发送的报文 (默认的 HAL_MQTT_SendV、
+ * 没有 sendv 的传输层) 也不会被另一个任务的报文插入 */
+static void MQTT_TransportSend(MQTT_Client *client, const uint8_t *buf, size_t len)
+{
+    client->stats.bytesOut += (uint32_t)len;
+    if (client->rateBytesPerSec)
+        client->rateTokens -= (int32_t)len; /* 限速：所有写出的字节都消耗令牌 */
+    if (client->transport)
+        client->transport->send(client->transportCtx, buf, len);
+    else
+        HAL_MQTT_Send(buf, len);
+}
+
+static void MQTT_TransportSendV(MQTT_Client *client, const MQTT_IoVec *iov, size_t cnt)
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < cnt; i++)
+        total += (uint32_t)iov[i].len;
+    client->stats.bytesOut += total;
+    if (client->rateBytesPerSec)
+        client->rateTokens -= (int32_t)total;
+
+    if (!client->transport)
+    {
+        HAL_MQTT_SendV(iov, cnt);
+        return;
+    }
+
+    if (client->transport->sendv)
+    {
+        client->transport->sendv(client->transportCtx, iov, cnt);
+        return;
+    }
+    for (size_t i = 0; i < cnt; i++)
+    {
+        if (iov[i].len > 0)
+            client->transport->send(client->transportCtx, (const uint8_t *)iov[i].base, iov[i].len);
+    }
+}
+
+static int MQTT_TransportRecv(MQTT_Client *client, uint8_t *buf, size_t bufSize, uint32_t timeoutMs)
+{
+    int n = client->transport ? client->transport->recv(client->transportCtx, buf, bufSize, timeoutMs)
+                              : HAL_MQTT_Recv(buf, bufSize, timeoutMs);
+    if (n > 0)
+        client->stats.bytesIn += (uint32_t)n;
+    return n;
+}
+
+/* 接收路径回复 [类型][2][PacketID] 形式的 ACK (PUBACK / PUBREC / PUBCOMP)，调用方不得持有 HAL_MQTT_Lock */
+static void MQTT_SendAck(MQTT_Client *client, uint8_t type, uint16_t packetId)
+{
+    uint8_t ackBuf[4];
+    HAL_MQTT_Lock();
+    MQTT_TransportSend(client, ackBuf, MQTT_BuildAckPacket(ackBuf, sizeof(ackBuf), type, packetId));
+    HAL_MQTT_Unlock();
+}
+
 /* * 编码 MQTT 剩余长度字段 (Variable Byte Integer)
  * 算法：每字节低7位存数据，最高位(bit7)为延续标志(1表示后续还有字节)
  */
@@ -73,15 +155,107 @@ static int MQTT_DecodeLength(const uint8_t *encoded, size_t rxlen,
     return 0;
 }
 
+/* --------------------------------------------------------------------------
+ * MQTT 5 属性 (Properties)
+ * 属性区 = 属性长度 (变长整数，与剩余长度同一编码) + 若干 [标识][值]
+ * -------------------------------------------------------------------------- */
+
+/* 写入一个整数属性 (Maximum Packet Size 为 4 字节，其余为 2 字节)，返回写入的字节数 */
+static uint32_t MQTT_PropWrite(uint8_t *p, uint8_t id, uint32_t value)
+{
+    p[0] = id;
+    if (id == MQTT_PROP_MAX_PACKET)
+    {
+        p[1] = (uint8_t)(value >> 24);
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 8);
+        p[4] = (uint8_t)value;
+        return 5;
+    }
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)value;
+    return 3;
+}
+
+/* * 读取一个属性
+ * 整数类型的值写入 value，字符串/二进制类型只跳过 (value 为 0)
+ * 返回值: 属性占用的字节数，0 表示标识未知或数据不足
+ */
+static uint32_t MQTT_PropRead(const uint8_t *p, uint32_t len, uint8_t *id, uint32_t *value)
+{
+    if (len < 1)
+        return 0;
+
+    *id = p[0];
+    *value = 0;
+    switch (p[0])
+    {
+    case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A: /* 单字节 */
+        if (len < 2)
+            return 0;
+        *value = p[1];
+        return 2;
+    case 0x13: case 0x21: case 0x22: case 0x23: /* 双字节整数 */
+        if (len < 3)
+            return 0;
+        *value = (uint32_t)((p[1] << 8) | p[2]);
+        return 3;
+    case 0x02: case 0x11: case 0x18: case 0x27: /* 四字节整数 */
+        if (len < 5)
+            return 0;
+        *value = ((uint32_t)p[1] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 8) | p[4];
+        return 5;
+    case 0x0B: /* 变长整数 (Subscription Identifier) */
+    {
+        uint8_t n = 0;
+        if (MQTT_DecodeLength(&p[1], len - 1, &n, value, 268435455u) != 0)
+            return 0;
+        return 1u + n;
+    }
+    case 0x26: /* 字符串对 (User Property) */
+    {
+        if (len < 3)
+            return 0;
+        uint32_t k = (uint32_t)((p[1] << 8) | p[2]);
+        if (len < 5 + k)
+            return 0;
+        uint32_t n = 5 + k + (uint32_t)((p[3 + k] << 8) | p[4 + k]);
+        return (len < n) ? 0 : n;
+    }
+    case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F: /* 字符串 / 二进制 */
+    {
+        if (len < 3)
+            return 0;
+        uint32_t n = 3 + (uint32_t)((p[1] << 8) | p[2]);
+        return (len < n) ? 0 : n;
+    }
+    default:
+        return 0;
+    }
+}
+
+/* * 读取属性区：p 指向属性长度字段，props/propsLen 返回属性内容
+ * 返回值: 属性区总长度 (含长度字段)，0 表示格式错误或超出 len
+ */
+static uint32_t MQTT_PropSection(const uint8_t *p, uint32_t len, const uint8_t **props, uint32_t *propsLen)
+{
+    uint8_t n = 0;
+    if (MQTT_DecodeLength(p, len, &n, propsLen, len) != 0 || n + *propsLen > len)
+        return 0;
+    *props = p + n;
+    return n + *propsLen;
+}
+
 /* --------------------------------------------------------------------------
  * 报文构建函数
  * -------------------------------------------------------------------------- */
 
-/* 构建 CONNECT 报文 */
-uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize,
-                                 const char *clientId, const char *userName,
-                                 const char *password, uint16_t keepAlive,
-                                 uint8_t cleanSession)
+/* 构建 CONNECT 报文 (version 为 MQTT_VERSION_5 时在可变报头末尾写入属性区) */
+static uint32_t MQTT_BuildConnect(uint8_t *txBuf, size_t txBufSize,
+                                  const char *clientId, const char *userName,
+                                  const char *password, uint16_t keepAlive,
+                                  uint8_t cleanSession, uint8_t version,
+                                  uint16_t receiveMax, uint32_t maxPacketSize)
 {
     if (!txBuf || !clientId)
         return 0;
@@ -90,11 +264,24 @@ uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize,
     size_t userNameLen = userName ? strlen(userName) : 0;
     size_t passwordLen = password ? strlen(password) : 0;
 
+    /* MQTT 5 属性 (最多 8 字节，属性长度字段 1 字节) */
+    uint8_t props[8];
+    uint32_t propsLen = 0;
+    if (version == MQTT_VERSION_5)
+    {
+        if (receiveMax)
+            propsLen += MQTT_PropWrite(&props[propsLen], MQTT_PROP_RECEIVE_MAX, receiveMax);
+        if (maxPacketSize)
+            propsLen += MQTT_PropWrite(&props[propsLen], MQTT_PROP_MAX_PACKET, maxPacketSize);
+    }
+
     /* 计算剩余长度:
-     * 可变报头(10字节: ProtoName(6)+Lvl(1)+Flags(1)+KA(2)) +
+     * 可变报头(10字节: ProtoName(6)+Lvl(1)+Flags(1)+KA(2)) + [属性区(v5)] +
      * 载荷(ClientID(2+len) + User(2+len)? + Pass(2+len)?)
      */
     uint32_t remainingLength = 10 + (2 + clientIdLen);
+    if (version == MQTT_VERSION_5)
+        remainingLength += 1 + propsLen;
     if (userNameLen)
         remainingLength += (2 + userNameLen);
     if (passwordLen)
@@ -122,8 +309,8 @@ uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize,
     *p++ = 'T';
     *p++ = 'T';
 
-    /* Protocol Level: 4 代表 v3.1.1 */
-    *p++ = 0x04;
+    /* Protocol Level: 4 代表 v3.1.1, 5 代表 v5.0 */
+    *p++ = (version == MQTT_VERSION_5) ? MQTT_VERSION_5 : MQTT_VERSION_3_1_1;
 
     /* Connect Flags 标志位构建 */
     uint8_t connectFlags = 0;
@@ -140,6 +327,14 @@ uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize,
     *p++ = (uint8_t)(keepAlive >> 8);
     *p++ = (uint8_t)keepAlive;
 
+    /* Properties (v5) */
+    if (version == MQTT_VERSION_5)
+    {
+        *p++ = (uint8_t)propsLen;
+        memcpy(p, props, propsLen);
+        p += propsLen;
+    }
+
     /* 4. 有效载荷 (Payload) */
 
     /* Client Identifier */
@@ -170,30 +365,55 @@ uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize,
     return (uint32_t)(p - txBuf);
 }
 
-/* 构建 SUBSCRIBE 报文 当前实现仅支持单 Topic 订阅 */
-uint32_t MQTT_BuildSubscribePacket(uint8_t *txBuf, size_t txBufSize,
-                                   const char *topic, uint16_t packetId, uint8_t qos)
+/* 构建 CONNECT 报文 (MQTT 3.1.1) */
+uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize,
+                                 const char *clientId, const char *userName,
+                                 const char *password, uint16_t keepAlive,
+                                 uint8_t cleanSession)
+{
+    return MQTT_BuildConnect(txBuf, txBufSize, clientId, userName, password, keepAlive, cleanSession,
+                             MQTT_VERSION_3_1_1, 0, 0);
+}
+
+/* 构建 CONNECT 报文 (MQTT 5.0) */
+uint32_t MQTT_BuildConnectPacketV5(uint8_t *txBuf, size_t txBufSize,
+                                   const char *clientId, const char *userName,
+                                   const char *password, uint16_t keepAlive,
+                                   uint8_t cleanSession, uint16_t receiveMax,
+                                   uint32_t maxPacketSize)
+{
+    return MQTT_BuildConnect(txBuf, txBufSize, clientId, userName, password, keepAlive, cleanSession,
+                             MQTT_VERSION_5, receiveMax, maxPacketSize);
+}
+
+/* 构建 SUBSCRIBE / UNSUBSCRIBE 报文 (当前实现仅支持单 Topic)
+ * v5 在 PacketID 之后多一个空属性区 (1 字节 0)；Subscription Options 的低 2 位即 QoS，与 3.1.1 兼容 */
+static uint32_t MQTT_BuildSubscribe(uint8_t *txBuf, size_t txBufSize, const char *topic,
+                                    uint16_t packetId, uint8_t qos, bool unsubscribe, uint8_t version)
 {
     if (!txBuf || !topic)
         return 0;
 
     size_t topicLen = strlen(topic);
-    /* 剩余长度 = Packet Identifier(2) + Topic Length(2) + Topic + Requested QoS(1) */
-    uint32_t remainingLength = 2 + 2 + topicLen + 1;
+    /* 剩余长度 = Packet Identifier(2) + [属性长度(1)] + Topic Length(2) + Topic + [Requested QoS(1)]
+     * UNSUBSCRIBE Payload 只包含 Topic Filter，不包含 QoS */
+    uint32_t remainingLength = 2 + 2 + topicLen + (unsubscribe ? 0 : 1) + (version == MQTT_VERSION_5 ? 1 : 0);
 
     uint8_t encodedLen = 0;
     if (1 + 4 + remainingLength > txBufSize)
         return 0;
 
-    /* 固定报头: 0x82 (SUBSCRIBE = 8, bits 3-0 必须为 0010) */
-    txBuf[0] = 0x82;
+    /* 固定报头: 0x82 (SUBSCRIBE = 8) / 0xA2 (UNSUBSCRIBE = 10)，bits 3-0 必须为 0010 */
+    txBuf[0] = unsubscribe ? 0xA2 : 0x82;
     MQTT_EncodeLength(remainingLength, &txBuf[1], &encodedLen);
 
     uint8_t *p = &txBuf[1 + encodedLen];
 
-    /* 可变报头: Packet Identifier */
+    /* 可变报头: Packet Identifier [+ Properties] */
     *p++ = (uint8_t)(packetId >> 8);
     *p++ = (uint8_t)packetId;
+    if (version == MQTT_VERSION_5)
+        *p++ = 0x00;
 
     /* Payload: Topic Filter */
     *p++ = (uint8_t)(topicLen >> 8);
@@ -202,50 +422,24 @@ uint32_t MQTT_BuildSubscribePacket(uint8_t *txBuf, size_t txBufSize,
     p += topicLen;
 
     /* Payload: Requested QoS */
-    *p++ = qos & 0x03;
+    if (!unsubscribe)
+        *p++ = qos & 0x03;
 
     return (uint32_t)(p - txBuf);
 }
 
+/* 构建 SUBSCRIBE 报文 当前实现仅支持单 Topic 订阅 */
+uint32_t MQTT_BuildSubscribePacket(uint8_t *txBuf, size_t txBufSize,
+                                   const char *topic, uint16_t packetId, uint8_t qos)
+{
+    return MQTT_BuildSubscribe(txBuf, txBufSize, topic, packetId, qos, false, MQTT_VERSION_3_1_1);
+}
+
 /* 构建 UNSUBSCRIBE 报文 */
 uint32_t MQTT_BuildUnsubscribePacket(uint8_t *txBuf, size_t txBufSize,
                                      const char *topic, uint16_t packetId)
 {
-    if (!txBuf || !topic)
-        return 0;
-
-    size_t topicLen = strlen(topic);
-    /* 剩余长度 = Packet Identifier(2) + Topic Length(2) + Topic */
-    /* UNSUBSCRIBE Payload 只包含 Topic Filter，不包含 QoS */
-    uint32_t remainingLength = 2 + 2 + topicLen;
-
-    uint8_t encodedLen = 0;
-    if (1 + 4 + remainingLength > txBufSize)
-        return 0;
-
-    /* 固定报头: 0xA2 (UNSUBSCRIBE = 10, bits 3-0 必须为 0010) */
-    /* Type(1010) | Reserved(0010) = 10100010 = 0xA2 */
-    txBuf[0] = 0xA2;
-
-    /* 编码剩余长度 */
-    MQTT_EncodeLength(remainingLength, &txBuf[1], &encodedLen);
-
-    uint8_t *p = &txBuf[1 + encodedLen];
-
-    /* 可变报头: Packet Identifier */
-    *p++ = (uint8_t)(packetId >> 8);
-    *p++ = (uint8_t)packetId;
-
-    /* Payload: Topic Filter */
-    /* 包含长度前缀的字符串 */
-    *p++ = (uint8_t)(topicLen >> 8);
-    *p++ = (uint8_t)topicLen;
-    memcpy(p, topic, topicLen);
-    p += topicLen;
-
-    /* UNSUBSCRIBE 报文没有 QoS 字段 */
-
-    return (uint32_t)(p - txBuf);
+    return MQTT_BuildSubscribe(txBuf, txBufSize, topic, packetId, 0, true, MQTT_VERSION_3_1_1);
 }
 
 /* 构建 PUBLISH 报文 */
@@ -303,6 +497,136 @@ uint32_t MQTT_BuildPublishPacket(uint8_t *txBuf, size_t txBufSize,
     return (uint32_t)(p - txBuf);
 }
 
+/* * 构建 PUBLISH 报文头 (零拷贝发送使用)
+ * 只写入 固定报头 + Topic 长度字段，Topic、PacketID 和 Payload 由调用者作为独立数据段发送
+ * 返回值: 写入 hdr 的字节数 (最多 MQTT_PUBLISH_HDR_MAX)，0 表示失败
+ */
+uint32_t MQTT_BuildPublishHeader(uint8_t *hdr, size_t hdrSize,
+                                 uint16_t topicLen, size_t payloadLen,
+                                 uint8_t dup, uint8_t qos, uint8_t retain)
+{
+    if (!hdr)
+        return 0;
+
+    /* 剩余长度: Topic Length(2) + Topic + [PacketID(2) if QoS>0] + Payload，协议上限 268435455 */
+    size_t remainingLength = 2 + (size_t)topicLen + (qos > 0 ? 2 : 0);
+    if (payloadLen > 268435455u - remainingLength)
+        return 0;
+    remainingLength += payloadLen;
+
+    uint8_t encodedLen = 0;
+    uint8_t encoded[4];
+    MQTT_EncodeLength((uint32_t)remainingLength, encoded, &encodedLen);
+    if (hdrSize < 1u + encodedLen + 2u)
+        return 0;
+
+    hdr[0] = (uint8_t)(0x30 | ((dup & 0x01) << 3) | ((qos & 0x03) << 1) | (retain & 0x01));
+    memcpy(&hdr[1], encoded, encodedLen);
+    hdr[1 + encodedLen] = (uint8_t)(topicLen >> 8);
+    hdr[2 + encodedLen] = (uint8_t)topicLen;
+
+    return 1u + encodedLen + 2u;
+}
+
+/* * 准备发布模板：在 buf 中预先写入 Topic 长度字段与 Topic
+ * 之后每次发布不再计算 strlen(topic)，也不再复制 Topic
+ */
+bool MQTT_PreparePublishTemplate(MQTT_PublishTemplate *tpl, uint8_t *buf, size_t bufSize,
+                                 const char *topic, uint8_t qos, uint8_t retain)
+{
+    if (!tpl || !buf || !topic || qos > MQTT_QOS2)
+        return false;
+
+    size_t topicLen = strlen(topic);
+    if (topicLen == 0 || topicLen > 0xFFFF)
+        return false;
+
+    /* 至少能放下 预留报头 + Topic 长度 + Topic + PacketID */
+    if (bufSize < MQTT_TEMPLATE_BUF_SIZE(topicLen, 0))
+        return false;
+
+    uint8_t *p = &buf[MQTT_TEMPLATE_HDR_RESERVE];
+    *p++ = (uint8_t)(topicLen >> 8);
+    *p++ = (uint8_t)topicLen;
+    memcpy(p, topic, topicLen);
+
+    tpl->buf = buf;
+    tpl->bufSize = bufSize;
+    tpl->topic = (const char *)p;
+    tpl->topicLen = (uint16_t)topicLen;
+    tpl->qos = qos;
+    tpl->retain = retain ? 1 : 0;
+    return true;
+}
+
+/* * 用模板构建 PUBLISH 报文
+ * 只写入 PacketID、Payload 与固定报头；固定报头靠右对齐到预留区末尾，与 Topic 长度字段相接
+ */
+uint32_t MQTT_BuildPublishFromTemplate(const MQTT_PublishTemplate *tpl, const void *payload, size_t payloadLen,
+                                       uint16_t packetId, uint8_t dup, const uint8_t **packet)
+{
+    if (!tpl || !tpl->buf || !packet || (!payload && payloadLen > 0))
+        return 0;
+
+    /* QoS 1 和 2 需要 Packet ID */
+    if (tpl->qos > 0 && packetId == 0)
+        return 0;
+
+    /* 可变报头: Topic Length(2) + Topic + [PacketID(2) if QoS>0]，Payload 紧随其后 */
+    size_t varLen = 2 + (size_t)tpl->topicLen + (tpl->qos > 0 ? 2 : 0);
+    size_t offset = MQTT_TEMPLATE_HDR_RESERVE + varLen;
+    if (payloadLen > tpl->bufSize - offset || payloadLen > 268435455u - varLen)
+        return 0;
+
+    uint8_t *p = &tpl->buf[MQTT_TEMPLATE_HDR_RESERVE + 2 + tpl->topicLen];
+    if (tpl->qos > 0)
+    {
+        *p++ = (uint8_t)(packetId >> 8);
+        *p++ = (uint8_t)packetId;
+    }
+    /* Payload 已在模板的 Payload 区中编码好时不复制 */
+    if (payloadLen > 0 && p != (const uint8_t *)payload)
+        memcpy(p, payload, payloadLen);
+
+    /* 固定报头: 剩余长度编码为 1~4 字节，从预留区末尾向前写 */
+    uint8_t encoded[4];
+    uint8_t encodedLen = 0;
+    uint32_t remainingLength = (uint32_t)(varLen + payloadLen);
+    MQTT_EncodeLength(remainingLength, encoded, &encodedLen);
+
+    uint8_t *start = &tpl->buf[MQTT_TEMPLATE_HDR_RESERVE - 1 - encodedLen];
+    start[0] = (uint8_t)(0x30 | ((dup & 0x01) << 3) | ((tpl->qos & 0x03) << 1) | tpl->retain);
+    memcpy(&start[1], encoded, encodedLen);
+
+    *packet = start;
+    return 1u + encodedLen + remainingLength;
+}
+
+/* 模板的 Payload 区起始地址 (紧随 Topic 与 PacketID 之后) */
+uint8_t *MQTT_PublishTemplatePayload(const MQTT_PublishTemplate *tpl, size_t *capacity)
+{
+    if (!tpl || !tpl->buf || !capacity)
+        return NULL;
+
+    size_t offset = MQTT_TEMPLATE_HDR_RESERVE + 2 + (size_t)tpl->topicLen + (tpl->qos > 0 ? 2 : 0);
+    *capacity = tpl->bufSize - offset;
+    return &tpl->buf[offset];
+}
+
+/* * 构建 PUBACK / PUBREC / PUBREL / PUBCOMP 报文 (固定 4 字节)
+ * packetType 传报文类型高 4 位 (0x40 / 0x50 / 0x60 / 0x70)，PUBREL 的保留标志位自动置为 0x02
+ */
+uint32_t MQTT_BuildAckPacket(uint8_t *txBuf, size_t txBufSize, uint8_t packetType, uint16_t packetId)
+{
+    if (!txBuf || txBufSize < 4)
+        return 0;
+    txBuf[0] = (uint8_t)((packetType & 0xF0) | ((packetType & 0xF0) == 0x60 ? 0x02 : 0x00));
+    txBuf[1] = 0x02; /* Length: 2 */
+    txBuf[2] = (uint8_t)(packetId >> 8);
+    txBuf[3] = (uint8_t)packetId;
+    return 4;
+}
+
 /* 构建 PINGREQ 报文 */
 uint32_t MQTT_BuildPingReqPacket(uint8_t *txBuf, size_t txBufSize)
 {
@@ -423,13 +747,13 @@ bool MQTT_CheckPingResp(const uint8_t *rxBuf, size_t rxLen)
     return (rxBuf[0] == 0xD0 && rxBuf[1] == 0x00);
 }
 
-/* * 解析收到的 PUBLISH 报文
+/* * 解析收到的 PUBLISH 报文 (version 为 MQTT_VERSION_5 时跳过 PacketID 之后的属性区)
  * 返回值: >=0 Payload长度; -1 报文头错误; -2 数据未收全; -3 格式逻辑错误; -4 缓冲区不足
  */
-int MQTT_ParsePublishMessage(const uint8_t *rxBuf, size_t rxLen,
+static int MQTT_ParsePublish(const uint8_t *rxBuf, size_t rxLen,
                              uint8_t *recvTopic, size_t recvTopicSize,
                              char *payload, size_t payloadSize,
-                             uint16_t *packetId)
+                             uint16_t *packetId, uint8_t version)
 {
     uint32_t remainingLength = 0;
     uint8_t decodedLen = 0;
@@ -497,11 +821,23 @@ int MQTT_ParsePublishMessage(const uint8_t *rxBuf, size_t rxLen,
         *packetId = 0;
     }
 
+    /* 4. 跳过属性区 (v5)：本客户端声明 Topic Alias Maximum 为 0，服务器不会使用别名，其余属性不需要 */
+    if (version == MQTT_VERSION_5)
+    {
+        const uint8_t *props;
+        uint32_t propsLen;
+        uint32_t n = MQTT_PropSection(p, remainingLength - (topicLen + headerMetaLen), &props, &propsLen);
+        if (n == 0)
+            return -3;
+        p += n;
+        headerMetaLen += n;
+    }
+
     /* --- 开始解析 Payload --- */
 
     /* 计算 Payload 长度 */
-    /* Payload = 剩余长度 - (Topic长度字段 + Topic内容 + PacketID字段) */
-    uint32_t payloadLen = remainingLength - (2 + topicLen + (qos > 0 ? 2 : 0));
+    /* Payload = 剩余长度 - (Topic长度字段 + Topic内容 + PacketID字段 + 属性区) */
+    uint32_t payloadLen = remainingLength - (topicLen + headerMetaLen);
 
     /* 检查用户缓冲区是否足够 */
     if (payloadLen >= payloadSize)
@@ -513,236 +849,721 @@ int MQTT_ParsePublishMessage(const uint8_t *rxBuf, size_t rxLen,
     return (int)payloadLen;
 }
 
-/* ============================================================
- * 核心：接收与处理循环 (Receiver Task)
- * ============================================================ */
+/* 解析收到的 PUBLISH 报文 (MQTT 3.1.1) */
+int MQTT_ParsePublishMessage(const uint8_t *rxBuf, size_t rxLen,
+                             uint8_t *recvTopic, size_t recvTopicSize,
+                             char *payload, size_t payloadSize,
+                             uint16_t *packetId)
+{
+    return MQTT_ParsePublish(rxBuf, rxLen, recvTopic, recvTopicSize, payload, payloadSize, packetId,
+                             MQTT_VERSION_3_1_1);
+}
 
-/* * 内部函数：处理接收到的数据
- * 该函数在 MQTT_ProcessLoop 中被调用
+/* MQTT 5 应答报文的公共字段 */
+typedef struct
+{
+    uint16_t packetId;   /* PacketID (CONNACK 为 0) */
+    uint8_t flags;       /* CONNACK 的 Acknowledge Flags */
+    uint8_t reason;      /* 原因码 (SUBACK/UNSUBACK 取第一个，省略时为 0 即成功) */
+    const uint8_t *props; /* 属性内容 */
+    uint32_t propsLen;
+} MQTT_AckV5;
+
+/* * 解析 MQTT 5 应答报文 (CONNACK / SUBACK / UNSUBACK / PUBACK / PUBREC / PUBCOMP / DISCONNECT)
+ * 各类型的布局:
+ *   CONNACK:            [Flags][Reason][属性区]
+ *   SUBACK / UNSUBACK:  [PacketID][属性区][Reason...]
+ *   PUB*:               [PacketID][Reason][属性区]   (剩余长度为 2 时原因码与属性区均省略)
+ *   DISCONNECT:         [Reason][属性区]             (剩余长度为 0 时省略)
+ * 返回 false 表示格式错误
  */
-static void MQTT_HandleIncoming(MQTT_Client *client, size_t len)
+static bool MQTT_ParseAckV5(const uint8_t *pkt, size_t len, MQTT_AckV5 *ack)
 {
-    /* 只要收到了合法数据，说明链路是通的，刷新活动时间 */
-    client->lastActiveTick = HAL_MQTT_GetTick();
-
-    /* 获取报文类型 (高4位) */
-    uint8_t packetType = client->rxBuf[0] & 0xF0;
+    uint8_t encLen = 0;
+    uint32_t rl = 0;
 
-    /* ----------------------------------------------------
-     * 场景 1: 服务器推送的消息 (PUBLISH)
-     * ---------------------------------------------------- */
-    if (packetType == 0x30)
-    {
-        uint16_t pid = 0;
-        uint8_t qos = (client->rxBuf[0] & 0x06) >> 1;
+    memset(ack, 0, sizeof(MQTT_AckV5));
+    if (len < 2 || MQTT_DecodeLength(&pkt[1], len - 1, &encLen, &rl, (uint32_t)len - 1) != 0 ||
+        1u + encLen + rl > len)
+        return false;
 
-        /* 使用 client 结构体中的 msgTopicBuf 和 msgPayloadBuf 进行解析
-           避免了在栈上分配大数组，防止栈溢出 */
-        int payloadLen = MQTT_ParsePublishMessage(client->rxBuf, len,
-                                                  client->msgTopicBuf, client->msgTopicBufSize,
-                                                  client->msgPayloadBuf, client->msgPayloadBufSize,
-                                                  &pid);
+    const uint8_t *p = &pkt[1 + encLen];
+    uint8_t type = pkt[0] & 0xF0;
 
-        if (payloadLen >= 0)
+    if (type == 0x20 || type == 0xE0)
+    {
+        if (type == 0x20 && rl < 2)
+            return false;
+        if (type == 0x20)
         {
-            /* --- 步骤 A: 响应 PUBACK (最优先) --- */
-            /* 只要是 QoS 1，无论是否重复，都必须回复 ACK，告诉服务器“我活着且收到了” */
-            if (qos == 1)
-            {
-                /* 手动构建 PUBACK 报文 (4字节)，不依赖外部 Build 函数 */
-                uint8_t ackBuf[4];
-                ackBuf[0] = 0x40; /* Type: PUBACK */
-                ackBuf[1] = 0x02; /* Length: 2 */
-                ackBuf[2] = (uint8_t)(pid >> 8);
-                ackBuf[3] = (uint8_t)pid;
-
-                HAL_MQTT_Send(ackBuf, 4);
-                HAL_MQTT_Log("MQTT: Auto-replied PUBACK id=%d\r\n", pid);
-            }
+            ack->flags = *p++;
+            rl--;
+        }
+        if (rl == 0)
+            return true;
+        ack->reason = *p++;
+        rl--;
+        return rl == 0 || MQTT_PropSection(p, rl, &ack->props, &ack->propsLen) != 0;
+    }
 
-            /* --- 步骤 B: 去重判断 --- */
-            /* 如果 QoS > 0，需要检查是否重复处理 */
-            if (qos > 0)
-            {
-                if (pid == client->lastRxPacketId)
-                {
-                    /* ID 相同，说明是重复报文，直接丢弃，不回调用户 */
-                    HAL_MQTT_Log("MQTT: Duplicate Msg ID %d, dropped.\r\n", pid);
-                    return;
-                }
-                /* 更新最后收到的 ID */
-                client->lastRxPacketId = pid;
-            }
+    if (rl < 2)
+        return false;
+    ack->packetId = (uint16_t)((p[0] << 8) | p[1]);
+    p += 2;
+    rl -= 2;
 
-            /* --- 步骤 C: 回调用户 --- */
-            HAL_MQTT_OnPublishReceived((const char *)client->msgTopicBuf,
-                                       (const char *)client->msgPayloadBuf,
-                                       (size_t)payloadLen);
-        }
-        return; /* 处理完毕 */
+    if (type == 0x90 || type == 0xB0)
+    {
+        uint32_t n = MQTT_PropSection(p, rl, &ack->props, &ack->propsLen);
+        if (n == 0 || n >= rl)
+            return false;
+        ack->reason = p[n];
+        return true;
     }
 
-    /* ----------------------------------------------------
-     * 场景 2: 各种应答报文 (ACK)
-     * ---------------------------------------------------- */
+    if (rl == 0)
+        return true;
+    ack->reason = *p++;
+    rl--;
+    return rl == 0 || MQTT_PropSection(p, rl, &ack->props, &ack->propsLen) != 0;
+}
 
-    /* 如果发送线程当前并没有在等待 ACK，则忽略这些报文 */
-    if (client->waitState != MQTT_WAIT_BUSY)
-        return;
+/* ============================================================
+ * 异步请求表管理 (调用方必须持有 HAL_MQTT_Lock)
+ * ============================================================ */
 
-    bool isExpected = false;
+/* 判断操作是否需要等待 ACK */
+static bool MQTT_NeedsAck(MQTT_Operation op, uint8_t qos)
+{
+    if (op == MQTT_OP_DISCONNECT)
+        return false;
+    if (op == MQTT_OP_PUBLISH && qos == 0)
+        return false;
+    return true;
+}
 
-    switch (packetType)
-    {
-    case 0x20: /* CONNACK */
-        if (client->awaitType == MQTT_OP_CONNECT &&
-            MQTT_CheckConnAck(client->rxBuf, len))
-            isExpected = true;
-        break;
+/* 请求是否仍在等待服务器应答 */
+static bool MQTT_IsPending(const MQTT_Request *req)
+{
+    return req->state == MQTT_REQ_WAIT_ACK || req->state == MQTT_REQ_WAIT_COMP;
+}
 
-    case 0x90: /* SUBACK */
-        if (client->awaitType == MQTT_OP_SUBSCRIBE &&
-            MQTT_CheckSubAck(client->rxBuf, len, client->awaitPacketId, client->qos))
-            isExpected = true;
-        break;
+/* 在途窗口是否可用 (槽数量必须是 2 的幂) */
+static bool MQTT_InflightEnabled(MQTT_Client *client)
+{
+    return client->inflight && client->inflightSize &&
+           (client->inflightSize & (client->inflightSize - 1)) == 0;
+}
 
-    case 0xB0: /* UNSUBACK */
-        if (client->awaitType == MQTT_OP_UNSUBSCRIBE &&
-            MQTT_CheckUnsubAck(client->rxBuf, len, client->awaitPacketId))
-            isExpected = true;
-        break;
+/* 是否注册了流式过滤器 (匹配的 PUBLISH 不需要整包放入接收区) */
+static bool MQTT_Streaming(MQTT_Client *client)
+{
+#if MQTT_ENABLE_ROUTER
+    return client->router && client->router->streamCount > 0;
+#else
+    (void)client;
+    return false;
+#endif
+}
 
-    case 0x40: /* PUBACK */
-        if (client->awaitType == MQTT_OP_PUBLISH &&
-            MQTT_CheckPubAck(client->rxBuf, len, client->awaitPacketId))
-            isExpected = true;
-        break;
+/* 判断请求槽是否属于在途窗口 */
+static bool MQTT_IsInflight(MQTT_Client *client, const MQTT_Request *req)
+{
+    return client->inflight && req >= client->inflight &&
+           req < client->inflight + client->inflightSize;
+}
 
-    case 0xD0: /* PINGRESP */
-        if (client->awaitType == MQTT_OP_PING &&
-            MQTT_CheckPingResp(client->rxBuf, len))
-            isExpected = true;
-        break;
+/* 请求是否占用着报文 ID (等待应答，或已分配 ID、在优先级队列中等待发送) */
+static bool MQTT_HoldsPacketId(const MQTT_Request *req)
+{
+    return MQTT_IsPending(req) || req->state == MQTT_REQ_QUEUED;
+}
 
-    default:
-        break;
+/* 报文 ID 是否仍在等待 ACK */
+static bool MQTT_PacketIdInUse(MQTT_Client *client, uint16_t packetId)
+{
+    for (uint8_t i = 0; i < MQTT_MAX_REQUESTS; i++)
+    {
+        if (MQTT_HoldsPacketId(&client->requests[i]) && client->requests[i].packetId == packetId)
+            return true;
     }
 
-    /* 如果确认是发送线程期待的 ACK */
-    if (isExpected)
+    if (MQTT_InflightEnabled(client))
     {
-        /* 修改标志位，唤醒发送线程 */
-        client->waitState = MQTT_WAIT_SUCCESS;
-        HAL_MQTT_Log("MQTT: Received expected ACK for Op %d\r\n", client->awaitType);
+        MQTT_Request *slot = &client->inflight[packetId & (client->inflightSize - 1)];
+        if (MQTT_HoldsPacketId(slot) && slot->packetId == packetId)
+            return true;
     }
+    return false;
 }
 
-/* ============================================================
- * 内部函数：发送 PINGREQ (非阻塞，不占用 txBuf)
- * ============================================================ */
-static void MQTT_SendPingRaw(void)
+/* 尚未确认的 QoS > 0 PUBLISH 数量 (在途窗口 + 请求表，含排队等待发送的) */
+static uint32_t MQTT_UnackedPublishes(MQTT_Client *client)
 {
-    /* PINGREQ 固定报文: 0xC0 0x00 */
-    uint8_t pingBuf[2] = {0xC0, 0x00};
-    /* 直接发送，不等待响应，响应由 ProcessLoop 的 HandleIncoming 异步处理 */
-    HAL_MQTT_Send(pingBuf, 2);
-    HAL_MQTT_Log("MQTT: KeepAlive PING sent\r\n");
+    uint32_t n = client->inflightCount;
+    for (uint8_t i = 0; i < MQTT_MAX_REQUESTS; i++)
+    {
+        const MQTT_Request *req = &client->requests[i];
+        if (MQTT_HoldsPacketId(req) && req->op == MQTT_OP_PUBLISH && req->qos > 0)
+            n++;
+    }
+    return n;
 }
 
-/* 心跳检查函数 */
-static void MQTT_MaintainKeepAlive(MQTT_Client *client)
+/* 分配下一个报文 ID：跳过 0，并跳过仍在等待 ACK 的 ID */
+static uint16_t MQTT_NextPacketId(MQTT_Client *client)
 {
-    /* 1. 如果未连接，禁止发送心跳 */
-    if (client->isConnected == false)
-        return;
+    for (;;)
+    {
+        client->packetId++;
+        /* MQTT 协议规定 PacketID 不能为 0，如果溢出回绕到 0，必须跳过变为 1 */
+        if (client->packetId == 0)
+            client->packetId = 1;
 
-    /* 2. 如果 KeepAlive=0，表示禁用心跳 */
-    if (client->keepAlive == 0)
-        return;
+        if (!MQTT_PacketIdInUse(client, client->packetId))
+        {
+            MQTT_SessionLease(client, client->packetId);
+            return client->packetId;
+        }
+    }
+}
+
+/* 在途窗口分配：找到一个下标空闲的报文 ID，窗口已满返回 NULL */
+static MQTT_Request *MQTT_AllocInflight(MQTT_Client *client, uint16_t *packetId)
+{
+    /* PUBACK 可能乱序到达，最早的槽未释放时继续向后找 */
+    for (uint16_t n = 0; n < client->inflightSize; n++)
+    {
+        uint16_t pid = MQTT_NextPacketId(client);
+        MQTT_Request *slot = &client->inflight[pid & (client->inflightSize - 1)];
+        if (slot->state == MQTT_REQ_FREE)
+        {
+            *packetId = pid;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* 查找等待指定 ACK 的请求，未找到返回 NULL */
+static MQTT_Request *MQTT_FindWaiting(MQTT_Client *client, MQTT_Operation op, uint16_t packetId, bool matchId)
+{
+    /* 在途窗口：按 packetId 直接定位，O(1) */
+    if (op == MQTT_OP_PUBLISH && matchId && MQTT_InflightEnabled(client))
+    {
+        MQTT_Request *slot = &client->inflight[packetId & (client->inflightSize - 1)];
+        if (MQTT_IsPending(slot) && slot->packetId == packetId)
+            return slot;
+    }
+
+    /* 相同类型时优先匹配截止时刻最早 (即最早发出) 的请求 (如 PINGRESP) */
+    MQTT_Request *found = NULL;
+    for (uint8_t i = 0; i < MQTT_MAX_REQUESTS; i++)
+    {
+        MQTT_Request *req = &client->requests[i];
+        if (!MQTT_IsPending(req) || req->op != op || (matchId && req->packetId != packetId))
+            continue;
+        if (!found || (int32_t)(req->timer.expire - found->timer.expire) < 0)
+            found = req;
+    }
+    return found;
+}
+
+/* 定时器到期：按定时器所属的对象分发 (调用方必须持有 HAL_MQTT_Lock) */
+static void MQTT_TimerExpired(MQTT_Client *client, MQTT_Timer *timer)
+{
+    if (timer == &client->keepAliveTimer)
+        MQTT_KeepAliveTimeout(client);
+    else if (timer == &client->batchTimer)
+        MQTT_BatchFlush(client, MQTT_FLUSH_LINGER);
+    else if (timer == &client->rateTimer)
+        MQTT_RateDrain(client);
+    else
+        MQTT_ExpireRequest(client, (MQTT_Request *)((uint8_t *)timer - offsetof(MQTT_Request, timer)));
+}
+
+#if MQTT_ENABLE_TIMER_WHEEL
+
+/* 时间轮回调 */
+static void MQTT_WheelCallback(timer_wheel_t *tw, tw_timer_t *timer, void *ctx)
+{
+    (void)tw;
+    MQTT_TimerExpired((MQTT_Client *)ctx, timer);
+}
+
+/* 取得客户端的时间轮 (首次使用时初始化) */
+static timer_wheel_t *MQTT_Timers(MQTT_Client *client)
+{
+    if (!client->timers.slots)
+        tw_init(&client->timers, client->timerSlots, MQTT_TIMER_SLOTS, HAL_MQTT_GetTick());
+    return &client->timers;
+}
+
+/* 启动定时器 (已启动则按新的到期时刻重新计时)，O(1) */
+static void MQTT_TimerStart(MQTT_Client *client, MQTT_Timer *timer, uint32_t expire)
+{
+    timer_wheel_t *tw = MQTT_Timers(client);
+    tw_stop(tw, timer);
+    tw_timer_init(timer, MQTT_WheelCallback, client);
+    tw_start(tw, timer, expire);
+}
+
+/* 停止定时器 (未启动则忽略)，O(1) */
+static void MQTT_TimerStop(MQTT_Client *client, MQTT_Timer *timer)
+{
+    tw_stop(&client->timers, timer);
+}
+
+/* 触发所有到期的定时器 */
+static void MQTT_TimersRun(MQTT_Client *client, uint32_t now)
+{
+    tw_advance(MQTT_Timers(client), now);
+}
+
+/* 距离最早到期的定时器的时间 (没有启动的定时器时为 UINT32_MAX) */
+static uint32_t MQTT_TimersNextDelay(MQTT_Client *client, uint32_t now)
+{
+    return tw_next_delay(MQTT_Timers(client), now);
+}
+
+#else
+
+/* 启动定时器 (已启动则按新的到期时刻重新计时) */
+static void MQTT_TimerStart(MQTT_Client *client, MQTT_Timer *timer, uint32_t expire)
+{
+    (void)client;
+    timer->expire = expire;
+    timer->active = true;
+}
+
+/* 停止定时器 (未启动则忽略) */
+static void MQTT_TimerStop(MQTT_Client *client, MQTT_Timer *timer)
+{
+    (void)client;
+    timer->active = false;
+}
+
+/* 取第 i 个可能启动的定时器：3 个固定定时器，之后是请求表，在途窗口只在有在途请求时检查 */
+static MQTT_Timer *MQTT_TimerAt(MQTT_Client *client, uint32_t i)
+{
+    MQTT_Timer *fixed[3] = {&client->keepAliveTimer, &client->batchTimer, &client->rateTimer};
+
+    if (i < 3)
+        return fixed[i];
+    i -= 3;
+    if (i < MQTT_MAX_REQUESTS)
+        return &client->requests[i].timer;
+    i -= MQTT_MAX_REQUESTS;
+    if (client->inflightCount > 0 && MQTT_InflightEnabled(client) && i < client->inflightSize)
+        return &client->inflight[i].timer;
+    return NULL;
+}
 
-    uint32_t currentTick = HAL_MQTT_GetTick();
-    uint32_t keepAliveMs = client->keepAlive * 1000;
+/* 逐个检查并触发到期的定时器 (回调中重新启动的定时器按新的到期时刻等待) */
+static void MQTT_TimersRun(MQTT_Client *client, uint32_t now)
+{
+    MQTT_Timer *timer;
 
-    /* 检查时间差是否超过 KeepAlive 的一半 */
-    /* 注意：必须正确处理时间回绕 */
-    if (currentTick - client->lastActiveTick > (keepAliveMs / 2))
+    for (uint32_t i = 0; (timer = MQTT_TimerAt(client, i)) != NULL; i++)
     {
-        /* 发送 PINGREQ */
-        MQTT_SendPingRaw();
+        if (timer->active && (int32_t)(now - timer->expire) >= 0)
+        {
+            timer->active = false;
+            MQTT_TimerExpired(client, timer);
+        }
+    }
+}
 
-        /* [Bug修正]：防止 PING 洪水攻击。
-         * 我们不能简单的 +=5000，因为如果断网很久，old + 5000 依然远小于 current。
-         * 正确的做法是：假装我们在 "超时期限前5秒" 发送了心跳。
-         * 这样如果 5秒内没收到 PINGRESP (刷新 lastActiveTick)，
-         * ProcessLoop 会再次进入这里重发 PING。
-         */
-        client->lastActiveTick = currentTick - (keepAliveMs / 2) + 5000;
+/* 距离最早到期的定时器的时间 (没有启动的定时器时为 UINT32_MAX) */
+static uint32_t MQTT_TimersNextDelay(MQTT_Client *client, uint32_t now)
+{
+    uint32_t wait = UINT32_MAX;
+    MQTT_Timer *timer;
 
-        /* 或者更简单的策略：暂时更新为当前时间，视为一次“尝试活动”。
-           如果服务器不回包，应用层应该通过其他机制（如检测 PINGRESP 超时）来断开连接。
-           但在轻量级实现中，上面的策略能保证 5秒重发一次 PING。
-        */
+    for (uint32_t i = 0; (timer = MQTT_TimerAt(client, i)) != NULL; i++)
+    {
+        if (!timer->active)
+            continue;
+        int32_t remain = (int32_t)(timer->expire - now);
+        if (remain <= 0)
+            return 0;
+        if ((uint32_t)remain < wait)
+            wait = (uint32_t)remain;
     }
+    return wait;
 }
 
-/* * 接收主循环 (消费者)
- * 作用：一直运行，负责从硬件读取数据，并调用 HandleIncoming 进行处理
- */
-void MQTT_ProcessLoop(MQTT_Client *client)
+#endif
+
+/* 启动请求的超时定时器 (已启动则按新的截止时刻重新计时) */
+static void MQTT_TimerInsert(MQTT_Client *client, MQTT_Request *req, uint32_t deadline)
 {
-    if (!client)
+    MQTT_TimerStart(client, &req->timer, deadline);
+}
+
+/* 停止请求的超时定时器 (未启动则忽略) */
+static void MQTT_TimerRemove(MQTT_Client *client, MQTT_Request *req)
+{
+    MQTT_TimerStop(client, &req->timer);
+}
+
+/* --------------------------------------------------------------------------
+ * 字节环形区 (接收分帧与批处理共用，语义与 ring_buffer 的软件模式相同)
+ * -------------------------------------------------------------------------- */
+
+/* 初始化环形区 (size 必须是 2 的幂且不小于 2) */
+static bool MQTT_RingInit(MQTT_Ring *rb, uint8_t *buffer, uint32_t size)
+{
+    if (!buffer || size < 2 || (size & (size - 1)) != 0)
+        return false;
+    rb->buffer = buffer;
+    rb->size = size;
+    rb->mask = size - 1;
+    rb->head = 0;
+    rb->tail = 0;
+    return true;
+}
+
+/* 已写入、尚未读取的字节数 */
+static uint32_t MQTT_RingCount(const MQTT_Ring *rb)
+{
+    return (rb->head - rb->tail) & rb->mask;
+}
+
+/* 丢弃 len 字节 (超过已有数据时全部丢弃) */
+static void MQTT_RingSkip(MQTT_Ring *rb, uint32_t len)
+{
+    uint32_t count = MQTT_RingCount(rb);
+    rb->tail = (rb->tail + ((len < count) ? len : count)) & rb->mask;
+}
+
+/* 写入数据，回绕时分两段复制 (调用者保证空闲空间足够) */
+static void MQTT_RingWrite(MQTT_Ring *rb, const uint8_t *data, uint32_t len)
+{
+    if (len == 0)
+        return;
+    uint32_t first = rb->size - rb->head;
+    if (first > len)
+        first = len;
+    memcpy(&rb->buffer[rb->head], data, first);
+    memcpy(rb->buffer, data + first, len - first);
+    rb->head = (rb->head + len) & rb->mask;
+}
+
+/* 连续的空闲段 (到环形区末尾为止)，已满时返回 NULL */
+static uint8_t *MQTT_RingWriteSpace(MQTT_Ring *rb, uint32_t *len)
+{
+    uint32_t space = (rb->size - 1) - MQTT_RingCount(rb);
+    uint32_t toEnd = rb->size - rb->head;
+    *len = (space < toEnd) ? space : toEnd;
+    return (*len > 0) ? &rb->buffer[rb->head] : NULL;
+}
+
+/* 提交直接写入空闲段的 len 字节 (不超过空闲空间) */
+static void MQTT_RingCommit(MQTT_Ring *rb, uint32_t len)
+{
+    uint32_t space = (rb->size - 1) - MQTT_RingCount(rb);
+    rb->head = (rb->head + ((len < space) ? len : space)) & rb->mask;
+}
+
+/* 批处理是否启用 (首次使用时初始化环形缓冲区) */
+static bool MQTT_BatchEnabled(MQTT_Client *client)
+{
+    if (!client->batchBuf)
+        return false;
+    if (!client->batchRing.buffer && !MQTT_RingInit(&client->batchRing, client->batchBuf, client->batchBufSize))
+        return false;
+    return true;
+}
+
+/* 把批处理缓冲区的内容一次写给传输层 (回绕时为两个数据段) */
+static void MQTT_BatchFlush(MQTT_Client *client, MQTT_FlushReason reason)
+{
+    if (client->batchCount == 0)
         return;
 
-    /* 1. 尝试接收数据
-       建议 timeout 设置为短时间 (如 50ms)，以便让线程有机会处理其他事务或退出。
-       如果是在裸机 while(1) 中调用，timeout 可以设为 0 或 1。 */
-    int rlen = HAL_MQTT_Recv(client->rxBuf, client->rxBufSize, 50);
+    MQTT_Ring *rb = &client->batchRing;
+    uint32_t total = MQTT_RingCount(rb);
+    MQTT_IoVec iov[2];
+    size_t cnt = 0;
+    uint32_t len = rb->size - rb->tail;
+    if (len > total)
+        len = total;
+
+    iov[cnt].base = &rb->buffer[rb->tail];
+    iov[cnt++].len = len;
+    if (len < total)
+    {
+        /* 数据跨越缓冲区末尾，第二段从缓冲区开头开始 */
+        iov[cnt].base = rb->buffer;
+        iov[cnt++].len = total - len;
+    }
+    MQTT_TransportSendV(client, iov, cnt);
+    MQTT_RingSkip(rb, total);
+
+    /* 更新统计 */
+    MQTT_BatchStats *st = &client->batchStats;
+    uint32_t now = HAL_MQTT_GetTick();
+    st->batches++;
+    st->packets += client->batchCount;
+    st->bytes += total;
+    st->lastPackets = client->batchCount;
+    st->lastBytes = total;
+    st->lastLingerMs = now - client->batchStartTick;
+    if (st->lastLingerMs > st->maxLingerMs)
+        st->maxLingerMs = st->lastLingerMs;
+    st->byReason[reason]++;
+
+    client->batchCount = 0;
+    client->lastActiveTick = now;
+    MQTT_TimerStop(client, &client->batchTimer);
+}
+
+/* 把一个已编码的报文 (分散数据段) 追加到批处理缓冲区，返回 false 表示放不下，需要直接发送 */
+static bool MQTT_BatchAppend(MQTT_Client *client, const MQTT_IoVec *iov, size_t cnt)
+{
+    MQTT_Ring *rb = &client->batchRing;
+    uint32_t total = 0;
+    for (size_t i = 0; i < cnt; i++)
+        total += (uint32_t)iov[i].len;
+
+    /* 单个报文超过缓冲区容量：先发出已积累的报文，再由调用者直接发送 */
+    if (total > rb->size - 1)
+    {
+        MQTT_BatchFlush(client, MQTT_FLUSH_ORDER);
+        return false;
+    }
+
+    if (total > (rb->size - 1) - MQTT_RingCount(rb))
+        MQTT_BatchFlush(client, MQTT_FLUSH_FULL);
+
+    for (size_t i = 0; i < cnt; i++)
+        MQTT_RingWrite(rb, (const uint8_t *)iov[i].base, (uint32_t)iov[i].len);
 
-    /* 如果读到了数据 */
-    if (rlen > 0)
+    if (client->batchCount++ == 0)
     {
-        MQTT_HandleIncoming(client, (size_t)rlen);
+        client->batchStartTick = HAL_MQTT_GetTick();
+        MQTT_TimerStart(client, &client->batchTimer, client->batchStartTick + client->batchLingerMs);
     }
 
-    /* 2. 检查并维持心跳 (在断开连接情况下会自动跳过) */
-    MQTT_MaintainKeepAlive(client);
+    /* 达到阈值立即发送 */
+    if (client->batchMaxBytes && MQTT_RingCount(rb) >= client->batchMaxBytes)
+        MQTT_BatchFlush(client, MQTT_FLUSH_BYTES);
+    else if (client->batchMaxCount && client->batchCount >= client->batchMaxCount)
+        MQTT_BatchFlush(client, MQTT_FLUSH_COUNT);
+    return true;
+}
+
+/* 在 rxBuf 中选取环形区大小 (2^n)，使可接收的最大报文 = min(环形区 - 1, 拼接区) 尽量大
+ * 返回值: 最大报文长度 (< 2 表示 rxBuf 太小)，ringSize 返回对应的环形区大小 */
+static uint32_t MQTT_RxLayout(size_t rxBufSize, uint32_t *ringSize)
+{
+    uint32_t size = (rxBufSize > 0x80000000u) ? 0x80000000u : (uint32_t)rxBufSize;
+    uint32_t ring = 1;
+    uint32_t best = 0, bestRing = 0;
+
+    while (ring != 0 && ring <= size)
+    {
+        uint32_t maxPkt = ring - 1;
+        if (size - ring < maxPkt)
+            maxPkt = size - ring;
+        if (maxPkt >= best)
+        {
+            best = maxPkt;
+            bestRing = ring;
+        }
+        ring <<= 1;
+    }
+
+    if (ringSize)
+        *ringSize = bestRing;
+    return best;
 }
 
 /* ============================================================
- * 核心：发送操作 (Sender Function)
+ * MQTT 5 主题别名 (调用方必须持有 HAL_MQTT_Lock)
  * ============================================================ */
 
-/* * 执行 MQTT 操作
- * 作用：构建报文 -> 发送 -> 设置等待标志 -> 轮询等待标志变更
+/* 可用的别名数量：别名表容量与服务器 Topic Alias Maximum 的较小者 */
+static uint16_t MQTT_AliasCapacity(MQTT_Client *client)
+{
+    if (client->protocolVersion != MQTT_VERSION_5 || !client->topicAliases)
+        return 0;
+    return (client->topicAliasCount < client->serverTopicAliasMax) ? client->topicAliasCount
+                                                                     : client->serverTopicAliasMax;
+}
+
+/* * 为 Topic 选择别名
+ * 已约定过的 Topic 返回其表项 (*known = true)；否则返回空闲或最久未用的表项 (*known = false)，
+ * 发出报文后由 MQTT_AliasCommit 记录新的约定
+ * 返回值: 表项下标 (别名 = 下标 + 1)，-1 表示不使用别名
  */
-bool MQTT_TryOperation(MQTT_Client *client, MQTT_Operation op)
+static int MQTT_AliasLookup(MQTT_Client *client, const char *topic, uint16_t topicLen, bool *known)
+{
+    uint16_t cap = MQTT_AliasCapacity(client);
+
+    /* 别名属性本身占 3 字节，不长于它的 Topic 没有收益 */
+    if (cap == 0 || topicLen <= 3 || topicLen > MQTT_ALIAS_TOPIC_MAX)
+        return -1;
+
+    int victim = -1;
+    for (uint16_t i = 0; i < cap; i++)
+    {
+        MQTT_TopicAlias *a = &client->topicAliases[i];
+        if (a->topicLen == topicLen && memcmp(a->topic, topic, topicLen) == 0)
+        {
+            *known = true;
+            return i;
+        }
+
+        /* 淘汰候选：优先空闲表项，其次最久未使用的 */
+        const MQTT_TopicAlias *v = (victim >= 0) ? &client->topicAliases[victim] : NULL;
+        if (!v || (v->topicLen != 0 && (a->topicLen == 0 || (int32_t)(a->lastUse - v->lastUse) < 0)))
+            victim = i;
+    }
+
+    *known = false;
+    return victim;
+}
+
+/* 报文已发出：刷新 LRU 序号，新约定的别名记录 Topic */
+static void MQTT_AliasCommit(MQTT_Client *client, int idx, const char *topic, uint16_t topicLen, bool known)
+{
+    MQTT_TopicAlias *a = &client->topicAliases[idx];
+    a->lastUse = ++client->aliasClock;
+
+    if (known)
+    {
+        client->stats.aliasHits++;
+        client->stats.aliasBytesSaved += topicLen - 3u;
+        return;
+    }
+    memcpy(a->topic, topic, topicLen);
+    a->topicLen = topicLen;
+}
+
+/* 新连接：别名约定失效，服务器限制恢复为协议默认值，等待 CONNACK 重新声明 */
+static void MQTT_ResetSession5(MQTT_Client *client)
+{
+    if (client->topicAliases)
+    {
+        for (uint16_t i = 0; i < client->topicAliasCount; i++)
+            client->topicAliases[i].topicLen = 0;
+    }
+    client->serverReceiveMax = 0xFFFF;
+    client->serverMaxPacket = 0;
+    client->serverTopicAliasMax = 0;
+}
+
+/* 构建并发送请求；需要 ACK 的请求会启动超时定时器 */
+static bool MQTT_SendRequest(MQTT_Client *client, MQTT_Request *req, uint8_t dup)
 {
-    if (!client)
-        return false;
     uint32_t len = 0;
 
-    /* 1. 构建报文 (Tx 阶段) */
+    uint8_t version = (client->protocolVersion == MQTT_VERSION_5) ? MQTT_VERSION_5 : MQTT_VERSION_3_1_1;
+
+    /* PUBLISH 走分散发送：报文头在栈上构建，Topic 和 Payload 直接引用原始内存 */
+    uint8_t hdr[MQTT_PUBLISH_HDR_MAX];
+    uint8_t pidBuf[2];
+    uint8_t props[MQTT_PUBLISH_PROPS_MAX];
+    MQTT_IoVec iov[4 + MQTT_MAX_IOV];
+    size_t iovCnt = 0;
+    uint32_t wireLen = 0;
+    int alias = -1;
+    bool aliasKnown = false;
+
     /* 根据操作类型调用对应的构建函数 */
-    switch (op)
+    switch (req->op)
     {
     case MQTT_OP_CONNECT:
-        len = MQTT_BuildConnectPacket(client->txBuf, client->txBufSize, client->clientId, client->userName, client->password, client->keepAlive, client->cleanSession);
+#if MQTT_ENABLE_ROUTER
+        /* 新连接：上一个连接中未收完的流式消息由接收线程结束 */
+        client->rxStreamReset = true;
+#endif
+        if (version == MQTT_VERSION_5)
+        {
+            /* Receive Maximum 为接收方向 QoS 2 状态表容量，服务器同时等待 PUBCOMP 的消息不会超过它 */
+            /* 注册了流式过滤器时不限制报文大小，大消息由流式接收处理 */
+            MQTT_ResetSession5(client);
+            bool streaming = MQTT_Streaming(client);
+            len = MQTT_BuildConnectPacketV5(client->txBuf, client->txBufSize, client->clientId, client->userName,
+                                            client->password, client->keepAlive, client->cleanSession,
+                                            MQTT_RX_QOS2_MAX,
+                                            streaming ? 0 : MQTT_RxLayout(client->rxBufSize, NULL));
+        }
+        else
+        {
+            len = MQTT_BuildConnectPacket(client->txBuf, client->txBufSize, client->clientId, client->userName, client->password, client->keepAlive, client->cleanSession);
+        }
         break;
     case MQTT_OP_SUBSCRIBE:
-        len = MQTT_BuildSubscribePacket(client->txBuf, client->txBufSize, client->subTopic, client->packetId, client->qos);
+        len = MQTT_BuildSubscribe(client->txBuf, client->txBufSize, req->topic, req->packetId, req->qos, false, version);
         break;
     case MQTT_OP_UNSUBSCRIBE:
-        len = MQTT_BuildUnsubscribePacket(client->txBuf, client->txBufSize, client->subTopic, client->packetId);
+        len = MQTT_BuildSubscribe(client->txBuf, client->txBufSize, req->topic, req->packetId, 0, true, version);
         break;
     case MQTT_OP_PUBLISH:
-        /* 自动管理 PacketID */
-        /* 无论是 QoS 1 还是 QoS 0，都进行自增，确保 ID 唯一且流动 */
-        client->packetId++;
-        /* MQTT 协议规定 PacketID 不能为 0，如果溢出回绕到 0，必须跳过变为 1 */
-        if (client->packetId == 0)
-            client->packetId = 1;
-        len = MQTT_BuildPublishPacket(client->txBuf, client->txBufSize, client->pubTopic, client->pubMsg, client->packetId, 0, client->qos, client->retain);
+    {
+        /* QoS 2 第二阶段：发送 (或重发) PUBREL */
+        if (req->state == MQTT_REQ_WAIT_COMP)
+        {
+            len = MQTT_BuildAckPacket(client->txBuf, client->txBufSize, 0x60, req->packetId);
+            break;
+        }
+
+        size_t payloadLen = 0;
+        iovCnt = 4;
+        if (req->iov)
+        {
+            for (uint8_t i = 0; i < req->iovCnt; i++)
+            {
+                iov[iovCnt++] = req->iov[i];
+                payloadLen += req->iov[i].len;
+            }
+        }
+        else
+        {
+            iov[iovCnt].base = req->msg;
+            iov[iovCnt].len = strlen(req->msg);
+            payloadLen = iov[iovCnt++].len;
+        }
+
+        /* MQTT 5：PacketID 之后是属性区，可携带主题别名；已约定的别名只发送别名，Topic 为空。
+         * 重发时服务器未必处理过首次发送，发送完整 Topic 且不带别名 */
+        uint16_t topicLen = req->topicLen;
+        uint32_t propsLen = 0;
+        if (version == MQTT_VERSION_5)
+        {
+            if (!dup)
+                alias = MQTT_AliasLookup(client, req->topic, req->topicLen, &aliasKnown);
+            propsLen = 1;
+            if (alias >= 0)
+            {
+                propsLen += MQTT_PropWrite(&props[1], MQTT_PROP_TOPIC_ALIAS, (uint32_t)alias + 1);
+                if (aliasKnown)
+                    topicLen = 0;
+            }
+            props[0] = (uint8_t)(propsLen - 1);
+        }
+
+        /* 重发的 PUBLISH 报文必须将 DUP 标志置 1 (属性区计入剩余长度) */
+        len = MQTT_BuildPublishHeader(hdr, sizeof(hdr), topicLen, payloadLen + propsLen, dup, req->qos, req->retain);
+        if (len == 0 || (req->qos > 0 && req->packetId == 0))
+            return false;
+
+        pidBuf[0] = (uint8_t)(req->packetId >> 8);
+        pidBuf[1] = (uint8_t)req->packetId;
+        iov[0].base = hdr;
+        iov[0].len = len;
+        iov[1].base = req->topic;
+        iov[1].len = topicLen;
+        iov[2].base = pidBuf;
+        iov[2].len = (req->qos > 0) ? 2 : 0;
+        iov[3].base = props;
+        iov[3].len = propsLen;
+        wireLen = len + topicLen + (uint32_t)iov[2].len + propsLen + (uint32_t)payloadLen;
         break;
+    }
     case MQTT_OP_PING:
         len = MQTT_BuildPingReqPacket(client->txBuf, client->txBufSize);
         break;
@@ -750,99 +1571,2536 @@ bool MQTT_TryOperation(MQTT_Client *client, MQTT_Operation op)
         len = MQTT_BuildDisconnectPacket(client->txBuf, client->txBufSize);
         break;
     default:
-        return false;
+        break;
     }
 
     /* 构建失败或缓冲区不足 */
     if (len == 0)
         return false;
 
-    /* ----------------------------------------------------
-     * 特殊情况：不需要等待 ACK 的操作
-     * ---------------------------------------------------- */
-    if ((op == MQTT_OP_PUBLISH && client->qos == 0) ||
-        op == MQTT_OP_DISCONNECT)
+    /* MQTT 5：超过服务器 Maximum Packet Size 的报文不能发送 */
+    if (iovCnt == 0)
+        wireLen = len;
+    if (client->serverMaxPacket && wireLen > client->serverMaxPacket)
     {
-        /* 直接发送并返回成功 */
-        HAL_MQTT_Send(client->txBuf, len);
-        client->lastActiveTick = HAL_MQTT_GetTick();
-        /* 如果是主动断开，标记为未连接 */
-        if (op == MQTT_OP_DISCONNECT)
-        {
-            client->isConnected = false;
-            HAL_MQTT_Log("MQTT: Disconnected by user\r\n");
-        }
-        return true;
+        HAL_MQTT_Log("MQTT: Packet exceeds server maximum (%u)\r\n", (unsigned)wireLen);
+        return false;
     }
+    if (alias >= 0)
+        MQTT_AliasCommit(client, alias, req->topic, req->topicLen, aliasKnown);
 
-    /* ----------------------------------------------------
-     * 正常情况：需要等待 ACK (带重试机制)
-     * ---------------------------------------------------- */
-    for (uint8_t attempt = 0; attempt < client->maxRetrys; attempt++)
+    uint32_t now = HAL_MQTT_GetTick();
+
+    /* 先登记“我期待什么 ACK”，再发送。
+     * 接收线程匹配 ACK 前同样需要持锁，因此即使 ACK 回来得极快也能正确处理 */
+    if (MQTT_NeedsAck(req->op, req->qos))
+    {
+        req->attempts++;
+        MQTT_TimerInsert(client, req, now + client->retryIntervalMs);
+    }
+
+    HAL_MQTT_Log("MQTT: Sending Op %d (Attempt %d)\r\n", req->op, req->attempts);
+    if (req->op == MQTT_OP_PUBLISH && !dup && req->state != MQTT_REQ_WAIT_COMP)
+        client->stats.publishOut++;
+
+    if (MQTT_BatchEnabled(client))
     {
-        HAL_MQTT_Log("MQTT: Sending Op %d (Attempt %d)\r\n", op, attempt + 1);
+        /* QoS 0 PUBLISH 进入批处理缓冲区，等待阈值触发后合并发送 */
+        if (req->op == MQTT_OP_PUBLISH && req->qos == 0 && MQTT_BatchAppend(client, iov, iovCnt))
+            return true;
 
-        /* [修复]如果是 PUBLISH 报文的重发，必须将 DUP 标志置 1 */
-        /* MQTT 固定报头 Byte 1: Type(4) | DUP(1) | QoS(2) | Retain(1) */
-        /* Bit 3 是 DUP 位，0x08 = 0000 1000 */
-        if (attempt > 0 && op == MQTT_OP_PUBLISH)
+        if (req->op == MQTT_OP_CONNECT)
         {
-            client->txBuf[0] |= 0x08;
+            /* 重新连接：上一个连接中未发出的 QoS 0 报文直接丢弃 */
+            MQTT_RingSkip(&client->batchRing, MQTT_RingCount(&client->batchRing));
+            client->batchCount = 0;
+            MQTT_TimerStop(client, &client->batchTimer);
         }
+        else
+        {
+            /* 其他报文立即发送，先发出已积累的报文以保持发送顺序 */
+            MQTT_BatchFlush(client, MQTT_FLUSH_ORDER);
+        }
+    }
 
-        /* A. 在发送前，先设置好“我期待什么 ACK” */
-        /* 这样能保证即使 ACK 回来得极快，Receiver 也能正确处理 */
-        client->awaitType = op;
-        client->awaitPacketId = client->packetId;
-        client->waitState = MQTT_WAIT_BUSY; /* 状态：忙碌中 */
-
-        /* B. 发送数据 */
-        HAL_MQTT_Send(client->txBuf, len);
+    if (iovCnt > 0)
+        MQTT_TransportSendV(client, iov, iovCnt);
+    else
+        MQTT_TransportSend(client, client->txBuf, len);
+    client->lastActiveTick = now;
+    return true;
+}
 
-        /* C. 等待循环 (Wait Loop) */
-        /* 这里不读 HAL_Recv，只检查 waitState 变量是否被 Receiver 线程修改 */
-        uint32_t startTick = HAL_MQTT_GetTick();
-        bool isTimeout = false;
+#if MQTT_ENABLE_POOL
+/* * 把 Topic 与 Payload 复制到内存池中的一块，布局为 [MQTT_IoVec][Topic\0][Payload]
+ * 成功后 topic / iov 指向副本，调用者可以立即释放原数据；返回 NULL 表示池中没有足够大的空闲块
+ * 设置了压缩时 Payload 区按原始长度 + 2 申请，写入压缩帧或原始数据 (raw 为 true 时原样复制：已是发送格式，如恢复的会话记录)
+ */
+static void *MQTT_PoolCopy(MQTT_Client *client, MQTT_Operation op, bool raw, const char **topic, size_t topicLen,
+                           const MQTT_IoVec **iov, size_t *iovCnt)
+{
+    MQTT_IoVec msg;
+    const MQTT_IoVec *src = NULL;
+    size_t n = 0;
+    size_t payloadLen = 0;
 
-        while (client->waitState == MQTT_WAIT_BUSY)
+    if (op == MQTT_OP_PUBLISH)
+    {
+        src = *iov;
+        n = *iovCnt;
+        if (!src)
         {
-            /* 检查是否超时 */
-            if (HAL_MQTT_GetTick() - startTick > client->retryIntervalMs)
-            {
-                isTimeout = true;
-                break;
-            }
-
-            /* 适当延时，让出 CPU 给 Receiver 线程运行 */
-            HAL_MQTT_Delay(5);
+            msg.base = client->pubMsg;
+            msg.len = strlen(client->pubMsg);
+            src = &msg;
+            n = 1;
         }
+        for (size_t i = 0; i < n; i++)
+            payloadLen += src[i].len;
+    }
 
-        /* D. 检查结果 */
-        if (!isTimeout && client->waitState == MQTT_WAIT_SUCCESS)
+#if MQTT_ENABLE_COMPRESS
+    bool compress = op == MQTT_OP_PUBLISH && !raw && client->compress && client->compress->work;
+    size_t payloadCap = compress ? MQTT_COMPRESS_OUT_SIZE(payloadLen) : payloadLen;
+#else
+    size_t payloadCap = payloadLen;
+    (void)raw;
+#endif
+    size_t need = sizeof(MQTT_IoVec) + topicLen + 1 + payloadCap;
+    if (need > UINT32_MAX)
+        return NULL;
+
+    uint8_t *block = (uint8_t *)mp_alloc(client->pool, (uint32_t)need);
+    if (!block)
+        return NULL;
+
+    MQTT_IoVec *vec = (MQTT_IoVec *)block;
+    char *t = (char *)(vec + 1);
+    memcpy(t, *topic, topicLen);
+    t[topicLen] = 0;
+
+    uint8_t *p = (uint8_t *)t + topicLen + 1;
+    vec->base = p;
+    vec->len = payloadLen;
+#if MQTT_ENABLE_COMPRESS
+    if (compress)
+    {
+        /* 编码器工作内存由所有发送任务共用 */
+        HAL_MQTT_Lock();
+        vec->len = MQTT_CompressPayload(client->compress, src, n, p, payloadCap);
+        HAL_MQTT_Unlock();
+    }
+    else
+#endif
+    {
+        for (size_t i = 0; i < n; i++)
         {
-            client->waitState = MQTT_WAIT_IDLE; /* 清除状态 */
-            /* 如果是连接操作成功，标记为已连接 */
-            if (op == MQTT_OP_CONNECT)
-            {
-                client->isConnected = true;
-                client->lastActiveTick = HAL_MQTT_GetTick(); /* 初始化心跳计时 */
-                HAL_MQTT_Log("MQTT: lastActiveTick update\r\n");
-            }
-            return true;                        /* 操作成功 */
+            memcpy(p, src[i].base, src[i].len);
+            p += src[i].len;
         }
+    }
 
-        HAL_MQTT_Log("MQTT: Wait ACK Timeout\r\n");
-        /* 如果超时，循环继续，进行下一次重发 */
+    *topic = t;
+    if (op == MQTT_OP_PUBLISH)
+    {
+        *iov = vec;
+        *iovCnt = 1;
     }
+    return block;
+}
+#endif
 
-    /* 重试次数耗尽，操作失败 */
-    client->waitState = MQTT_WAIT_IDLE;
+/* 归还内存池中的一块 (为 NULL 时忽略) */
+static void MQTT_PoolFree(MQTT_Client *client, void *block)
+{
+#if MQTT_ENABLE_POOL
+    mp_free(client->pool, block);
+#else
+    (void)client;
+    (void)block;
+#endif
+}
 
-    /* 如果连接尝试失败，确保标志位为 false */
-    if (op == MQTT_OP_CONNECT)
+/* 归还请求在内存池中的副本 */
+static void MQTT_PoolRelease(MQTT_Client *client, MQTT_Request *req)
+{
+#if MQTT_ENABLE_POOL
+    if (req->block)
     {
-        client->isConnected = false;
+        mp_free(client->pool, req->block);
+        req->block = NULL;
+    }
+#else
+    (void)client;
+    (void)req;
+#endif
+}
+
+#if MQTT_ENABLE_STORE || MQTT_ENABLE_SESSION
+/* 取得 PUBLISH 的 Payload 数据段 (没有 iov 时以 msg 构成一段，放在调用者提供的 msg 中) */
+static const MQTT_IoVec *MQTT_RequestPayload(const MQTT_Request *req, MQTT_IoVec *msg, size_t *n)
+{
+    if (req->iov)
+    {
+        *n = req->iovCnt;
+        return req->iov;
     }
+    msg->base = req->msg;
+    msg->len = strlen(req->msg);
+    *n = 1;
+    return msg;
+}
+#endif
+
+/* 是否为离线队列的补发请求 (消息本身就在队列里，不复制、不重复存入) */
+static bool MQTT_IsStoreDrain(MQTT_Callback cb)
+{
+#if MQTT_ENABLE_STORE
+    return cb == MQTT_StoreCallback;
+#else
+    (void)cb;
     return false;
+#endif
 }
 
+/* 把未送达的 PUBLISH 存入离线队列 (补发中的消息本身就在队列里，不再重复存入) */
+static bool MQTT_StoreRequest(MQTT_Client *client, MQTT_Request *req)
+{
+#if MQTT_ENABLE_STORE
+    if (!client->store || req->op != MQTT_OP_PUBLISH || MQTT_IsStoreDrain(req->cb))
+        return false;
+
+    MQTT_IoVec msg;
+    size_t n;
+    const MQTT_IoVec *payload = MQTT_RequestPayload(req, &msg, &n);
+
+    if (!MQTT_StoreAppend(client->store, req->topic, req->topicLen, payload, n, req->qos, req->retain))
+    {
+        HAL_MQTT_Log("MQTT: Offline store full\r\n");
+        return false;
+    }
+    return true;
+#else
+    (void)client;
+    (void)req;
+    return false;
+#endif
+}
+
+/* 结束请求：停止超时定时器，等待 ProcessLoop 触发回调 (无回调则直接释放) */
+static void MQTT_CompleteRequest(MQTT_Client *client, MQTT_Request *req, MQTT_Result result)
+{
+    MQTT_TimerRemove(client, req);
+
+    /* 还在优先级队列中 (如同步等待超时被取消)：先移出队列 */
+    if (req->state == MQTT_REQ_QUEUED)
+        MQTT_PrioRemove(client, req);
+
+    /* 重试耗尽的发布存入离线队列，连接恢复后补发 */
+    if (result == MQTT_RESULT_TIMEOUT && MQTT_StoreRequest(client, req))
+        result = MQTT_RESULT_STORED;
+
+    /* 不再需要重发，归还内存池中的副本 */
+    MQTT_SessionLogDone(client, req);
+    MQTT_PoolRelease(client, req);
+
+    /* 确认延迟：从提交到收到 PUBACK (QoS 1) / PUBCOMP (QoS 2) */
+    if (result == MQTT_RESULT_OK && req->op == MQTT_OP_PUBLISH && req->qos > 0 && client->stats.ackLatency)
+        MQTT_HistogramRecord(client->stats.ackLatency, HAL_MQTT_GetTick() - req->submitTick);
+
+    req->result = result;
+    req->state = req->cb ? MQTT_REQ_DONE : MQTT_REQ_FREE;
+
+    if (MQTT_IsInflight(client, req))
+    {
+        client->inflightCount--;
+        if (req->cb)
+            client->inflightDone++;
+    }
+
+    /* 连接失败或被拒绝，确保标志位为 false */
+    if (req->op == MQTT_OP_CONNECT && result != MQTT_RESULT_OK)
+        client->isConnected = false;
+}
+
+/* ============================================================
+ * 限速与优先级调度 (调用方必须持有 HAL_MQTT_Lock)
+ * 令牌桶按字节计费：写给传输层的每个字节消耗一个令牌，令牌可以透支为负；
+ * 只有令牌为正时才从优先级队列放行下一条，因此平均速率不超过 rateBytesPerSec，
+ * 突发不超过 rateBurst 加一个报文。队列之间按 Deficit Round Robin 加权公平调度。
+ * ============================================================ */
+
+/* 按经过的时间补充令牌，最多补满令牌桶 */
+static void MQTT_RateRefill(MQTT_Client *client, uint32_t now)
+{
+    uint32_t burst = client->rateBurst ? client->rateBurst : client->rateBytesPerSec;
+    if (burst > INT32_MAX)
+        burst = INT32_MAX;
+
+    /* 以千分之一字节为单位累计，低速率下频繁调用也不会丢失零头 */
+    uint64_t acc = (uint64_t)(now - client->rateTick) * client->rateBytesPerSec + client->rateFrac;
+    int64_t tokens = (int64_t)client->rateTokens + (int64_t)(acc / 1000);
+    client->rateTick = now;
+    client->rateFrac = (uint32_t)(acc % 1000);
+    if (tokens >= (int64_t)burst)
+    {
+        tokens = burst;
+        client->rateFrac = 0;
+    }
+    client->rateTokens = (int32_t)tokens;
+}
+
+/* 排队的 PUBLISH 的报文长度 (按上限估算报头，用于加权公平调度计费) */
+static uint32_t MQTT_RequestBytes(const MQTT_Request *req)
+{
+    uint32_t len = 1 + 4 + 2 + req->topicLen + (req->qos > 0 ? 2 : 0);
+    if (req->iov)
+    {
+        for (uint8_t i = 0; i < req->iovCnt; i++)
+            len += (uint32_t)req->iov[i].len;
+    }
+    else
+    {
+        len += (uint32_t)strlen(req->msg);
+    }
+    return len;
+}
+
+/* 优先级每轮可发送的字节数 */
+static uint32_t MQTT_PrioQuantum(MQTT_Client *client, uint8_t prio)
+{
+    static const uint8_t defaults[MQTT_PRIO_MAX] = {4, 8, 1, 0};
+    uint8_t weight = client->prioWeights[prio] ? client->prioWeights[prio] : defaults[prio];
+    return (uint32_t)weight * MQTT_PRIO_QUANTUM;
+}
+
+/* 请求加入所属优先级队列的队尾 */
+static void MQTT_PrioEnqueue(MQTT_Client *client, MQTT_Request *req)
+{
+    uint8_t p = req->priority;
+
+    req->state = MQTT_REQ_QUEUED;
+    req->next = NULL;
+    if (client->prioTail[p])
+        client->prioTail[p]->next = req;
+    else
+        client->prioHead[p] = req;
+    client->prioTail[p] = req;
+    client->prioQueued++;
+
+    if (++client->stats.queueDepth[p] > client->stats.queuePeak[p])
+        client->stats.queuePeak[p] = client->stats.queueDepth[p];
+}
+
+/* 取出优先级队列的队首 */
+static MQTT_Request *MQTT_PrioDequeue(MQTT_Client *client, uint8_t p)
+{
+    MQTT_Request *req = client->prioHead[p];
+
+    client->prioHead[p] = req->next;
+    if (!client->prioHead[p])
+        client->prioTail[p] = NULL;
+    req->next = NULL;
+    client->prioQueued--;
+    client->stats.queueDepth[p]--;
+    return req;
+}
+
+/* 从优先级队列中移除任意位置的请求，O(队列长度) */
+static void MQTT_PrioRemove(MQTT_Client *client, MQTT_Request *req)
+{
+    uint8_t p = req->priority;
+    MQTT_Request *prev = NULL;
+
+    for (MQTT_Request *it = client->prioHead[p]; it; prev = it, it = it->next)
+    {
+        if (it != req)
+            continue;
+        if (!prev)
+        {
+            MQTT_PrioDequeue(client, p);
+            return;
+        }
+        prev->next = req->next;
+        if (client->prioTail[p] == req)
+            client->prioTail[p] = prev;
+        req->next = NULL;
+        client->prioQueued--;
+        client->stats.queueDepth[p]--;
+        return;
+    }
+}
+
+/* 发送一条出队的 PUBLISH (提交时已返回 true，失败以 MQTT_RESULT_ERROR 完成) */
+static void MQTT_RateSend(MQTT_Client *client, MQTT_Request *req)
+{
+    bool needsAck = MQTT_NeedsAck(req->op, req->qos);
+
+    req->state = needsAck ? MQTT_REQ_WAIT_ACK : MQTT_REQ_FREE;
+    if (!MQTT_SendRequest(client, req, 0))
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_ERROR);
+    else if (!needsAck)
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_OK);
+}
+
+/* 放行排队的 PUBLISH：令牌为正时按加权公平顺序逐条发送，令牌用完后由 rateTimer 在补足时刻继续 */
+static void MQTT_RateDrain(MQTT_Client *client)
+{
+    if (client->prioQueued == 0)
+        return;
+
+    uint32_t now = HAL_MQTT_GetTick();
+    if (client->rateBytesPerSec)
+        MQTT_RateRefill(client, now);
+    if (client->rateThrottled)
+    {
+        client->stats.throttledMs += now - client->rateThrottleTick;
+        client->rateThrottled = false;
+    }
+
+    /* Deficit Round Robin：轮到的队列领取 权重 × 份额 字节，队首报文不超过余额时发送，
+     * 否则余额留到下一轮，轮到下一个队列；队列变空时余额清零。
+     * 运行中把 rateBytesPerSec 改为 0 即关闭限速，排队的消息全部按调度顺序发出 */
+    while (client->prioQueued > 0 && (client->rateTokens > 0 || !client->rateBytesPerSec))
+    {
+        uint8_t p = client->prioCursor;
+        MQTT_Request *req = client->prioHead[p];
+
+        if (req && !client->prioCharged)
+        {
+            client->prioDeficit[p] += MQTT_PrioQuantum(client, p);
+            client->prioCharged = true;
+        }
+
+        uint32_t bytes = req ? MQTT_RequestBytes(req) : 0;
+        if (!req || bytes > client->prioDeficit[p])
+        {
+            if (!req)
+                client->prioDeficit[p] = 0;
+            client->prioCursor = (uint8_t)((p + 1) % MQTT_PRIO_CONTROL);
+            client->prioCharged = false;
+            continue;
+        }
+
+        client->prioDeficit[p] -= bytes;
+        MQTT_RateSend(client, MQTT_PrioDequeue(client, p));
+    }
+
+    /* 令牌不足：计算补足 1 个令牌所需的时间 */
+    if (client->prioQueued > 0)
+    {
+        uint64_t need = (uint64_t)(1 - (int64_t)client->rateTokens) * 1000 - client->rateFrac;
+        uint32_t waitMs = (uint32_t)((need + client->rateBytesPerSec - 1) / client->rateBytesPerSec);
+
+        client->rateThrottled = true;
+        client->rateThrottleTick = now;
+        MQTT_TimerStart(client, &client->rateTimer, now + (waitMs ? waitMs : 1));
+    }
+}
+
+/* ============================================================
+ * 核心：接收与处理循环 (Receiver Task)
+ * ============================================================ */
+
+/* 接收方向 QoS 2 状态：查找 PacketID 在表中的位置，不在表中 (或为 0) 返回 -1
+ * 表长受 Receive Maximum 限制，顺序查找即可 */
+static int32_t MQTT_RxQos2Find(const MQTT_Client *client, uint16_t pid)
+{
+    for (uint16_t i = 0; pid != 0 && i < client->rxQos2Count; i++)
+    {
+        if (client->rxQos2[i] == pid)
+            return i;
+    }
+    return -1;
+}
+
+/* 接收方向 QoS 2 状态：PacketID 是否在等待 PUBREL (0 不是合法的 PacketID) */
+static bool MQTT_RxQos2Has(const MQTT_Client *client, uint16_t pid)
+{
+    return MQTT_RxQos2Find(client, pid) >= 0;
+}
+
+/* 接收方向 QoS 2 状态：删除表中第 i 项，保持到达顺序 */
+static void MQTT_RxQos2Delete(MQTT_Client *client, uint16_t i)
+{
+    client->rxQos2Count--;
+    memmove(&client->rxQos2[i], &client->rxQos2[i + 1], (size_t)(client->rxQos2Count - i) * sizeof(client->rxQos2[0]));
+}
+
+/* 接收方向 QoS 2 状态：登记 PacketID，表满时淘汰最早的一项；PacketID 为 0 返回 false */
+static bool MQTT_RxQos2Insert(MQTT_Client *client, uint16_t pid)
+{
+    if (pid == 0)
+        return false;
+    if (MQTT_RxQos2Has(client, pid))
+        return true;
+
+    if (client->rxQos2Count >= MQTT_RX_QOS2_MAX)
+    {
+        client->stats.rxQos2Evicted++;
+        HAL_MQTT_Log("MQTT: QoS2 state full, forgetting id=%d\r\n", client->rxQos2[0]);
+        MQTT_RxQos2Delete(client, 0);
+    }
+    client->rxQos2[client->rxQos2Count++] = pid;
+    return true;
+}
+
+/* 接收方向 QoS 2 状态：收到 PUBREL 后清除 PacketID */
+static void MQTT_RxQos2Remove(MQTT_Client *client, uint16_t pid)
+{
+    int32_t i = MQTT_RxQos2Find(client, pid);
+    if (i >= 0)
+        MQTT_RxQos2Delete(client, (uint16_t)i);
+}
+
+/* * 接收去重：滑动窗口位图，O(1) 查询
+ * 窗口覆盖 [rxTopId - 窗口大小 + 1, rxTopId]，收到更大的 ID 时窗口前移，
+ * 重新进入窗口的槽位属于一整个窗口之前的旧 ID，前移时清零 (按 ID 数量老化)。
+ * 只有 DUP=1 且位已置位才判为重复：服务器收到 PUBACK 后可以复用同一个 ID 发送新消息 (DUP=0)。
+ * 返回 true 表示重复报文
+ */
+static bool MQTT_RxIsDuplicate(MQTT_Client *client, uint16_t pid, bool dup)
+{
+    const uint32_t bits = MQTT_RX_DEDUP_BYTES * 8;
+    uint8_t *seen = client->rxSeen;
+
+    if (!client->rxDedupReady)
+    {
+        memset(seen, 0, MQTT_RX_DEDUP_BYTES);
+        client->rxTopId = pid;
+        client->rxDedupReady = true;
+    }
+
+    uint16_t ahead = (uint16_t)(pid - client->rxTopId);
+    if (ahead != 0 && ahead < 0x8000)
+    {
+        /* 窗口前移 */
+        if (ahead >= bits)
+        {
+            memset(seen, 0, MQTT_RX_DEDUP_BYTES);
+        }
+        else
+        {
+            for (uint32_t i = 1; i <= ahead; i++)
+            {
+                uint32_t idx = (uint16_t)(client->rxTopId + i) & (bits - 1);
+                seen[idx >> 3] &= (uint8_t)~(1u << (idx & 7));
+            }
+        }
+        client->rxTopId = pid;
+    }
+    else if ((uint16_t)(client->rxTopId - pid) >= bits)
+    {
+        /* 落后于窗口，无法判断，按新消息处理 */
+        return false;
+    }
+
+    uint32_t idx = pid & (bits - 1);
+    uint8_t mask = (uint8_t)(1u << (idx & 7));
+    bool hit = (seen[idx >> 3] & mask) != 0;
+    seen[idx >> 3] |= mask;
+
+    return hit && dup;
+}
+
+#if MQTT_ENABLE_CACHE
+/* 把收到的 PUBLISH 写入最新值缓存 (msgTopicBuf 中已是解析出的 Topic，payload 为解压后的 Payload)
+ * Topic 被 msgTopicBuf 截断或含有 '\0' 时不缓存，否则会以错误的键保存
+ */
+static void MQTT_CacheIncoming(MQTT_Client *client, const uint8_t *pkt, const char *payload, size_t payloadLen)
+{
+    /* 跳过剩余长度字段，读取报文中的 Topic 长度 */
+    size_t off = 1;
+    while (pkt[off] & 0x80)
+        off++;
+    off++;
+    size_t topicLen = ((size_t)pkt[off] << 8) | pkt[off + 1];
+    if (strlen((const char *)client->msgTopicBuf) != topicLen)
+        return;
+
+    HAL_MQTT_Lock();
+    MQTT_CachePut(client->cache, (const char *)client->msgTopicBuf, topicLen,
+                  payload, payloadLen, (pkt[0] & 0x01) != 0, HAL_MQTT_GetTick());
+    HAL_MQTT_Unlock();
+}
+#endif
+
+/* 撤销一次去重登记：消息未交付完就断开了，重连后服务器的重发 (DUP=1) 需要重新接收 */
+static void MQTT_RxForget(MQTT_Client *client, uint16_t pid)
+{
+    const uint32_t bits = MQTT_RX_DEDUP_BYTES * 8;
+
+    if (!client->rxDedupReady || (uint16_t)(client->rxTopId - pid) >= bits)
+        return;
+
+    uint32_t idx = pid & (bits - 1);
+    client->rxSeen[idx >> 3] &= (uint8_t)~(1u << (idx & 7));
+}
+
+#if MQTT_ENABLE_SESSION
+/* ============================================================
+ * 会话持久化 (设置了 client->session 时生效；除注明外调用方必须持有 HAL_MQTT_Lock)
+ * 状态变化以增量记录追加到会话日志；当前段写满时由 MQTT_SessionCheckpoint
+ * 把仍然有效的状态 (未确认的 PUBLISH、去重窗口、QoS 2 状态表) 写成快照放入下一段。
+ * ============================================================ */
+
+/* PUBLISH 记录的数据：[Topic 长度 2][Topic][Payload 数据段]，返回数据段数量 */
+static size_t MQTT_SessionPublishData(const MQTT_Request *req, uint8_t *lenBuf, MQTT_IoVec *v, MQTT_IoVec *msg)
+{
+    size_t n;
+    const MQTT_IoVec *payload = MQTT_RequestPayload(req, msg, &n);
+
+    lenBuf[0] = (uint8_t)(req->topicLen >> 8);
+    lenBuf[1] = (uint8_t)req->topicLen;
+    v[0].base = lenBuf;
+    v[0].len = 2;
+    v[1].base = req->topic;
+    v[1].len = req->topicLen;
+    for (size_t i = 0; i < n; i++)
+        v[2 + i] = payload[i];
+    return 2 + n;
+}
+
+/* 写快照：当前段已满，把仍然有效的状态写入下一段，成功后旧段被回收 */
+static bool MQTT_SessionCheckpoint(MQTT_Client *client)
+{
+    MQTT_Session *session = client->session;
+    if (!MQTT_SessionBeginSnapshot(session))
+        return false;
+
+    /* 1. 未确认的 PUBLISH (及其所处的 QoS 2 阶段) */
+    bool ok = true;
+    uint16_t slots = MQTT_InflightEnabled(client) ? client->inflightSize : 0;
+    for (uint32_t i = 0; ok && i < MQTT_MAX_REQUESTS + (uint32_t)slots; i++)
+    {
+        MQTT_Request *req = (i < MQTT_MAX_REQUESTS) ? &client->requests[i] : &client->inflight[i - MQTT_MAX_REQUESTS];
+        if (!req->logged)
+            continue;
+
+        uint8_t lenBuf[2];
+        MQTT_IoVec msg;
+        MQTT_IoVec v[2 + MQTT_MAX_IOV];
+        size_t n = MQTT_SessionPublishData(req, lenBuf, v, &msg);
+        ok = MQTT_SessionAppend(session, MQTT_SESSION_OUT, (uint8_t)(req->qos | (req->retain << 2)), req->packetId, v, n);
+        if (ok && req->state == MQTT_REQ_WAIT_COMP)
+            ok = MQTT_SessionAppend(session, MQTT_SESSION_REL, 0, req->packetId, NULL, 0);
+    }
+
+    /* 2. 接收去重窗口与 QoS 2 状态表 */
+    if (ok && client->rxDedupReady)
+    {
+        MQTT_IoVec v = {client->rxSeen, MQTT_RX_DEDUP_BYTES};
+        ok = MQTT_SessionAppend(session, MQTT_SESSION_WINDOW, 0, client->rxTopId, &v, 1);
+    }
+    for (uint16_t i = 0; ok && i < client->rxQos2Count; i++)
+        ok = MQTT_SessionAppend(session, MQTT_SESSION_RX2, 0, client->rxQos2[i], NULL, 0);
+
+    /* 快照放不下一个段时放弃，继续使用旧段 (之后的记录无法写入) */
+    return MQTT_SessionEndSnapshot(session, ok);
+}
+
+/* 追加一条会话记录，当前段放不下时先写快照 */
+static bool MQTT_SessionLog(MQTT_Client *client, uint8_t type, uint8_t flags, uint16_t id,
+                            const MQTT_IoVec *data, size_t n)
+{
+    MQTT_Session *session = client->session;
+    uint32_t len = 0;
+    for (size_t i = 0; i < n; i++)
+        len += (uint32_t)data[i].len;
+
+    if (!MQTT_SessionHasRoom(session, len))
+        MQTT_SessionCheckpoint(client);
+    if (MQTT_SessionAppend(session, type, flags, id, data, n))
+        return true;
+
+    HAL_MQTT_Log("MQTT: Session journal write failed (type %d)\r\n", type);
+    return false;
+}
+
+/* 记录发出的 QoS > 0 PUBLISH (在第一次发送之前) */
+static void MQTT_SessionLogPublish(MQTT_Client *client, MQTT_Request *req)
+{
+    uint8_t lenBuf[2];
+    MQTT_IoVec msg;
+    MQTT_IoVec v[2 + MQTT_MAX_IOV];
+    size_t n = MQTT_SessionPublishData(req, lenBuf, v, &msg);
+
+    req->logged = MQTT_SessionLog(client, MQTT_SESSION_OUT, (uint8_t)(req->qos | (req->retain << 2)),
+                                  req->packetId, v, n);
+    if (!req->logged)
+        client->session->stats.lost++;
+}
+
+/* 已记录的 PUBLISH 结束 (确认、超时、被拒绝或发送失败) */
+static void MQTT_SessionLogDone(MQTT_Client *client, MQTT_Request *req)
+{
+    if (!req->logged)
+        return;
+    req->logged = false;
+    MQTT_SessionLog(client, MQTT_SESSION_DONE, 0, req->packetId, NULL, 0);
+}
+
+/* PacketID 租约：分配的 ID 超出上次记录的租约时续租，重启后从租约末尾继续分配，不会与重启前的 ID 重复 */
+static void MQTT_SessionLease(MQTT_Client *client, uint16_t packetId)
+{
+    MQTT_Session *session = client->session;
+    if (!session || (uint16_t)(session->pidLease - packetId) < MQTT_SESSION_PID_LEASE)
+        return;
+
+    session->pidLease = (uint16_t)(packetId + MQTT_SESSION_PID_LEASE - 1);
+    MQTT_SessionLog(client, MQTT_SESSION_LEASE, 0, session->pidLease, NULL, 0);
+}
+#else
+/* 未启用会话持久化：接收方向状态变更沿用会话记录的类型编号 (见 mqtt_session.h)，其余为空操作 */
+#define MQTT_SESSION_RX 7
+#define MQTT_SESSION_RX_FORGET 8
+#define MQTT_SESSION_RX2 9
+#define MQTT_SESSION_RX2_REL 10
+
+static void MQTT_SessionLogDone(MQTT_Client *client, MQTT_Request *req)
+{
+    (void)client;
+    (void)req;
+}
+
+static void MQTT_SessionLease(MQTT_Client *client, uint16_t packetId)
+{
+    (void)client;
+    (void)packetId;
+}
+#endif
+
+/* * 接收方向状态的变更 (接收线程，不持锁)：QoS 1 去重登记 (返回 false 表示重复)、撤销登记、QoS 2 状态表插入 / 删除
+ * 设置了会话日志时在锁内修改并记录 (快照可能在发送线程中读取这些状态)
+ */
+static bool MQTT_RxUpdate(MQTT_Client *client, uint8_t type, uint16_t pid, bool dup)
+{
+    bool ok;
+#if MQTT_ENABLE_SESSION
+    bool logging = (client->session != NULL);
+#else
+    bool logging = false;
+#endif
+
+    if (logging)
+        HAL_MQTT_Lock();
+
+    switch (type)
+    {
+    case MQTT_SESSION_RX:
+        ok = !MQTT_RxIsDuplicate(client, pid, dup);
+        break;
+    case MQTT_SESSION_RX_FORGET:
+        MQTT_RxForget(client, pid);
+        ok = true;
+        break;
+    case MQTT_SESSION_RX2:
+        ok = MQTT_RxQos2Insert(client, pid);
+        break;
+    default:
+        ok = MQTT_RxQos2Has(client, pid);
+        MQTT_RxQos2Remove(client, pid);
+        break;
+    }
+
+    if (logging)
+    {
+#if MQTT_ENABLE_SESSION
+        if (ok)
+            MQTT_SessionLog(client, type, 0, pid, NULL, 0);
+#endif
+        HAL_MQTT_Unlock();
+    }
+    return ok;
+}
+
+#if MQTT_ENABLE_SESSION
+/* 找到等待确认的 PUBLISH (在途窗口或请求表) */
+static MQTT_Request *MQTT_SessionFind(MQTT_Client *client, uint16_t packetId)
+{
+    return MQTT_FindWaiting(client, MQTT_OP_PUBLISH, packetId, true);
+}
+
+/* 恢复一条 PUBLISH 记录：复制到内存池，放回在途窗口或请求表 (PacketID 不变) */
+static bool MQTT_SessionRestorePublish(MQTT_Client *client, const MQTT_SessionRecord *rec)
+{
+    if (rec->len < 2 || !client->pool || MQTT_SessionFind(client, rec->id))
+        return false;
+    uint16_t topicLen = (uint16_t)((rec->data[0] << 8) | rec->data[1]);
+    if (2u + topicLen > rec->len)
+        return false;
+
+    MQTT_Request *req = NULL;
+    if (MQTT_InflightEnabled(client) && client->inflight[rec->id & (client->inflightSize - 1)].state == MQTT_REQ_FREE)
+    {
+        req = &client->inflight[rec->id & (client->inflightSize - 1)];
+    }
+    else
+    {
+        for (int i = 0; i < MQTT_MAX_REQUESTS && !req; i++)
+        {
+            if (client->requests[i].state == MQTT_REQ_FREE)
+                req = &client->requests[i];
+        }
+    }
+    if (!req)
+        return false;
+
+    /* 日志中的 Payload 已是发送格式 (可能是压缩帧)，原样复制 */
+    const char *topic = (const char *)&rec->data[2];
+    MQTT_IoVec payload = {&rec->data[2 + topicLen], rec->len - 2u - topicLen};
+    const MQTT_IoVec *iov = &payload;
+    size_t iovCnt = 1;
+    void *block = MQTT_PoolCopy(client, MQTT_OP_PUBLISH, true, &topic, topicLen, &iov, &iovCnt);
+    if (!block)
+        return false;
+
+    memset(req, 0, sizeof(MQTT_Request));
+    req->op = MQTT_OP_PUBLISH;
+    req->qos = rec->flags & 0x03;
+    req->retain = (rec->flags >> 2) & 0x01;
+    req->topic = topic;
+    req->topicLen = topicLen;
+    req->iov = iov;
+    req->iovCnt = 1;
+    req->block = block;
+    req->packetId = rec->id;
+    req->priority = MQTT_PRIO_BULK;
+    req->submitTick = HAL_MQTT_GetTick();
+    req->state = MQTT_REQ_WAIT_ACK;
+    req->logged = true;
+    if (MQTT_IsInflight(client, req))
+        client->inflightCount++;
+    return true;
+}
+
+/* * 从会话日志恢复重启前的状态
+ * 依次重放当前段的记录：未确认的 PUBLISH 放回请求表，接收去重窗口与 QoS 2 状态表恢复原样
+ */
+bool MQTT_SessionRestore(MQTT_Client *client)
+{
+    MQTT_Session *session = client ? client->session : NULL;
+    if (!session)
+        return false;
+
+    HAL_MQTT_Lock();
+
+    /* 重启前分配过的 ID 都不超过租约末尾 */
+    if (session->pidLease)
+        client->packetId = session->pidLease;
+
+    MQTT_SessionRecord rec;
+    MQTT_Request *req;
+    uint32_t pos = 0;
+    while (MQTT_SessionNext(session, &pos, &rec))
+    {
+        switch (rec.type)
+        {
+        case MQTT_SESSION_OUT:
+            if (!MQTT_SessionRestorePublish(client, &rec))
+            {
+                session->stats.lost++;
+                HAL_MQTT_Log("MQTT: Session publish id=%d not restored\r\n", rec.id);
+            }
+            break;
+        case MQTT_SESSION_REL:
+            req = MQTT_SessionFind(client, rec.id);
+            if (req)
+                req->state = MQTT_REQ_WAIT_COMP;
+            break;
+        case MQTT_SESSION_DONE:
+            req = MQTT_SessionFind(client, rec.id);
+            if (req && req->logged)
+            {
+                MQTT_PoolRelease(client, req);
+                req->logged = false;
+                req->state = MQTT_REQ_FREE;
+                if (MQTT_IsInflight(client, req))
+                    client->inflightCount--;
+            }
+            break;
+        case MQTT_SESSION_RX:
+            MQTT_RxIsDuplicate(client, rec.id, false);
+            break;
+        case MQTT_SESSION_RX_FORGET:
+            MQTT_RxForget(client, rec.id);
+            break;
+        case MQTT_SESSION_RX2:
+            MQTT_RxQos2Insert(client, rec.id);
+            break;
+        case MQTT_SESSION_RX2_REL:
+            if (rec.id == 0)
+                client->rxQos2Count = 0;
+            else
+                MQTT_RxQos2Remove(client, rec.id);
+            break;
+        case MQTT_SESSION_WINDOW:
+            if (rec.len == MQTT_RX_DEDUP_BYTES)
+            {
+                memcpy(client->rxSeen, rec.data, MQTT_RX_DEDUP_BYTES);
+                client->rxTopId = rec.id;
+                client->rxDedupReady = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* 统计恢复的消息 (不含之后已结束的) */
+    uint16_t slots = MQTT_InflightEnabled(client) ? client->inflightSize : 0;
+    for (uint32_t i = 0; i < MQTT_MAX_REQUESTS + (uint32_t)slots; i++)
+    {
+        req = (i < MQTT_MAX_REQUESTS) ? &client->requests[i] : &client->inflight[i - MQTT_MAX_REQUESTS];
+        if (req->logged)
+            session->stats.restored++;
+    }
+
+    HAL_MQTT_Unlock();
+    return true;
+}
+#endif
+
+/* 连接建立 (CONNACK，持锁)：未确认的 PUBLISH / PUBREL 立即带 DUP 重发，不等超时 */
+static void MQTT_ResendPending(MQTT_Client *client)
+{
+    uint16_t slots = MQTT_InflightEnabled(client) ? client->inflightSize : 0;
+    for (uint32_t i = 0; i < MQTT_MAX_REQUESTS + (uint32_t)slots; i++)
+    {
+        MQTT_Request *req = (i < MQTT_MAX_REQUESTS) ? &client->requests[i] : &client->inflight[i - MQTT_MAX_REQUESTS];
+        if (req->op != MQTT_OP_PUBLISH || !MQTT_IsPending(req))
+            continue;
+
+        MQTT_TimerRemove(client, req);
+        req->attempts = 0;
+        if (!MQTT_SendRequest(client, req, 1))
+            MQTT_CompleteRequest(client, req, MQTT_RESULT_ERROR);
+    }
+}
+
+#if MQTT_ENABLE_SESSION
+/* * 连接建立 (CONNACK，持锁)：重发未确认的 PUBLISH / PUBREL；
+ * 服务器没有保留会话 (Session Present = 0) 时清空接收方向 QoS 2 状态，并按订阅表重新订阅
+ */
+static void MQTT_SessionResume(MQTT_Client *client, bool present)
+{
+    MQTT_Session *session = client->session;
+
+    MQTT_ResendPending(client);
+
+    if (!present)
+    {
+        if (client->rxQos2Count > 0)
+        {
+            client->rxQos2Count = 0;
+            MQTT_SessionLog(client, MQTT_SESSION_RX2_REL, 0, 0, NULL, 0);
+        }
+        session->resubNext = 0;
+        session->resubPending = true;
+    }
+}
+
+/* 自动重新订阅的完成回调 (只用于区分请求来源) */
+static void MQTT_SessionResubCallback(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx)
+{
+    (void)client;
+    (void)op;
+    (void)ctx;
+    if (result != MQTT_RESULT_OK)
+        HAL_MQTT_Log("MQTT: Resubscribe failed (%d)\r\n", result);
+}
+
+/* 订阅 / 退订成功：更新订阅表并记录 (自动重新订阅的请求不再记录) */
+static void MQTT_SessionLogSub(MQTT_Client *client, MQTT_Request *req)
+{
+    MQTT_Session *session = client->session;
+    MQTT_IoVec v = {req->topic, req->topicLen};
+
+    if (req->cb == MQTT_SessionResubCallback)
+        return;
+
+    if (req->op == MQTT_OP_UNSUBSCRIBE)
+    {
+        MQTT_SessionRemoveSub(session, req->topic, req->topicLen);
+        MQTT_SessionLog(client, MQTT_SESSION_UNSUB, 0, 0, &v, 1);
+    }
+    else if (MQTT_SessionAddSub(session, req->topic, req->topicLen, req->qos))
+    {
+        MQTT_SessionLog(client, MQTT_SESSION_SUB, req->qos, 0, &v, 1);
+    }
+    else
+    {
+        session->stats.lost++;
+        HAL_MQTT_Log("MQTT: Subscription not persisted\r\n");
+    }
+}
+
+/* 重新订阅 (不持锁)：服务器没有保留会话时按订阅表逐条提交 (请求表满时下次 ProcessLoop 继续) */
+static void MQTT_SessionDrain(MQTT_Client *client)
+{
+    MQTT_Session *session = client->session;
+    if (!session || !session->resubPending || !client->isConnected)
+        return;
+
+    while (session->resubNext < session->subCap)
+    {
+        MQTT_SessionSub *sub = &session->subs[session->resubNext];
+        if (sub->len > 0 && !MQTT_SubmitRequest(client, MQTT_OP_SUBSCRIBE, sub->filter, sub->len, NULL, 0,
+                                                sub->qos, 0, MQTT_SessionResubCallback, NULL))
+            return;
+        session->resubNext++;
+    }
+    session->resubPending = false;
+}
+#endif
+
+/* PUBREC：进入第二阶段，发送 PUBREL 并重新计时 (重复的 PUBREC 同样立即重发 PUBREL) */
+static void MQTT_HandlePubRec(MQTT_Client *client, MQTT_Request *req)
+{
+    MQTT_TimerRemove(client, req);
+    if (req->state == MQTT_REQ_WAIT_ACK)
+    {
+        req->state = MQTT_REQ_WAIT_COMP;
+        req->attempts = 0;
+#if MQTT_ENABLE_SESSION
+        if (req->logged)
+            MQTT_SessionLog(client, MQTT_SESSION_REL, 0, req->packetId, NULL, 0);
+#endif
+    }
+    if (!MQTT_SendRequest(client, req, 0))
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_ERROR);
+}
+
+/* CONNACK 属性：记录服务器的 Receive Maximum / Maximum Packet Size / Topic Alias Maximum */
+static void MQTT_ApplyConnAckProps(MQTT_Client *client, const MQTT_AckV5 *ack)
+{
+    const uint8_t *p = ack->props;
+    uint32_t left = ack->propsLen;
+
+    while (left > 0)
+    {
+        uint8_t id;
+        uint32_t value;
+        uint32_t n = MQTT_PropRead(p, left, &id, &value);
+        if (n == 0)
+            break;
+
+        if (id == MQTT_PROP_RECEIVE_MAX && value > 0)
+            client->serverReceiveMax = (uint16_t)value;
+        else if (id == MQTT_PROP_MAX_PACKET)
+            client->serverMaxPacket = value;
+        else if (id == MQTT_PROP_TOPIC_ALIAS_MAX)
+            client->serverTopicAliasMax = (uint16_t)value;
+        p += n;
+        left -= n;
+    }
+}
+
+/* * MQTT 5 应答匹配：原因码 < 0x80 为成功，>= 0x80 为失败 (请求以 REJECTED 结束，不再重试)
+ * 返回 true 表示请求已成功完成，由调用者按成功处理
+ */
+static bool MQTT_MatchAckV5(MQTT_Client *client, MQTT_Request *req, uint8_t packetType, const MQTT_AckV5 *ack)
+{
+    bool failed = ack->reason >= 0x80;
+
+    switch (packetType)
+    {
+    case 0x20: /* CONNACK */
+        if (!failed)
+            MQTT_ApplyConnAckProps(client, ack);
+        break;
+    case 0x90: /* SUBACK：原因码即授予的 QoS，不应高于请求的 QoS */
+        failed = failed || ack->reason > req->qos;
+        break;
+    case 0xB0: /* UNSUBACK (0x11 没有该订阅 也视为成功) */
+        break;
+    case 0x40: /* PUBACK (0x10 没有匹配的订阅者 也视为成功) */
+        if (req->qos != 1)
+            return false;
+        break;
+    case 0x50: /* PUBREC：失败时 QoS 2 流程到此结束，不发送 PUBREL */
+        if (req->qos != 2)
+            return false;
+        if (!failed)
+        {
+            MQTT_HandlePubRec(client, req);
+            return false;
+        }
+        break;
+    case 0x70: /* PUBCOMP */
+        if (req->state != MQTT_REQ_WAIT_COMP)
+            return false;
+        break;
+    default:
+        return false;
+    }
+
+    req->reasonCode = ack->reason;
+    if (failed)
+    {
+        HAL_MQTT_Log("MQTT: Op %d rejected, reason=0x%02X\r\n", req->op, ack->reason);
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_REJECTED);
+        return false;
+    }
+    return true;
+}
+
+/* 收到合法数据：链路是通的，刷新活动时间 */
+static void MQTT_RxActivity(MQTT_Client *client)
+{
+    /* lastActiveTick 也由发送路径 (持锁) 更新 */
+    HAL_MQTT_Lock();
+    client->lastActiveTick = HAL_MQTT_GetTick();
+
+    /* 心跳已得到回应：从重发 PINGREQ 的节奏恢复为按空闲时间计时 */
+    if (client->pingAttempts > 0)
+        MQTT_KeepAliveRestart(client);
+    HAL_MQTT_Unlock();
+}
+
+/* * 内部函数：处理接收到的数据
+ * 该函数在 MQTT_ProcessLoop 中被调用，pkt 指向一个完整报文 (位于接收环形区内)
+ */
+static void MQTT_HandleIncoming(MQTT_Client *client, const uint8_t *pkt, size_t len)
+{
+    MQTT_RxActivity(client);
+
+    /* 获取报文类型 (高4位) */
+    uint8_t packetType = pkt[0] & 0xF0;
+
+    /* ----------------------------------------------------
+     * 场景 1: 服务器推送的消息 (PUBLISH)
+     * ---------------------------------------------------- */
+    if (packetType == 0x30)
+    {
+        uint16_t pid = 0;
+        uint8_t qos = (pkt[0] & 0x06) >> 1;
+
+        /* 使用 client 结构体中的 msgTopicBuf 和 msgPayloadBuf 进行解析
+           避免了在栈上分配大数组，防止栈溢出 */
+        int payloadLen = MQTT_ParsePublish(pkt, len,
+                                           client->msgTopicBuf, client->msgTopicBufSize,
+                                           client->msgPayloadBuf, client->msgPayloadBufSize,
+                                           &pid, client->protocolVersion);
+
+        if (payloadLen >= 0)
+        {
+            /* --- 步骤 A: 响应 PUBACK (最优先) --- */
+            /* 只要是 QoS 1，无论是否重复，都必须回复 ACK，告诉服务器“我活着且收到了” */
+            if (qos == 1)
+            {
+                MQTT_SendAck(client, 0x40, pid);
+                HAL_MQTT_Log("MQTT: Auto-replied PUBACK id=%d\r\n", pid);
+            }
+
+            /* QoS 2：收到即交付，PacketID 记入状态表直到 PUBREL，期间的重发只回复 PUBREC */
+            if (qos == 2)
+            {
+                bool known = MQTT_RxQos2Has(client, pid);
+
+                /* PacketID 为 0 的 QoS 2 PUBLISH 不合法，无法确认 */
+                if (!known && !MQTT_RxUpdate(client, MQTT_SESSION_RX2, pid, false))
+                {
+                    client->stats.parseFailures++;
+                    HAL_MQTT_Log("MQTT: QoS2 PUBLISH without packet id, dropped\r\n");
+                    return;
+                }
+
+                MQTT_SendAck(client, 0x50, pid);
+
+                if (known)
+                {
+                    client->stats.dupsDropped++;
+                    HAL_MQTT_Log("MQTT: Duplicate QoS2 Msg ID %d, dropped.\r\n", pid);
+                    return;
+                }
+            }
+
+            /* --- 步骤 B: 去重判断 --- */
+            /* QoS 1 需要检查是否重复处理 (QoS 2 已由状态表保证) */
+            if (qos == 1 && !MQTT_RxUpdate(client, MQTT_SESSION_RX, pid, (pkt[0] & 0x08) != 0))
+            {
+                /* 窗口内已处理过的重发报文，直接丢弃，不回调用户 */
+                client->stats.dupsDropped++;
+                HAL_MQTT_Log("MQTT: Duplicate Msg ID %d, dropped.\r\n", pid);
+                return;
+            }
+
+            /* --- 步骤 C: 回调用户 --- */
+            const char *payload = client->msgPayloadBuf;
+            size_t plen = (size_t)payloadLen;
+#if MQTT_ENABLE_COMPRESS
+            /* 压缩帧先解压到 compress->rxBuf (不是压缩帧时原样交付) */
+            if (client->compress && client->compress->rxBuf)
+            {
+                payload = (const char *)MQTT_DecompressPayload(client->compress, (const uint8_t *)payload, plen, &plen);
+                if (!payload)
+                {
+                    client->stats.oversized++;
+                    HAL_MQTT_Log("MQTT: Decompressed payload too large, dropped.\r\n");
+                    return;
+                }
+            }
+#endif
+
+            client->stats.publishIn++;
+#if MQTT_ENABLE_CACHE
+            /* 先更新最新值缓存，处理函数中查询到的即为本条消息 */
+            if (client->cache)
+                MQTT_CacheIncoming(client, pkt, payload, plen);
+#endif
+#if MQTT_ENABLE_ROUTER
+            /* 优先交给订阅分发器，没有匹配的过滤器时再走全局回调 */
+            if (client->router &&
+                MQTT_RouterDispatch(client->router, client, (const char *)client->msgTopicBuf,
+                                    payload, plen) > 0)
+                return;
+#endif
+
+            HAL_MQTT_OnPublishReceived((const char *)client->msgTopicBuf, payload, plen);
+        }
+        else
+        {
+            client->stats.parseFailures++;
+        }
+        return; /* 处理完毕 */
+    }
+
+    /* ----------------------------------------------------
+     * 场景 1.5: 接收方向 QoS 2 的 PUBREL
+     * 释放 PacketID 并回复 PUBCOMP (未知 ID 同样回复，让服务器结束流程)
+     * ---------------------------------------------------- */
+    if (packetType == 0x60)
+    {
+        if (len < 4)
+            return;
+        uint16_t pid = (uint16_t)((pkt[2] << 8) | pkt[3]);
+        MQTT_RxUpdate(client, MQTT_SESSION_RX2_REL, pid, false);
+        MQTT_SendAck(client, 0x70, pid);
+        return;
+    }
+
+    /* ----------------------------------------------------
+     * 场景 1.6: 服务器主动断开 (MQTT 5)
+     * 记录原因码，交由应用重新连接
+     * ---------------------------------------------------- */
+    if (packetType == 0xE0)
+    {
+        MQTT_AckV5 ack;
+        HAL_MQTT_Lock();
+        client->lastReasonCode = MQTT_ParseAckV5(pkt, len, &ack) ? ack.reason : 0;
+        client->isConnected = false;
+        HAL_MQTT_Unlock();
+        HAL_MQTT_Log("MQTT: Server DISCONNECT, reason=0x%02X\r\n", client->lastReasonCode);
+        return;
+    }
+
+    /* ----------------------------------------------------
+     * 场景 2: 各种应答报文 (ACK)
+     * 根据报文类型 (和 Packet ID) 在请求表中找到对应的等待请求
+     * ---------------------------------------------------- */
+
+    MQTT_Operation op;
+    bool hasId = true;
+    bool v5 = (client->protocolVersion == MQTT_VERSION_5);
+    MQTT_AckV5 ack;
+
+    switch (packetType)
+    {
+    case 0x20: /* CONNACK */
+        op = MQTT_OP_CONNECT;
+        hasId = false;
+        break;
+    case 0x90: /* SUBACK */
+        op = MQTT_OP_SUBSCRIBE;
+        break;
+    case 0xB0: /* UNSUBACK */
+        op = MQTT_OP_UNSUBSCRIBE;
+        break;
+    case 0x40: /* PUBACK */
+    case 0x50: /* PUBREC */
+    case 0x70: /* PUBCOMP */
+        op = MQTT_OP_PUBLISH;
+        break;
+    case 0xD0: /* PINGRESP */
+        op = MQTT_OP_PING;
+        hasId = false;
+        break;
+    default:
+        return;
+    }
+
+    uint16_t pid = 0;
+    if (v5 && op != MQTT_OP_PING)
+    {
+        /* v5 应答可能带原因码和属性，剩余长度不再固定 */
+        if (!MQTT_ParseAckV5(pkt, len, &ack))
+        {
+            client->stats.parseFailures++;
+            return;
+        }
+        pid = ack.packetId;
+    }
+    else if (hasId)
+    {
+        if (len < 4)
+            return;
+        pid = (uint16_t)((pkt[2] << 8) | pkt[3]);
+    }
+
+    HAL_MQTT_Lock();
+
+    /* 如果没有请求在等待这个 ACK，则忽略该报文 */
+    MQTT_Request *req = MQTT_FindWaiting(client, op, pid, hasId);
+    if (req)
+    {
+        bool matched = false;
+
+        if (v5 && op != MQTT_OP_PING)
+        {
+            /* MQTT 5：按原因码判断成功或拒绝 */
+            matched = MQTT_MatchAckV5(client, req, packetType, &ack);
+        }
+        else
+        {
+            switch (op)
+            {
+            case MQTT_OP_CONNECT:
+                matched = MQTT_CheckConnAck(pkt, len);
+                /* 服务器明确拒绝连接，无需再重试 */
+                if (!matched)
+                {
+                    req->reasonCode = (len >= 4) ? pkt[3] : 0;
+                    MQTT_CompleteRequest(client, req, MQTT_RESULT_REJECTED);
+                }
+                break;
+            case MQTT_OP_SUBSCRIBE:
+                matched = MQTT_CheckSubAck(pkt, len, req->packetId, req->qos);
+                if (!matched)
+                {
+                    req->reasonCode = (len >= 5) ? pkt[4] : 0;
+                    MQTT_CompleteRequest(client, req, MQTT_RESULT_REJECTED);
+                }
+                break;
+            case MQTT_OP_UNSUBSCRIBE:
+                matched = MQTT_CheckUnsubAck(pkt, len, req->packetId);
+                break;
+            case MQTT_OP_PUBLISH:
+                if (packetType == 0x40)
+                {
+                    matched = (req->qos == 1) && MQTT_CheckPubAck(pkt, len, req->packetId);
+                }
+                else if (packetType == 0x50 && req->qos == 2 && pkt[1] == 0x02)
+                {
+                    MQTT_HandlePubRec(client, req);
+                }
+                else if (packetType == 0x70)
+                {
+                    /* PUBCOMP：只有已发出 PUBREL 的请求才算完成 */
+                    matched = (req->state == MQTT_REQ_WAIT_COMP) && pkt[1] == 0x02;
+                }
+                break;
+            case MQTT_OP_PING:
+                matched = MQTT_CheckPingResp(pkt, len);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (matched)
+        {
+            /* 如果是连接操作成功，标记为已连接并初始化心跳计时 */
+            if (op == MQTT_OP_CONNECT)
+            {
+                client->isConnected = true;
+                client->lastActiveTick = HAL_MQTT_GetTick();
+
+                /* Session Present 在 CONNACK 的确认标志 bit0 (Clean Session = 1 时服务器必须置 0)；
+                 * 新会话 (包括 Clean Session = 0 但服务器已丢弃旧会话) 不会再收到旧会话的 PUBREL */
+                bool present = !client->cleanSession && ((v5 ? ack.flags : pkt[2]) & 0x01) != 0;
+
+                /* 会话持久化：由 MQTT_SessionResume 清空 QoS 2 状态并记入日志；
+                 * MQTT 5 连接期间不重发，未确认的 PUBLISH / PUBREL 只在重连后重发 */
+#if MQTT_ENABLE_SESSION
+                if (client->session)
+                {
+                    MQTT_SessionResume(client, present);
+                }
+                else
+#endif
+                {
+                    if (!present)
+                        client->rxQos2Count = 0;
+                    if (v5)
+                        MQTT_ResendPending(client);
+                }
+            }
+#if MQTT_ENABLE_SESSION
+            else if (client->session && (op == MQTT_OP_SUBSCRIBE || op == MQTT_OP_UNSUBSCRIBE))
+            {
+                MQTT_SessionLogSub(client, req);
+            }
+#endif
+            MQTT_CompleteRequest(client, req, MQTT_RESULT_OK);
+            HAL_MQTT_Log("MQTT: Received expected ACK for Op %d\r\n", op);
+        }
+    }
+
+    HAL_MQTT_Unlock();
+}
+
+/* ============================================================
+ * 内部函数：发送 PINGREQ (非阻塞，不占用 txBuf)
+ * ============================================================ */
+static void MQTT_SendPingRaw(MQTT_Client *client)
+{
+    /* PINGREQ 固定报文: 0xC0 0x00 */
+    uint8_t pingBuf[2] = {0xC0, 0x00};
+    /* 直接发送，不等待响应，响应由 ProcessLoop 的 HandleIncoming 异步处理 */
+    MQTT_TransportSend(client, pingBuf, 2);
+    HAL_MQTT_Log("MQTT: KeepAlive PING sent\r\n");
+}
+
+/* 按空闲时间重新启动心跳定时器 (调用方必须持有 HAL_MQTT_Lock) */
+static void MQTT_KeepAliveRestart(MQTT_Client *client)
+{
+    client->pingAttempts = 0;
+    if (client->isConnected && client->keepAlive > 0)
+        MQTT_TimerStart(client, &client->keepAliveTimer, client->lastActiveTick + client->keepAlive * 1000u / 2 + 1);
+}
+
+/* 心跳定时器到期
+ * 收发报文只刷新 lastActiveTick，不移动定时器；到期时若期间有过收发，按新的空闲起点重新计时，
+ * 因此每个心跳周期最多触发一两次，与收发的报文数量无关。
+ * 空闲超过半个心跳周期发送 PINGREQ，之后每 MQTT_PING_RETRY_MS 检查一次：
+ * 收到任何报文即恢复按空闲时间计时 (MQTT_KeepAliveRestart)，否则重发 PINGREQ，连续 maxRetrys 次无回包判定连接已断开 */
+static void MQTT_KeepAliveTimeout(MQTT_Client *client)
+{
+    /* 未连接或禁用心跳：不再计时，连接恢复后由 MQTT_MaintainKeepAlive 重新启动 */
+    if (!client->isConnected || client->keepAlive == 0)
+    {
+        client->pingAttempts = 0;
+        return;
+    }
+
+    uint32_t now = HAL_MQTT_GetTick();
+    uint32_t idleTick = client->lastActiveTick + client->keepAlive * 1000u / 2 + 1;
+
+    if (client->pingAttempts == 0 && (int32_t)(now - idleTick) < 0)
+    {
+        /* 期间有过收发，尚未空闲满半个周期 */
+        MQTT_TimerStart(client, &client->keepAliveTimer, idleTick);
+        return;
+    }
+
+    if (client->pingAttempts >= (client->maxRetrys ? client->maxRetrys : 1))
+    {
+        /* PINGREQ 一直没有回应：链路已断，交由应用重新连接 */
+        HAL_MQTT_Log("MQTT: KeepAlive timeout, connection lost\r\n");
+        client->stats.timeouts++;
+        client->isConnected = false;
+        client->pingAttempts = 0;
+        return;
+    }
+
+    MQTT_SendPingRaw(client);
+    client->pingAttempts++;
+    MQTT_TimerStart(client, &client->keepAliveTimer, now + MQTT_PING_RETRY_MS);
+}
+
+/* 心跳维护：连接建立后启动心跳定时器，之后由定时器自行维持 */
+static void MQTT_MaintainKeepAlive(MQTT_Client *client)
+{
+    HAL_MQTT_Lock();
+    if (client->isConnected && client->keepAlive > 0 && !client->keepAliveTimer.active)
+        MQTT_KeepAliveRestart(client);
+    HAL_MQTT_Unlock();
+}
+
+#if MQTT_ENABLE_ROUTER
+/* ============================================================
+ * 流式接收
+ * 匹配流式过滤器的 PUBLISH 只需可变报头能放入接收区：解析出 Topic 后即从环形区移除报头，
+ * Payload 随到达原地交给处理函数，处理完的部分立即释放，占用内存与消息大小无关。
+ * ACK 在 Payload 全部交付后才回复，QoS 2 的状态表登记也推迟到交付完成；中途重连时撤销 QoS 1 的去重登记，
+ * 服务器的重发可以被重新接收。
+ * ============================================================ */
+
+/* 流式消息结束 (交付完成或被处理函数放弃)：回复 ACK 并清除状态 */
+static void MQTT_RxStreamFinish(MQTT_Client *client)
+{
+    MQTT_StreamChunk *c = &client->rxChunk;
+
+    if (c->qos == 1)
+    {
+        MQTT_SendAck(client, 0x40, c->packetId);
+    }
+    else if (c->qos == 2)
+    {
+        MQTT_RxUpdate(client, MQTT_SESSION_RX2, c->packetId, false);
+        MQTT_SendAck(client, 0x50, c->packetId);
+    }
+
+    client->rxStream = NULL;
+}
+
+/* 重连：结束未收完的流式消息，丢弃环形区中属于旧连接的剩余 Payload */
+static void MQTT_RxStreamAbort(MQTT_Client *client)
+{
+    MQTT_StreamHandler handler = client->rxStream;
+    MQTT_StreamChunk *c = &client->rxChunk;
+
+    if (!handler)
+        return;
+
+    uint32_t left = c->totalLen - c->offset;
+    uint32_t count = MQTT_RingCount(&client->rxRing);
+    MQTT_RingSkip(&client->rxRing, (count < left) ? count : left);
+
+    if (c->qos == 1)
+        MQTT_RxUpdate(client, MQTT_SESSION_RX_FORGET, c->packetId, false);
+
+    client->rxStream = NULL;
+    handler(client, MQTT_STREAM_ABORT, c, client->rxStreamCtx);
+}
+
+/* * 尝试以流式方式接收环形区队首的 PUBLISH (固定报头已解码，total 为整包长度)
+ * 返回值: 1 已开始流式接收 (或作为重复报文丢弃); 0 不走流式 (没有匹配的流式过滤器或报头异常，按普通报文处理);
+ *         -1 可变报头未收全
+ */
+static int MQTT_RxStreamBegin(MQTT_Client *client, uint32_t count, uint8_t encLen, uint32_t total)
+{
+    MQTT_Ring *rb = &client->rxRing;
+
+    /* 1. 已收到的部分 (不超过最大报文长度) 拼接为连续内存，可变报头必须在其中 */
+    uint32_t avail = (count < total) ? count : total;
+    if (avail > client->rxMaxPacket)
+        avail = client->rxMaxPacket;
+    bool more = (avail < total && avail < client->rxMaxPacket);
+
+    uint32_t tail = rb->tail;
+    if (tail + avail > rb->size)
+        memcpy(&rb->buffer[rb->size], &rb->buffer[0], tail + avail - rb->size);
+    const uint8_t *pkt = &rb->buffer[tail];
+
+    /* 2. 可变报头：Topic、PacketID、属性区 (v5) */
+    uint8_t qos = (pkt[0] & 0x06) >> 1;
+    uint32_t hdrLen = 1 + encLen + 2;
+    if (hdrLen > avail)
+        return more ? -1 : 0;
+
+    uint32_t topicOff = hdrLen;
+    uint16_t topicLen = (uint16_t)((pkt[topicOff - 2] << 8) | pkt[topicOff - 1]);
+    hdrLen += topicLen + ((qos > 0) ? 2 : 0);
+    if (hdrLen > total)
+        return 0;
+    if (hdrLen > avail)
+        return more ? -1 : 0;
+
+    if (client->protocolVersion == MQTT_VERSION_5)
+    {
+        uint8_t n = 0;
+        uint32_t propsLen = 0;
+        int ret = MQTT_DecodeLength(&pkt[hdrLen], avail - hdrLen, &n, &propsLen, total - hdrLen);
+        if (ret == -2)
+            return more ? -1 : 0;
+        if (ret != 0 || hdrLen + n + propsLen > total)
+            return 0;
+        hdrLen += n + propsLen;
+        if (hdrLen > avail)
+            return more ? -1 : 0;
+    }
+
+    /* 3. 查找流式处理函数 (Topic 复制到 msgTopicBuf，超长时截断) */
+    if (!client->msgTopicBuf || client->msgTopicBufSize == 0)
+        return 0;
+    size_t copyLen = (topicLen < client->msgTopicBufSize - 1) ? topicLen : (client->msgTopicBufSize - 1);
+    memcpy(client->msgTopicBuf, &pkt[topicOff], copyLen);
+    client->msgTopicBuf[copyLen] = 0;
+
+    void *ctx = NULL;
+    MQTT_StreamHandler handler = MQTT_RouterFindStream(client->router, (const char *)client->msgTopicBuf, &ctx);
+    if (!handler)
+        return 0;
+
+    MQTT_StreamChunk *c = &client->rxChunk;
+    memset(c, 0, sizeof(MQTT_StreamChunk));
+    c->topic = (const char *)client->msgTopicBuf;
+    c->totalLen = total - hdrLen;
+    c->qos = qos;
+    c->retain = (pkt[0] & 0x01) != 0;
+    if (qos > 0)
+        c->packetId = (uint16_t)((pkt[topicOff + topicLen] << 8) | pkt[topicOff + topicLen + 1]);
+    bool dup = (pkt[0] & 0x08) != 0;
+
+    MQTT_RingSkip(rb, hdrLen);
+    MQTT_RxActivity(client);
+
+    /* 4. 重复报文：只回复 ACK，Payload 直接丢弃 */
+    if (qos == 1 && !MQTT_RxUpdate(client, MQTT_SESSION_RX, c->packetId, dup))
+    {
+        client->stats.dupsDropped++;
+        client->rxDiscard = c->totalLen;
+        MQTT_SendAck(client, 0x40, c->packetId);
+        return 1;
+    }
+    if (qos == 2)
+    {
+        if (MQTT_RxQos2Has(client, c->packetId))
+        {
+            client->stats.dupsDropped++;
+            client->rxDiscard = c->totalLen;
+            MQTT_SendAck(client, 0x50, c->packetId);
+            return 1;
+        }
+        if (c->packetId == 0)
+        {
+            client->stats.parseFailures++;
+            client->rxDiscard = c->totalLen;
+            return 1;
+        }
+    }
+
+    /* 5. 通知处理函数，之后由 MQTT_RxStreamFeed 交付 Payload */
+    client->stats.publishIn++;
+    if (handler(client, MQTT_STREAM_BEGIN, c, ctx) < 0)
+    {
+        client->rxDiscard = c->totalLen;
+        MQTT_RxStreamFinish(client);
+        return 1;
+    }
+
+    client->rxStream = handler;
+    client->rxStreamCtx = ctx;
+    return 1;
+}
+
+/* * 把环形区中已到达的 Payload 交给流式处理函数 (一次最多交付到环形区末尾，回绕部分下一轮交付)
+ * 返回 false 表示需要等待：数据未到，或处理函数暂停
+ */
+static bool MQTT_RxStreamFeed(MQTT_Client *client)
+{
+    MQTT_Ring *rb = &client->rxRing;
+    MQTT_StreamChunk *c = &client->rxChunk;
+    uint32_t left = c->totalLen - c->offset;
+
+    if (left > 0)
+    {
+        uint32_t n = MQTT_RingCount(rb);
+        if (n > left)
+            n = left;
+        if (n > rb->size - rb->tail)
+            n = rb->size - rb->tail;
+        if (n == 0)
+            return false;
+
+        c->data = &rb->buffer[rb->tail];
+        c->len = n;
+        int32_t used = client->rxStream(client, MQTT_STREAM_DATA, c, client->rxStreamCtx);
+        c->data = NULL;
+        c->len = 0;
+
+        /* 处理函数放弃该消息 */
+        if (used < 0)
+        {
+            client->rxDiscard = left;
+            MQTT_RxStreamFinish(client);
+            return true;
+        }
+
+        /* 处理函数暂停：数据留在环形区，下次 MQTT_ProcessLoop 再交付 */
+        if (used == 0)
+            return false;
+        if ((uint32_t)used > n)
+            used = (int32_t)n;
+
+        MQTT_RingSkip(rb, (uint32_t)used);
+        c->offset += (uint32_t)used;
+        MQTT_RxActivity(client);
+        if (c->offset < c->totalLen)
+            return true;
+    }
+
+    client->rxStream(client, MQTT_STREAM_END, c, client->rxStreamCtx);
+    MQTT_RxStreamFinish(client);
+    return true;
+}
+#endif
+
+/* 初始化接收分帧：在 rxBuf 中选取环形区大小，使可接收的最大报文尽量大 */
+static bool MQTT_RxInit(MQTT_Client *client)
+{
+    uint32_t bestRing = 0;
+    uint32_t best = MQTT_RxLayout(client->rxBufSize, &bestRing);
+
+    if (best < 2 || !MQTT_RingInit(&client->rxRing, client->rxBuf, bestRing))
+        return false;
+
+    client->rxMaxPacket = best;
+    client->rxDiscard = 0;
+    return true;
+}
+
+/* 从接收环形区中取出所有完整报文并处理 */
+static void MQTT_RxFrame(MQTT_Client *client)
+{
+    MQTT_Ring *rb = &client->rxRing;
+
+    for (;;)
+    {
+        uint32_t count = MQTT_RingCount(rb);
+
+        /* 1. 正在丢弃超长报文 */
+        if (client->rxDiscard > 0)
+        {
+            uint32_t n = (count < client->rxDiscard) ? count : client->rxDiscard;
+            MQTT_RingSkip(rb, n);
+            client->rxDiscard -= n;
+            if (client->rxDiscard > 0)
+                return;
+            continue;
+        }
+
+#if MQTT_ENABLE_ROUTER
+        /* 2. 正在流式接收的 PUBLISH：交付已到达的 Payload */
+        if (client->rxStream)
+        {
+            if (!MQTT_RxStreamFeed(client))
+                return;
+            continue;
+        }
+#endif
+
+        if (count < 2)
+            return;
+
+        /* 3. 解析固定报头 (剩余长度最多 4 字节，可能跨越环形区末尾，逐字节取出) */
+        uint8_t hdr[4];
+        uint32_t hdrLen = (count - 1 < 4) ? count - 1 : 4;
+        for (uint32_t i = 0; i < hdrLen; i++)
+            hdr[i] = rb->buffer[(rb->tail + 1 + i) & rb->mask];
+
+        uint8_t encLen = 0;
+        uint32_t remaining = 0;
+        int ret = MQTT_DecodeLength(hdr, hdrLen, &encLen, &remaining, 268435455u);
+        if (ret == -2 && hdrLen < 4)
+            return; /* 长度字段未收全 */
+        if (ret != 0)
+        {
+            /* 长度字段非法，字节流已失去同步，清空接收区 */
+            HAL_MQTT_Log("MQTT: Malformed length, flush rx\r\n");
+            client->stats.parseFailures++;
+            MQTT_RingSkip(rb, count);
+            return;
+        }
+
+        uint32_t total = 1 + encLen + remaining;
+
+        /* 4. 匹配流式过滤器的 PUBLISH 不需要整包放入接收区 */
+#if MQTT_ENABLE_ROUTER
+        if ((rb->buffer[rb->tail] & 0xF0) == 0x30 && MQTT_Streaming(client))
+        {
+            int stream = MQTT_RxStreamBegin(client, count, encLen, total);
+            if (stream < 0)
+                return;
+            if (stream > 0)
+                continue;
+        }
+#endif
+
+        /* 5. 超长报文：无法放入接收区，丢弃 */
+        if (total > client->rxMaxPacket)
+        {
+            HAL_MQTT_Log("MQTT: Packet too large (%u), dropped\r\n", (unsigned)total);
+            client->stats.oversized++;
+            client->rxDiscard = total;
+            continue;
+        }
+
+        /* 6. 报文未收全，保留在环形区等待后续数据 */
+        if (count < total)
+            return;
+
+        /* 7. 跨越环形区末尾：把回绕到开头的部分复制到拼接区，整包即连续 */
+        uint32_t tail = rb->tail;
+        if (tail + total > rb->size)
+            memcpy(&rb->buffer[rb->size], &rb->buffer[0], tail + total - rb->size);
+
+        MQTT_HandleIncoming(client, &rb->buffer[tail], total);
+        MQTT_RingSkip(rb, total);
+    }
+}
+
+/* 计算本次接收的等待时间：最长 50ms，且不超过下一次需要处理的时刻，保证重发及时 */
+static uint32_t MQTT_NextTimeout(MQTT_Client *client)
+{
+    uint32_t wait = MQTT_NextWakeup(client);
+    return (wait < 50) ? wait : 50;
+}
+
+/* 处理一个到期请求：未达到重试上限则重发，否则判定超时 (在定时器到期时调用)
+ * MQTT 5 不允许在同一连接上重发 PUBLISH / PUBREL (MQTT-4.4.0-1)：连接期间只计次继续等待，
+ * 重连后由 MQTT_ResendPending 重发；重试次数耗尽同样判定超时 */
+static void MQTT_ExpireRequest(MQTT_Client *client, MQTT_Request *req)
+{
+    MQTT_TimerRemove(client, req);
+    HAL_MQTT_Log("MQTT: Wait ACK Timeout\r\n");
+
+    if (req->attempts < client->maxRetrys && req->op == MQTT_OP_PUBLISH && client->isConnected &&
+        client->protocolVersion == MQTT_VERSION_5)
+    {
+        req->attempts++;
+        MQTT_TimerInsert(client, req, HAL_MQTT_GetTick() + client->retryIntervalMs);
+    }
+    else if (req->attempts < client->maxRetrys)
+    {
+        /* 重发 (PUBLISH 带 DUP 标志)，重新启动超时定时器 */
+        client->stats.retries++;
+        if (!MQTT_SendRequest(client, req, 1))
+            MQTT_CompleteRequest(client, req, MQTT_RESULT_ERROR);
+    }
+    else
+    {
+        /* 重试次数耗尽，操作失败 */
+        client->stats.timeouts++;
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_TIMEOUT);
+    }
+}
+
+/* 触发所有到期的定时器 (请求重发/超时、批处理发送、心跳) */
+static void MQTT_ProcessTimeouts(MQTT_Client *client)
+{
+    HAL_MQTT_Lock();
+    MQTT_TimersRun(client, HAL_MQTT_GetTick());
+    HAL_MQTT_Unlock();
+}
+
+/* 触发完成回调：先在锁内摘下已完成的请求，再在锁外逐个回调 */
+static void MQTT_DispatchCompletions(MQTT_Client *client)
+{
+    struct
+    {
+        MQTT_Callback cb;
+        void *ctx;
+        MQTT_Operation op;
+        MQTT_Result result;
+        uint8_t reasonCode;
+    } done[MQTT_MAX_REQUESTS];
+    uint8_t count;
+    uint32_t slots = MQTT_MAX_REQUESTS + (MQTT_InflightEnabled(client) ? client->inflightSize : 0);
+
+    /* 每批最多摘 MQTT_MAX_REQUESTS 个，摘满说明可能还有剩余，继续下一批 */
+    do
+    {
+        count = 0;
+
+        HAL_MQTT_Lock();
+        for (uint32_t i = 0; i < slots && count < MQTT_MAX_REQUESTS; i++)
+        {
+            MQTT_Request *req;
+            if (i < MQTT_MAX_REQUESTS)
+                req = &client->requests[i];
+            else if (client->inflightDone > 0)
+                req = &client->inflight[i - MQTT_MAX_REQUESTS];
+            else
+                break;
+
+            if (req->state != MQTT_REQ_DONE)
+                continue;
+
+            done[count].cb = req->cb;
+            done[count].ctx = req->ctx;
+            done[count].op = req->op;
+            done[count].result = req->result;
+            done[count].reasonCode = req->reasonCode;
+            count++;
+
+            req->state = MQTT_REQ_FREE;
+            if (MQTT_IsInflight(client, req))
+                client->inflightDone--;
+        }
+        HAL_MQTT_Unlock();
+
+        /* 回调中允许再次调用 MQTT_Submit；回调中可读取 lastReasonCode */
+        for (uint8_t i = 0; i < count; i++)
+        {
+            client->lastReasonCode = done[i].reasonCode;
+            done[i].cb(client, done[i].op, done[i].result, done[i].ctx);
+        }
+    } while (count == MQTT_MAX_REQUESTS);
+}
+
+#if MQTT_ENABLE_STORE
+/* 补发完成：确认成功则出队，失败则保留在队首，下次重新补发 */
+static void MQTT_StoreCallback(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx)
+{
+    (void)op;
+    (void)ctx;
+
+    HAL_MQTT_Lock();
+    if (result == MQTT_RESULT_OK)
+        MQTT_StoreConsume(client->store);
+    client->storeBusy = false;
+    HAL_MQTT_Unlock();
+}
+
+/* 离线队列补发：连接正常时按顺序逐条发送，同一时刻只有一条在途，并限制发送间隔 */
+static void MQTT_StoreDrain(MQTT_Client *client)
+{
+    if (!client->store || !client->isConnected || client->storeBusy)
+        return;
+
+    uint32_t now = HAL_MQTT_GetTick();
+    if (now - client->storeDrainTick < client->storeDrainIntervalMs)
+        return;
+
+    MQTT_StoreRecord rec;
+    HAL_MQTT_Lock();
+    bool ok = MQTT_StorePeek(client->store, &rec);
+    HAL_MQTT_Unlock();
+    if (!ok)
+        return;
+
+    /* Topic 与 Payload 直接引用队列中的记录，出队之前一直有效 */
+    client->storeIov.base = rec.payload;
+    client->storeIov.len = rec.payloadLen;
+    client->storeBusy = true;
+    client->storeDrainTick = now;
+
+    if (!MQTT_SubmitRequest(client, MQTT_OP_PUBLISH, rec.topic, rec.topicLen, &client->storeIov, 1,
+                            rec.qos, rec.retain, MQTT_StoreCallback, NULL))
+        client->storeBusy = false;
+}
+#endif
+
+#if MQTT_ENABLE_CHANNEL
+/* 任务通道：完成回调把结果写回提交命令的通道 */
+static void MQTT_ChannelCallback(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx)
+{
+    MQTT_ChannelComplete((MQTT_ChannelTicket *)ctx, op, result, client->lastReasonCode);
+}
+
+/* 是否还有未完成的请求 (请求槽、在途窗口、Receive Maximum 与内存池都由它们占用，完成后即释放) */
+static bool MQTT_HasOutstanding(MQTT_Client *client)
+{
+    bool busy = client->inflightCount > 0 || client->inflightDone > 0;
+    for (uint8_t i = 0; i < MQTT_MAX_REQUESTS && !busy; i++)
+        busy = (client->requests[i].state != MQTT_REQ_FREE);
+    return busy;
+}
+
+/* 按顺序提交各通道中的命令 (请求表只在 I/O 循环中修改)
+ * 资源暂时不足时命令留在队首，该通道暂停提交，请求完成后重试；参数错误或没有未完成请求时仍无法提交的
+ * 命令以 ERROR 完成。blockedOnly 为 true 时只重试被暂停的通道 */
+static void MQTT_ChannelDrain(MQTT_Client *client, bool blockedOnly)
+{
+    static const MQTT_IoVec empty = {NULL, 0};
+
+    /* 通道只在链表头插入，取得链表头后遍历不需要持锁 */
+    HAL_MQTT_Lock();
+    MQTT_Channel *channel = client->channels;
+    HAL_MQTT_Unlock();
+
+    for (; channel; channel = channel->next)
+    {
+        MQTT_ChannelCmd cmd;
+        MQTT_ChannelTicket *ticket;
+
+        if (blockedOnly && !channel->blocked)
+            continue;
+        channel->blocked = false;
+
+        while ((ticket = MQTT_ChannelPeek(channel, &cmd)) != NULL)
+        {
+            const MQTT_IoVec *iov = cmd.iov;
+            size_t n = cmd.iovCnt;
+            bool needTopic = (cmd.op == MQTT_OP_PUBLISH || cmd.op == MQTT_OP_SUBSCRIBE || cmd.op == MQTT_OP_UNSUBSCRIBE);
+            bool valid = (!needTopic || cmd.topic) && (iov || n == 0) && n <= MQTT_MAX_IOV;
+            bool ok = false;
+
+            /* 通道命令不使用 client 上的 pubTopic/pubMsg/subTopic，空 Payload 也走数据段路径 */
+            if (valid)
+            {
+                if (cmd.op == MQTT_OP_PUBLISH && n == 0)
+                {
+                    iov = &empty;
+                    n = 1;
+                }
+                ok = MQTT_SubmitRequest(client, cmd.op, cmd.topic, cmd.topicLen, iov, n, cmd.qos, cmd.retain,
+                                        MQTT_ChannelCallback, ticket);
+            }
+
+            if (!ok && valid)
+            {
+                HAL_MQTT_Lock();
+                channel->blocked = MQTT_HasOutstanding(client);
+                HAL_MQTT_Unlock();
+                if (channel->blocked)
+                    break;
+            }
+
+            MQTT_ChannelTake(channel);
+            if (!ok)
+                MQTT_ChannelComplete(ticket, cmd.op, MQTT_RESULT_ERROR, 0);
+        }
+    }
+}
+#endif
+
+/* * 接收主循环 (消费者)
+ * 作用：一直运行，负责从硬件读取数据、匹配 ACK、驱动超时重发并触发完成回调
+ */
+/* * 距离下一次需要调用 MQTT_ProcessLoop 的时间
+ * 取请求超时、批处理等待、离线补发与心跳中最早的时刻；有待触发的回调时为 0
+ */
+uint32_t MQTT_NextWakeup(MQTT_Client *client)
+{
+    if (!client)
+        return UINT32_MAX;
+
+    uint32_t wait = UINT32_MAX;
+    uint32_t now = HAL_MQTT_GetTick();
+
+    HAL_MQTT_Lock();
+
+    /* 还有回调没触发，不要阻塞 */
+    if (client->inflightDone > 0)
+        wait = 0;
+    for (uint8_t i = 0; i < MQTT_MAX_REQUESTS; i++)
+    {
+        if (client->requests[i].state == MQTT_REQ_DONE)
+            wait = 0;
+    }
+
+#if MQTT_ENABLE_CHANNEL
+    /* 任务通道中还有命令没有取出 */
+    for (MQTT_Channel *channel = client->channels; channel; channel = channel->next)
+    {
+        if (MQTT_ChannelHasCommand(channel) && !channel->blocked)
+            wait = 0;
+    }
+#endif
+
+#if MQTT_ENABLE_SESSION
+    /* 还有订阅等待重新提交 */
+    if (client->session && client->session->resubPending && client->isConnected)
+        wait = 0;
+#endif
+
+    /* 限速已关闭但还有排队的消息 */
+    if (client->prioQueued > 0 && !client->rateBytesPerSec)
+        wait = 0;
+
+    /* 请求超时、批处理等待、心跳和限速令牌补足都由定时器管理，取最早的到期时刻 */
+    uint32_t timerWait = MQTT_TimersNextDelay(client, now);
+    if (timerWait < wait)
+        wait = timerWait;
+
+#if MQTT_ENABLE_ROUTER
+    /* 流式消息被处理函数暂停：稍后重新交付 */
+    if (client->rxStream && MQTT_RingCount(&client->rxRing) > 0 && MQTT_STREAM_RETRY_MS < wait)
+        wait = MQTT_STREAM_RETRY_MS;
+#endif
+
+#if MQTT_ENABLE_STORE
+    /* 下一次离线补发的时刻 */
+    if (client->store && client->isConnected && !client->storeBusy && MQTT_StoreCount(client->store) > 0)
+    {
+        int32_t remain = (int32_t)(client->storeDrainTick + client->storeDrainIntervalMs - now);
+        if (remain <= 0)
+            wait = 0;
+        else if ((uint32_t)remain < wait)
+            wait = (uint32_t)remain;
+    }
+#endif
+
+    HAL_MQTT_Unlock();
+
+    return wait;
+}
+
+bool MQTT_RxBlocked(MQTT_Client *client)
+{
+    uint32_t space;
+    return client && client->rxRing.buffer && !MQTT_RingWriteSpace(&client->rxRing, &space);
+}
+
+void MQTT_ProcessLoop(MQTT_Client *client)
+{
+    if (!client)
+        return;
+
+    if (!client->rxRing.buffer && !MQTT_RxInit(client))
+        return;
+
+#if MQTT_ENABLE_ROUTER
+    /* 0. 重连后结束未收完的流式消息；处理函数暂停过时，先交付环形区中剩余的数据 */
+    if (client->rxStreamReset)
+    {
+        client->rxStreamReset = false;
+        MQTT_RxStreamAbort(client);
+    }
+    if (client->rxStream)
+        MQTT_RxFrame(client);
+#endif
+
+#if MQTT_ENABLE_CHANNEL
+    /* 1. 提交各任务通道中的命令 */
+    MQTT_ChannelDrain(client, false);
+#endif
+
+    /* 2. 尝试接收数据，直接收进环形区的连续空闲段
+       等待时间最长 50ms，且不会越过最近一个请求的超时时刻。
+       如果是在裸机 while(1) 中调用，HAL_MQTT_Recv 可以忽略 timeout 直接返回。 */
+    uint32_t timeout = MQTT_NextTimeout(client);
+    for (uint8_t n = 0; n < 2; n++)
+    {
+        uint32_t space;
+        uint8_t *wp = MQTT_RingWriteSpace(&client->rxRing, &space);
+        if (!wp)
+            break;
+
+        int rlen = MQTT_TransportRecv(client, wp, space, timeout);
+        if (rlen <= 0)
+            break;
+        MQTT_RingCommit(&client->rxRing, (uint32_t)rlen);
+
+        /* 一次读取可能包含多个报文，也可能只有半个，按序处理所有完整报文 */
+        MQTT_RxFrame(client);
+
+        /* 空闲段被填满 (通常是写到了环形区末尾)，说明可能还有数据，不等待再读一次 */
+        if ((uint32_t)rlen < space)
+            break;
+        timeout = 0;
+    }
+
+    /* 3. 到期的定时器：请求重发或判定超时、批处理等待到期发送、心跳、限速令牌补足 */
+    MQTT_ProcessTimeouts(client);
+
+    /* 4. 放行排队的消息 (限速参数可能在运行中被修改，每次都重新检查) */
+    if (client->prioQueued > 0)
+    {
+        HAL_MQTT_Lock();
+        MQTT_RateDrain(client);
+        HAL_MQTT_Unlock();
+    }
+
+    /* 5. 触发完成回调，释放的请求槽先用于重试暂停的通道命令 */
+    MQTT_DispatchCompletions(client);
+#if MQTT_ENABLE_CHANNEL
+    MQTT_ChannelDrain(client, true);
+#endif
+
+    /* 6. 补发离线队列中的消息；服务器没有保留会话时重新订阅 */
+#if MQTT_ENABLE_STORE
+    MQTT_StoreDrain(client);
+#endif
+#if MQTT_ENABLE_SESSION
+    MQTT_SessionDrain(client);
+#endif
+
+    /* 7. 连接建立后启动心跳定时器 (在断开连接情况下会自动跳过) */
+    MQTT_MaintainKeepAlive(client);
+}
+
+/* ============================================================
+ * 核心：发送操作 (Sender Function)
+ * ============================================================ */
+
+/* * 异步提交 MQTT 操作 (内部实现)
+ * 作用：占用请求槽 -> 构建报文 -> 发送 -> 立即返回
+ * ACK 匹配、超时重发与回调由 MQTT_ProcessLoop 完成
+ * topic 为 NULL 时使用 client 上的 pubTopic/subTopic；iov 为 NULL 时 PUBLISH 发送 pubMsg
+ */
+static bool MQTT_SubmitRequest(MQTT_Client *client, MQTT_Operation op,
+                               const char *topic, size_t topicLen,
+                               const MQTT_IoVec *iov, size_t iovCnt,
+                               uint8_t qos, uint8_t retain,
+                               MQTT_Callback cb, void *ctx)
+{
+    if (!client || op > MQTT_OP_DISCONNECT)
+        return false;
+
+    if (!topic)
+    {
+        topic = (op == MQTT_OP_PUBLISH) ? client->pubTopic : client->subTopic;
+        topicLen = topic ? strlen(topic) : 0;
+    }
+
+    /* PUBLISH 参数检查 (Topic 长度字段只有 2 字节) */
+    if (op == MQTT_OP_PUBLISH)
+    {
+        if (!topic || topicLen > 0xFFFF || iovCnt > MQTT_MAX_IOV || (!iov && !client->pubMsg))
+            return false;
+    }
+
+    /* 设置了内存池：在锁外复制 Topic/Payload (补发的离线消息直接引用队列中的数据，不复制) */
+    void *block = NULL;
+#if MQTT_ENABLE_POOL
+    if (client->pool && topic && !MQTT_IsStoreDrain(cb) &&
+        (op == MQTT_OP_PUBLISH || op == MQTT_OP_SUBSCRIBE || op == MQTT_OP_UNSUBSCRIBE))
+    {
+        block = MQTT_PoolCopy(client, op, false, &topic, topicLen, &iov, &iovCnt);
+        if (!block)
+        {
+            HAL_MQTT_Log("MQTT: Memory pool exhausted\r\n");
+            return false;
+        }
+    }
+#endif
+
+    HAL_MQTT_Lock();
+
+    /* MQTT 5 流量控制：未确认的 QoS > 0 PUBLISH 数量不超过服务器的 Receive Maximum */
+    if (op == MQTT_OP_PUBLISH && qos > 0 && client->isConnected && client->protocolVersion == MQTT_VERSION_5 &&
+        MQTT_UnackedPublishes(client) >= client->serverReceiveMax)
+    {
+        HAL_MQTT_Unlock();
+        MQTT_PoolFree(client, block);
+        HAL_MQTT_Log("MQTT: Server receive maximum reached\r\n");
+        return false;
+    }
+
+    /* 1. 寻找空闲请求槽：QoS1 发布优先进入在途窗口，其他操作使用请求表 */
+    MQTT_Request *req = NULL;
+    uint16_t inflightId = 0;
+
+    if (op == MQTT_OP_PUBLISH && qos > 0 && MQTT_InflightEnabled(client))
+    {
+        req = MQTT_AllocInflight(client, &inflightId);
+        if (!req)
+        {
+            HAL_MQTT_Unlock();
+            MQTT_PoolFree(client, block);
+            HAL_MQTT_Log("MQTT: In-flight window full\r\n");
+            return false;
+        }
+        client->inflightCount++;
+    }
+    else
+    {
+        for (int i = 0; i < MQTT_MAX_REQUESTS; i++)
+        {
+            if (client->requests[i].state == MQTT_REQ_FREE)
+            {
+                req = &client->requests[i];
+                break;
+            }
+        }
+        if (!req)
+        {
+            HAL_MQTT_Unlock();
+            MQTT_PoolFree(client, block);
+            HAL_MQTT_Log("MQTT: Request table full\r\n");
+            return false;
+        }
+    }
+
+    /* 2. 保存重发所需参数 (字符串只保存指针，未使用内存池时调用者需保证在回调前有效) */
+    memset(req, 0, sizeof(MQTT_Request));
+    req->op = op;
+    req->qos = qos;
+    req->retain = retain;
+    req->topic = topic;
+    req->topicLen = (uint16_t)topicLen;
+    req->msg = client->pubMsg;
+    req->iov = iov;
+    req->iovCnt = (uint8_t)iovCnt;
+#if MQTT_ENABLE_POOL
+    req->block = block;
+#endif
+    req->cb = cb;
+    req->ctx = ctx;
+    req->submitTick = HAL_MQTT_GetTick();
+    /* 离线队列补发固定为批量类别，不挤占实时消息 */
+    req->priority = (MQTT_IsStoreDrain(cb) || client->priority >= MQTT_PRIO_MAX) ? MQTT_PRIO_BULK : client->priority;
+
+    /* 3. 自动管理 PacketID (在途窗口的 ID 已在分配槽时确定) */
+    if (inflightId)
+        req->packetId = inflightId;
+    else if (op == MQTT_OP_SUBSCRIBE || op == MQTT_OP_UNSUBSCRIBE ||
+             (op == MQTT_OP_PUBLISH && req->qos > 0))
+        req->packetId = MQTT_NextPacketId(client);
+
+    bool needsAck = MQTT_NeedsAck(op, req->qos);
+    req->state = needsAck ? MQTT_REQ_WAIT_ACK : MQTT_REQ_FREE;
+
+    /* 4. 离线时发布直接存入离线队列，不发送 */
+    if (op == MQTT_OP_PUBLISH && !client->isConnected && MQTT_StoreRequest(client, req))
+    {
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_STORED);
+        HAL_MQTT_Unlock();
+        return true;
+    }
+
+    /* 会话持久化：QoS > 0 的发布在发出之前记录 (补发的离线消息仍在离线队列中，不重复记录) */
+#if MQTT_ENABLE_SESSION
+    if (op == MQTT_OP_PUBLISH && req->qos > 0 && client->session && !MQTT_IsStoreDrain(cb))
+        MQTT_SessionLogPublish(client, req);
+#endif
+
+    /* 5. 限速：非控制类的 PUBLISH 进入优先级队列，由令牌桶放行 */
+    if (op == MQTT_OP_PUBLISH && req->priority != MQTT_PRIO_CONTROL && client->rateBytesPerSec)
+    {
+        MQTT_PrioEnqueue(client, req);
+        MQTT_RateDrain(client);
+        HAL_MQTT_Unlock();
+        return true;
+    }
+
+    /* 6. 构建并发送 */
+    if (!MQTT_SendRequest(client, req, 0))
+    {
+        MQTT_SessionLogDone(client, req);
+        MQTT_PoolRelease(client, req);
+        req->state = MQTT_REQ_FREE;
+        if (MQTT_IsInflight(client, req))
+            client->inflightCount--;
+        HAL_MQTT_Unlock();
+        return false;
+    }
+
+    /* 不需要等待 ACK 的操作：发出即完成 */
+    if (!needsAck)
+    {
+        /* 如果是主动断开，标记为未连接 */
+        if (op == MQTT_OP_DISCONNECT)
+        {
+            client->isConnected = false;
+            HAL_MQTT_Log("MQTT: Disconnected by user\r\n");
+        }
+        MQTT_CompleteRequest(client, req, MQTT_RESULT_OK);
+    }
+
+    HAL_MQTT_Unlock();
+    return true;
+}
+
+/* * 异步提交 MQTT 操作
+ * 参数取自 client 上的 pubTopic/pubMsg/subTopic/qos/retain
+ */
+bool MQTT_Submit(MQTT_Client *client, MQTT_Operation op, MQTT_Callback cb, void *ctx)
+{
+    return MQTT_SubmitRequest(client, op, NULL, 0, NULL, 0, client->qos, client->retain, cb, ctx);
+}
+
+/* * 异步发布二进制数据 (零拷贝)
+ * Payload 不经过 txBuf，由 HAL_MQTT_SendV 直接从用户内存发送
+ */
+bool MQTT_SubmitPublishV(MQTT_Client *client, const char *topic, uint16_t topicLen,
+                         const MQTT_IoVec *payload, size_t n, MQTT_Callback cb, void *ctx)
+{
+    static const MQTT_IoVec empty = {NULL, 0};
+
+    if (!topic || (!payload && n > 0))
+        return false;
+
+    /* 空 Payload 也走数据段路径，避免退回到 pubMsg */
+    if (n == 0)
+    {
+        payload = &empty;
+        n = 1;
+    }
+    return MQTT_SubmitRequest(client, MQTT_OP_PUBLISH, topic, topicLen, payload, n, client->qos, client->retain, cb, ctx);
+}
+
+/* * 用模板异步发布
+ * Topic 直接引用模板中已编码的副本，QoS/Retain 取自模板
+ */
+bool MQTT_SubmitPublishTemplate(MQTT_Client *client, const MQTT_PublishTemplate *tpl,
+                                const MQTT_IoVec *payload, size_t n, MQTT_Callback cb, void *ctx)
+{
+    static const MQTT_IoVec empty = {NULL, 0};
+
+    if (!tpl || !tpl->topic || (!payload && n > 0))
+        return false;
+
+    if (n == 0)
+    {
+        payload = &empty;
+        n = 1;
+    }
+    return MQTT_SubmitRequest(client, MQTT_OP_PUBLISH, tpl->topic, tpl->topicLen, payload, n, tpl->qos, tpl->retain, cb, ctx);
+}
+
+/* 立即发送批处理缓冲区中积累的报文 */
+void MQTT_Flush(MQTT_Client *client)
+{
+    if (!client)
+        return;
+
+    HAL_MQTT_Lock();
+    MQTT_BatchFlush(client, MQTT_FLUSH_MANUAL);
+    HAL_MQTT_Unlock();
+}
+
+/* 同步等待上下文 (位于 MQTT_TryOperation 的栈上)
+ * 回调先写 result 再以释放语义置位 done，等待方以获取语义读到 done 后 result 一定可见 */
+typedef struct
+{
+    volatile uint32_t done;
+    MQTT_Result result;
+} MQTT_SyncWait;
+
+static void MQTT_SyncCallback(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx)
+{
+    MQTT_SyncWait *wait = (MQTT_SyncWait *)ctx;
+    (void)client;
+    (void)op;
+    wait->result = result;
+    MQTT_StoreRelease(&wait->done, 1);
+}
+
+/* 撤销一个仍在请求表中的同步请求，返回 false 表示它已被 ProcessLoop 摘走 (回调即将执行) */
+static bool MQTT_CancelSync(MQTT_Client *client, MQTT_SyncWait *wait)
+{
+    bool found = false;
+
+    HAL_MQTT_Lock();
+    uint32_t count = MQTT_MAX_REQUESTS + (MQTT_InflightEnabled(client) ? client->inflightSize : 0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        MQTT_Request *req = (i < MQTT_MAX_REQUESTS) ? &client->requests[i]
+                                                    : &client->inflight[i - MQTT_MAX_REQUESTS];
+        if (req->state != MQTT_REQ_FREE && req->ctx == wait && req->cb == MQTT_SyncCallback)
+        {
+            /* 按已完成处理，但不再回调 */
+            req->cb = NULL;
+            MQTT_CompleteRequest(client, req, MQTT_RESULT_TIMEOUT);
+            found = true;
+        }
+    }
+    HAL_MQTT_Unlock();
+
+    return found;
+}
+
+/* 等待同步请求完成 (ProcessLoop 在另一个任务中触发回调) */
+static bool MQTT_WaitSync(MQTT_Client *client, MQTT_SyncWait *wait)
+{
+    /* 兜底超时：防止 ProcessLoop 没有运行导致永久阻塞 */
+    uint32_t attempts = client->maxRetrys ? client->maxRetrys : 1;
+    uint32_t limit = client->retryIntervalMs * (attempts + 1);
+    uint32_t startTick = HAL_MQTT_GetTick();
+
+    while (!MQTT_LoadAcquire(&wait->done))
+    {
+        if (HAL_MQTT_GetTick() - startTick > limit)
+        {
+            if (MQTT_CancelSync(client, wait))
+                return false;
+            /* 请求已被摘走，等待回调写回结果后再返回 (wait 位于调用者栈上) */
+            limit = UINT32_MAX;
+        }
+        HAL_MQTT_Delay(1);
+    }
+
+    return wait->result == MQTT_RESULT_OK || wait->result == MQTT_RESULT_STORED;
+}
+
+/* * 执行 MQTT 操作 (同步版本)
+ * 作用：MQTT_Submit -> 等待 ProcessLoop 触发完成回调
+ * 注意：需要另一个任务在运行 MQTT_ProcessLoop；新代码建议直接使用 MQTT_Submit
+ */
+bool MQTT_TryOperation(MQTT_Client *client, MQTT_Operation op)
+{
+    if (!client)
+        return false;
+
+    /* 不需要等待 ACK 的操作直接发送即可，不依赖 ProcessLoop */
+    if (!MQTT_NeedsAck(op, client->qos))
+        return MQTT_Submit(client, op, NULL, NULL);
+
+    MQTT_SyncWait wait = {0, MQTT_RESULT_ERROR};
+    if (!MQTT_Submit(client, op, MQTT_SyncCallback, &wait))
+        return false;
+
+    return MQTT_WaitSync(client, &wait);
+}
+
+/* * 同步发布二进制数据
+ * QoS 0 发送即返回；QoS > 0 等待 PUBACK，返回后 payload 即可释放
+ */
+bool MQTT_PublishV(MQTT_Client *client, const char *topic, uint16_t topicLen, const MQTT_IoVec *payload, size_t n)
+{
+    if (!client)
+        return false;
+
+    if (!MQTT_NeedsAck(MQTT_OP_PUBLISH, client->qos))
+        return MQTT_SubmitPublishV(client, topic, topicLen, payload, n, NULL, NULL);
+
+    MQTT_SyncWait wait = {0, MQTT_RESULT_ERROR};
+    if (!MQTT_SubmitPublishV(client, topic, topicLen, payload, n, MQTT_SyncCallback, &wait))
+        return false;
+
+    return MQTT_WaitSync(client, &wait);
+}
+
+/* --------------------------------------------------------------------------
+ * 延迟直方图
+ * 小于 2 * MQTT_HIST_SUB_COUNT 的值每个值一个桶；更大的值按最高位所在的 2 的幂区间
+ * 分组，组内按最高位之后的 MQTT_HIST_SUB_BITS 位再等分，记录与查询都是 O(1) / O(桶数)
+ * -------------------------------------------------------------------------- */
+
+static uint32_t MQTT_HistogramIndex(uint32_t value)
+{
+    if (value < 2 * MQTT_HIST_SUB_COUNT)
+        return value;
+
+    uint32_t msb = 31;
+    while (!(value & (1u << msb)))
+        msb--;
+    uint32_t shift = msb - MQTT_HIST_SUB_BITS;
+    return (shift + 1) * MQTT_HIST_SUB_COUNT + ((value >> shift) & (MQTT_HIST_SUB_COUNT - 1));
+}
+
+/* 桶内的最大值 */
+static uint32_t MQTT_HistogramUpper(uint32_t index)
+{
+    if (index < 2 * MQTT_HIST_SUB_COUNT)
+        return index;
+
+    uint32_t shift = index / MQTT_HIST_SUB_COUNT - 1;
+    uint32_t lower = (MQTT_HIST_SUB_COUNT + index % MQTT_HIST_SUB_COUNT) << shift;
+    return lower + ((1u << shift) - 1);
+}
+
+void MQTT_HistogramRecord(MQTT_Histogram *hist, uint32_t value)
+{
+    if (!hist)
+        return;
+
+    hist->counts[MQTT_HistogramIndex(value)]++;
+    if (hist->total == 0 || value < hist->min)
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+    hist->total++;
+    hist->sum += value;
+}
+
+uint32_t MQTT_HistogramPercentile(const MQTT_Histogram *hist, uint32_t permyriad)
+{
+    if (!hist || hist->total == 0)
+        return 0;
+    if (permyriad > 10000)
+        permyriad = 10000;
+
+    /* 第 rank 个样本 (向上取整，至少为 1) */
+    uint64_t rank = ((uint64_t)hist->total * permyriad + 9999) / 10000;
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < MQTT_HIST_BUCKETS; i++)
+    {
+        seen += hist->counts[i];
+        if (seen >= rank)
+        {
+            uint32_t upper = MQTT_HistogramUpper(i);
+            return (upper < hist->max) ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
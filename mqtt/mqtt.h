@@ -12,6 +12,79 @@ extern "C"
 #include <string.h>
 #include "mqtt_hal.h"
 
+/* ============================================================
+ * 可选功能开关 (默认全部关闭，可在编译选项中覆盖，如 -DMQTT_ENABLE_ROUTER=1)
+ * 全部关闭时客户端只需要 mqtt.c 与 mqtt_hal.c；开启某项功能后还要编译对应的源文件 (见 README)。
+ * 开关会改变 MQTT_Client 的布局，所有包含 mqtt.h 的源文件必须使用相同的设置。
+ * ============================================================ */
+
+/* 订阅分发与流式接收 (mqtt_router.c)：client->router */
+#ifndef MQTT_ENABLE_ROUTER
+#define MQTT_ENABLE_ROUTER 0
+#endif
+
+/* 提交时复制 Topic/Payload (../mem_pool)：client->pool */
+#ifndef MQTT_ENABLE_POOL
+#define MQTT_ENABLE_POOL 0
+#endif
+
+/* 离线发布队列 (mqtt_store.c，../CRC_Lib)：client->store */
+#ifndef MQTT_ENABLE_STORE
+#define MQTT_ENABLE_STORE 0
+#endif
+
+/* 最新值缓存 (mqtt_cache.c，../mem_pool)：client->cache */
+#ifndef MQTT_ENABLE_CACHE
+#define MQTT_ENABLE_CACHE 0
+#endif
+
+/* Payload 压缩 (mqtt_compress.c，../lzss，../CRC_Lib)：client->compress，发送方向的压缩需同时开启 POOL */
+#ifndef MQTT_ENABLE_COMPRESS
+#define MQTT_ENABLE_COMPRESS 0
+#endif
+
+/* 会话持久化 (mqtt_session.c，../CRC_Lib)：client->session，恢复时需要内存池 */
+#ifndef MQTT_ENABLE_SESSION
+#define MQTT_ENABLE_SESSION 0
+#endif
+
+/* 任务通道 (mqtt_channel.c)：MQTT_ChannelAttach 登记的通道由 MQTT_ProcessLoop 提交 */
+#ifndef MQTT_ENABLE_CHANNEL
+#define MQTT_ENABLE_CHANNEL 0
+#endif
+
+/* 定时器使用时间轮 (../timer_wheel)：关闭时 MQTT_ProcessLoop 逐个扫描请求槽与心跳等定时器，
+ * 在途窗口较大 (inflightSize 上百) 时开启可以省去每轮的扫描 */
+#ifndef MQTT_ENABLE_TIMER_WHEEL
+#define MQTT_ENABLE_TIMER_WHEEL 0
+#endif
+
+#if MQTT_ENABLE_SESSION && !MQTT_ENABLE_POOL
+#error "MQTT_ENABLE_SESSION requires MQTT_ENABLE_POOL"
+#endif
+
+#if MQTT_ENABLE_ROUTER
+#include "mqtt_router.h"
+#endif
+#if MQTT_ENABLE_POOL
+#include "../mem_pool/mem_pool.h"
+#endif
+#if MQTT_ENABLE_STORE
+#include "mqtt_store.h"
+#endif
+#if MQTT_ENABLE_CACHE
+#include "mqtt_cache.h"
+#endif
+#if MQTT_ENABLE_COMPRESS
+#include "mqtt_compress.h"
+#endif
+#if MQTT_ENABLE_SESSION
+#include "mqtt_session.h"
+#endif
+#if MQTT_ENABLE_TIMER_WHEEL
+#include "../timer_wheel/timer_wheel.h"
+#endif
+
 /* ============================================================
  * 宏定义与枚举
  * ============================================================ */
@@ -19,11 +92,26 @@ extern "C"
 /* MQTT 服务质量等级 (QoS) 定义 */
 #define MQTT_QOS0 0 /* 最多一次 (Fire and Forget) */
 #define MQTT_QOS1 1 /* 至少一次 (需要 PUBACK) */
-#define MQTT_QOS2 2 /* 只有一次 (不支持) */
+#define MQTT_QOS2 2 /* 只有一次 (需要 PUBREC/PUBREL/PUBCOMP 四次握手) */
 
 /* 协议规定的最大变长长度字节数 (4字节可表示 256MB) */
 #define MQTT_MAX_VAR_LEN 4
 
+/* 协议版本 (CONNECT 报文中的 Protocol Level) */
+#define MQTT_VERSION_3_1_1 4 /* 默认 */
+#define MQTT_VERSION_5 5     /* MQTT 5.0：属性、原因码、主题别名与流量控制 */
+
+/* MQTT 5 属性标识 (本协议栈会编码或解析的部分) */
+#define MQTT_PROP_RECEIVE_MAX 0x21     /* Receive Maximum (2 字节) */
+#define MQTT_PROP_TOPIC_ALIAS_MAX 0x22 /* Topic Alias Maximum (2 字节) */
+#define MQTT_PROP_TOPIC_ALIAS 0x23     /* Topic Alias (2 字节) */
+#define MQTT_PROP_MAX_PACKET 0x27      /* Maximum Packet Size (4 字节) */
+
+/* MQTT 5 主题别名可记录的最大主题长度 (更长的主题不分配别名，可在编译选项中覆盖) */
+#ifndef MQTT_ALIAS_TOPIC_MAX
+#define MQTT_ALIAS_TOPIC_MAX 128
+#endif
+
 /* MQTT 操作类型枚举 */
 typedef enum
 {
@@ -36,21 +124,262 @@ typedef enum
     MQTT_OP_DISCONNECT /* 断开连接 */
 } MQTT_Operation;
 
-/* 异步等待状态枚举 (用于线程间同步) */
+/* 异步操作结果 (通过完成回调通知) */
+typedef enum
+{
+    MQTT_RESULT_OK = 0,   /* 成功：收到预期的 ACK (无需 ACK 的报文则表示已发出) */
+    MQTT_RESULT_TIMEOUT,  /* 超时：重试次数耗尽仍未收到 ACK */
+    MQTT_RESULT_REJECTED, /* 拒绝：服务器返回失败码 (CONNACK 非 0 / SUBACK 0x80 / MQTT 5 原因码 >= 0x80) */
+    MQTT_RESULT_ERROR,    /* 错误：报文构建失败或缓冲区不足 */
+    MQTT_RESULT_STORED    /* 未送达，已存入离线队列，连接恢复后自动补发 (仅在设置了 store 时出现) */
+} MQTT_Result;
+
+/* 请求槽状态 */
+typedef enum
+{
+    MQTT_REQ_FREE = 0, /* 空闲 */
+    MQTT_REQ_WAIT_ACK, /* 已发送，超时定时器已启动，等待 ACK 或超时重发 */
+    MQTT_REQ_WAIT_COMP, /* QoS 2 发布：已收到 PUBREC 并发出 PUBREL，等待 PUBCOMP */
+    MQTT_REQ_DONE,     /* 已完成，等待 ProcessLoop 触发完成回调 */
+    MQTT_REQ_QUEUED    /* 限速：已占用请求槽和 PacketID，在优先级队列中等待发送 */
+} MQTT_RequestState;
+
+/* 接收去重位图大小 (字节，必须是 2 的幂，可在编译选项中覆盖)
+ * 每位对应一个 PacketID，窗口覆盖最近 8 * N 个 ID：MCU 上 64 字节 (512 个 ID)，
+ * Linux 上可设为 8192 字节覆盖全部 65536 个 ID */
+#ifndef MQTT_RX_DEDUP_BYTES
+#define MQTT_RX_DEDUP_BYTES 64
+#endif
+#if (MQTT_RX_DEDUP_BYTES & (MQTT_RX_DEDUP_BYTES - 1)) != 0 || MQTT_RX_DEDUP_BYTES > 8192
+#error "MQTT_RX_DEDUP_BYTES must be a power of 2 and <= 8192"
+#endif
+
+/* 接收方向 QoS 2 状态表容量：同时等待 PUBREL 的 PacketID 数 (每项 2 字节，可在编译选项中覆盖)
+ * MQTT 5 在 CONNECT 中以 Receive Maximum 声明该值，服务器不会超出；
+ * MQTT 3.1.1 没有流控，表满时淘汰最早的一项 (stats.rxQos2Evicted)，该消息之后的重发可能被再次交付 */
+#ifndef MQTT_RX_QOS2_MAX
+#define MQTT_RX_QOS2_MAX 64
+#endif
+#if MQTT_RX_QOS2_MAX < 1 || MQTT_RX_QOS2_MAX > 65535
+#error "MQTT_RX_QOS2_MAX must be in 1..65535"
+#endif
+
+/* 流式消息被处理函数暂停 (未处理完本段数据) 后，MQTT_NextWakeup 给出的重新交付间隔 (毫秒) */
+#ifndef MQTT_STREAM_RETRY_MS
+#define MQTT_STREAM_RETRY_MS 10
+#endif
+
+/* 同时挂起的异步请求数量上限 (可在编译选项中覆盖) */
+#ifndef MQTT_MAX_REQUESTS
+#define MQTT_MAX_REQUESTS 8
+#endif
+
+/* 客户端时间轮槽数 (MQTT_ENABLE_TIMER_WHEEL 时有效，2 的幂，1 槽 = 1ms，可在编译选项中覆盖)
+ * 请求超时、重发、心跳和批处理等待共用；槽数越多，超过一圈的定时器被重复检查的次数越少，每槽占一个指针 */
+#ifndef MQTT_TIMER_SLOTS
+#define MQTT_TIMER_SLOTS 64
+#endif
+#if (MQTT_TIMER_SLOTS & (MQTT_TIMER_SLOTS - 1)) != 0
+#error "MQTT_TIMER_SLOTS must be a power of 2"
+#endif
+
+/* 心跳 PINGREQ 发出后等待回包的时间 (毫秒)，超时重发，连续 maxRetrys 次无回包判定断线 (可在编译选项中覆盖) */
+#ifndef MQTT_PING_RETRY_MS
+#define MQTT_PING_RETRY_MS 5000
+#endif
+
+/* PublishV 一次最多携带的 Payload 数据段数量 (可在编译选项中覆盖) */
+#ifndef MQTT_MAX_IOV
+#define MQTT_MAX_IOV 4
+#endif
+
+/* 发布优先级 (限速时的调度类别)：控制 > 告警 > 遥测 > 批量，默认 (0) 为遥测 */
 typedef enum
 {
-    MQTT_WAIT_IDLE = 0, /* 空闲：当前无等待任务 */
-    MQTT_WAIT_BUSY,     /* 忙碌：已发送请求，正在等待 ACK */
-    MQTT_WAIT_SUCCESS,  /* 成功：接收任务已收到预期的 ACK */
-    MQTT_WAIT_TIMEOUT   /* 超时：等待时间耗尽 (通常由发送方判断) */
-} MQTT_WaitState;
+    MQTT_PRIO_TELEMETRY = 0, /* 遥测 (默认) */
+    MQTT_PRIO_ALARM,         /* 告警：权重高于遥测 */
+    MQTT_PRIO_BULK,          /* 批量数据：权重最低 (离线队列补发固定为此类别) */
+    MQTT_PRIO_CONTROL,       /* 控制：不排队，立即发送 (SUBSCRIBE 等协议报文、ACK、重发同样如此) */
+    MQTT_PRIO_MAX
+} MQTT_Priority;
+
+/* 加权公平调度的基本份额 (字节)：每轮各类别可发送 权重 × 份额 字节 (可在编译选项中覆盖) */
+#ifndef MQTT_PRIO_QUANTUM
+#define MQTT_PRIO_QUANTUM 512
+#endif
+
+/* PUBLISH 固定报头 + Topic 长度字段的最大长度: 1 + 4 + 2 */
+#define MQTT_PUBLISH_HDR_MAX 7
+
+/* 发布模板中为固定报头预留的字节数: 报文类型(1) + 剩余长度(最多 4) */
+#define MQTT_TEMPLATE_HDR_RESERVE (1 + MQTT_MAX_VAR_LEN)
+
+/* 发布模板所需的缓冲区大小: 预留报头 + Topic 长度(2) + Topic + PacketID(2) + Payload */
+#define MQTT_TEMPLATE_BUF_SIZE(topicLen, maxPayload) \
+    (MQTT_TEMPLATE_HDR_RESERVE + 2 + (size_t)(topicLen) + 2 + (size_t)(maxPayload))
+
+/* MQTT 5 PUBLISH 属性区的最大长度: 属性长度(1) + Topic Alias(3) */
+#define MQTT_PUBLISH_PROPS_MAX 4
+
+/* 批处理发送的触发原因 */
+typedef enum
+{
+    MQTT_FLUSH_BYTES = 0, /* 达到字节阈值 batchMaxBytes */
+    MQTT_FLUSH_COUNT,     /* 达到报文数阈值 batchMaxCount */
+    MQTT_FLUSH_LINGER,    /* 第一条报文等待超过 batchLingerMs */
+    MQTT_FLUSH_FULL,      /* 缓冲区放不下新报文 */
+    MQTT_FLUSH_ORDER,     /* 其他报文需要立即发送，先发出已积累的报文以保持顺序 */
+    MQTT_FLUSH_MANUAL,    /* 用户调用 MQTT_Flush */
+    MQTT_FLUSH_REASON_MAX
+} MQTT_FlushReason;
+
+/* 批处理统计 */
+typedef struct
+{
+    uint32_t batches;                         /* 已发送批次数 (即传输层写入次数) */
+    uint32_t packets;                         /* 经批处理发送的报文总数 */
+    uint32_t bytes;                           /* 经批处理发送的字节总数 */
+    uint16_t lastPackets;                     /* 最近一批的报文数 */
+    uint32_t lastBytes;                       /* 最近一批的字节数 */
+    uint32_t lastLingerMs;                    /* 最近一批第一条报文的等待时间 */
+    uint32_t maxLingerMs;                     /* 最大等待时间 */
+    uint32_t byReason[MQTT_FLUSH_REASON_MAX]; /* 各触发原因的次数 */
+} MQTT_BatchStats;
+
+/* 延迟直方图分桶精度：每个 2 的幂区间再等分为 2^MQTT_HIST_SUB_BITS 个子桶
+ * (HDR 风格的对数-线性分桶，相对误差不超过 1/2^MQTT_HIST_SUB_BITS，默认 12.5%) */
+#ifndef MQTT_HIST_SUB_BITS
+#define MQTT_HIST_SUB_BITS 3
+#endif
+#define MQTT_HIST_SUB_COUNT (1u << MQTT_HIST_SUB_BITS)
+#define MQTT_HIST_BUCKETS ((33 - MQTT_HIST_SUB_BITS) * MQTT_HIST_SUB_COUNT)
+
+/* 延迟直方图 (单位由记录方决定：客户端内部为 Tick 毫秒) */
+typedef struct
+{
+    uint32_t counts[MQTT_HIST_BUCKETS]; /* 各桶计数 */
+    uint32_t total;                     /* 样本总数 */
+    uint32_t min;                       /* 最小值 (total 为 0 时无效) */
+    uint32_t max;                       /* 最大值 */
+    uint64_t sum;                       /* 样本之和 (用于计算平均值) */
+} MQTT_Histogram;
+
+/* 客户端运行统计 (只读，由协议栈更新；多任务下读取的是近似值) */
+typedef struct
+{
+    uint32_t bytesOut;       /* 写给传输层的字节数 */
+    uint32_t bytesIn;        /* 从传输层读到的字节数 */
+    uint32_t publishOut;     /* 发出的 PUBLISH 数 (不含重发) */
+    uint32_t publishIn;      /* 交付给应用的下行 PUBLISH 数 */
+    uint32_t retries;        /* 超时重发次数 */
+    uint32_t timeouts;       /* 重试耗尽的请求数 */
+    uint32_t dupsDropped;    /* 被去重丢弃的下行 PUBLISH 数 (QoS 1 窗口 + QoS 2 状态表) */
+    uint32_t rxQos2Evicted;  /* QoS 2 状态表满时被淘汰的 PacketID 数 (只有不遵守 Receive Maximum 的服务器或 MQTT 3.1.1 会发生) */
+    uint32_t parseFailures;  /* 解析失败的报文数 (剩余长度非法、PUBLISH 格式错误或缓冲区不足) */
+    uint32_t oversized;      /* 超过接收区容量而被丢弃的报文数 */
+    uint32_t aliasHits;      /* MQTT 5：以主题别名代替 Topic 发出的 PUBLISH 数 */
+    uint32_t aliasBytesSaved; /* MQTT 5：别名命中节省的字节数 (每次 Topic 长度 - 3 字节别名属性) */
+    uint32_t throttledMs;    /* 限速：队列中有消息但令牌不足、等待发送的累计时间 */
+    uint16_t queueDepth[MQTT_PRIO_MAX]; /* 限速：各优先级队列当前排队的 PUBLISH 数 (CONTROL 恒为 0) */
+    uint16_t queuePeak[MQTT_PRIO_MAX];  /* 限速：各优先级队列的历史最大排队数 */
+    MQTT_Histogram *ackLatency; /* 可选：PUBLISH 提交到收到 PUBACK/PUBCOMP 的耗时 (毫秒)，由用户提供内存 */
+} MQTT_Stats;
+
+/* 传输层接口 (可选)：设置到 MQTT_Client::transport 后，该客户端的收发不再经过全局
+ * HAL_MQTT_Send/SendV/Recv，一个进程内可以运行多个各自连接的客户端 (如压测工具)
+ * 语义与对应的 HAL 接口相同，ctx 为 MQTT_Client::transportCtx */
+typedef struct
+{
+    void (*send)(void *ctx, const uint8_t *buf, size_t len);
+    void (*sendv)(void *ctx, const MQTT_IoVec *iov, size_t cnt); /* 可为 NULL (逐段调用 send) */
+    int (*recv)(void *ctx, uint8_t *buf, size_t bufSize, uint32_t timeoutMs);
+} MQTT_Transport;
+
+struct MQTT_Client;
+
+/* 完成回调：在 MQTT_ProcessLoop 的线程上下文中执行 */
+typedef void (*MQTT_Callback)(struct MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx);
+
+/* 预编码的 PUBLISH 模板 (MQTT_PreparePublishTemplate 填充)
+ * buf 布局: [预留报头 5 字节][Topic 长度 2 字节][Topic][PacketID][Payload]
+ * Topic 只在准备时写入一次；每次构建只写入固定报头 (靠右对齐到预留区末尾)、PacketID 和 Payload */
+typedef struct
+{
+    uint8_t *buf;      /* 编码缓冲区 (由用户提供，模板独占) */
+    size_t bufSize;    /* 缓冲区大小 */
+    const char *topic; /* 指向 buf 中已编码的 Topic (不以 0 结尾)，原字符串可以释放 */
+    uint16_t topicLen; /* Topic 长度 */
+    uint8_t qos;       /* QoS 等级 */
+    uint8_t retain;    /* 保留标志 */
+} MQTT_PublishTemplate;
+
+/* MQTT 5 主题别名表项 (别名 = 表项下标 + 1) */
+typedef struct
+{
+    uint16_t topicLen;                /* 0 表示空闲 */
+    uint32_t lastUse;                 /* 最近使用的序号 (LRU 淘汰) */
+    char topic[MQTT_ALIAS_TOPIC_MAX]; /* 已与服务器约定的主题 (不以 0 结尾) */
+} MQTT_TopicAlias;
+
+/* 字节环形区 (内部使用：接收分帧与批处理)
+ * 大小为 2 的幂，保留 1 字节区分空与满；读写位置只在 I/O 循环中 (批处理在 HAL_MQTT_Lock 内) 修改 */
+typedef struct
+{
+    uint8_t *buffer; /* 数据区 */
+    uint32_t size;   /* 容量 (2 的幂) */
+    uint32_t mask;   /* size - 1 */
+    uint32_t head;   /* 写位置 */
+    uint32_t tail;   /* 读位置 */
+} MQTT_Ring;
+
+/* 定时器 (内部使用)：开启 MQTT_ENABLE_TIMER_WHEEL 时由时间轮管理，否则只记录截止时刻，
+ * 由 MQTT_ProcessLoop 逐个检查 */
+#if MQTT_ENABLE_TIMER_WHEEL
+typedef tw_timer_t MQTT_Timer;
+#else
+typedef struct
+{
+    uint32_t expire; /* 到期时刻 */
+    bool active;     /* 是否已启动 */
+} MQTT_Timer;
+#endif
+
+/* 异步请求槽：保存重发所需的全部参数 */
+typedef struct MQTT_Request
+{
+    MQTT_RequestState state; /* 槽状态 */
+    MQTT_Operation op;       /* 操作类型 */
+    MQTT_Result result;      /* 完成结果 (state == DONE 时有效) */
+    uint16_t packetId;       /* 报文 ID (SUBSCRIBE/UNSUBSCRIBE/PUBLISH) */
+    uint8_t qos;             /* QoS 等级 */
+    uint8_t retain;          /* 保留标志 */
+    uint8_t attempts;        /* 已发送次数 */
+    uint8_t reasonCode;      /* MQTT 5：应答中的原因码 (3.1.1 下为 0，拒绝时为返回码) */
+    uint8_t priority;        /* 发布优先级 (MQTT_Priority) */
+    const char *topic;       /* 主题 (调用者需保证在回调之前有效) */
+    const char *msg;         /* 消息内容 (同上) */
+    const MQTT_IoVec *iov;   /* 二进制 Payload 数据段 (PublishV 使用，为 NULL 时发送 msg) */
+    uint8_t iovCnt;          /* 数据段数量 */
+#if MQTT_ENABLE_POOL
+    void *block;             /* 内存池中的 Topic/Payload 副本 (NULL 表示引用调用者的内存)，完成时释放 */
+#endif
+#if MQTT_ENABLE_SESSION
+    bool logged;             /* 已写入会话日志 (完成时追加结束记录) */
+#endif
+    uint16_t topicLen;       /* 主题长度 */
+    uint32_t submitTick;     /* 提交时刻 (用于统计确认延迟) */
+    MQTT_Callback cb;        /* 完成回调 (可为 NULL) */
+    void *ctx;               /* 回调用户参数 */
+    MQTT_Timer timer;        /* 等待 ACK 的超时定时器 (timer.expire 即截止时刻) */
+    struct MQTT_Request *next; /* 优先级队列中的下一个请求 (state == QUEUED 时有效) */
+} MQTT_Request;
 
 /* ============================================================
  * 核心数据结构
  * ============================================================ */
 
 /* MQTT 客户端句柄结构体 */
-typedef struct
+typedef struct MQTT_Client
 {
     /* --- 通信缓冲区 --- */
     uint8_t *txBuf;   /* 发送缓冲区指针 (用于构建报文) */
@@ -58,6 +387,24 @@ typedef struct
     uint8_t *rxBuf;   /* 接收缓冲区指针 (用于存放 HAL_Recv 的原始数据) */
     size_t rxBufSize; /* 接收缓冲区大小 */
 
+    /* --- 传输层 (可选，为 NULL 时使用全局 HAL 收发接口) --- */
+    const MQTT_Transport *transport;
+    void *transportCtx;
+
+    /* --- 接收分帧 (内部使用，首次 ProcessLoop 时自动初始化) --- */
+    /* rxBuf 被划分为 [环形区 2^n 字节][拼接区]：数据先进入环形区，
+     * 跨越环形区末尾的报文把回绕部分复制到拼接区，使整包连续后原地解析 */
+    MQTT_Ring rxRing;     /* 环形区控制块 */
+    uint32_t rxMaxPacket; /* 可接收的最大报文长度 (超过则丢弃) */
+    uint32_t rxDiscard;   /* 超长报文剩余待丢弃的字节数 */
+#if MQTT_ENABLE_ROUTER
+    /* 流式接收：匹配流式过滤器的 PUBLISH 只解析可变报头，Payload 原地分段交给处理函数 */
+    MQTT_StreamHandler rxStream; /* 正在接收的流式消息的处理函数 (NULL 表示没有) */
+    void *rxStreamCtx;           /* 处理函数用户参数 */
+    MQTT_StreamChunk rxChunk;    /* 正在接收的流式消息 */
+    volatile bool rxStreamReset; /* 已发送 CONNECT，下次 MQTT_ProcessLoop 时结束未收完的流式消息 */
+#endif
+
     /* --- 消息解析缓冲区 (新增：防止栈溢出) --- */
     uint8_t *msgTopicBuf;     /* 用于存放解析出的下行 Topic */
     size_t msgTopicBufSize;   /* Topic 缓冲区大小 */
@@ -70,6 +417,7 @@ typedef struct
     const char *password; /* 密码 (可选) */
     uint16_t keepAlive;   /* 心跳间隔 (秒) */
     uint8_t cleanSession; /* 1=不保留会话, 0=保留会话 */
+    uint8_t protocolVersion; /* MQTT_VERSION_3_1_1 (0 视同) 或 MQTT_VERSION_5 */
 
     /* --- 传输控制参数 --- */
     uint32_t retryIntervalMs; /* 等待 ACK 的超时时间/重试间隔 (毫秒) */
@@ -78,21 +426,144 @@ typedef struct
     /* --- 状态管理 --- */
     bool isConnected;        /* 连接状态标志 */
     uint32_t lastActiveTick; /* 最后一次成功收发的时间戳 */
-    uint16_t lastRxPacketId; /* 接收去重记录 */
+    uint8_t pingAttempts;    /* 心跳：已发出、尚未收到任何回包的 PINGREQ 数 */
+
+    /* --- 定时器 (内部使用，首次使用时自动初始化) --- */
+    /* 请求超时与重发、心跳、批处理等待由 MQTT_ProcessLoop 按 HAL_MQTT_GetTick 检查 (开启时间轮时共用一个时间轮) */
+#if MQTT_ENABLE_TIMER_WHEEL
+    timer_wheel_t timers;
+    tw_timer_t *timerSlots[MQTT_TIMER_SLOTS];
+#endif
+    MQTT_Timer keepAliveTimer; /* 空闲半个心跳周期后发送 PINGREQ，之后等待回包 */
+    MQTT_Timer batchTimer;     /* 批处理第一条报文的等待截止 */
+    MQTT_Timer rateTimer;      /* 限速：令牌补足后继续发送排队的消息 */
+
+    /* --- 接收去重 (滑动窗口位图) --- */
+    uint16_t rxTopId;                      /* 窗口顶端：最近收到的最大 PacketID */
+    bool rxDedupReady;                     /* 窗口是否已初始化 */
+    uint8_t rxSeen[MQTT_RX_DEDUP_BYTES];   /* 已处理 PacketID 位图，按 PacketID 低位索引 */
+
+    /* --- 接收方向 QoS 2 状态 (按到达顺序排列的 PacketID 表) --- */
+    uint16_t rxQos2[MQTT_RX_QOS2_MAX];     /* 已交付用户、等待 PUBREL 的 PacketID，最早的在前 */
+    uint16_t rxQos2Count;                  /* 表中的 PacketID 数量 */
 
     /* --- 当前操作上下文 (由发送方设置) --- */
     const char *pubTopic; /* 要发布的主题 */
     const char *pubMsg;   /* 要发布的消息内容 */
     const char *subTopic; /* 要订阅/退订的主题 */
-    uint16_t packetId;    /* 当前报文 ID */
+    uint16_t packetId;    /* 报文 ID 计数器 (提交时自动自增分配) */
     uint8_t qos;          /* QoS 等级 */
     uint8_t retain;       /* 保留标志 */
+    uint8_t priority;     /* 发布优先级 (MQTT_Priority，只在设置了 rateBytesPerSec 时生效) */
+
+    /* --- 异步请求表 (核心机制) --- */
+    /* MQTT_Submit 填充请求槽，MQTT_ProcessLoop 负责匹配 ACK、超时重发和触发回调 */
+    /* 两者之间通过 HAL_MQTT_Lock/HAL_MQTT_Unlock 互斥 */
+    MQTT_Request requests[MQTT_MAX_REQUESTS];
 
-    /* --- 线程同步标志 (核心机制) --- */
-    /* 发送方设置这些值，接收方检查这些值 */
-    volatile MQTT_WaitState waitState; /* 当前等待状态 */
-    volatile MQTT_Operation awaitType; /* 期待收到的 ACK 类型 (如 OP_PUBLISH -> 等待 PUBACK) */
-    volatile uint16_t awaitPacketId;   /* 期待的 Packet ID */
+    /* --- QoS1 在途窗口 (可选，由用户提供内存) --- */
+    /* 以 packetId & (inflightSize - 1) 为下标，允许多个 PUBLISH 同时等待 PUBACK */
+    MQTT_Request *inflight; /* 槽数组 (为 NULL 时 QoS1 发布占用 requests，一次最多 MQTT_MAX_REQUESTS 条) */
+    uint16_t inflightSize;  /* 槽数量，即窗口大小 (必须是 2 的幂，如 16/32/64) */
+    uint16_t inflightCount; /* 当前在途数量 */
+    uint16_t inflightDone;  /* 已完成、等待触发回调的槽数量 */
+
+    /* --- QoS 0 发布批处理 (可选) --- */
+    /* 设置 batchBuf 后 QoS 0 PUBLISH 先编码进发送环形缓冲区，满足任一阈值时一次性写给传输层 */
+    uint8_t *batchBuf;        /* 批处理缓冲区 (大小必须是 2 的幂，为 NULL 时不启用) */
+    uint32_t batchBufSize;    /* 缓冲区大小 */
+    uint32_t batchMaxBytes;   /* 积累到该字节数立即发送 (0 表示缓冲区放不下时才发送) */
+    uint16_t batchMaxCount;   /* 积累到该报文数立即发送 (0 表示不限) */
+    uint16_t batchLingerMs;   /* 第一条报文最长等待时间 (延迟与吞吐的权衡，0 表示下一次 ProcessLoop 即发送) */
+    MQTT_Ring batchRing;      /* 内部使用 */
+    uint16_t batchCount;      /* 当前批内报文数 */
+    uint32_t batchStartTick;  /* 当前批第一条报文的入队时刻 */
+    MQTT_BatchStats batchStats; /* 批处理统计 */
+
+    /* --- 限速与优先级调度 (可选) --- */
+    /* 设置 rateBytesPerSec 后，非 CONTROL 优先级的 PUBLISH 先进入各自的优先级队列，
+     * 由令牌桶按字节速率放行，各队列之间按权重做加权公平调度 (Deficit Round Robin)；
+     * 所有写给传输层的字节 (含 ACK、心跳、重发) 都消耗令牌 */
+    uint32_t rateBytesPerSec;            /* 平均速率 (字节/秒，0 表示不限速) */
+    uint32_t rateBurst;                  /* 令牌桶容量，即允许的突发字节数 (0 表示 1 秒的量) */
+    uint8_t prioWeights[MQTT_PRIO_MAX];  /* 各优先级的权重 (0 表示默认值：遥测 4、告警 8、批量 1) */
+    int32_t rateTokens;                  /* 内部使用：当前令牌 (字节，可为负) */
+    uint32_t rateFrac;                   /* 内部使用：不足 1 字节的令牌 (千分之一字节) */
+    uint32_t rateTick;                   /* 内部使用：上次补充令牌的时刻 */
+    bool rateThrottled;                  /* 内部使用：正在等待令牌 */
+    uint32_t rateThrottleTick;           /* 内部使用：开始等待的时刻 */
+    MQTT_Request *prioHead[MQTT_PRIO_MAX]; /* 内部使用：各优先级队列 */
+    MQTT_Request *prioTail[MQTT_PRIO_MAX];
+    uint32_t prioDeficit[MQTT_PRIO_MAX]; /* 内部使用：本轮剩余可发送的字节数 */
+    uint8_t prioCursor;                  /* 内部使用：当前轮到的优先级 */
+    bool prioCharged;                    /* 内部使用：当前优先级已领取本轮份额 */
+    uint16_t prioQueued;                 /* 内部使用：排队的 PUBLISH 总数 */
+
+#if MQTT_ENABLE_ROUTER
+    /* --- 订阅分发 (可选) --- */
+    /* 设置后下行 PUBLISH 按 Topic 分发给匹配的处理函数，没有任何过滤器匹配时才调用 HAL_MQTT_OnPublishReceived */
+    MQTT_Router *router;
+#endif
+
+#if MQTT_ENABLE_POOL
+    /* --- 内存池 (可选) --- */
+    /* 设置后，提交 PUBLISH / SUBSCRIBE / UNSUBSCRIBE 时把 Topic 与 Payload 复制到池中的一块，
+     * 调用者提交后即可释放或改写原数据；请求完成时归还。池中没有合适的块时提交返回 false */
+    mem_pool_t *pool;
+#endif
+
+#if MQTT_ENABLE_STORE
+    /* --- 离线发布队列 (可选) --- */
+    /* 设置后，离线时提交的 PUBLISH 以及重试耗尽的 PUBLISH 存入队列 (结果为 MQTT_RESULT_STORED)，
+     * 连接恢复后由 MQTT_ProcessLoop 按原顺序逐条补发，收到确认后出队 */
+    MQTT_Store *store;
+    uint16_t storeDrainIntervalMs; /* 两条补发消息之间的最小间隔 (限速，避免挤占实时消息) */
+    bool storeBusy;                /* 内部使用：有一条补发消息在途 */
+    uint32_t storeDrainTick;       /* 上一次补发的时刻 */
+    MQTT_IoVec storeIov;           /* 补发消息的 Payload 数据段 */
+#endif
+
+#if MQTT_ENABLE_CACHE
+    /* --- 最新值缓存 (可选) --- */
+    /* 设置后，每条下行 PUBLISH 在分发前写入缓存 (Topic 被 msgTopicBuf 截断的消息与流式接收的消息除外)，
+     * 应用可用 MQTT_CacheGet 在本地读取各 Topic 的最新值 */
+    MQTT_Cache *cache;
+#endif
+
+#if MQTT_ENABLE_COMPRESS
+    /* --- Payload 压缩 (可选) --- */
+    /* 设置后，经内存池复制的 PUBLISH Payload 在复制时压缩 (需同时设置 pool)，
+     * 收到的压缩 Payload 在写入缓存、交给处理函数之前解压 (流式接收的消息原样交付) */
+    MQTT_Compress *compress;
+#endif
+
+#if MQTT_ENABLE_SESSION
+    /* --- 会话持久化 (可选，配合 cleanSession = 0) --- */
+    /* 设置后，未确认的 QoS > 0 PUBLISH、PacketID、订阅与接收去重状态的变化追加到会话日志；
+     * 重启后先 MQTT_SessionOpen 再 MQTT_SessionRestore 恢复 (需同时设置 pool)，CONNACK 后立即重发未确认的消息，
+     * 服务器没有保留会话时按订阅表自动重新订阅 */
+    MQTT_Session *session;
+#endif
+
+    /* --- 任务通道 (可选，见 mqtt_channel.h，需开启 MQTT_ENABLE_CHANNEL) --- */
+    /* 应用任务通过各自的通道提交命令，由 MQTT_ProcessLoop 取出后提交，完成记录经通道送回 */
+    struct MQTT_Channel *channels; /* 已登记的通道 (MQTT_ChannelAttach 添加，由 HAL_MQTT_Lock 保护) */
+    void *ioWaiter;                /* 运行 MQTT_ProcessLoop 的任务 (提交命令后 HAL_MQTT_Notify 的参数，可为 NULL) */
+
+    /* --- MQTT 5 (protocolVersion 为 MQTT_VERSION_5 时有效) --- */
+    /* 主题别名：发布时自动为主题分配别名 (LRU 淘汰)，之后同一主题只发送 2 字节别名；
+     * 别名数量取表容量与服务器 Topic Alias Maximum 的较小者，每次 CONNECT 清空 */
+    MQTT_TopicAlias *topicAliases; /* 别名表 (由用户提供，为 NULL 时不使用别名) */
+    uint16_t topicAliasCount;      /* 表项数量 */
+    uint32_t aliasClock;           /* 内部使用：LRU 序号 */
+    /* 服务器在 CONNACK 中声明的限制 (内部使用，CONNECT 时复位为协议默认值) */
+    uint16_t serverReceiveMax;    /* 未确认的 QoS > 0 PUBLISH 上限，达到后 Submit 返回 false */
+    uint32_t serverMaxPacket;     /* 服务器可接收的最大报文 (0 表示不限)，超过的报文以 ERROR 结束 */
+    uint16_t serverTopicAliasMax; /* 服务器接受的最大别名 */
+    uint8_t lastReasonCode;       /* 正在回调的请求的原因码 (在完成回调中读取)，或服务器 DISCONNECT 的原因码 */
+
+    /* --- 运行统计 (只读；需要延迟直方图时把 stats.ackLatency 指向用户提供的 MQTT_Histogram) --- */
+    MQTT_Stats stats;
 
 } MQTT_Client;
 
@@ -102,9 +573,21 @@ typedef struct
 
 /* --- 报文构建函数 --- */
 uint32_t MQTT_BuildConnectPacket(uint8_t *txBuf, size_t txBufSize, const char *clientId, const char *userName, const char *password, uint16_t keepAlive, uint8_t cleanSession);
+/* MQTT 5 CONNECT：携带 Receive Maximum 与 Maximum Packet Size 属性 (为 0 时省略该属性) */
+uint32_t MQTT_BuildConnectPacketV5(uint8_t *txBuf, size_t txBufSize, const char *clientId, const char *userName, const char *password, uint16_t keepAlive, uint8_t cleanSession, uint16_t receiveMax, uint32_t maxPacketSize);
 uint32_t MQTT_BuildSubscribePacket(uint8_t *txBuf, size_t txBufSize, const char *topic, uint16_t packetId, uint8_t qos);
 uint32_t MQTT_BuildUnsubscribePacket(uint8_t *txBuf, size_t txBufSize, const char *topic, uint16_t packetId);
 uint32_t MQTT_BuildPublishPacket(uint8_t *txBuf, size_t txBufSize, const char *topic, const char *msg, uint16_t packetId, uint8_t dup, uint8_t qos, uint8_t retain);
+uint32_t MQTT_BuildPublishHeader(uint8_t *hdr, size_t hdrSize, uint16_t topicLen, size_t payloadLen, uint8_t dup, uint8_t qos, uint8_t retain);
+
+/* 发布模板：同一 Topic 反复发布时预先编码 Topic，之后每次只写入报头、PacketID 与 Payload (MQTT 3.1.1 格式)
+ * buf 至少 MQTT_TEMPLATE_BUF_SIZE(Topic 长度, 最大 Payload) 字节，由模板独占；返回 false 表示参数错误或缓冲区不足 */
+bool MQTT_PreparePublishTemplate(MQTT_PublishTemplate *tpl, uint8_t *buf, size_t bufSize, const char *topic, uint8_t qos, uint8_t retain);
+/* 用模板构建 PUBLISH：packet 返回报文起始地址 (位于 tpl->buf 内)，返回报文长度，0 表示失败 (Payload 放不下等) */
+uint32_t MQTT_BuildPublishFromTemplate(const MQTT_PublishTemplate *tpl, const void *payload, size_t payloadLen, uint16_t packetId, uint8_t dup, const uint8_t **packet);
+/* 模板的 Payload 区：可直接在其中编码 Payload (如 CBOR)，再以返回的指针作为 payload 构建，构建时不再复制；capacity 返回可用字节数 */
+uint8_t *MQTT_PublishTemplatePayload(const MQTT_PublishTemplate *tpl, size_t *capacity);
+uint32_t MQTT_BuildAckPacket(uint8_t *txBuf, size_t txBufSize, uint8_t packetType, uint16_t packetId);
 uint32_t MQTT_BuildPingReqPacket(uint8_t *txBuf, size_t txBufSize);
 uint32_t MQTT_BuildDisconnectPacket(uint8_t *txBuf, size_t txBufSize);
 
@@ -120,10 +603,54 @@ int MQTT_ParsePublishMessage(const uint8_t *rxBuf, size_t rxLen, uint8_t *recvTo
 
 /* --- 核心业务函数 --- */
 
-/* 发送操作 (生产者)：只负责构建报文、发送、并阻塞等待 waitState 变更为成功 */
+/* 异步提交 (生产者)：按 client 上的 pubTopic/pubMsg/subTopic/qos/retain 构建并立即发送，
+ * 不等待 ACK。ACK 匹配、超时重发由 MQTT_ProcessLoop 驱动，完成后在其中调用 cb。
+ * 返回 false 表示请求表已满或报文构建失败 (此时 cb 不会被调用)。 */
+bool MQTT_Submit(MQTT_Client *client, MQTT_Operation op, MQTT_Callback cb, void *ctx);
+
+/* 异步发布二进制数据 (零拷贝)：topic 不要求以 0 结尾，payload 由最多 MQTT_MAX_IOV 个数据段组成，
+ * 通过 HAL_MQTT_SendV 直接发送，不受 txBufSize 限制。QoS/Retain 取自 client。
+ * QoS > 0 时 topic、iov 数组及其指向的数据需保持有效直到 cb 触发 (重发需要)。 */
+bool MQTT_SubmitPublishV(MQTT_Client *client, const char *topic, uint16_t topicLen,
+                         const MQTT_IoVec *payload, size_t n, MQTT_Callback cb, void *ctx);
+
+/* 用模板异步发布：Topic、QoS、Retain 取自模板 (不计算 strlen，不读取 client->qos/retain)，
+ * Payload 语义同 MQTT_SubmitPublishV，模板在回调之前需保持有效 */
+bool MQTT_SubmitPublishTemplate(MQTT_Client *client, const MQTT_PublishTemplate *tpl,
+                                const MQTT_IoVec *payload, size_t n, MQTT_Callback cb, void *ctx);
+
+/* 同步发布二进制数据：QoS 0 发送即返回，QoS > 0 阻塞到收到 PUBACK 或超时，返回后即可释放数据 */
+bool MQTT_PublishV(MQTT_Client *client, const char *topic, uint16_t topicLen, const MQTT_IoVec *payload, size_t n);
+
+/* 同步发送 (兼容旧接口)：基于 MQTT_Submit，阻塞直到操作完成或超时
+ * 设置了离线队列时，PUBLISH 存入队列 (MQTT_RESULT_STORED) 也返回 true */
 bool MQTT_TryOperation(MQTT_Client *client, MQTT_Operation op);
 
-/* 接收循环 (消费者)：负责接收数据、自动回复 ACK、并更新 waitState 标志 */
+#if MQTT_ENABLE_SESSION
+/* 从会话日志恢复重启前的状态 (在 MQTT_SessionOpen 之后、连接之前调用)：
+ * 未确认的 PUBLISH 复制到内存池放回请求表 (PacketID 不变，无完成回调)，CONNACK 后带 DUP 重发；
+ * PacketID 计数从上次的租约末尾继续，接收去重窗口与 QoS 2 状态表一并恢复。
+ * 内存池或请求槽不足而无法恢复的消息计入 session->stats.lost；返回 false 表示未设置 session */
+bool MQTT_SessionRestore(MQTT_Client *client);
+#endif
+
+/* 立即发送批处理缓冲区中积累的报文 */
+void MQTT_Flush(MQTT_Client *client);
+
+/* 距离下一次需要调用 MQTT_ProcessLoop 的毫秒数 (请求超时、批处理、离线补发、心跳)，
+ * UINT32_MAX 表示只需在收到数据时处理；供事件驱动的调度器 (如 mqtt_engine) 安排定时器 */
+uint32_t MQTT_NextWakeup(MQTT_Client *client);
+
+/* 接收区已满 (流式消息的处理函数暂停)，MQTT_ProcessLoop 暂不从传输层读取；
+ * 按可读事件调度的调用者 (如 mqtt_engine) 应在此期间停止监听可读事件，否则水平触发会空转 */
+bool MQTT_RxBlocked(MQTT_Client *client);
+
+/* 延迟直方图：记录一个样本 / 查询分位数 (permyriad 为万分比，如 5000 = p50，9990 = p99.9)
+ * 返回值为所在桶的上界，直方图为空时返回 0 */
+void MQTT_HistogramRecord(MQTT_Histogram *hist, uint32_t value);
+uint32_t MQTT_HistogramPercentile(const MQTT_Histogram *hist, uint32_t permyriad);
+
+/* 接收循环 (消费者)：负责接收数据、自动回复 ACK、匹配请求、超时重发并触发完成回调 */
 void MQTT_ProcessLoop(MQTT_Client *client);
 
 #ifdef __cplusplus
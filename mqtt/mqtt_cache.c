@@ -0,0 +1,403 @@
+#include "mqtt_cache.h"
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+/* 哈希：FNV-1a */
+static uint32_t MQTT_CacheHash(const char *topic, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (uint8_t)topic[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+/* 查找 Topic，返回表项下标，未找到返回 -1；slot 输出所在槽位 (未找到时为可插入的空槽) */
+static int32_t MQTT_CacheFind(MQTT_Cache *cache, const char *topic, size_t len, uint32_t hash, uint32_t *slot)
+{
+    uint32_t pos = hash & cache->slotMask;
+
+    for (;;)
+    {
+        uint16_t s = cache->slots[pos];
+        if (s == 0)
+        {
+            *slot = pos;
+            return -1;
+        }
+
+        MQTT_CacheEntry *e = &cache->entries[s - 1];
+        if (e->hash == hash && e->topicLen == len && memcmp(e->data, topic, len) == 0)
+        {
+            *slot = pos;
+            return s - 1;
+        }
+        pos = (pos + 1) & cache->slotMask;
+    }
+}
+
+/* 已知表项所在的槽位 */
+static uint32_t MQTT_CacheSlotOf(MQTT_Cache *cache, uint16_t idx)
+{
+    uint32_t pos = cache->entries[idx].hash & cache->slotMask;
+    while (cache->slots[pos] != idx + 1)
+        pos = (pos + 1) & cache->slotMask;
+    return pos;
+}
+
+/* LRU 链表：摘下表项 */
+static void MQTT_CacheUnlink(MQTT_Cache *cache, uint16_t idx)
+{
+    MQTT_CacheEntry *e = &cache->entries[idx];
+
+    if (e->prev != MQTT_CACHE_NONE)
+        cache->entries[e->prev].next = e->next;
+    else
+        cache->lruHead = e->next;
+
+    if (e->next != MQTT_CACHE_NONE)
+        cache->entries[e->next].prev = e->prev;
+    else
+        cache->lruTail = e->prev;
+}
+
+/* LRU 链表：插到最近使用的一端 */
+static void MQTT_CachePushFront(MQTT_Cache *cache, uint16_t idx)
+{
+    MQTT_CacheEntry *e = &cache->entries[idx];
+
+    e->prev = MQTT_CACHE_NONE;
+    e->next = cache->lruHead;
+    if (cache->lruHead != MQTT_CACHE_NONE)
+        cache->entries[cache->lruHead].prev = idx;
+    else
+        cache->lruTail = idx;
+    cache->lruHead = idx;
+}
+
+/* 删除槽位上的条目：后续元素回移填补空位 (不使用墓碑)，归还内存池块与表项 */
+static void MQTT_CacheDelete(MQTT_Cache *cache, uint32_t slot)
+{
+    const uint32_t mask = cache->slotMask;
+    uint16_t idx = (uint16_t)(cache->slots[slot] - 1);
+    MQTT_CacheEntry *e = &cache->entries[idx];
+
+    uint32_t hole = slot;
+    uint32_t pos = hole;
+    for (;;)
+    {
+        pos = (pos + 1) & mask;
+        uint16_t s = cache->slots[pos];
+        if (s == 0)
+            break;
+
+        /* 该元素的初始槽不在 (hole, pos] 区间内时，可以移到空位上 */
+        uint32_t home = cache->entries[s - 1].hash & mask;
+        if (((pos - home) & mask) >= ((pos - hole) & mask))
+        {
+            cache->slots[hole] = s;
+            hole = pos;
+        }
+    }
+    cache->slots[hole] = 0;
+
+    MQTT_CacheUnlink(cache, idx);
+    mp_free(cache->pool, e->data);
+    cache->used -= e->topicLen + e->len;
+    cache->count--;
+
+    e->data = NULL;
+    e->next = cache->freeHead;
+    cache->freeHead = idx;
+}
+
+/* 淘汰最久未用的条目，缓存为空时返回 false */
+static bool MQTT_CacheEvict(MQTT_Cache *cache)
+{
+    if (cache->lruTail == MQTT_CACHE_NONE)
+        return false;
+
+    MQTT_CacheDelete(cache, MQTT_CacheSlotOf(cache, cache->lruTail));
+    cache->stats.evictions++;
+    return true;
+}
+
+/* 内存池没有合适的空闲块：从最久未用的一端找第一个块足够大的条目淘汰 (只在池耗尽时遍历)，
+ * 避免为了一个大消息清空所有占用小块的条目。没有这样的条目时返回 false
+ */
+static bool MQTT_CacheEvictFor(MQTT_Cache *cache, size_t need)
+{
+    for (uint16_t i = cache->lruTail; i != MQTT_CACHE_NONE; i = cache->entries[i].prev)
+    {
+        if (mp_block_size(cache->pool, cache->entries[i].data) >= need)
+        {
+            MQTT_CacheDelete(cache, MQTT_CacheSlotOf(cache, i));
+            cache->stats.evictions++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 过滤器匹配：'+' 匹配单层，'#' 匹配剩余所有层级 (含父层级本身)，$ 开头的 Topic 不参与首层通配符匹配 */
+static bool MQTT_CacheMatch(const char *filter, const char *topic)
+{
+    if (topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+        return false;
+
+    for (;;)
+    {
+        if (filter[0] == '#')
+            return true;
+
+        if (filter[0] == '+')
+        {
+            filter++;
+            while (*topic && *topic != '/')
+                topic++;
+        }
+        else
+        {
+            while (*filter && *filter != '/')
+            {
+                if (*filter != *topic)
+                    return false;
+                filter++;
+                topic++;
+            }
+            if (*topic && *topic != '/')
+                return false;
+        }
+
+        /* 两者都位于层级末尾 */
+        if (*filter == '\0')
+            return *topic == '\0';
+        if (*topic == '\0')
+            return filter[1] == '#' && filter[2] == '\0';
+        filter++;
+        topic++;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * 对外接口
+ * -------------------------------------------------------------------------- */
+
+bool MQTT_CacheInit(MQTT_Cache *cache, void *arena, size_t size, uint16_t maxEntries,
+                    mem_pool_t *pool, uint32_t budget)
+{
+    if (!cache || !arena || !pool || maxEntries == 0 || maxEntries > 0x7FFF)
+        return false;
+
+    /* 哈希表大小：不小于 2 倍表项数的 2 的幂，负载不超过一半 */
+    uint32_t slotCount = 1;
+    while (slotCount < 2u * maxEntries)
+        slotCount <<= 1;
+
+    /* arena 起始地址按指针对齐 (表项中有指针) */
+    uintptr_t base = (uintptr_t)arena;
+    uintptr_t aligned = (base + sizeof(void *) - 1) & ~(uintptr_t)(sizeof(void *) - 1);
+    size_t need = (aligned - base) + (size_t)maxEntries * sizeof(MQTT_CacheEntry) + slotCount * sizeof(uint16_t);
+    if (size < need)
+        return false;
+
+    memset(cache, 0, sizeof(MQTT_Cache));
+    cache->entries = (MQTT_CacheEntry *)aligned;
+    cache->slots = (uint16_t *)(cache->entries + maxEntries);
+    cache->cap = maxEntries;
+    cache->slotMask = slotCount - 1;
+    cache->pool = pool;
+    cache->budget = budget;
+    cache->mode = MQTT_CACHE_ALL;
+    cache->lruHead = cache->lruTail = MQTT_CACHE_NONE;
+
+    /* 所有表项串成空闲链表 */
+    memset(cache->slots, 0, slotCount * sizeof(uint16_t));
+    for (uint16_t i = 0; i < maxEntries; i++)
+    {
+        memset(&cache->entries[i], 0, sizeof(MQTT_CacheEntry));
+        cache->entries[i].next = (i + 1 < maxEntries) ? (uint16_t)(i + 1) : MQTT_CACHE_NONE;
+    }
+    cache->freeHead = 0;
+    return true;
+}
+
+bool MQTT_CachePut(MQTT_Cache *cache, const char *topic, size_t topicLen,
+                   const void *payload, size_t len, bool retain, uint32_t tick)
+{
+    if (!cache || !cache->entries || !topic || topicLen == 0 || topicLen > 0xFFFF || (!payload && len > 0))
+        return false;
+
+    uint32_t hash = MQTT_CacheHash(topic, topicLen);
+    uint32_t slot;
+    int32_t idx = MQTT_CacheFind(cache, topic, topicLen, hash, &slot);
+
+    /* 空的保留消息：服务器已删除该 Topic 的保留消息 */
+    if (retain && len == 0)
+    {
+        if (idx >= 0)
+            MQTT_CacheDelete(cache, slot);
+        return true;
+    }
+
+    /* 只缓存保留消息时，普通消息只更新已有的条目 */
+    if (idx < 0 && cache->mode == MQTT_CACHE_RETAINED && !retain)
+        return true;
+
+    /* 块内布局 [Topic][\0][Payload] */
+    size_t need = topicLen + 1 + len;
+    size_t bytes = topicLen + len;
+
+    if (idx >= 0)
+    {
+        MQTT_CacheEntry *old = &cache->entries[idx];
+        uint32_t usedOthers = cache->used - (old->topicLen + old->len);
+
+        /* 原块放得下且不超预算：就地覆盖 Payload (最常见的情况：同一 Topic 的数值周期性刷新) */
+        if (need <= mp_block_size(cache->pool, old->data) &&
+            (cache->budget == 0 || usedOthers + bytes <= cache->budget))
+        {
+            if (len > 0)
+                memcpy(&old->data[topicLen + 1], payload, len);
+            cache->used = usedOthers + (uint32_t)bytes;
+            old->len = (uint32_t)len;
+            old->tick = tick;
+            old->retained = retain;
+            if (cache->lruHead != (uint16_t)idx)
+            {
+                MQTT_CacheUnlink(cache, (uint16_t)idx);
+                MQTT_CachePushFront(cache, (uint16_t)idx);
+            }
+            cache->stats.updates++;
+            return true;
+        }
+
+        /* 否则先删除旧值 (新值放不下时也不能继续返回过期数据)，释放的块可以立即复用 */
+        MQTT_CacheDelete(cache, slot);
+    }
+
+    /* 超过最大块或预算的消息不缓存，不为它淘汰其他条目 */
+    mem_pool_t *pool = cache->pool;
+    if (pool->count == 0 || need > pool->classes[pool->count - 1].blockSize ||
+        (cache->budget > 0 && bytes > cache->budget))
+    {
+        cache->stats.dropped++;
+        return false;
+    }
+
+    /* 按表项数与字节预算淘汰，再向内存池申请 (池中没有合适的块时淘汰一个占用大块的条目) */
+    while (cache->count >= cache->cap || (cache->budget > 0 && cache->used + bytes > cache->budget))
+        MQTT_CacheEvict(cache);
+
+    uint8_t *block = mp_alloc(pool, (uint32_t)need);
+    if (!block && MQTT_CacheEvictFor(cache, need))
+        block = mp_alloc(pool, (uint32_t)need);
+    if (!block)
+    {
+        cache->stats.dropped++;
+        return false;
+    }
+
+    /* 淘汰可能移动了槽位，重新探测插入位置 */
+    MQTT_CacheFind(cache, topic, topicLen, hash, &slot);
+
+    uint16_t i = cache->freeHead;
+    MQTT_CacheEntry *e = &cache->entries[i];
+    cache->freeHead = e->next;
+
+    memcpy(block, topic, topicLen);
+    block[topicLen] = '\0';
+    if (len > 0)
+        memcpy(&block[topicLen + 1], payload, len);
+
+    e->data = block;
+    e->hash = hash;
+    e->len = (uint32_t)len;
+    e->tick = tick;
+    e->topicLen = (uint16_t)topicLen;
+    e->retained = retain;
+
+    cache->slots[slot] = (uint16_t)(i + 1);
+    MQTT_CachePushFront(cache, i);
+    cache->count++;
+    cache->used += (uint32_t)bytes;
+    cache->stats.updates++;
+    return true;
+}
+
+const uint8_t *MQTT_CacheGet(MQTT_Cache *cache, const char *topic, size_t *len, uint32_t *tick)
+{
+    if (!cache || !cache->entries || !topic || !len)
+        return NULL;
+
+    size_t topicLen = strlen(topic);
+    uint32_t slot;
+    int32_t idx = MQTT_CacheFind(cache, topic, topicLen, MQTT_CacheHash(topic, topicLen), &slot);
+    if (idx < 0)
+    {
+        cache->stats.misses++;
+        return NULL;
+    }
+
+    /* 标记为最近使用 */
+    if (cache->lruHead != (uint16_t)idx)
+    {
+        MQTT_CacheUnlink(cache, (uint16_t)idx);
+        MQTT_CachePushFront(cache, (uint16_t)idx);
+    }
+
+    MQTT_CacheEntry *e = &cache->entries[idx];
+    cache->stats.hits++;
+    *len = e->len;
+    if (tick)
+        *tick = e->tick;
+    return &e->data[e->topicLen + 1];
+}
+
+bool MQTT_CacheRemove(MQTT_Cache *cache, const char *topic)
+{
+    if (!cache || !cache->entries || !topic)
+        return false;
+
+    size_t topicLen = strlen(topic);
+    uint32_t slot;
+    if (MQTT_CacheFind(cache, topic, topicLen, MQTT_CacheHash(topic, topicLen), &slot) < 0)
+        return false;
+
+    MQTT_CacheDelete(cache, slot);
+    return true;
+}
+
+void MQTT_CacheClear(MQTT_Cache *cache)
+{
+    if (!cache || !cache->entries)
+        return;
+
+    while (cache->lruHead != MQTT_CACHE_NONE)
+        MQTT_CacheDelete(cache, MQTT_CacheSlotOf(cache, cache->lruHead));
+}
+
+uint16_t MQTT_CacheForEach(MQTT_Cache *cache, const char *filter, MQTT_CacheVisitor visit, void *ctx)
+{
+    if (!cache || !cache->entries || !visit)
+        return 0;
+
+    uint16_t visited = 0;
+    for (uint16_t i = cache->lruHead; i != MQTT_CACHE_NONE; i = cache->entries[i].next)
+    {
+        MQTT_CacheEntry *e = &cache->entries[i];
+        const char *topic = (const char *)e->data;
+        if (filter && !MQTT_CacheMatch(filter, topic))
+            continue;
+
+        visited++;
+        if (!visit(topic, &e->data[e->topicLen + 1], e->len, e->tick, ctx))
+            break;
+    }
+    return visited;
+}
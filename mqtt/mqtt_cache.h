@@ -0,0 +1,134 @@
+#ifndef __MQTT_CACHE_H__
+#define __MQTT_CACHE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "../mem_pool/mem_pool.h"
+
+/* ============================================================
+ * 保留消息 / 最新值缓存 (Last-Known-Value Cache)
+ * 以 Topic 为键保存最近一次收到的 Payload，由下行 PUBLISH 自动更新，应用查询时不需要网络往返。
+ * 表项与哈希槽存放在用户提供的 arena 中 (开放寻址，线性探测，删除时回移)，
+ * Topic + Payload 存放在 mem_pool 的块中；超出表项数或字节预算时按 LRU 淘汰，
+ * 内存池没有合适的空闲块时淘汰最久未用、且块足够大的条目。
+ * 查找、更新、删除均为 O(1) (与缓存条目数无关，内存池耗尽时的淘汰除外)。
+ * ============================================================ */
+
+/* 链表空指针 */
+#define MQTT_CACHE_NONE 0xFFFF
+
+/* 缓存范围 */
+typedef enum
+{
+    MQTT_CACHE_ALL,     /* 缓存所有下行 PUBLISH 的最新值 */
+    MQTT_CACHE_RETAINED /* 只由保留消息 (RETAIN = 1) 创建条目，已缓存的 Topic 收到普通消息时同样更新 */
+} MQTT_CacheMode;
+
+/* 缓存条目 (内部使用) */
+typedef struct
+{
+    uint8_t *data;     /* 内存池块：[Topic][\0][Payload] (NULL 表示空闲) */
+    uint32_t hash;     /* Topic 哈希 */
+    uint32_t len;      /* Payload 长度 */
+    uint32_t tick;     /* 最后更新时刻 */
+    uint16_t topicLen; /* Topic 长度 */
+    uint16_t prev;     /* LRU 链表：更新/更近使用的方向 */
+    uint16_t next;     /* LRU 链表：更久未用的方向 (空闲时为空闲链表) */
+    bool retained;     /* 最后一次更新是否为保留消息 */
+} MQTT_CacheEntry;
+
+/* 运行统计 */
+typedef struct
+{
+    uint32_t hits;      /* MQTT_CacheGet 命中次数 */
+    uint32_t misses;    /* MQTT_CacheGet 未命中次数 */
+    uint32_t updates;   /* 写入 (新建或覆盖) 次数 */
+    uint32_t evictions; /* 因表项数、字节预算或内存池不足被淘汰的条目数 */
+    uint32_t dropped;   /* 放不进缓存而未保存的消息数 (大于最大块或预算，或内存池中腾不出合适的块) */
+} MQTT_CacheStats;
+
+/* 缓存控制块 */
+typedef struct
+{
+    MQTT_CacheEntry *entries; /* 表项数组 */
+    uint16_t cap;             /* 表项容量 */
+    uint16_t count;           /* 已使用表项数 */
+    uint16_t *slots;          /* 哈希表 (开放寻址，存表项下标 + 1，0 表示空) */
+    uint32_t slotMask;        /* 哈希表大小 - 1 (大小为 2 的幂，至少为表项容量的 2 倍) */
+    uint16_t freeHead;        /* 空闲表项链表 */
+    uint16_t lruHead;         /* 最近使用的条目 */
+    uint16_t lruTail;         /* 最久未用的条目 (首先淘汰) */
+    mem_pool_t *pool;         /* Topic + Payload 的存储 (可与 client.pool 共用) */
+    uint32_t budget;          /* 字节预算：Topic + Payload 总字节数上限 (0 表示只受内存池限制) */
+    uint32_t used;            /* 已缓存的 Topic + Payload 字节数 */
+    MQTT_CacheMode mode;      /* 缓存范围 */
+    MQTT_CacheStats stats;
+} MQTT_Cache;
+
+/* 估算 arena 大小：maxEntries 个表项 + 哈希表 (含对齐余量) */
+#define MQTT_CACHE_ARENA_SIZE(maxEntries) \
+    ((size_t)(maxEntries) * sizeof(MQTT_CacheEntry) + (size_t)(maxEntries) * 8 + 16)
+
+/**
+ * @brief 初始化缓存
+ * @param cache      控制块
+ * @param arena      用户提供的内存 (静态数组即可，可用 MQTT_CACHE_ARENA_SIZE 估算)
+ * @param size       内存大小
+ * @param maxEntries 最大条目数 (1 ~ 32767)
+ * @param pool       存放 Topic 与 Payload 的内存池 (已添加等级)
+ * @param budget     字节预算 (0 表示只受内存池限制)
+ * @return true 成功; false 参数错误或内存不足
+ */
+bool MQTT_CacheInit(MQTT_Cache *cache, void *arena, size_t size, uint16_t maxEntries,
+                    mem_pool_t *pool, uint32_t budget);
+
+/**
+ * @brief 写入一个 Topic 的最新值 (协议栈收到 PUBLISH 时自动调用)
+ * @note  retain 为 true 且 len 为 0 表示服务器删除了该保留消息，对应条目被移除；
+ *        MQTT_CACHE_RETAINED 模式下，未缓存的 Topic 只有保留消息才会新建条目
+ * @return true 已保存 (或已按规则移除/忽略); false 条目过大或内存不足
+ */
+bool MQTT_CachePut(MQTT_Cache *cache, const char *topic, size_t topicLen,
+                   const void *payload, size_t len, bool retain, uint32_t tick);
+
+/**
+ * @brief 查找 Topic 的最新值，并把条目标记为最近使用
+ * @param len  输出 Payload 长度
+ * @param tick 输出最后更新时刻 (可为 NULL)
+ * @return Payload 指针 (位于内存池块中，下一次写入缓存前有效；其他任务读取时需持有 HAL_MQTT_Lock 并复制)；
+ *         未缓存时返回 NULL
+ */
+const uint8_t *MQTT_CacheGet(MQTT_Cache *cache, const char *topic, size_t *len, uint32_t *tick);
+
+/**
+ * @brief 删除一个 Topic 的条目
+ * @return true 成功; false 未缓存
+ */
+bool MQTT_CacheRemove(MQTT_Cache *cache, const char *topic);
+
+/**
+ * @brief 清空缓存 (归还所有内存池块)
+ */
+void MQTT_CacheClear(MQTT_Cache *cache);
+
+/* 遍历回调：返回 false 停止遍历 */
+typedef bool (*MQTT_CacheVisitor)(const char *topic, const uint8_t *payload, size_t len, uint32_t tick, void *ctx);
+
+/**
+ * @brief 按最近使用顺序遍历匹配过滤器的条目 (不改变 LRU 顺序，耗时与条目数成正比)
+ * @param filter 订阅过滤器 (支持 '+' / '#')，NULL 表示全部
+ * @return 访问的条目数
+ */
+uint16_t MQTT_CacheForEach(MQTT_Cache *cache, const char *filter, MQTT_CacheVisitor visit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_CACHE_H__ */
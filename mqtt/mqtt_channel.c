@@ -0,0 +1,146 @@
+#include "mqtt_channel.h"
+
+#define MQTT_CHANNEL_MASK (MQTT_CHANNEL_DEPTH - 1)
+#define MQTT_CHANNEL_NONE 0xFF
+
+/* --------------------------------------------------------------------------
+ * 下标与内存序
+ * cmdHead 只由应用任务写、doneHead 只由 I/O 循环写，对方以获取语义读取；cmdTail / doneTail 各自私有。
+ * 两端都不检查队列满：应用任务只在 pending < MQTT_CHANNEL_DEPTH 时提交，而 pending 包含了
+ * 两条队列中的全部记录。重用命令槽 k (上一次是命令 k - DEPTH) 时，应用任务已取回的完成记录
+ * 至少有一条属于更新的命令，I/O 循环按顺序取命令，说明它早已读完命令槽 k；完成队列同理。
+ * -------------------------------------------------------------------------- */
+
+void MQTT_ChannelInit(MQTT_Channel *channel, void *waiter)
+{
+    if (!channel)
+        return;
+
+    memset(channel, 0, sizeof(*channel));
+    channel->waiter = waiter;
+    for (uint8_t i = 0; i < MQTT_CHANNEL_DEPTH; i++)
+    {
+        channel->tickets[i].channel = channel;
+        channel->tickets[i].next = (i + 1 < MQTT_CHANNEL_DEPTH) ? (uint8_t)(i + 1) : MQTT_CHANNEL_NONE;
+    }
+    channel->ticketFree = 0;
+}
+
+bool MQTT_ChannelAttach(MQTT_Client *client, MQTT_Channel *channel)
+{
+    if (!client || !channel || channel->client)
+        return false;
+
+#if MQTT_ENABLE_CHANNEL
+    /* 只在链表头插入，I/O 循环在锁内取得链表头后可以不加锁遍历 */
+    HAL_MQTT_Lock();
+    channel->client = client;
+    channel->next = client->channels;
+    client->channels = channel;
+    HAL_MQTT_Unlock();
+    return true;
+#else
+    /* 未开启 MQTT_ENABLE_CHANNEL 时 MQTT_ProcessLoop 不会取出通道中的命令 */
+    return false;
+#endif
+}
+
+/* ============================================================
+ * 应用任务侧
+ * ============================================================ */
+
+bool MQTT_ChannelSubmit(MQTT_Channel *channel, const MQTT_ChannelCmd *cmd)
+{
+    if (!channel || !cmd || !channel->client || channel->pending >= MQTT_CHANNEL_DEPTH)
+        return false;
+
+    uint32_t head = channel->cmdHead;
+    channel->cmd[head & MQTT_CHANNEL_MASK] = *cmd;
+    channel->pending++;
+    MQTT_StoreRelease(&channel->cmdHead, head + 1);
+
+    HAL_MQTT_Notify(channel->client->ioWaiter);
+    return true;
+}
+
+bool MQTT_ChannelPoll(MQTT_Channel *channel, MQTT_ChannelDone *done)
+{
+    if (!channel || !done)
+        return false;
+
+    uint32_t tail = channel->doneTail;
+    if (tail == MQTT_LoadAcquire(&channel->doneHead))
+        return false;
+
+    *done = channel->done[tail & MQTT_CHANNEL_MASK];
+    channel->doneTail = tail + 1;
+    channel->pending--;
+    return true;
+}
+
+bool MQTT_ChannelWait(MQTT_Channel *channel, MQTT_ChannelDone *done, uint32_t timeoutMs)
+{
+    uint32_t startTick = HAL_MQTT_GetTick();
+
+    /* 通知是带计数的：完成记录在检查之后、等待之前写入时，HAL_MQTT_Wait 立即返回 */
+    while (!MQTT_ChannelPoll(channel, done))
+    {
+        uint32_t elapsed = HAL_MQTT_GetTick() - startTick;
+        if (!channel || elapsed >= timeoutMs)
+            return false;
+        HAL_MQTT_Wait(channel->waiter, timeoutMs - elapsed);
+    }
+    return true;
+}
+
+uint32_t MQTT_ChannelPending(const MQTT_Channel *channel)
+{
+    return channel ? channel->pending : 0;
+}
+
+/* ============================================================
+ * I/O 循环侧
+ * ============================================================ */
+
+bool MQTT_ChannelHasCommand(const MQTT_Channel *channel)
+{
+    return channel->cmdTail != MQTT_LoadAcquire(&channel->cmdHead);
+}
+
+MQTT_ChannelTicket *MQTT_ChannelPeek(MQTT_Channel *channel, MQTT_ChannelCmd *cmd)
+{
+    uint32_t tail = channel->cmdTail;
+    if (tail == MQTT_LoadAcquire(&channel->cmdHead))
+        return NULL;
+
+    /* 在途命令不超过通道深度，总能分到回调上下文；完成回调不会在提交过程中触发，
+     * 预留的上下文在 MQTT_ChannelTake 之前不会被其他命令使用 */
+    MQTT_ChannelTicket *ticket = &channel->tickets[channel->ticketFree];
+    *cmd = channel->cmd[tail & MQTT_CHANNEL_MASK];
+    ticket->tag = cmd->tag;
+    return ticket;
+}
+
+void MQTT_ChannelTake(MQTT_Channel *channel)
+{
+    channel->ticketFree = channel->tickets[channel->ticketFree].next;
+    channel->cmdTail++;
+}
+
+void MQTT_ChannelComplete(MQTT_ChannelTicket *ticket, MQTT_Operation op, MQTT_Result result, uint8_t reasonCode)
+{
+    MQTT_Channel *channel = ticket->channel;
+    uint32_t head = channel->doneHead;
+
+    MQTT_ChannelDone *done = &channel->done[head & MQTT_CHANNEL_MASK];
+    done->tag = ticket->tag;
+    done->op = op;
+    done->result = result;
+    done->reasonCode = reasonCode;
+
+    ticket->next = channel->ticketFree;
+    channel->ticketFree = (uint8_t)(ticket - channel->tickets);
+
+    MQTT_StoreRelease(&channel->doneHead, head + 1);
+    HAL_MQTT_Notify(channel->waiter);
+}
@@ -0,0 +1,138 @@
+#ifndef __MQTT_CHANNEL_H__
+#define __MQTT_CHANNEL_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "mqtt.h"
+
+/* ============================================================
+ * 任务通道 (应用任务 <-> I/O 循环的无锁交接)
+ * 每个应用任务持有一个通道：一条命令队列 (应用任务 -> MQTT_ProcessLoop) 与一条完成队列
+ * (MQTT_ProcessLoop -> 应用任务)，都是单生产者单消费者的环形队列，两端各自只写自己的下标，
+ * 以获取/释放语义 (MQTT_LoadAcquire / MQTT_StoreRelease) 交接，提交与取回完成记录都不加锁。
+ * 多个应用任务各用一个通道即可同时提交，互不竞争；命令由 I/O 循环统一提交，
+ * 请求表只被 I/O 任务访问。
+ * 容量约束：已提交、完成记录尚未取走的命令不超过 MQTT_CHANNEL_DEPTH，因此两条队列都不会溢出，
+ * 队列满只在提交时以返回 false 体现。
+ * ============================================================ */
+
+/* 通道深度：每个通道同时未完成的命令数 (2 的幂，不超过 128，可在编译选项中覆盖) */
+#ifndef MQTT_CHANNEL_DEPTH
+#define MQTT_CHANNEL_DEPTH 8
+#endif
+
+#if (MQTT_CHANNEL_DEPTH & (MQTT_CHANNEL_DEPTH - 1)) != 0 || MQTT_CHANNEL_DEPTH > 128
+#error "MQTT_CHANNEL_DEPTH must be a power of 2 not greater than 128"
+#endif
+
+/* 两端下标之间的填充 (字节)，取缓存行大小可避免伪共享；单核 MCU 可设为 4 节省内存 */
+#ifndef MQTT_CHANNEL_PAD
+#define MQTT_CHANNEL_PAD 64
+#endif
+
+/* 命令：与 MQTT_SubmitPublishV 的参数相同，topic / iov / Payload 需保持有效直到取回完成记录
+ * (设置了 client->pool 时 I/O 循环提交时即复制，但提交时刻由 I/O 循环决定) */
+typedef struct
+{
+    MQTT_Operation op;     /* 操作类型 (PUBLISH / SUBSCRIBE / UNSUBSCRIBE 必须给出 topic) */
+    uint8_t qos;           /* QoS 等级 */
+    uint8_t retain;        /* 保留标志 (PUBLISH) */
+    uint16_t topicLen;     /* 主题长度 */
+    const char *topic;     /* 主题或订阅过滤器 */
+    const MQTT_IoVec *iov; /* Payload 数据段 (PUBLISH，iovCnt 为 0 表示空 Payload) */
+    size_t iovCnt;         /* 数据段数量 */
+    void *tag;             /* 用户标记，原样带回完成记录 */
+} MQTT_ChannelCmd;
+
+/* 完成记录 */
+typedef struct
+{
+    void *tag;              /* 命令的用户标记 */
+    MQTT_Operation op;      /* 操作类型 */
+    MQTT_Result result;     /* 结果 (I/O 循环提交失败时为 MQTT_RESULT_ERROR) */
+    uint8_t reasonCode;     /* 应答中的原因码 (同 client->lastReasonCode) */
+} MQTT_ChannelDone;
+
+/* 在途命令的回调上下文 (内部使用) */
+typedef struct
+{
+    struct MQTT_Channel *channel;
+    void *tag;
+    uint8_t next; /* 空闲链表中的下一个 */
+} MQTT_ChannelTicket;
+
+/* 通道控制块 (由用户提供，MQTT_ChannelInit 初始化) */
+typedef struct MQTT_Channel
+{
+    /* --- 应用任务写入 --- */
+    volatile uint32_t cmdHead; /* 已写入的命令数 (发布给 I/O 循环) */
+    uint32_t doneTail;         /* 已取回的完成记录数 */
+    uint32_t pending;          /* 已提交、完成记录尚未取回的命令数 */
+    uint8_t padApp[MQTT_CHANNEL_PAD];
+
+    /* --- I/O 循环写入 --- */
+    volatile uint32_t doneHead; /* 已写入的完成记录数 (发布给应用任务) */
+    uint32_t cmdTail;           /* 已取出的命令数 */
+    uint8_t ticketFree;         /* 空闲回调上下文链表头 */
+    bool blocked;               /* 队首命令因资源暂时不足未能提交，等待请求完成后重试 */
+    uint8_t padIo[MQTT_CHANNEL_PAD];
+
+    MQTT_ChannelCmd cmd[MQTT_CHANNEL_DEPTH];
+    MQTT_ChannelDone done[MQTT_CHANNEL_DEPTH];
+    MQTT_ChannelTicket tickets[MQTT_CHANNEL_DEPTH];
+
+    void *waiter;                /* 等待完成记录的应用任务 (HAL_MQTT_Notify 的参数，可为 NULL) */
+    MQTT_Client *client;         /* 所属客户端 (MQTT_ChannelAttach 设置) */
+    struct MQTT_Channel *next;   /* 客户端通道链表 */
+} MQTT_Channel;
+
+/* 初始化通道，waiter 为使用该通道的应用任务 (FreeRTOS 任务句柄、MQTT_PosixWaiter 等，可为 NULL) */
+void MQTT_ChannelInit(MQTT_Channel *channel, void *waiter);
+
+/**
+ * @brief 把通道登记到客户端，之后由 MQTT_ProcessLoop 取出命令
+ * @note  通道登记后不能移除，需与客户端同生命周期；可在 I/O 循环运行时登记
+ * @return true 成功; false 参数错误、通道已登记或未开启 MQTT_ENABLE_CHANNEL
+ */
+bool MQTT_ChannelAttach(MQTT_Client *client, MQTT_Channel *channel);
+
+/**
+ * @brief 提交一条命令 (应用任务，不加锁，O(1))，随后通知 client->ioWaiter
+ * @return true 已放入队列; false 通道未登记或未完成的命令已达 MQTT_CHANNEL_DEPTH (先取回完成记录)
+ */
+bool MQTT_ChannelSubmit(MQTT_Channel *channel, const MQTT_ChannelCmd *cmd);
+
+/* 取回一条完成记录 (应用任务，不阻塞)，返回 false 表示暂时没有 */
+bool MQTT_ChannelPoll(MQTT_Channel *channel, MQTT_ChannelDone *done);
+
+/* 等待并取回一条完成记录 (应用任务，通过 HAL_MQTT_Wait 阻塞)，返回 false 表示超时 */
+bool MQTT_ChannelWait(MQTT_Channel *channel, MQTT_ChannelDone *done, uint32_t timeoutMs);
+
+/* 已提交、完成记录尚未取回的命令数 (应用任务) */
+uint32_t MQTT_ChannelPending(const MQTT_Channel *channel);
+
+/* --- I/O 循环侧 (由 MQTT_ProcessLoop 调用) --- */
+
+/* 是否有尚未取出的命令 */
+bool MQTT_ChannelHasCommand(const MQTT_Channel *channel);
+
+/**
+ * @brief 读取队首命令并预留回调上下文，命令仍留在队列中
+ * @return 回调上下文 (作为 MQTT_Callback 的 ctx); NULL 表示没有命令
+ */
+MQTT_ChannelTicket *MQTT_ChannelPeek(MQTT_Channel *channel, MQTT_ChannelCmd *cmd);
+
+/* 移除队首命令并占用 MQTT_ChannelPeek 预留的回调上下文 (命令已提交或即将以失败完成时调用) */
+void MQTT_ChannelTake(MQTT_Channel *channel);
+
+/* 写入命令的完成记录并通知等待的应用任务，释放回调上下文 */
+void MQTT_ChannelComplete(MQTT_ChannelTicket *ticket, MQTT_Operation op, MQTT_Result result, uint8_t reasonCode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_CHANNEL_H__ */
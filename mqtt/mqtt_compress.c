@@ -0,0 +1,194 @@
+#include "mqtt_compress.h"
+#include "../CRC_Lib/CRC_Lib.h"
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+/* 写入原始长度 (与剩余长度相同的变长编码)，返回字节数 */
+static size_t MQTT_CompressPutLength(uint8_t *p, uint32_t value)
+{
+    size_t n = 0;
+    do
+    {
+        uint8_t b = value & 0x7F;
+        value >>= 7;
+        if (value)
+            b |= 0x80;
+        p[n++] = b;
+    } while (value);
+    return n;
+}
+
+/* 读取原始长度，返回字节数，格式错误返回 0 */
+static size_t MQTT_CompressGetLength(const uint8_t *p, size_t len, uint32_t *value)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < len && i < 4; i++)
+    {
+        v |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+        if ((p[i] & 0x80) == 0)
+        {
+            *value = v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/* 尝试压缩，输出不短于原始数据时返回 0 */
+static size_t MQTT_CompressTry(MQTT_Compress *cz, const MQTT_IoVec *iov, size_t n, size_t total, uint8_t *out)
+{
+    lzss_encoder_t enc;
+    if (lzss_enc_init(&enc, cz->work, cz->workSize, cz->windowBits, cz->lookaheadBits) != LZSS_OK)
+        return 0;
+
+    size_t op = 0;
+    out[op++] = MQTT_COMPRESS_MAGIC;
+    out[op++] = (uint8_t)(((cz->windowBits - LZSS_WINDOW_MIN) << 4) | cz->lookaheadBits);
+    if (cz->dict)
+    {
+        lzss_enc_set_dict(&enc, cz->dict, cz->dictLen);
+        out[1] |= MQTT_COMPRESS_DICT;
+        out[op++] = cz->dictCrc;
+    }
+    op += MQTT_CompressPutLength(out + op, (uint32_t)total);
+    if (op + 1 >= total)
+        return 0;
+
+    /* 输出上限为原始长度 - 1：写满 (LZSS_MORE) 即说明压缩不划算 */
+    int ret = LZSS_OK;
+    for (size_t i = 0; i < n && ret == LZSS_OK; i++)
+    {
+        size_t produced = 0;
+        ret = lzss_enc_process(&enc, (const uint8_t *)iov[i].base, iov[i].len, NULL,
+                               out + op, total - 1 - op, &produced, i + 1 == n);
+        op += produced;
+    }
+    return (ret == LZSS_DONE) ? op : 0;
+}
+
+/* --------------------------------------------------------------------------
+ * 对外接口
+ * -------------------------------------------------------------------------- */
+
+bool MQTT_CompressInit(MQTT_Compress *cz, void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits,
+                       uint8_t *rxBuf, size_t rxBufSize)
+{
+    if (!cz || (!work && !rxBuf))
+        return false;
+
+    /* 用一次初始化检查窗口参数与工作内存 */
+    if (work)
+    {
+        lzss_encoder_t enc;
+        if (lzss_enc_init(&enc, work, workSize, windowBits, lookaheadBits) != LZSS_OK)
+            return false;
+    }
+
+    memset(cz, 0, sizeof(MQTT_Compress));
+    cz->work = work;
+    cz->workSize = workSize;
+    cz->windowBits = windowBits;
+    cz->lookaheadBits = lookaheadBits;
+    cz->minLen = 32;
+    cz->rxBuf = rxBuf;
+    cz->rxBufSize = rxBufSize;
+    return true;
+}
+
+bool MQTT_CompressSetDict(MQTT_Compress *cz, const void *dict, size_t len)
+{
+    if (len > 0xFFFF)
+        return false;
+    cz->dict = (dict && len > 0) ? (const uint8_t *)dict : NULL;
+    cz->dictLen = cz->dict ? (uint16_t)len : 0;
+    cz->dictCrc = cz->dict ? CRC8_Cal(cz->dict, cz->dictLen) : 0;
+    return true;
+}
+
+size_t MQTT_CompressPayload(MQTT_Compress *cz, const MQTT_IoVec *iov, size_t n, uint8_t *out, size_t outSize)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++)
+        total += iov[i].len;
+    if (total > 0x0FFFFFFF || outSize < MQTT_COMPRESS_OUT_SIZE(total))
+        return 0;
+
+    if (cz->work && total >= cz->minLen)
+    {
+        size_t len = MQTT_CompressTry(cz, iov, n, total, out);
+        if (len > 0)
+        {
+            cz->stats.packed++;
+            cz->stats.rawBytes += (uint32_t)total;
+            cz->stats.packedBytes += (uint32_t)len;
+            return len;
+        }
+    }
+
+    /* 原样输出：以 0xFF 开头时加未压缩帧头，接收方不会把它当作压缩帧 */
+    size_t op = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (iov[i].len == 0)
+            continue;
+        if (op == 0 && ((const uint8_t *)iov[i].base)[0] == MQTT_COMPRESS_MAGIC)
+        {
+            out[op++] = MQTT_COMPRESS_MAGIC;
+            out[op++] = 0;
+        }
+        memcpy(out + op, iov[i].base, iov[i].len);
+        op += iov[i].len;
+    }
+    cz->stats.skipped++;
+    return op;
+}
+
+const uint8_t *MQTT_DecompressPayload(MQTT_Compress *cz, const uint8_t *payload, size_t len, size_t *outLen)
+{
+    *outLen = len;
+    if (len < 2 || payload[0] != MQTT_COMPRESS_MAGIC)
+        return payload;
+
+    /* 未压缩帧：去掉帧头 */
+    if (payload[1] == 0)
+    {
+        *outLen = len - 2;
+        return payload + 2;
+    }
+
+    /* 参数超出范围、长度字段错误或字典不一致：不是本协议栈 (或本字典) 产生的帧，作为普通 Payload 交付 */
+    bool useDict = (payload[1] & MQTT_COMPRESS_DICT) != 0;
+    uint8_t windowBits = ((payload[1] >> 4) & 0x07) + LZSS_WINDOW_MIN;
+    uint8_t lookaheadBits = payload[1] & 0x0F;
+    size_t hdr = useDict ? 3 : 2;
+    uint32_t orig = 0;
+    size_t n = (len > hdr) ? MQTT_CompressGetLength(payload + hdr, len - hdr, &orig) : 0;
+    if (n == 0 || windowBits > LZSS_WINDOW_MAX || lookaheadBits < LZSS_LOOKAHEAD_MIN ||
+        lookaheadBits >= windowBits || (useDict && (!cz->dict || payload[2] != cz->dictCrc)))
+    {
+        cz->stats.errors++;
+        return payload;
+    }
+    hdr += n;
+
+    if (!cz->rxBuf || orig >= cz->rxBufSize)
+    {
+        cz->stats.oversized++;
+        return NULL;
+    }
+
+    if (lzss_decompress(windowBits, lookaheadBits, useDict ? cz->dict : NULL, useDict ? cz->dictLen : 0,
+                        payload + hdr, len - hdr, cz->rxBuf, orig) != LZSS_OK)
+    {
+        cz->stats.errors++;
+        return payload;
+    }
+
+    cz->rxBuf[orig] = 0;
+    cz->stats.unpacked++;
+    *outLen = orig;
+    return cz->rxBuf;
+}
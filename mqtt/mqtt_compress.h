@@ -0,0 +1,107 @@
+#ifndef __MQTT_COMPRESS_H__
+#define __MQTT_COMPRESS_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "mqtt_hal.h"
+#include "../lzss/lzss.h"
+
+/* ============================================================
+ * Payload 压缩 (LZSS)
+ * 设置到 MQTT_Client::compress 后，经内存池复制的 PUBLISH Payload 在复制时压缩 (重发、离线队列保存的都是压缩后的数据)，
+ * 收到的压缩 Payload 在交给缓存和处理函数之前解压。压缩后的 Payload 以帧头标记：
+ *   [0xFF][字典 << 7 | (windowBits - 8) << 4 | lookaheadBits][字典 CRC8 (仅使用字典时)][原始长度 (变长编码，同剩余长度)][LZSS 码流]
+ * 参数字节为 0 表示未压缩的原始数据 (压缩不划算且原始 Payload 以 0xFF 开头时使用，避免被误认)。
+ * 短消息自身重复很少，两端可用 MQTT_CompressSetDict 约定同一段预置字典 (如一条典型消息)，帧头携带字典的 CRC8，
+ * 接收端字典不一致时不解压。
+ * 0xFF 不会出现在 UTF-8 文本与合法 CBOR 的首字节，未启用压缩的发布者的 JSON / 文本 / CBOR 不受影响。
+ * 发送与接收都不分配内存：编码器工作内存 8 × 窗口，解压直接写入用户提供的输出缓冲区。
+ * ============================================================ */
+
+/* 帧头首字节 */
+#define MQTT_COMPRESS_MAGIC 0xFF
+
+/* 帧头最大长度：标记 + 参数 + 字典 CRC8 + 4 字节原始长度 */
+#define MQTT_COMPRESS_HDR_MAX 7
+
+/* 参数字节中的字典标志 */
+#define MQTT_COMPRESS_DICT 0x80
+
+/* 编码一个 len 字节 Payload 所需的输出空间 (压缩不划算时原样输出，最多加 2 字节帧头) */
+#define MQTT_COMPRESS_OUT_SIZE(len) ((size_t)(len) + 2)
+
+/* 运行统计 */
+typedef struct
+{
+    uint32_t packed;      /* 发送：压缩后发出的 Payload 数 */
+    uint32_t skipped;     /* 发送：过短或压缩后没有变小、原样发出的 Payload 数 */
+    uint32_t rawBytes;    /* 发送：被压缩的 Payload 压缩前的总字节数 */
+    uint32_t packedBytes; /* 发送：被压缩的 Payload 压缩后的总字节数 (含帧头) */
+    uint32_t unpacked;    /* 接收：解压成功的 Payload 数 */
+    uint32_t errors;      /* 接收：以 0xFF 开头但帧头、字典或码流错误、作为普通 Payload 交付的消息数 */
+    uint32_t oversized;   /* 接收：原始长度超过 rxBuf 而被丢弃的消息数 */
+} MQTT_CompressStats;
+
+/* 压缩控制块 */
+typedef struct
+{
+    void *work;            /* 编码器工作内存 (为 NULL 时不压缩发出的消息) */
+    size_t workSize;       /* 工作内存大小 (至少 LZSS_ENC_WORK_SIZE(windowBits)) */
+    uint8_t windowBits;    /* 发送：窗口位数 (LZSS_WINDOW_MIN ~ LZSS_WINDOW_MAX) */
+    uint8_t lookaheadBits; /* 发送：最长匹配位数 (LZSS_LOOKAHEAD_MIN ~ windowBits - 1) */
+    uint16_t minLen;       /* 发送：短于该长度的 Payload 不尝试压缩 */
+    uint8_t *rxBuf;        /* 解压输出缓冲区 (为 NULL 时收到的消息原样交付) */
+    size_t rxBufSize;      /* 缓冲区大小 (末尾补 0，可还原的最大 Payload 为 rxBufSize - 1) */
+    const uint8_t *dict;   /* 预置字典 (为 NULL 时不使用)，两端需相同 */
+    uint16_t dictLen;      /* 字典长度 */
+    uint8_t dictCrc;       /* 字典的 CRC8，写入帧头供接收端核对 */
+    MQTT_CompressStats stats;
+} MQTT_Compress;
+
+/**
+ * @brief 初始化压缩控制块 (minLen 默认为 32，可在初始化后修改)
+ * @param work     编码器工作内存 (2 字节对齐)，为 NULL 时只解压
+ * @param workSize 工作内存大小，可用 LZSS_ENC_WORK_SIZE(windowBits) 计算
+ * @param rxBuf    解压输出缓冲区，为 NULL 时只压缩
+ * @return true 成功; false 参数错误或工作内存不足
+ */
+bool MQTT_CompressInit(MQTT_Compress *cz, void *work, size_t workSize, uint8_t windowBits, uint8_t lookaheadBits,
+                       uint8_t *rxBuf, size_t rxBufSize);
+
+/**
+ * @brief 设置预置字典 (发送、接收共用，需在开始收发之前设置)
+ * @note  字典只保存指针，内容在使用期间不可修改；只有最后 2^windowBits 字节参与匹配
+ * @param dict 字典数据，为 NULL 时取消字典
+ * @return true 成功; false 字典过长 (超过 65535 字节)
+ */
+bool MQTT_CompressSetDict(MQTT_Compress *cz, const void *dict, size_t len);
+
+/**
+ * @brief 把由 n 个数据段组成的 Payload 编码为一帧写入 out (协议栈复制 PUBLISH 时自动调用)
+ * @note  压缩后比原始数据短时写入压缩帧，否则原样写入 (首字节为 0xFF 时加 2 字节未压缩帧头)；
+ *        编码器工作内存不可重入，多任务同时调用需自行互斥 (协议栈内部持有 HAL_MQTT_Lock)
+ * @param outSize 输出缓冲区大小 (至少 MQTT_COMPRESS_OUT_SIZE(Payload 总长度))
+ * @return 写入的字节数；输出缓冲区不足时返回 0
+ */
+size_t MQTT_CompressPayload(MQTT_Compress *cz, const MQTT_IoVec *iov, size_t n, uint8_t *out, size_t outSize);
+
+/**
+ * @brief 还原收到的 Payload (协议栈收到 PUBLISH 时自动调用)
+ * @note  不是压缩帧时原样返回；未压缩帧返回去掉帧头的数据；压缩帧解压到 rxBuf (末尾补 0)；
+ *        帧头要求字典而本端没有或 CRC8 不一致时原样返回并计入 errors
+ * @param outLen 输出还原后的长度
+ * @return 还原后的数据；原始长度超过 rxBuf 时返回 NULL (应丢弃该消息)
+ */
+const uint8_t *MQTT_DecompressPayload(MQTT_Compress *cz, const uint8_t *payload, size_t len, size_t *outLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_COMPRESS_H__ */
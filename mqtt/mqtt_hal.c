@@ -30,6 +30,25 @@ __WEAK void HAL_MQTT_Send(const uint8_t *data, size_t len)
     /* 用户在应用层实现：通过 UART / 网卡 等发送数据 */
 }
 
+/*
+ * 分散发送：PUBLISH 报文由 [固定报头+Topic长度] [Topic] [PacketID] [Payload...] 多段组成，
+ * Payload 直接引用用户内存，不经过 txBuf 拷贝。
+ *
+ * 示例 (POSIX socket):
+ * void HAL_MQTT_SendV(const MQTT_IoVec *iov, size_t cnt) {
+ * writev(sock, (const struct iovec *)iov, (int)cnt);
+ * }
+ */
+__WEAK void HAL_MQTT_SendV(const MQTT_IoVec *iov, size_t cnt)
+{
+    /* 默认逐段发送 (协议层调用时持有 HAL_MQTT_Lock，各段之间不会插入其他报文) */
+    for (size_t i = 0; i < cnt; i++)
+    {
+        if (iov[i].len > 0)
+            HAL_MQTT_Send((const uint8_t *)iov[i].base, iov[i].len);
+    }
+}
+
 __WEAK int HAL_MQTT_Recv(uint8_t *buf, size_t bufSize, uint32_t timeoutMs)
 {
     /* 用户在应用层实现：通过 UART / 网卡 等接收数据 */
@@ -56,3 +75,42 @@ __WEAK uint32_t HAL_MQTT_GetTick(void)
     /* 用户在应用层实现：获取系统时间戳 */
     return 0;
 }
+
+/*
+ * 请求表互斥锁：保护 MQTT_Client::requests / 时间轮 timers 以及 txBuf。
+ * MQTT_Submit (业务线程) 与 MQTT_ProcessLoop (接收线程) 都会在持锁期间构建并发送报文，
+ * 锁内不会调用任何用户回调，因此可以使用普通 (非递归) 互斥锁。
+ *
+ * 示例 (FreeRTOS):
+ * void HAL_MQTT_Lock(void)   { xSemaphoreTake(xMutexMqtt, portMAX_DELAY); }
+ * void HAL_MQTT_Unlock(void) { xSemaphoreGive(xMutexMqtt); }
+ */
+__WEAK void HAL_MQTT_Lock(void)
+{
+    /* 裸机单线程模式下无需加锁 */
+}
+
+__WEAK void HAL_MQTT_Unlock(void)
+{
+    /* 裸机单线程模式下无需加锁 */
+}
+
+/*
+ * 任务唤醒：MQTT_Channel 的 I/O 循环写入完成记录后通知等待的应用任务，
+ * 应用任务提交命令后通知 I/O 循环 (client->ioWaiter)。
+ *
+ * 示例 (FreeRTOS，waiter 为 TaskHandle_t；任务通知带计数，先通知后等待也不会丢失):
+ * void HAL_MQTT_Notify(void *waiter) { xTaskNotifyGive((TaskHandle_t)waiter); }
+ * void HAL_MQTT_Wait(void *waiter, uint32_t timeoutMs) { (void)waiter; ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)); }
+ */
+__WEAK void HAL_MQTT_Notify(void *waiter)
+{
+    /* 默认不通知，等待方轮询 */
+    (void)waiter;
+}
+
+__WEAK void HAL_MQTT_Wait(void *waiter, uint32_t timeoutMs)
+{
+    (void)waiter;
+    HAL_MQTT_Delay(timeoutMs < 1 ? timeoutMs : 1);
+}
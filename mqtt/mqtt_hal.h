@@ -21,10 +21,60 @@ extern "C" {
 #define __WEAK
 #endif
 
+/* ============================================================
+ * 跨任务共享的 32 位计数器 (获取/释放语义)
+ * 一个任务写入数据后用 MQTT_StoreRelease 发布计数，另一个任务用 MQTT_LoadAcquire 读到新值时，
+ * 保证也能看到之前写入的数据 (多核下 volatile 不提供这一保证)。
+ * GCC / Clang / armclang 使用 __atomic 内建函数；其他编译器退化为 volatile 访问加
+ * MQTT_MEMORY_BARRIER，多核平台需在编译选项中把它定义为完整屏障 (如 CMSIS 的 __DMB())
+ * ============================================================ */
+#if defined(__GNUC__) || defined(__clang__)
+static inline uint32_t MQTT_LoadAcquire(const volatile uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void MQTT_StoreRelease(volatile uint32_t *p, uint32_t value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+#else
+#ifndef MQTT_MEMORY_BARRIER
+#define MQTT_MEMORY_BARRIER() ((void)0)
+#endif
+
+static inline uint32_t MQTT_LoadAcquire(const volatile uint32_t *p)
+{
+    uint32_t value = *p;
+    MQTT_MEMORY_BARRIER();
+    return value;
+}
+
+static inline void MQTT_StoreRelease(volatile uint32_t *p, uint32_t value)
+{
+    MQTT_MEMORY_BARRIER();
+    *p = value;
+}
+#endif
+
+/* 分散发送的数据段 (成员顺序与 POSIX struct iovec 一致，可直接强转后交给 writev/sendmsg) */
+typedef struct
+{
+    const void *base; /* 数据段起始地址 */
+    size_t len;       /* 数据段长度 */
+} MQTT_IoVec;
+
 /* 发送数据接口 */
 void HAL_MQTT_Send(const uint8_t *buf, size_t len);
 
+/* 分散发送接口 (Scatter-Gather)：依次发送 iov[0..cnt-1]，多个数据段属于同一个报文
+ * 默认实现逐段调用 HAL_MQTT_Send；有 writev/sendmsg 或支持链式 DMA 的平台建议重写。
+ * 协议层的所有发送 (含接收路径回复的 ACK) 都在 HAL_MQTT_Lock 内调用 HAL_MQTT_Send / HAL_MQTT_SendV，
+ * 实现了请求表互斥接口时，同一客户端的报文不会互相插入；应用自行直接写同一链路时需持有同一把锁 */
+void HAL_MQTT_SendV(const MQTT_IoVec *iov, size_t cnt);
+
 /* 接收数据接口 (阻塞或带超时读取)
+ * 按字节流读取即可：一次可以返回半个报文或多个报文，由协议层负责分帧
  * 返回值: >0 实际读取字节数; =0 超时; <0 错误
  */
 int HAL_MQTT_Recv(uint8_t *buf, size_t bufSize, uint32_t timeoutMs);
@@ -38,6 +88,18 @@ uint32_t HAL_MQTT_GetTick(void);
 /* 延时接口 */
 void HAL_MQTT_Delay(uint32_t ms);
 
+/* 请求表互斥接口 (MQTT_Submit 与 MQTT_ProcessLoop 位于不同任务时必须实现)
+ * 裸机单循环调用时可保持默认空实现 */
+void HAL_MQTT_Lock(void);
+void HAL_MQTT_Unlock(void);
+
+/* 任务唤醒接口 (MQTT_Channel 使用，waiter 为用户登记的等待者句柄，为 NULL 时不唤醒)
+ * HAL_MQTT_Notify：通知等待者 (可能在另一个任务中调用，通知在对方开始等待之前到达也不能丢失)
+ * HAL_MQTT_Wait：等待通知，最长 timeoutMs；被通知或超时都返回，调用者自行检查条件
+ * 默认实现不通知、等待时延时 1ms 轮询；FreeRTOS 可用任务通知，Linux 见 port/posix (eventfd) */
+void HAL_MQTT_Notify(void *waiter);
+void HAL_MQTT_Wait(void *waiter, uint32_t timeoutMs);
+
 /* 初始化接口 */
 void HAL_MQTT_Init(void);
 
@@ -0,0 +1,331 @@
+#include "mqtt_router.h"
+#include <string.h>
+
+/* Topic 拆分后的单个层级 */
+typedef struct
+{
+    const char *name;
+    uint16_t len;
+} MQTT_RouteLevel;
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+/* 哈希：FNV-1a (层级名) 混合父节点下标 */
+static uint32_t MQTT_RouteHash(uint16_t parent, const char *name, uint16_t len)
+{
+    uint32_t h = 2166136261u ^ parent;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+/* 查找普通子节点，返回哈希表槽位；未找到时 *found 为 false，返回可插入的空槽 */
+static uint32_t MQTT_RouteProbe(MQTT_Router *router, uint16_t parent, const char *name, uint16_t len, bool *found)
+{
+    uint32_t pos = MQTT_RouteHash(parent, name, len) & router->slotMask;
+
+    for (;;)
+    {
+        uint16_t idx = router->slots[pos];
+        if (idx == 0)
+        {
+            *found = false;
+            return pos;
+        }
+
+        MQTT_RouteNode *node = &router->nodes[idx];
+        if (node->parent == parent && node->nameLen == len &&
+            memcmp(&router->names[node->nameOff], name, len) == 0)
+        {
+            *found = true;
+            return pos;
+        }
+        pos = (pos + 1) & router->slotMask;
+    }
+}
+
+/* 分配一个新节点，失败返回 0 */
+static uint16_t MQTT_RouteAlloc(MQTT_Router *router, uint16_t parent, const char *name, uint16_t len)
+{
+    if (router->nodeCount >= router->nodeCap || len > router->namesCap - router->namesUsed)
+        return 0;
+
+    uint16_t idx = router->nodeCount++;
+    MQTT_RouteNode *node = &router->nodes[idx];
+    memset(node, 0, sizeof(MQTT_RouteNode));
+    node->parent = parent;
+    node->nameLen = len;
+    node->nameOff = router->namesUsed;
+
+    memcpy(&router->names[router->namesUsed], name, len);
+    router->namesUsed += len;
+    return idx;
+}
+
+/* 查找 (或创建) 指定层级对应的子节点，返回 0 表示不存在或分配失败 */
+static uint16_t MQTT_RouteChild(MQTT_Router *router, uint16_t parent, const char *name, uint16_t len, bool create)
+{
+    MQTT_RouteNode *node = &router->nodes[parent];
+
+    /* 通配符子节点直接挂在父节点上，匹配时不需要查哈希表 */
+    if (len == 1 && (name[0] == '+' || name[0] == '#'))
+    {
+        uint16_t *child = (name[0] == '+') ? &node->plus : &node->hash;
+        if (*child == 0 && create)
+            *child = MQTT_RouteAlloc(router, parent, name, len);
+        return *child;
+    }
+
+    bool found;
+    uint32_t pos = MQTT_RouteProbe(router, parent, name, len, &found);
+    if (found)
+        return router->slots[pos];
+    if (!create)
+        return 0;
+
+    /* 哈希表保持至少一半空闲 (容量为节点数的 2 倍以上)，探测链很短 */
+    uint16_t idx = MQTT_RouteAlloc(router, parent, name, len);
+    if (idx)
+        router->slots[pos] = idx;
+    return idx;
+}
+
+/* 按过滤器逐层查找节点；create 为 true 时沿途创建，并校验通配符用法 */
+static uint16_t MQTT_RouteWalk(MQTT_Router *router, const char *filter, bool create)
+{
+    uint16_t node = 0;
+    const char *p = filter;
+
+    for (;;)
+    {
+        const char *end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > 0xFFFF)
+            return 0;
+
+        /* 通配符必须独占一个层级，'#' 只能出现在最后 */
+        if (len > 1 && (memchr(p, '+', len) || memchr(p, '#', len)))
+            return 0;
+        if (len == 1 && p[0] == '#' && end)
+            return 0;
+
+        node = MQTT_RouteChild(router, node, p, (uint16_t)len, create);
+        if (node == 0)
+            return 0;
+
+        if (!end)
+            return node;
+        p = end + 1;
+    }
+}
+
+/* 命中一个过滤器节点：普通处理函数直接调用；查找流式处理函数时只记录第一个 */
+static int MQTT_RouteHit(MQTT_RouteNode *node, struct MQTT_Client *client, const char *topic,
+                         const char *payload, size_t len, MQTT_RouteNode **stream)
+{
+    if (stream)
+    {
+        if (node->stream && !*stream)
+        {
+            *stream = node;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!node->handler)
+        return 0;
+    node->handler(client, topic, payload, len, node->ctx);
+    return 1;
+}
+
+/* 递归匹配：只沿存在的分支前进，递归深度不超过 Topic 层级数 */
+static int MQTT_RouteMatch(MQTT_Router *router, uint16_t idx, const MQTT_RouteLevel *levels,
+                           uint8_t level, uint8_t count, struct MQTT_Client *client,
+                           const char *topic, const char *payload, size_t len, MQTT_RouteNode **stream)
+{
+    MQTT_RouteNode *node = &router->nodes[idx];
+    int calls = 0;
+
+    /* 以 '$' 开头的 Topic (如 $SYS) 不参与首层通配符匹配 */
+    bool wildcard = !(level == 0 && levels[0].len > 0 && levels[0].name[0] == '$');
+
+    /* '#' 匹配剩余所有层级，也匹配父层级本身 ("a/#" 匹配 "a") */
+    if (node->hash && wildcard)
+        calls += MQTT_RouteHit(&router->nodes[node->hash], client, topic, payload, len, stream);
+
+    if (level == count)
+        return calls + MQTT_RouteHit(node, client, topic, payload, len, stream);
+
+    if (node->plus && wildcard)
+        calls += MQTT_RouteMatch(router, node->plus, levels, level + 1, count, client, topic, payload, len, stream);
+
+    uint16_t child = MQTT_RouteChild(router, idx, levels[level].name, levels[level].len, false);
+    /* 字面量为 "+" / "#" 的 Topic 层级不应命中通配符节点 */
+    if (child && child != node->plus && child != node->hash)
+        calls += MQTT_RouteMatch(router, child, levels, level + 1, count, client, topic, payload, len, stream);
+
+    return calls;
+}
+
+/* 拆分 Topic 层级 (只记录指针和长度，不拷贝)，返回层级数；超过 MQTT_ROUTER_MAX_LEVELS 时返回 0 */
+static uint8_t MQTT_RouteSplit(const char *topic, MQTT_RouteLevel *levels)
+{
+    uint8_t count = 0;
+    const char *p = topic;
+
+    for (;;)
+    {
+        if (count == MQTT_ROUTER_MAX_LEVELS)
+            return 0;
+
+        const char *end = strchr(p, '/');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n > 0xFFFF)
+            return 0;
+
+        levels[count].name = p;
+        levels[count].len = (uint16_t)n;
+        count++;
+
+        if (!end)
+            return count;
+        p = end + 1;
+    }
+}
+
+/* 在过滤器节点上登记处理函数 (普通与流式二选一) */
+static bool MQTT_RouteSet(MQTT_Router *router, const char *filter, MQTT_MessageHandler handler,
+                          MQTT_StreamHandler stream, void *ctx)
+{
+    uint16_t idx = MQTT_RouteWalk(router, filter, true);
+    if (idx == 0)
+        return false;
+
+    MQTT_RouteNode *node = &router->nodes[idx];
+    if (node->stream)
+        router->streamCount--;
+    if (stream)
+        router->streamCount++;
+
+    node->handler = handler;
+    node->stream = stream;
+    node->ctx = ctx;
+    return true;
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+bool MQTT_RouterInit(MQTT_Router *router, void *arena, size_t size, uint16_t maxNodes)
+{
+    if (!router || !arena || maxNodes == 0 || maxNodes > 0x7FFF)
+        return false;
+
+    /* 1. 节点数组放在最前面，按指针大小对齐 */
+    uintptr_t base = (uintptr_t)arena;
+    uintptr_t aligned = (base + sizeof(void *) - 1) & ~(uintptr_t)(sizeof(void *) - 1);
+    size_t used = (size_t)(aligned - base);
+
+    size_t nodeBytes = (size_t)maxNodes * sizeof(MQTT_RouteNode);
+
+    /* 2. 哈希表大小取不小于 2 * maxNodes 的 2 的幂 */
+    uint32_t slotCount = 1;
+    while (slotCount < 2u * maxNodes)
+        slotCount <<= 1;
+    size_t slotBytes = slotCount * sizeof(uint16_t);
+
+    if (size < used + nodeBytes + slotBytes)
+        return false;
+
+    memset(router, 0, sizeof(MQTT_Router));
+    router->nodes = (MQTT_RouteNode *)aligned;
+    router->nodeCap = maxNodes;
+    router->slots = (uint16_t *)(aligned + nodeBytes);
+    router->slotMask = slotCount - 1;
+    memset(router->slots, 0, slotBytes);
+
+    /* 3. 剩余空间作为层级名字符池 */
+    router->names = (char *)(aligned + nodeBytes + slotBytes);
+    router->namesCap = (uint32_t)(size - used - nodeBytes - slotBytes);
+
+    /* 4. 根节点 */
+    memset(&router->nodes[0], 0, sizeof(MQTT_RouteNode));
+    router->nodeCount = 1;
+    return true;
+}
+
+bool MQTT_RouterAdd(MQTT_Router *router, const char *filter, MQTT_MessageHandler handler, void *ctx)
+{
+    if (!router || !router->nodes || !filter || !filter[0] || !handler)
+        return false;
+
+    return MQTT_RouteSet(router, filter, handler, NULL, ctx);
+}
+
+bool MQTT_RouterAddStream(MQTT_Router *router, const char *filter, MQTT_StreamHandler handler, void *ctx)
+{
+    if (!router || !router->nodes || !filter || !filter[0] || !handler)
+        return false;
+
+    return MQTT_RouteSet(router, filter, NULL, handler, ctx);
+}
+
+bool MQTT_RouterRemove(MQTT_Router *router, const char *filter)
+{
+    if (!router || !router->nodes || !filter)
+        return false;
+
+    uint16_t idx = MQTT_RouteWalk(router, filter, false);
+    if (idx == 0 || (!router->nodes[idx].handler && !router->nodes[idx].stream))
+        return false;
+
+    if (router->nodes[idx].stream)
+        router->streamCount--;
+    router->nodes[idx].handler = NULL;
+    router->nodes[idx].stream = NULL;
+    router->nodes[idx].ctx = NULL;
+    return true;
+}
+
+int MQTT_RouterDispatch(MQTT_Router *router, struct MQTT_Client *client, const char *topic,
+                        const char *payload, size_t len)
+{
+    if (!router || !router->nodes || !topic)
+        return 0;
+
+    /* 1. 拆分层级 */
+    MQTT_RouteLevel levels[MQTT_ROUTER_MAX_LEVELS];
+    uint8_t count = MQTT_RouteSplit(topic, levels);
+    if (count == 0)
+        return 0;
+
+    /* 2. 从根节点开始匹配 */
+    return MQTT_RouteMatch(router, 0, levels, 0, count, client, topic, payload, len, NULL);
+}
+
+MQTT_StreamHandler MQTT_RouterFindStream(MQTT_Router *router, const char *topic, void **ctx)
+{
+    if (!router || !router->nodes || !topic || router->streamCount == 0)
+        return NULL;
+
+    MQTT_RouteLevel levels[MQTT_ROUTER_MAX_LEVELS];
+    uint8_t count = MQTT_RouteSplit(topic, levels);
+    if (count == 0)
+        return NULL;
+
+    MQTT_RouteNode *node = NULL;
+    MQTT_RouteMatch(router, 0, levels, 0, count, NULL, topic, NULL, 0, &node);
+    if (!node)
+        return NULL;
+
+    if (ctx)
+        *ctx = node->ctx;
+    return node->stream;
+}
@@ -0,0 +1,142 @@
+#ifndef __MQTT_ROUTER_H__
+#define __MQTT_ROUTER_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ============================================================
+ * 订阅分发器 (Topic Trie)
+ * 把订阅过滤器 (支持 '+' / '#' 通配符) 映射到各自的处理函数。
+ * 所有节点、哈希槽和层级名都存放在用户提供的一块内存 (arena) 中，
+ * 匹配时不分配内存，耗时只与 Topic 的层级数有关，与过滤器数量无关。
+ * ============================================================ */
+
+/* Topic 最大层级数 (超过的下行消息不会被分发，可在编译选项中覆盖) */
+#ifndef MQTT_ROUTER_MAX_LEVELS
+#define MQTT_ROUTER_MAX_LEVELS 16
+#endif
+
+struct MQTT_Client;
+
+/* 消息处理函数：在 MQTT_ProcessLoop 的线程上下文中执行 */
+typedef void (*MQTT_MessageHandler)(struct MQTT_Client *client, const char *topic,
+                                    const char *payload, size_t len, void *ctx);
+
+/* 流式接收事件 */
+typedef enum
+{
+    MQTT_STREAM_BEGIN, /* 收到 Topic 与 Payload 总长度，尚无数据 */
+    MQTT_STREAM_DATA,  /* 一段 Payload (按到达顺序，可能是任意长度) */
+    MQTT_STREAM_END,   /* Payload 已全部交付，随后回复 PUBACK / PUBREC */
+    MQTT_STREAM_ABORT  /* 消息未收完时发送了新的 CONNECT (重连)，已收到的部分应丢弃 */
+} MQTT_StreamEvent;
+
+/* 流式消息描述 (BEGIN 到 END/ABORT 之间内容不变，offset/data/len 随每段更新) */
+typedef struct
+{
+    const char *topic;   /* Topic (存放在 msgTopicBuf 中，超长时截断) */
+    uint32_t totalLen;   /* Payload 总长度 */
+    uint32_t offset;     /* 本段在 Payload 中的偏移 (即已交付的字节数) */
+    const uint8_t *data; /* 本段数据 (仅 DATA 事件有效，指向接收区，回调返回后失效) */
+    uint32_t len;        /* 本段长度 */
+    uint16_t packetId;   /* PacketID (QoS 0 为 0) */
+    uint8_t qos;
+    bool retain;
+} MQTT_StreamChunk;
+
+/* * 流式处理函数：在 MQTT_ProcessLoop 的线程上下文中执行
+ * DATA 事件返回已处理的字节数 (0 ~ len)，不足 len 时剩余数据留在接收区，下次 MQTT_ProcessLoop 再次交付；
+ * 接收区满后不再从传输层读取，由 TCP 窗口把背压传递给服务器。
+ * BEGIN / DATA 返回负数表示放弃该消息：剩余数据被丢弃，仍回复 ACK，之后不再有事件。
+ * END / ABORT 的返回值被忽略。
+ */
+typedef int32_t (*MQTT_StreamHandler)(struct MQTT_Client *client, MQTT_StreamEvent event,
+                                      const MQTT_StreamChunk *chunk, void *ctx);
+
+/* Trie 节点：一个节点对应过滤器中的一个层级 */
+typedef struct
+{
+    uint16_t parent;             /* 父节点下标 (根节点为 0) */
+    uint16_t plus;               /* '+' 子节点下标 (0 表示无) */
+    uint16_t hash;               /* '#' 子节点下标 (0 表示无) */
+    uint16_t nameLen;            /* 层级名长度 */
+    uint32_t nameOff;            /* 层级名在字符池中的偏移 */
+    MQTT_MessageHandler handler; /* 以该节点结尾的过滤器的处理函数 (NULL 表示无) */
+    MQTT_StreamHandler stream;   /* 流式处理函数 (与 handler 二选一) */
+    void *ctx;                   /* 处理函数用户参数 */
+} MQTT_RouteNode;
+
+/* 分发器控制块 */
+typedef struct
+{
+    MQTT_RouteNode *nodes; /* 节点数组 (下标 0 为根节点) */
+    uint16_t nodeCap;      /* 节点容量 */
+    uint16_t nodeCount;    /* 已使用节点数 */
+    uint16_t *slots;       /* 普通子节点哈希表 (开放寻址，存节点下标，0 表示空) */
+    uint32_t slotMask;     /* 哈希表大小 - 1 (大小为 2 的幂) */
+    char *names;           /* 层级名字符池 */
+    uint32_t namesCap;     /* 字符池容量 */
+    uint32_t namesUsed;    /* 字符池已用字节数 */
+    uint16_t streamCount;  /* 已注册的流式过滤器数量 (为 0 时接收方向不做流式匹配) */
+} MQTT_Router;
+
+/* 估算 arena 大小：maxNodes 个节点 + 哈希表 + nameBytes 字节层级名 (偏大，含对齐余量) */
+#define MQTT_ROUTER_ARENA_SIZE(maxNodes, nameBytes) \
+    ((size_t)(maxNodes) * sizeof(MQTT_RouteNode) + (size_t)(maxNodes) * 8 + (nameBytes) + 16)
+
+/**
+ * @brief 初始化分发器
+ * @param router   控制块
+ * @param arena    用户提供的内存 (静态数组即可)
+ * @param size     内存大小 (可用 MQTT_ROUTER_ARENA_SIZE 估算)
+ * @param maxNodes 最大节点数 (每个过滤器层级占一个节点，公共前缀共享，上限 32767)
+ * @return true 成功; false 参数错误或内存不足
+ */
+bool MQTT_RouterInit(MQTT_Router *router, void *arena, size_t size, uint16_t maxNodes);
+
+/**
+ * @brief 注册订阅过滤器 (同一过滤器重复注册会替换处理函数)
+ * @param filter 过滤器，如 "dev/+/temp"、"cmd/#"
+ * @return true 成功; false 过滤器非法或 arena 已满
+ */
+bool MQTT_RouterAdd(MQTT_Router *router, const char *filter, MQTT_MessageHandler handler, void *ctx);
+
+/**
+ * @brief 注册流式订阅过滤器：匹配的 PUBLISH 不经过 msgPayloadBuf，Payload 随到达分段交给 handler，
+ *        消息大小不受 rxBuf / msgPayloadBuf 限制 (可变报头仍需放得进接收区)
+ * @note  同一过滤器重复注册 (普通或流式) 会替换原处理函数；多个流式过滤器匹配同一 Topic 时只交给其中一个
+ * @return true 成功; false 过滤器非法或 arena 已满
+ */
+bool MQTT_RouterAddStream(MQTT_Router *router, const char *filter, MQTT_StreamHandler handler, void *ctx);
+
+/**
+ * @brief 注销订阅过滤器 (节点保留在 arena 中，仅清除处理函数)
+ * @return true 成功; false 过滤器不存在
+ */
+bool MQTT_RouterRemove(MQTT_Router *router, const char *filter);
+
+/**
+ * @brief 把一条下行消息分发给所有匹配的处理函数
+ * @return 被调用的处理函数数量
+ */
+int MQTT_RouterDispatch(MQTT_Router *router, struct MQTT_Client *client, const char *topic,
+                        const char *payload, size_t len);
+
+/**
+ * @brief 查找匹配 Topic 的流式处理函数 (供协议栈接收时使用)
+ * @param ctx 输出处理函数的用户参数
+ * @return 处理函数；没有匹配的流式过滤器时为 NULL
+ */
+MQTT_StreamHandler MQTT_RouterFindStream(MQTT_Router *router, const char *topic, void **ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_ROUTER_H__ */
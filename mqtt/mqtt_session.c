@@ -0,0 +1,355 @@
+#include "mqtt_session.h"
+#include "../CRC_Lib/CRC_Lib.h"
+#include <string.h>
+
+/* 段头魔数 ("MQSS")；快照写完后才写入，回收段时先清零再擦除 */
+#define MQTT_SESSION_MAGIC 0x4D515353u
+
+/* 段头 (位于每段开头) */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+} MQTT_SessionSegHdr;
+
+/* 记录头 (之后为数据，按 4 字节对齐) */
+typedef struct
+{
+    uint16_t len; /* 数据长度 (0xFFFF 表示未写入) */
+    uint16_t crc; /* CRC16：记录头其余字段与数据 */
+    uint8_t type;
+    uint8_t flags;
+    uint16_t id;
+} MQTT_SessionRecHdr;
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+static uint32_t MQTT_SessionRecSize(uint32_t len)
+{
+    return MQTT_SESSION_REC_HDR + ((len + 3u) & ~3u);
+}
+
+static uint32_t MQTT_SessionSegStart(const MQTT_Session *session, uint16_t seg)
+{
+    return (uint32_t)seg * session->dev->segSize;
+}
+
+static bool MQTT_SessionRead(MQTT_Session *session, uint32_t off, void *buf, uint32_t len)
+{
+    MQTT_StoreDev *dev = session->dev;
+    if (dev->map)
+    {
+        memcpy(buf, dev->map + off, len);
+        return true;
+    }
+    return dev->read(dev, off, buf, len);
+}
+
+static uint16_t MQTT_SessionCrcHdr(const MQTT_SessionRecHdr *hdr)
+{
+    uint16_t crc = Modbus_CRC16_Update(0xFFFF, (const uint8_t *)&hdr->len, sizeof(hdr->len));
+    crc = Modbus_CRC16_Update(crc, &hdr->type, sizeof(hdr->type));
+    crc = Modbus_CRC16_Update(crc, &hdr->flags, sizeof(hdr->flags));
+    return Modbus_CRC16_Update(crc, (const uint8_t *)&hdr->id, sizeof(hdr->id));
+}
+
+/* 读取并校验 pos 处的记录 (pos 为段内偏移)；数据指向映射区或读取缓冲区 */
+static bool MQTT_SessionLoad(MQTT_Session *session, uint32_t pos, MQTT_SessionRecHdr *hdr, const uint8_t **data)
+{
+    MQTT_StoreDev *dev = session->dev;
+    uint32_t base = MQTT_SessionSegStart(session, session->seg);
+
+    if (pos + MQTT_SESSION_REC_HDR > dev->segSize || !MQTT_SessionRead(session, base + pos, hdr, sizeof(*hdr)))
+        return false;
+    if (hdr->len > MQTT_SESSION_REC_MAX || pos + MQTT_SESSION_REC_HDR + hdr->len > dev->segSize)
+        return false;
+
+    if (dev->map)
+    {
+        *data = dev->map + base + pos + MQTT_SESSION_REC_HDR;
+    }
+    else
+    {
+        if (hdr->len > session->bufSize ||
+            (hdr->len > 0 && !dev->read(dev, base + pos + MQTT_SESSION_REC_HDR, session->buf, hdr->len)))
+            return false;
+        *data = session->buf;
+    }
+
+    return Modbus_CRC16_Update(MQTT_SessionCrcHdr(hdr), *data, hdr->len) == hdr->crc;
+}
+
+/* 回收一个段：先清零魔数，再擦除 */
+static void MQTT_SessionRetire(MQTT_Session *session, uint16_t seg)
+{
+    MQTT_StoreDev *dev = session->dev;
+    uint32_t start = MQTT_SessionSegStart(session, seg);
+    uint32_t zero = 0;
+
+    dev->write(dev, start, &zero, sizeof(zero));
+    dev->erase(dev, start);
+}
+
+static int MQTT_SessionFindSub(const MQTT_Session *session, const char *filter, size_t len)
+{
+    for (uint16_t i = 0; i < session->subCap; i++)
+    {
+        const MQTT_SessionSub *sub = &session->subs[i];
+        if (sub->len == len && memcmp(sub->filter, filter, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+bool MQTT_SessionOpen(MQTT_Session *session, MQTT_StoreDev *dev, uint8_t *buf, uint32_t bufSize,
+                      MQTT_SessionSub *subs, uint16_t subCap)
+{
+    if (!session || !dev || !dev->write || !dev->erase || (!dev->map && (!dev->read || !buf)) || (!subs && subCap))
+        return false;
+    if (dev->segSize % 4 != 0 || dev->segSize <= MQTT_SESSION_SEG_HDR + MQTT_SESSION_REC_HDR ||
+        dev->size / dev->segSize < 2 || dev->size / dev->segSize > 0xFFFF)
+        return false;
+
+    memset(session, 0, sizeof(MQTT_Session));
+    session->dev = dev;
+    session->buf = buf;
+    session->bufSize = buf ? bufSize : 0;
+    session->segCount = (uint16_t)(dev->size / dev->segSize);
+    session->subs = subs;
+    session->subCap = subCap;
+    if (subs)
+        memset(subs, 0, sizeof(MQTT_SessionSub) * subCap);
+
+    /* 1. 序号最大的有效段即为当前段 (快照写到一半的段没有段头) */
+    bool any = false;
+    MQTT_SessionSegHdr sh;
+    for (uint16_t i = 0; i < session->segCount; i++)
+    {
+        if (!MQTT_SessionRead(session, MQTT_SessionSegStart(session, i), &sh, sizeof(sh)))
+            return false;
+        if (sh.magic != MQTT_SESSION_MAGIC)
+            continue;
+        if (!any || (int32_t)(sh.seq - session->seq) > 0)
+        {
+            session->seg = i;
+            session->seq = sh.seq;
+        }
+        any = true;
+    }
+
+    /* 空设备：格式化第一个段 */
+    if (!any)
+    {
+        MQTT_SessionSegHdr init = {MQTT_SESSION_MAGIC, 1};
+        if (!dev->erase(dev, 0) || !dev->write(dev, 0, &init, sizeof(init)))
+            return false;
+        session->seq = 1;
+        session->tail = MQTT_SESSION_SEG_HDR;
+        return true;
+    }
+
+    /* 2. 重放订阅与租约，第一条无效记录处即为末尾 */
+    MQTT_SessionRecord rec;
+    uint32_t pos = 0;
+    while (MQTT_SessionNext(session, &pos, &rec))
+    {
+        if (rec.type == MQTT_SESSION_LEASE)
+            session->pidLease = rec.id;
+        else if (rec.type == MQTT_SESSION_SUB)
+            MQTT_SessionAddSub(session, (const char *)rec.data, rec.len, rec.flags);
+        else if (rec.type == MQTT_SESSION_UNSUB)
+            MQTT_SessionRemoveSub(session, (const char *)rec.data, rec.len);
+    }
+    session->tail = pos;
+
+    /* 无效位置不是擦除状态：掉电时写了一半的记录，本段不再写入，下一次追加时整理为快照 */
+    MQTT_SessionRecHdr hdr;
+    if (pos + MQTT_SESSION_REC_HDR <= dev->segSize)
+    {
+        if (!MQTT_SessionRead(session, MQTT_SessionSegStart(session, session->seg) + pos, &hdr, sizeof(hdr)))
+            return false;
+        if (hdr.len != 0xFFFF || hdr.crc != 0xFFFF || hdr.type != 0xFF || hdr.flags != 0xFF || hdr.id != 0xFFFF)
+            session->tail = dev->segSize;
+    }
+    return true;
+}
+
+bool MQTT_SessionHasRoom(const MQTT_Session *session, uint32_t len)
+{
+    return len <= MQTT_SESSION_REC_MAX && session->tail + MQTT_SessionRecSize(len) <= session->dev->segSize;
+}
+
+bool MQTT_SessionAppend(MQTT_Session *session, uint8_t type, uint8_t flags, uint16_t id,
+                        const MQTT_IoVec *data, size_t n)
+{
+    if (!session || !session->dev || (!data && n > 0))
+        return false;
+
+    uint32_t len = 0;
+    for (size_t i = 0; i < n; i++)
+        len += (uint32_t)data[i].len;
+
+    MQTT_StoreDev *dev = session->dev;
+    if (!MQTT_SessionHasRoom(session, len) || (!dev->map && len > session->bufSize))
+        return false;
+
+    MQTT_SessionRecHdr hdr;
+    hdr.len = (uint16_t)len;
+    hdr.type = type;
+    hdr.flags = flags;
+    hdr.id = id;
+    uint16_t crc = MQTT_SessionCrcHdr(&hdr);
+    for (size_t i = 0; i < n; i++)
+        crc = Modbus_CRC16_Update(crc, (const uint8_t *)data[i].base, (uint16_t)data[i].len);
+    hdr.crc = crc;
+
+    /* 先写记录头再写数据：掉电时只会留下校验失败的半条记录 */
+    uint32_t pos = MQTT_SessionSegStart(session, session->seg) + session->tail;
+    if (!dev->write(dev, pos, &hdr, sizeof(hdr)))
+    {
+        session->stats.errors++;
+        return false;
+    }
+    pos += MQTT_SESSION_REC_HDR;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (data[i].len > 0 && !dev->write(dev, pos, data[i].base, (uint32_t)data[i].len))
+        {
+            session->stats.errors++;
+            return false;
+        }
+        pos += (uint32_t)data[i].len;
+    }
+
+    uint32_t size = MQTT_SessionRecSize(len);
+    session->tail += size;
+    session->stats.records++;
+    session->stats.bytes += size;
+    return true;
+}
+
+bool MQTT_SessionNext(MQTT_Session *session, uint32_t *pos, MQTT_SessionRecord *rec)
+{
+    if (!session || !session->dev || !pos || !rec)
+        return false;
+
+    /* 打开时 tail 尚未确定 (为 0)，读到第一条无效记录为止 */
+    if (*pos == 0)
+        *pos = MQTT_SESSION_SEG_HDR;
+    if (session->tail && *pos >= session->tail)
+        return false;
+
+    MQTT_SessionRecHdr hdr;
+    const uint8_t *data;
+    if (!MQTT_SessionLoad(session, *pos, &hdr, &data))
+        return false;
+
+    rec->type = hdr.type;
+    rec->flags = hdr.flags;
+    rec->id = hdr.id;
+    rec->data = data;
+    rec->len = hdr.len;
+    *pos += MQTT_SessionRecSize(hdr.len);
+    return true;
+}
+
+bool MQTT_SessionBeginSnapshot(MQTT_Session *session)
+{
+    if (!session || !session->dev || session->snapStart)
+        return false;
+
+    MQTT_StoreDev *dev = session->dev;
+    uint16_t next = (uint16_t)((session->seg + 1) % session->segCount);
+    if (!dev->erase(dev, MQTT_SessionSegStart(session, next)))
+    {
+        session->stats.errors++;
+        return false;
+    }
+
+    session->snapStart = session->tail;
+    session->seg = next;
+    session->tail = MQTT_SESSION_SEG_HDR;
+
+    /* 租约与订阅表由本模块维护，直接写入快照 */
+    bool ok = !session->pidLease ||
+              MQTT_SessionAppend(session, MQTT_SESSION_LEASE, 0, session->pidLease, NULL, 0);
+    for (uint16_t i = 0; ok && i < session->subCap; i++)
+    {
+        const MQTT_SessionSub *sub = &session->subs[i];
+        MQTT_IoVec v = {sub->filter, sub->len};
+        if (sub->len > 0)
+            ok = MQTT_SessionAppend(session, MQTT_SESSION_SUB, sub->qos, 0, &v, 1);
+    }
+    if (!ok)
+        MQTT_SessionEndSnapshot(session, false);
+    return ok;
+}
+
+bool MQTT_SessionEndSnapshot(MQTT_Session *session, bool commit)
+{
+    if (!session || !session->dev || !session->snapStart)
+        return false;
+
+    MQTT_StoreDev *dev = session->dev;
+    uint16_t prev = (uint16_t)((session->seg + session->segCount - 1) % session->segCount);
+    MQTT_SessionSegHdr sh = {MQTT_SESSION_MAGIC, session->seq + 1};
+
+    /* 写入段头后新段生效，旧段随即回收；失败时回到旧段 (新段没有段头，不会被打开) */
+    if (commit && dev->write(dev, MQTT_SessionSegStart(session, session->seg), &sh, sizeof(sh)))
+    {
+        MQTT_SessionRetire(session, prev);
+        session->seq = sh.seq;
+        session->snapStart = 0;
+        session->stats.snapshots++;
+        return true;
+    }
+
+    session->stats.errors++;
+    session->seg = prev;
+    session->tail = session->snapStart;
+    session->snapStart = 0;
+    return false;
+}
+
+bool MQTT_SessionAddSub(MQTT_Session *session, const char *filter, size_t len, uint8_t qos)
+{
+    if (!session || !filter || len == 0 || len >= MQTT_SESSION_FILTER_MAX)
+        return false;
+
+    int idx = MQTT_SessionFindSub(session, filter, len);
+    for (uint16_t i = 0; idx < 0 && i < session->subCap; i++)
+    {
+        if (session->subs[i].len == 0)
+            idx = i;
+    }
+    if (idx < 0)
+        return false;
+
+    MQTT_SessionSub *sub = &session->subs[idx];
+    memcpy(sub->filter, filter, len);
+    sub->filter[len] = '\0';
+    sub->len = (uint8_t)len;
+    sub->qos = qos & 0x03;
+    return true;
+}
+
+void MQTT_SessionRemoveSub(MQTT_Session *session, const char *filter, size_t len)
+{
+    /* 只标记为空闲，不移动其他表项 (重新订阅的请求可能正引用着它们) */
+    int idx = session ? MQTT_SessionFindSub(session, filter, len) : -1;
+    if (idx >= 0)
+        session->subs[idx].len = 0;
+}
+
+bool MQTT_SessionSync(MQTT_Session *session)
+{
+    if (!session || !session->dev)
+        return false;
+    return session->dev->sync ? session->dev->sync(session->dev) : true;
+}
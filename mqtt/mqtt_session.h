@@ -0,0 +1,160 @@
+#ifndef __MQTT_SESSION_H__
+#define __MQTT_SESSION_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "mqtt_hal.h"
+#include "mqtt_store.h"
+
+/* ============================================================
+ * 会话持久化 (Session Journal)
+ * cleanSession = 0 时服务器保留会话，客户端也需要在重启后记得自己的一半：
+ * 未确认的 QoS > 0 PUBLISH (含 QoS 2 所处的阶段)、PacketID 计数、订阅列表与接收去重状态。
+ * 这些状态以增量记录追加到块设备 (与离线队列相同的 MQTT_StoreDev，Linux 上为 mmap 文件，
+ * MCU 上为 Flash 扇区)，每条记录 8 字节头 + 数据，带 CRC16 校验，平时只追加不改写。
+ * 当前段写满时把仍然有效的状态写成快照放入下一段，快照写完后才写段头使其生效，再擦除旧段；
+ * 掉电时要么旧段有效、要么新段有效，写了一半的记录在打开时被丢弃。
+ * 本模块只负责日志与订阅表；与客户端状态的对接 (记录、快照、恢复) 由 mqtt.c 完成。
+ * ============================================================ */
+
+/* 段头大小 (魔数 + 段序号) */
+#define MQTT_SESSION_SEG_HDR 8
+
+/* 记录头大小 (长度 + CRC + 类型 + 标志 + ID) */
+#define MQTT_SESSION_REC_HDR 8
+
+/* 单条记录数据的最大长度 (超过的 PUBLISH 不记录，重启后无法恢复) */
+#define MQTT_SESSION_REC_MAX 0xFFFE
+
+/* 订阅过滤器的最大长度 (含结尾 0，更长的订阅不记录，可在编译选项中覆盖) */
+#ifndef MQTT_SESSION_FILTER_MAX
+#define MQTT_SESSION_FILTER_MAX 64
+#endif
+
+/* PacketID 租约：每分配这么多个 ID 记录一次，重启后从租约末尾继续分配 (可在编译选项中覆盖) */
+#ifndef MQTT_SESSION_PID_LEASE
+#define MQTT_SESSION_PID_LEASE 64
+#endif
+
+/* 记录类型 */
+#define MQTT_SESSION_LEASE 1     /* PacketID 租约 (id = 租约末尾) */
+#define MQTT_SESSION_OUT 2       /* 发出的 QoS > 0 PUBLISH (id = PacketID，flags = QoS | Retain << 2，数据 = [Topic 长度 2][Topic][Payload]) */
+#define MQTT_SESSION_REL 3       /* 发出的 QoS 2 PUBLISH 已收到 PUBREC，进入 PUBREL 阶段 */
+#define MQTT_SESSION_DONE 4      /* 发出的 PUBLISH 已结束 (确认、超时或被拒绝) */
+#define MQTT_SESSION_SUB 5       /* 订阅成功 (flags = QoS，数据 = 过滤器) */
+#define MQTT_SESSION_UNSUB 6     /* 退订成功 (数据 = 过滤器) */
+#define MQTT_SESSION_RX 7        /* 收到新的 QoS 1 PUBLISH (登记到去重窗口) */
+#define MQTT_SESSION_RX_FORGET 8 /* 撤销一次去重登记 (消息未交付完就断开了) */
+#define MQTT_SESSION_RX2 9       /* 收到新的 QoS 2 PUBLISH，等待 PUBREL */
+#define MQTT_SESSION_RX2_REL 10  /* 收到 PUBREL (id 为 0 表示清空：服务器没有保留会话) */
+#define MQTT_SESSION_WINDOW 11   /* 去重窗口快照 (id = 窗口顶端，数据 = 位图) */
+
+/* 一条日志记录 (data 指向映射区或 MQTT_Session::buf，读取下一条之前有效) */
+typedef struct
+{
+    uint8_t type;
+    uint8_t flags;
+    uint16_t id;
+    const uint8_t *data;
+    uint16_t len;
+} MQTT_SessionRecord;
+
+/* 订阅表项 (len 为 0 表示空闲) */
+typedef struct
+{
+    uint8_t qos;
+    uint8_t len;
+    char filter[MQTT_SESSION_FILTER_MAX]; /* 以 0 结尾，可直接用于重新订阅 */
+} MQTT_SessionSub;
+
+/* 运行统计 */
+typedef struct
+{
+    uint32_t records;   /* 追加的记录数 */
+    uint32_t bytes;     /* 追加的字节数 (含记录头与对齐) */
+    uint32_t snapshots; /* 写满后整理为快照的次数 */
+    uint32_t restored;  /* 重启后恢复的未确认 PUBLISH 数 */
+    uint32_t lost;      /* 无法记录或恢复的 PUBLISH / 订阅数 (过大、内存池不足、在途窗口冲突) */
+    uint32_t errors;    /* 设备读写失败或快照放不下一个段的次数 */
+} MQTT_SessionStats;
+
+/* 会话控制块 */
+typedef struct MQTT_Session
+{
+    MQTT_StoreDev *dev;
+    uint8_t *buf;          /* 读取缓冲区 (仅在 dev->map 为 NULL 时使用，决定可恢复的最大记录) */
+    uint32_t bufSize;      /* 缓冲区大小 */
+    uint16_t segCount;     /* 段数 */
+    uint16_t seg;          /* 当前有效 (正在追加) 的段 */
+    uint32_t seq;          /* 当前段的序号 */
+    uint32_t tail;         /* 下一条记录的写入位置 */
+    uint32_t snapStart;    /* 快照开始前的写入位置 (快照进行中时不为 0) */
+    uint16_t pidLease;     /* 已记录的 PacketID 租约末尾 (分配的 ID 超出 [末尾 - 租约 + 1, 末尾] 时续租) */
+    MQTT_SessionSub *subs; /* 订阅表 (由用户提供) */
+    uint16_t subCap;       /* 订阅表容量 */
+    uint16_t resubNext;    /* 内部使用：服务器没有保留会话时，下一个要重新订阅的表项 */
+    bool resubPending;     /* 内部使用：还有订阅等待重新提交 */
+    MQTT_SessionStats stats;
+} MQTT_Session;
+
+/**
+ * @brief 打开会话日志：扫描设备找到最新的有效段，恢复订阅表与 PacketID 租约 (设备为空时自动格式化)
+ * @note  未确认的 PUBLISH 与接收去重状态由 MQTT_SessionRestore 恢复到客户端
+ * @param buf     读取缓冲区，dev->map 不为 NULL 时可传 NULL
+ * @param subs    订阅表，subCap 为 0 时不记录订阅
+ * @return true 成功; false 参数错误或设备读写失败
+ */
+bool MQTT_SessionOpen(MQTT_Session *session, MQTT_StoreDev *dev, uint8_t *buf, uint32_t bufSize,
+                      MQTT_SessionSub *subs, uint16_t subCap);
+
+/* 当前段是否还放得下一条 len 字节数据的记录 (放不下时先整理为快照) */
+bool MQTT_SessionHasRoom(const MQTT_Session *session, uint32_t len);
+
+/**
+ * @brief 追加一条记录 (O(1))，数据可由多段组成
+ * @return true 成功; false 当前段已满、记录过大或写入失败
+ */
+bool MQTT_SessionAppend(MQTT_Session *session, uint8_t type, uint8_t flags, uint16_t id,
+                        const MQTT_IoVec *data, size_t n);
+
+/**
+ * @brief 遍历当前段的记录
+ * @param pos 遍历位置，从 0 开始，由本函数推进
+ * @return true 读出一条记录; false 已到末尾
+ */
+bool MQTT_SessionNext(MQTT_Session *session, uint32_t *pos, MQTT_SessionRecord *rec);
+
+/**
+ * @brief 开始快照：擦除下一段，之后的记录写入新段；先写入 PacketID 租约与订阅表
+ * @return true 成功; false 擦除或写入失败
+ */
+bool MQTT_SessionBeginSnapshot(MQTT_Session *session);
+
+/**
+ * @brief 结束快照
+ * @param commit true：写入段头使新段生效并擦除旧段; false：放弃新段，继续使用旧段
+ * @return true 新段已生效
+ */
+bool MQTT_SessionEndSnapshot(MQTT_Session *session, bool commit);
+
+/**
+ * @brief 订阅表：登记订阅成功 / 退订成功的过滤器 (只修改内存中的表，日志记录由调用者追加)
+ * @return true 成功; false 过滤器过长或表已满 (订阅不会被持久化)
+ */
+bool MQTT_SessionAddSub(MQTT_Session *session, const char *filter, size_t len, uint8_t qos);
+void MQTT_SessionRemoveSub(MQTT_Session *session, const char *filter, size_t len);
+
+/* 调用后端 sync 落盘 */
+bool MQTT_SessionSync(MQTT_Session *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_SESSION_H__ */
@@ -0,0 +1,361 @@
+#include "mqtt_store.h"
+#include "../CRC_Lib/CRC_Lib.h"
+#include <string.h>
+
+/* 段头魔数 ("MQSG")；回收段时先清零再擦除，掉电时半擦除的段不会被误认 */
+#define MQTT_STORE_MAGIC 0x4D515347u
+
+/* 记录状态：擦除后为 0xFF (未确认)，确认后改写为 0x00 */
+#define MQTT_STORE_PENDING 0xFF
+#define MQTT_STORE_CONSUMED 0x00
+
+/* 段头 (位于每段开头) */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+} MQTT_StoreSegHdr;
+
+/* 记录头 (之后依次为 Topic、Payload，按 4 字节对齐) */
+typedef struct
+{
+    uint16_t len;      /* Topic + Payload 长度 (0xFFFF 表示未写入) */
+    uint16_t crc;      /* CRC16：len、flags、topicLen 与数据体 */
+    uint8_t state;     /* 确认状态 (不参与校验) */
+    uint8_t flags;     /* bit0~1: QoS, bit2: Retain */
+    uint16_t topicLen; /* Topic 长度 */
+} MQTT_StoreRecHdr;
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+static uint32_t MQTT_StoreRecSize(uint16_t len)
+{
+    return MQTT_STORE_REC_HDR + (((uint32_t)len + 3u) & ~3u);
+}
+
+static uint32_t MQTT_StoreSegStart(MQTT_Store *store, uint16_t seg)
+{
+    return (uint32_t)seg * store->dev->segSize;
+}
+
+static bool MQTT_StoreRead(MQTT_Store *store, uint32_t off, void *buf, uint32_t len)
+{
+    MQTT_StoreDev *dev = store->dev;
+    if (dev->map)
+    {
+        memcpy(buf, dev->map + off, len);
+        return true;
+    }
+    return dev->read(dev, off, buf, len);
+}
+
+static uint16_t MQTT_StoreCrc(const MQTT_StoreRecHdr *hdr, const uint8_t *body)
+{
+    uint16_t crc = Modbus_CRC16_Update(0xFFFF, (const uint8_t *)&hdr->len, sizeof(hdr->len));
+    crc = Modbus_CRC16_Update(crc, &hdr->flags, sizeof(hdr->flags));
+    crc = Modbus_CRC16_Update(crc, (const uint8_t *)&hdr->topicLen, sizeof(hdr->topicLen));
+    return Modbus_CRC16_Update(crc, body, hdr->len);
+}
+
+/* 读取并校验 pos 处的记录；数据体指向映射区或读取缓冲区 */
+static bool MQTT_StoreLoad(MQTT_Store *store, uint32_t pos, MQTT_StoreRecHdr *hdr, const uint8_t **body)
+{
+    /* 记录不会从段起始处开始，pos 落在段边界上表示前一段已到末尾 */
+    uint32_t segEnd = (pos / store->dev->segSize + 1) * store->dev->segSize;
+    if (pos % store->dev->segSize == 0 || pos + MQTT_STORE_REC_HDR > segEnd ||
+        !MQTT_StoreRead(store, pos, hdr, sizeof(MQTT_StoreRecHdr)))
+        return false;
+
+    if (hdr->len > MQTT_STORE_REC_MAX || hdr->topicLen > hdr->len ||
+        pos + MQTT_STORE_REC_HDR + hdr->len > segEnd)
+        return false;
+
+    if (store->dev->map)
+    {
+        *body = store->dev->map + pos + MQTT_STORE_REC_HDR;
+    }
+    else
+    {
+        if (hdr->len > store->bufSize || !store->dev->read(store->dev, pos + MQTT_STORE_REC_HDR, store->buf, hdr->len))
+            return false;
+        *body = store->buf;
+    }
+
+    return MQTT_StoreCrc(hdr, *body) == hdr->crc;
+}
+
+/* 从 *pos 开始查找下一条有效记录 (必要时跨段)，到达队尾返回 false */
+static bool MQTT_StoreLocate(MQTT_Store *store, uint32_t *pos, uint16_t *seg,
+                             MQTT_StoreRecHdr *hdr, const uint8_t **body)
+{
+    while (*pos != store->tail)
+    {
+        if (MQTT_StoreLoad(store, *pos, hdr, body))
+            return true;
+
+        /* 本段已无有效记录 (段尾或掉电时写了一半的记录)，转到下一段 */
+        if (*seg == store->tailSeg)
+        {
+            *pos = store->tail;
+            break;
+        }
+        *seg = (uint16_t)((*seg + 1) % store->segCount);
+        *pos = MQTT_StoreSegStart(store, *seg) + MQTT_STORE_SEG_HDR;
+    }
+    return false;
+}
+
+/* 擦除一个段并写入段头，作为新的写入段 */
+static bool MQTT_StoreOpenSeg(MQTT_Store *store, uint16_t seg, uint32_t seq)
+{
+    MQTT_StoreDev *dev = store->dev;
+    uint32_t start = MQTT_StoreSegStart(store, seg);
+    MQTT_StoreSegHdr sh = {MQTT_STORE_MAGIC, seq};
+
+    if (!dev->erase(dev, start) || !dev->write(dev, start, &sh, sizeof(sh)))
+        return false;
+
+    store->tailSeg = seg;
+    store->seq = seq;
+    store->tail = start + MQTT_STORE_SEG_HDR;
+    return true;
+}
+
+/* 回收一个已全部确认的段：先清零魔数，再擦除 */
+static void MQTT_StoreRetire(MQTT_Store *store, uint16_t seg)
+{
+    MQTT_StoreDev *dev = store->dev;
+    uint32_t start = MQTT_StoreSegStart(store, seg);
+    uint32_t zero = 0;
+
+    dev->write(dev, start, &zero, sizeof(zero));
+    dev->erase(dev, start);
+}
+
+/* 队首跳过已确认的记录，离开的段立即回收 */
+static void MQTT_StoreAdvance(MQTT_Store *store)
+{
+    MQTT_StoreRecHdr hdr;
+    const uint8_t *body;
+
+    for (;;)
+    {
+        uint16_t seg = store->headSeg;
+        bool found = MQTT_StoreLocate(store, &store->head, &seg, &hdr, &body);
+
+        while (store->headSeg != seg)
+        {
+            MQTT_StoreRetire(store, store->headSeg);
+            store->headSeg = (uint16_t)((store->headSeg + 1) % store->segCount);
+        }
+
+        if (!found || hdr.state != MQTT_STORE_CONSUMED)
+            break;
+        store->head += MQTT_StoreRecSize(hdr.len);
+    }
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+bool MQTT_StoreOpen(MQTT_Store *store, MQTT_StoreDev *dev, uint8_t *buf, uint32_t bufSize)
+{
+    if (!store || !dev || !dev->write || !dev->erase || (!dev->map && (!dev->read || !buf)))
+        return false;
+    if (dev->segSize % 4 != 0 || dev->segSize <= MQTT_STORE_SEG_HDR + MQTT_STORE_REC_HDR ||
+        dev->size / dev->segSize < 2 || dev->size / dev->segSize > 0xFFFF)
+        return false;
+
+    memset(store, 0, sizeof(MQTT_Store));
+    store->dev = dev;
+    store->buf = buf;
+    store->bufSize = buf ? bufSize : 0;
+    store->segCount = (uint16_t)(dev->size / dev->segSize);
+
+    /* 1. 读取所有段头，序号最大的有效段为写入段 */
+    bool any = false;
+    MQTT_StoreSegHdr sh;
+    for (uint16_t i = 0; i < store->segCount; i++)
+    {
+        if (!MQTT_StoreRead(store, MQTT_StoreSegStart(store, i), &sh, sizeof(sh)))
+            return false;
+        if (sh.magic != MQTT_STORE_MAGIC)
+            continue;
+        if (!any || (int32_t)(sh.seq - store->seq) > 0)
+        {
+            store->tailSeg = i;
+            store->seq = sh.seq;
+        }
+        any = true;
+    }
+
+    /* 空设备：格式化第一个段 */
+    if (!any)
+    {
+        if (!MQTT_StoreOpenSeg(store, 0, 1))
+            return false;
+        store->head = store->tail;
+        return true;
+    }
+
+    /* 2. 向前查找序号连续的段，得到最早的段 */
+    store->headSeg = store->tailSeg;
+    uint32_t seq = store->seq;
+    for (;;)
+    {
+        uint16_t prev = (uint16_t)((store->headSeg + store->segCount - 1) % store->segCount);
+        if (prev == store->tailSeg ||
+            !MQTT_StoreRead(store, MQTT_StoreSegStart(store, prev), &sh, sizeof(sh)) ||
+            sh.magic != MQTT_STORE_MAGIC || sh.seq != seq - 1)
+            break;
+        store->headSeg = prev;
+        seq--;
+    }
+
+    /* 3. 扫描写入段，第一条无效记录处即为队尾 */
+    MQTT_StoreRecHdr hdr;
+    const uint8_t *body;
+    uint32_t segEnd = MQTT_StoreSegStart(store, store->tailSeg) + dev->segSize;
+    uint32_t pos = MQTT_StoreSegStart(store, store->tailSeg) + MQTT_STORE_SEG_HDR;
+
+    while (MQTT_StoreLoad(store, pos, &hdr, &body))
+        pos += MQTT_StoreRecSize(hdr.len);
+    store->tail = pos;
+
+    /* 无效位置不是擦除状态：掉电时写了一半的记录，本段不再写入 */
+    if (pos + MQTT_STORE_REC_HDR <= segEnd)
+    {
+        if (!MQTT_StoreRead(store, pos, &hdr, sizeof(hdr)))
+            return false;
+        if (hdr.len != 0xFFFF || hdr.crc != 0xFFFF || hdr.topicLen != 0xFFFF)
+            store->tail = segEnd;
+    }
+
+    /* 4. 统计未确认记录，队首跳过已确认的部分 */
+    uint16_t seg = store->headSeg;
+    pos = MQTT_StoreSegStart(store, seg) + MQTT_STORE_SEG_HDR;
+    while (MQTT_StoreLocate(store, &pos, &seg, &hdr, &body))
+    {
+        if (hdr.state != MQTT_STORE_CONSUMED)
+            store->count++;
+        pos += MQTT_StoreRecSize(hdr.len);
+    }
+
+    store->head = MQTT_StoreSegStart(store, store->headSeg) + MQTT_STORE_SEG_HDR;
+    MQTT_StoreAdvance(store);
+    return true;
+}
+
+bool MQTT_StoreAppend(MQTT_Store *store, const char *topic, uint16_t topicLen,
+                      const MQTT_IoVec *payload, size_t n, uint8_t qos, uint8_t retain)
+{
+    if (!store || !store->dev || !topic || (!payload && n > 0))
+        return false;
+
+    /* 1. 计算记录长度 */
+    uint32_t len = topicLen;
+    for (size_t i = 0; i < n; i++)
+        len += (uint32_t)payload[i].len;
+
+    MQTT_StoreDev *dev = store->dev;
+    uint32_t need = MQTT_StoreRecSize((uint16_t)len);
+    if (len > MQTT_STORE_REC_MAX || need > dev->segSize - MQTT_STORE_SEG_HDR ||
+        (!dev->map && len > store->bufSize))
+        return false;
+
+    /* 2. 当前段放不下则开新段 (追上最早的段说明队列已满) */
+    if (store->tail + need > MQTT_StoreSegStart(store, store->tailSeg) + dev->segSize)
+    {
+        uint16_t next = (uint16_t)((store->tailSeg + 1) % store->segCount);
+        if (next == store->headSeg || !MQTT_StoreOpenSeg(store, next, store->seq + 1))
+            return false;
+    }
+
+    /* 3. 先写记录头再写数据体：掉电时只会留下校验失败的半条记录 */
+    MQTT_StoreRecHdr hdr;
+    hdr.len = (uint16_t)len;
+    hdr.state = MQTT_STORE_PENDING;
+    hdr.flags = (uint8_t)((qos & 0x03) | (retain ? 0x04 : 0));
+    hdr.topicLen = topicLen;
+
+    uint16_t crc = Modbus_CRC16_Update(0xFFFF, (const uint8_t *)&hdr.len, sizeof(hdr.len));
+    crc = Modbus_CRC16_Update(crc, &hdr.flags, sizeof(hdr.flags));
+    crc = Modbus_CRC16_Update(crc, (const uint8_t *)&hdr.topicLen, sizeof(hdr.topicLen));
+    crc = Modbus_CRC16_Update(crc, (const uint8_t *)topic, topicLen);
+    for (size_t i = 0; i < n; i++)
+        crc = Modbus_CRC16_Update(crc, (const uint8_t *)payload[i].base, (uint16_t)payload[i].len);
+    hdr.crc = crc;
+
+    uint32_t pos = store->tail;
+    if (!dev->write(dev, pos, &hdr, sizeof(hdr)) ||
+        !dev->write(dev, pos + MQTT_STORE_REC_HDR, topic, topicLen))
+        return false;
+    pos += MQTT_STORE_REC_HDR + topicLen;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (payload[i].len > 0 && !dev->write(dev, pos, payload[i].base, (uint32_t)payload[i].len))
+            return false;
+        pos += (uint32_t)payload[i].len;
+    }
+
+    store->tail += need;
+
+    /* 队列原本为空时队首可能还停在上一段，移到新记录上 */
+    if (store->count++ == 0)
+        MQTT_StoreAdvance(store);
+    return true;
+}
+
+bool MQTT_StorePeek(MQTT_Store *store, MQTT_StoreRecord *rec)
+{
+    if (!store || !store->dev || !rec || store->count == 0)
+        return false;
+
+    MQTT_StoreRecHdr hdr;
+    const uint8_t *body;
+    if (!MQTT_StoreLoad(store, store->head, &hdr, &body))
+        return false;
+
+    rec->topic = (const char *)body;
+    rec->topicLen = hdr.topicLen;
+    rec->payload = body + hdr.topicLen;
+    rec->payloadLen = (uint16_t)(hdr.len - hdr.topicLen);
+    rec->qos = hdr.flags & 0x03;
+    rec->retain = (hdr.flags & 0x04) ? 1 : 0;
+    return true;
+}
+
+bool MQTT_StoreConsume(MQTT_Store *store)
+{
+    if (!store || !store->dev || store->count == 0)
+        return false;
+
+    MQTT_StoreRecHdr hdr;
+    if (!MQTT_StoreRead(store, store->head, &hdr, sizeof(hdr)))
+        return false;
+
+    /* 只改写状态字节 (1 -> 0)，不需要擦除 */
+    uint8_t state = MQTT_STORE_CONSUMED;
+    if (!store->dev->write(store->dev, store->head + offsetof(MQTT_StoreRecHdr, state), &state, 1))
+        return false;
+
+    store->count--;
+    store->head += MQTT_StoreRecSize(hdr.len);
+    MQTT_StoreAdvance(store);
+    return true;
+}
+
+uint32_t MQTT_StoreCount(const MQTT_Store *store)
+{
+    return store ? store->count : 0;
+}
+
+bool MQTT_StoreSync(MQTT_Store *store)
+{
+    if (!store || !store->dev)
+        return false;
+    return store->dev->sync ? store->dev->sync(store->dev) : true;
+}
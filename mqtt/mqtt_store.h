@@ -0,0 +1,106 @@
+#ifndef __MQTT_STORE_H__
+#define __MQTT_STORE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "mqtt_hal.h"
+
+/* ============================================================
+ * 离线发布队列 (Store-and-Forward)
+ * 追加写的分段日志：存储空间按擦除块划分为若干段，循环使用。
+ * 每条记录带 CRC16 校验，追加为 O(1)；确认后只把记录的状态字节清零
+ * (1 -> 0，Flash 无需擦除即可改写)，整段确认完后才擦除回收。
+ * 掉电重启后 MQTT_StoreOpen 扫描各段恢复队首/队尾，写了一半的记录被丢弃。
+ * ============================================================ */
+
+/* 段头大小 (魔数 + 段序号) */
+#define MQTT_STORE_SEG_HDR 8
+
+/* 记录头大小 (长度 + CRC + 状态 + 标志 + Topic 长度) */
+#define MQTT_STORE_REC_HDR 8
+
+/* 单条记录 (Topic + Payload) 的最大长度 */
+#define MQTT_STORE_REC_MAX 0xFFFE
+
+typedef struct MQTT_StoreDev MQTT_StoreDev;
+
+/* 块设备接口：Linux 上可用 mmap 文件，MCU 上可对接片内/SPI Flash、FRAM 等
+ * 要求：擦除后内容为 0xFF；write 只会把 1 改写为 0 (与 NOR Flash 一致)，且支持按字节写入 */
+struct MQTT_StoreDev
+{
+    uint8_t *map;      /* 可直接读取的映射地址 (mmap / 内存映射 Flash)，NULL 表示通过 read 读取 */
+    uint32_t size;     /* 总容量 (字节，segSize 的整数倍) */
+    uint32_t segSize;  /* 段大小 (通常为擦除块大小，至少 2 个段) */
+    bool (*read)(MQTT_StoreDev *dev, uint32_t off, void *buf, uint32_t len);        /* map 为 NULL 时必须实现 */
+    bool (*write)(MQTT_StoreDev *dev, uint32_t off, const void *buf, uint32_t len); /* 写入 */
+    bool (*erase)(MQTT_StoreDev *dev, uint32_t off);                                /* 擦除 off 所在的段 */
+    bool (*sync)(MQTT_StoreDev *dev);                                               /* 落盘 (可为 NULL) */
+    void *ctx;                                                                      /* 后端私有数据 */
+};
+
+/* 队首记录 (指针指向映射区或 MQTT_Store::buf，在 MQTT_StoreConsume 之前有效) */
+typedef struct
+{
+    const char *topic;
+    uint16_t topicLen;
+    const uint8_t *payload;
+    uint16_t payloadLen;
+    uint8_t qos;
+    uint8_t retain;
+} MQTT_StoreRecord;
+
+/* 队列控制块 */
+typedef struct MQTT_Store
+{
+    MQTT_StoreDev *dev;
+    uint8_t *buf;      /* 读取缓冲区 (仅在 dev->map 为 NULL 时使用，决定可读取的最大记录) */
+    uint32_t bufSize;  /* 缓冲区大小 */
+    uint16_t segCount; /* 段数 */
+    uint16_t headSeg;  /* 最早的段 */
+    uint16_t tailSeg;  /* 当前写入的段 */
+    uint32_t seq;      /* 当前写入段的序号 */
+    uint32_t head;     /* 最早未确认记录的位置 (设备内偏移) */
+    uint32_t tail;     /* 下一条记录的写入位置 */
+    uint32_t count;    /* 未确认记录数 */
+} MQTT_Store;
+
+/**
+ * @brief 打开队列：扫描设备恢复上次的队首/队尾 (设备为空时自动格式化)
+ * @param buf     读取缓冲区，dev->map 不为 NULL 时可传 NULL
+ * @return true 成功; false 参数错误或设备读写失败
+ */
+bool MQTT_StoreOpen(MQTT_Store *store, MQTT_StoreDev *dev, uint8_t *buf, uint32_t bufSize);
+
+/**
+ * @brief 追加一条记录 (O(1))，Payload 可由多段组成
+ * @return true 成功; false 队列已满、记录过大或写入失败
+ */
+bool MQTT_StoreAppend(MQTT_Store *store, const char *topic, uint16_t topicLen,
+                      const MQTT_IoVec *payload, size_t n, uint8_t qos, uint8_t retain);
+
+/**
+ * @brief 读取队首记录 (不出队)
+ * @return true 成功; false 队列为空或读取失败
+ */
+bool MQTT_StorePeek(MQTT_Store *store, MQTT_StoreRecord *rec);
+
+/* 确认队首记录 (补发成功后调用)，整段确认完后擦除回收 */
+bool MQTT_StoreConsume(MQTT_Store *store);
+
+/* 未确认记录数 */
+uint32_t MQTT_StoreCount(const MQTT_Store *store);
+
+/* 调用后端 sync 落盘 */
+bool MQTT_StoreSync(MQTT_Store *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_STORE_H__ */
@@ -0,0 +1,368 @@
+#define _GNU_SOURCE
+#include "mqtt_engine.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/* eventfd 在 epoll 中的标识 (客户端使用槽位下标) */
+#define MQTT_ENGINE_EVENT_ID 0xFFFFFFFFu
+
+/* --------------------------------------------------------------------------
+ * 传输层：收发交给 MQTT_PosixTransport，但接收从不等待 (由 epoll 负责等待)
+ * -------------------------------------------------------------------------- */
+
+static void MQTT_EngineSend(void *ctx, const uint8_t *buf, size_t len)
+{
+    MQTT_PosixTransport.send(&((MQTT_EngineConn *)ctx)->sock, buf, len);
+}
+
+static void MQTT_EngineSendV(void *ctx, const MQTT_IoVec *iov, size_t cnt)
+{
+    MQTT_PosixTransport.sendv(&((MQTT_EngineConn *)ctx)->sock, iov, cnt);
+}
+
+static int MQTT_EngineRecv(void *ctx, uint8_t *buf, size_t bufSize, uint32_t timeoutMs)
+{
+    (void)timeoutMs;
+    return MQTT_PosixTransport.recv(&((MQTT_EngineConn *)ctx)->sock, buf, bufSize, 0);
+}
+
+static const MQTT_Transport MQTT_EngineTransport = {
+    MQTT_EngineSend,
+    MQTT_EngineSendV,
+    MQTT_EngineRecv,
+};
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+/* 按客户端的下一个处理时刻重新挂入时间轮 */
+static void MQTT_EngineSchedule(MQTT_Engine *engine, MQTT_EngineConn *conn, uint32_t now)
+{
+    tw_stop(&engine->wheel, &conn->timer);
+    if (conn->sock.fd < 0)
+        return;
+
+    uint32_t wait = MQTT_NextWakeup(conn->client);
+    if (wait == UINT32_MAX)
+        return;
+
+    /* 已到期的时刻由时间轮推迟到下一个 Tick：同一次推进中不会重复触发同一个客户端 */
+    tw_start(&engine->wheel, &conn->timer, now + wait);
+}
+
+/* 接收区满 (流式消息暂停) 时从 epoll 中去掉 EPOLLIN，有空间后再加回：
+ * 水平触发下套接字一直可读，不去掉的话 epoll_wait 立即返回而 MQTT_ProcessLoop 不读取，引擎空转。
+ * 暂停期间由 MQTT_NextWakeup (MQTT_STREAM_RETRY_MS) 的定时器重新交付，交付后在这里恢复监听；
+ * epoll 仍会报告 EPOLLHUP / EPOLLERR，暂停中的连接收到它们时直接关闭 (见 MQTT_EngineRunOnce) */
+static void MQTT_EngineWatchRx(MQTT_Engine *engine, MQTT_EngineConn *conn)
+{
+    bool paused = MQTT_RxBlocked(conn->client);
+    if (paused == conn->rxPaused)
+        return;
+
+    struct epoll_event ev;
+    ev.events = paused ? 0 : (EPOLLIN | EPOLLRDHUP);
+    ev.data.u64 = (uint64_t)(conn - engine->conns);
+    if (epoll_ctl(engine->epfd, EPOLL_CTL_MOD, conn->sock.fd, &ev) != 0)
+        return;
+
+    conn->rxPaused = paused;
+    if (paused)
+        engine->stats.rxPauses++;
+}
+
+/* 连接断开：摘除套接字并通知应用 (槽位保留到 MQTT_EngineRemove) */
+static void MQTT_EngineClose(MQTT_Engine *engine, MQTT_EngineConn *conn)
+{
+    tw_stop(&engine->wheel, &conn->timer);
+    if (conn->sock.fd < 0)
+        return;
+
+    epoll_ctl(engine->epfd, EPOLL_CTL_DEL, conn->sock.fd, NULL);
+    MQTT_PosixClose(&conn->sock);
+    conn->rxPaused = false;
+    conn->client->isConnected = false;
+
+    if (engine->onClose)
+        engine->onClose(engine, conn->client, engine->onCloseCtx);
+}
+
+/* 处理一个客户端：收包、超时重发、回调、心跳，然后重新调度 */
+static void MQTT_EngineService(MQTT_Engine *engine, MQTT_EngineConn *conn)
+{
+    if (!conn->client || conn->sock.fd < 0)
+        return;
+
+    MQTT_ProcessLoop(conn->client);
+
+    if (conn->sock.failed)
+    {
+        MQTT_EngineClose(engine, conn);
+        return;
+    }
+    MQTT_EngineWatchRx(engine, conn);
+    MQTT_EngineSchedule(engine, conn, HAL_MQTT_GetTick());
+}
+
+/* 客户端的处理时刻到期 (时间轮回调) */
+static void MQTT_EngineTimeout(timer_wheel_t *tw, tw_timer_t *timer, void *ctx)
+{
+    MQTT_EngineConn *conn = (MQTT_EngineConn *)ctx;
+    (void)tw;
+    (void)timer;
+
+    conn->engine->stats.timerFires++;
+    MQTT_EngineService(conn->engine, conn);
+}
+
+/* 处理 MQTT_EngineNotify 登记的客户端：重新计算定时器 */
+static void MQTT_EngineDrainPending(MQTT_Engine *engine, uint32_t now)
+{
+    HAL_MQTT_Lock();
+    uint16_t idx = engine->pendingHead;
+    engine->pendingHead = 0;
+    while (idx)
+    {
+        MQTT_EngineConn *conn = &engine->conns[idx - 1];
+        idx = conn->pendingNext;
+        conn->pendingNext = 0;
+        conn->pending = false;
+        if (conn->client)
+            MQTT_EngineSchedule(engine, conn, now);
+    }
+    HAL_MQTT_Unlock();
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+bool MQTT_EngineInit(MQTT_Engine *engine, MQTT_EngineConn *conns, uint16_t capacity)
+{
+    if (!engine || !conns || capacity == 0)
+        return false;
+
+    memset(engine, 0, sizeof(MQTT_Engine));
+    memset(conns, 0, sizeof(MQTT_EngineConn) * capacity);
+    for (uint16_t i = 0; i < capacity; i++)
+        conns[i].sock.fd = -1;
+
+    engine->epfd = epoll_create1(EPOLL_CLOEXEC);
+    engine->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (engine->epfd < 0 || engine->evfd < 0)
+    {
+        if (engine->epfd >= 0)
+            close(engine->epfd);
+        if (engine->evfd >= 0)
+            close(engine->evfd);
+        return false;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = MQTT_ENGINE_EVENT_ID;
+    epoll_ctl(engine->epfd, EPOLL_CTL_ADD, engine->evfd, &ev);
+
+    engine->conns = conns;
+    engine->capacity = capacity;
+    tw_init(&engine->wheel, engine->wheelSlots, MQTT_ENGINE_WHEEL_SLOTS, HAL_MQTT_GetTick());
+    engine->running = true;
+    return true;
+}
+
+void MQTT_EngineDeinit(MQTT_Engine *engine)
+{
+    if (!engine || !engine->conns)
+        return;
+
+    for (uint16_t i = 0; i < engine->capacity; i++)
+    {
+        if (engine->conns[i].client)
+            MQTT_EngineRemove(engine, engine->conns[i].client);
+    }
+    close(engine->evfd);
+    close(engine->epfd);
+    engine->conns = NULL;
+}
+
+bool MQTT_EngineAdd(MQTT_Engine *engine, MQTT_Client *client, const MQTT_PosixSocket *sock)
+{
+    if (!engine || !client || !sock || sock->fd < 0 || engine->count >= engine->capacity)
+        return false;
+
+    MQTT_EngineConn *conn = NULL;
+    for (uint16_t i = 0; i < engine->capacity; i++)
+    {
+        if (!engine->conns[i].client)
+        {
+            conn = &engine->conns[i];
+            break;
+        }
+    }
+    if (!conn)
+        return false;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = (uint64_t)(conn - engine->conns);
+    if (epoll_ctl(engine->epfd, EPOLL_CTL_ADD, sock->fd, &ev) != 0)
+        return false;
+
+    memset(conn, 0, sizeof(MQTT_EngineConn));
+    tw_timer_init(&conn->timer, MQTT_EngineTimeout, conn);
+    conn->engine = engine;
+    conn->sock = *sock;
+    conn->client = client;
+    engine->count++;
+
+    HAL_MQTT_Lock();
+    client->transport = &MQTT_EngineTransport;
+    client->transportCtx = conn;
+    HAL_MQTT_Unlock();
+    return true;
+}
+
+void MQTT_EngineRemove(MQTT_Engine *engine, MQTT_Client *client)
+{
+    if (!engine || !client || client->transport != &MQTT_EngineTransport)
+        return;
+
+    MQTT_EngineConn *conn = (MQTT_EngineConn *)client->transportCtx;
+    if (conn->engine != engine || conn->client != client)
+        return;
+
+    tw_stop(&engine->wheel, &conn->timer);
+    if (conn->sock.fd >= 0)
+    {
+        epoll_ctl(engine->epfd, EPOLL_CTL_DEL, conn->sock.fd, NULL);
+        MQTT_PosixClose(&conn->sock);
+    }
+
+    HAL_MQTT_Lock();
+    /* 从待重新调度链表中摘除，避免槽位复用后链表错乱 */
+    uint16_t self = (uint16_t)(conn - engine->conns) + 1;
+    for (uint16_t *p = &engine->pendingHead; *p; p = &engine->conns[*p - 1].pendingNext)
+    {
+        if (*p == self)
+        {
+            *p = conn->pendingNext;
+            break;
+        }
+    }
+    conn->pending = false;
+    conn->client = NULL;
+    client->transport = NULL;
+    client->transportCtx = NULL;
+    client->isConnected = false;
+    HAL_MQTT_Unlock();
+
+    engine->count--;
+}
+
+void MQTT_EngineNotify(MQTT_Engine *engine, MQTT_Client *client)
+{
+    if (!engine || !client || client->transport != &MQTT_EngineTransport)
+        return;
+
+    MQTT_EngineConn *conn = (MQTT_EngineConn *)client->transportCtx;
+    bool wake = false;
+
+    HAL_MQTT_Lock();
+    if (!conn->pending && conn->client == client)
+    {
+        conn->pending = true;
+        conn->pendingNext = engine->pendingHead;
+        wake = (engine->pendingHead == 0); /* 链表原本为空才需要唤醒，避免重复写 eventfd */
+        engine->pendingHead = (uint16_t)(conn - engine->conns) + 1;
+        engine->stats.notifies++;
+    }
+    HAL_MQTT_Unlock();
+
+    if (wake)
+    {
+        uint64_t one = 1;
+        ssize_t ret = write(engine->evfd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+int MQTT_EngineRunOnce(MQTT_Engine *engine, uint32_t maxWaitMs)
+{
+    struct epoll_event events[MQTT_ENGINE_MAX_EVENTS];
+    int handled = 0;
+
+    if (!engine || !engine->conns)
+        return -1;
+
+    /* 1. 等待套接字事件，最长到最近的定时器 */
+    uint32_t wait = tw_next_delay(&engine->wheel, HAL_MQTT_GetTick());
+    if (wait > maxWaitMs)
+        wait = maxWaitMs;
+    if (wait > INT32_MAX)
+        wait = INT32_MAX;
+
+    int n = epoll_wait(engine->epfd, events, MQTT_ENGINE_MAX_EVENTS, (int)wait);
+    if (n < 0 && errno != EINTR)
+        return -1;
+    engine->stats.loops++;
+
+    /* 2. 处理可读 (或出错/对端关闭，由 ProcessLoop 读到错误后关闭) 的客户端 */
+    for (int i = 0; i < n; i++)
+    {
+        if (events[i].data.u64 == MQTT_ENGINE_EVENT_ID)
+        {
+            uint64_t value;
+            ssize_t ret = read(engine->evfd, &value, sizeof(value));
+            (void)ret;
+            continue;
+        }
+
+        MQTT_EngineConn *conn = &engine->conns[events[i].data.u64];
+        engine->stats.ioEvents++;
+        handled++;
+
+        /* 接收区已满时 MQTT_ProcessLoop 不读取，读不到错误，挂断/出错的事件会一直水平触发：直接关闭 */
+        if (conn->rxPaused && (events[i].events & (EPOLLHUP | EPOLLERR)))
+        {
+            MQTT_EngineClose(engine, conn);
+            continue;
+        }
+        MQTT_EngineService(engine, conn);
+    }
+
+    /* 3. 其他线程提交了请求：更新定时器 */
+    uint32_t now = HAL_MQTT_GetTick();
+    if (engine->pendingHead)
+        MQTT_EngineDrainPending(engine, now);
+
+    /* 4. 到期的定时器 */
+    handled += (int)tw_advance(&engine->wheel, now);
+    return handled;
+}
+
+void MQTT_EngineRun(MQTT_Engine *engine)
+{
+    if (!engine)
+        return;
+
+    while (engine->running)
+    {
+        if (MQTT_EngineRunOnce(engine, 1000) < 0)
+            break;
+    }
+}
+
+void MQTT_EngineStop(MQTT_Engine *engine)
+{
+    if (!engine)
+        return;
+
+    engine->running = false;
+    uint64_t one = 1;
+    ssize_t ret = write(engine->evfd, &one, sizeof(one));
+    (void)ret;
+}
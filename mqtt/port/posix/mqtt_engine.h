@@ -0,0 +1,119 @@
+#ifndef __MQTT_ENGINE_H__
+#define __MQTT_ENGINE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "mqtt_posix.h"
+#include "../../../timer_wheel/timer_wheel.h"
+
+/* ============================================================
+ * 多客户端事件引擎 (Linux epoll)
+ * 一个事件循环驱动任意多个 MQTT_Client：套接字可读时处理该客户端，
+ * 请求超时、心跳、批处理等待等时刻由共享的时间轮触发，空闲客户端不消耗 CPU。
+ * 每个客户端只占用一个 MQTT_EngineConn (几十字节)，不需要独立线程。
+ * 多核：创建多个引擎，各自在一个线程中运行 MQTT_EngineRun，把客户端分配到不同引擎。
+ * ============================================================ */
+
+/* 引擎时间轮 (timer_wheel) 槽数 (2 的幂，1 槽 = 1ms；超过一圈的定时器按圈数留在槽内) */
+#ifndef MQTT_ENGINE_WHEEL_SLOTS
+#define MQTT_ENGINE_WHEEL_SLOTS 1024
+#endif
+
+#if (MQTT_ENGINE_WHEEL_SLOTS & (MQTT_ENGINE_WHEEL_SLOTS - 1)) != 0
+#error "MQTT_ENGINE_WHEEL_SLOTS must be a power of 2"
+#endif
+
+/* 每次 epoll_wait 最多取出的事件数 */
+#ifndef MQTT_ENGINE_MAX_EVENTS
+#define MQTT_ENGINE_MAX_EVENTS 64
+#endif
+
+typedef struct MQTT_Engine MQTT_Engine;
+
+/* 连接断开通知：在引擎线程中调用，此时套接字已关闭，可调用 MQTT_EngineRemove 释放槽位后重连 */
+typedef void (*MQTT_EngineCloseHandler)(MQTT_Engine *engine, MQTT_Client *client, void *ctx);
+
+/* 每个客户端的引擎槽位 (由用户提供数组) */
+typedef struct
+{
+    MQTT_Client *client;    /* NULL 表示空闲 */
+    MQTT_Engine *engine;
+    MQTT_PosixSocket sock;  /* 引擎接管的套接字 */
+    tw_timer_t timer;       /* 下一次需要处理该客户端的时刻 (MQTT_NextWakeup) */
+    uint16_t pendingNext;   /* 待重新调度链表 (MQTT_EngineNotify) */
+    bool pending;           /* 是否在待重新调度链表中 */
+    bool rxPaused;          /* 接收区已满，暂时不监听可读事件 */
+} MQTT_EngineConn;
+
+/* 引擎统计 */
+typedef struct
+{
+    uint64_t loops;      /* 事件循环次数 */
+    uint64_t ioEvents;   /* 套接字可读事件 */
+    uint64_t timerFires; /* 定时器到期 */
+    uint64_t notifies;   /* 跨线程通知 */
+    uint64_t rxPauses;   /* 接收区满而暂停监听可读事件的次数 */
+} MQTT_EngineStats;
+
+/* 引擎控制块 */
+struct MQTT_Engine
+{
+    int epfd;                 /* epoll 实例 */
+    int evfd;                 /* eventfd：跨线程唤醒 */
+    MQTT_EngineConn *conns;   /* 槽位数组 */
+    uint16_t capacity;        /* 槽位数 */
+    uint16_t count;           /* 已使用槽位数 */
+    timer_wheel_t wheel;      /* 所有客户端共用的时间轮 */
+    tw_timer_t *wheelSlots[MQTT_ENGINE_WHEEL_SLOTS];
+    uint16_t pendingHead;     /* 待重新调度链表头 (由 HAL_MQTT_Lock 保护) */
+    volatile bool running;
+    MQTT_EngineCloseHandler onClose; /* 可选 */
+    void *onCloseCtx;
+    MQTT_EngineStats stats;
+};
+
+/**
+ * @brief 初始化引擎
+ * @param conns    槽位数组 (每个客户端一个)
+ * @param capacity 槽位数 (上限 65535)
+ * @return true 成功; false 参数错误或创建 epoll/eventfd 失败
+ */
+bool MQTT_EngineInit(MQTT_Engine *engine, MQTT_EngineConn *conns, uint16_t capacity);
+
+/* 释放引擎 (关闭所有仍在引擎中的套接字) */
+void MQTT_EngineDeinit(MQTT_Engine *engine);
+
+/**
+ * @brief 把已连接的客户端加入引擎：引擎接管套接字，并设置 client->transport
+ * 加入后在任意线程 MQTT_Submit (如 CONNECT)，再调用 MQTT_EngineNotify
+ * @return true 成功; false 槽位已满或套接字无效
+ */
+bool MQTT_EngineAdd(MQTT_Engine *engine, MQTT_Client *client, const MQTT_PosixSocket *sock);
+
+/* 移出引擎并关闭套接字 (需在引擎线程中调用，或在引擎停止后调用) */
+void MQTT_EngineRemove(MQTT_Engine *engine, MQTT_Client *client);
+
+/* 提交请求后通知引擎重新计算该客户端的定时器 (线程安全；在引擎回调中提交时也可调用) */
+void MQTT_EngineNotify(MQTT_Engine *engine, MQTT_Client *client);
+
+/**
+ * @brief 运行一次事件循环：等待套接字事件或最近的定时器，处理后返回
+ * @param maxWaitMs 最长等待时间
+ * @return 本次处理的客户端数; -1 表示 epoll 出错
+ */
+int MQTT_EngineRunOnce(MQTT_Engine *engine, uint32_t maxWaitMs);
+
+/* 循环运行直到 MQTT_EngineStop */
+void MQTT_EngineRun(MQTT_Engine *engine);
+
+/* 停止 MQTT_EngineRun (线程安全) */
+void MQTT_EngineStop(MQTT_Engine *engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_ENGINE_H__ */
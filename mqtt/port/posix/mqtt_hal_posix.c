@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mqtt_posix.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ============================================================
+ * 全局 HAL 的 POSIX 实现 (强定义，覆盖 mqtt_hal.c 中的弱定义)
+ * 定义 MQTT_POSIX_LOG 时日志输出到 stderr
+ * ============================================================ */
+
+static MQTT_PosixSocket *s_defaultSock;
+
+/* 递归锁：同一线程在回调中再次提交请求时不会自锁 */
+static pthread_mutex_t s_lock;
+static pthread_once_t s_lockOnce = PTHREAD_ONCE_INIT;
+
+static void MQTT_PosixLockInit(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void MQTT_PosixSetDefault(MQTT_PosixSocket *sock)
+{
+    s_defaultSock = sock;
+}
+
+void HAL_MQTT_Init(void)
+{
+    pthread_once(&s_lockOnce, MQTT_PosixLockInit);
+}
+
+void HAL_MQTT_Send(const uint8_t *buf, size_t len)
+{
+    if (s_defaultSock)
+        MQTT_PosixTransport.send(s_defaultSock, buf, len);
+}
+
+void HAL_MQTT_SendV(const MQTT_IoVec *iov, size_t cnt)
+{
+    if (s_defaultSock)
+        MQTT_PosixTransport.sendv(s_defaultSock, iov, cnt);
+}
+
+int HAL_MQTT_Recv(uint8_t *buf, size_t bufSize, uint32_t timeoutMs)
+{
+    if (!s_defaultSock)
+    {
+        HAL_MQTT_Delay(timeoutMs);
+        return 0;
+    }
+    return MQTT_PosixTransport.recv(s_defaultSock, buf, bufSize, timeoutMs);
+}
+
+void HAL_MQTT_Log(const char *fmt, ...)
+{
+#ifdef MQTT_POSIX_LOG
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+#else
+    (void)fmt;
+#endif
+}
+
+uint32_t HAL_MQTT_GetTick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+void HAL_MQTT_Delay(uint32_t ms)
+{
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+void HAL_MQTT_Lock(void)
+{
+    pthread_once(&s_lockOnce, MQTT_PosixLockInit);
+    pthread_mutex_lock(&s_lock);
+}
+
+void HAL_MQTT_Unlock(void)
+{
+    pthread_mutex_unlock(&s_lock);
+}
+
+/* waiter 为 MQTT_PosixWaiter：eventfd 计数累加，先通知后等待也不会丢失 */
+void HAL_MQTT_Notify(void *waiter)
+{
+    MQTT_PosixWaiter *w = (MQTT_PosixWaiter *)waiter;
+    uint64_t one = 1;
+
+    if (w && w->fd >= 0)
+    {
+        ssize_t ret = write(w->fd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+void HAL_MQTT_Wait(void *waiter, uint32_t timeoutMs)
+{
+    MQTT_PosixWaiter *w = (MQTT_PosixWaiter *)waiter;
+
+    if (!w || w->fd < 0)
+    {
+        HAL_MQTT_Delay(timeoutMs < 1 ? timeoutMs : 1);
+        return;
+    }
+
+    struct pollfd pfd = {w->fd, POLLIN, 0};
+    if (poll(&pfd, 1, (int)timeoutMs) > 0)
+    {
+        uint64_t value;
+        ssize_t ret = read(w->fd, &value, sizeof(value));
+        (void)ret;
+    }
+}
@@ -0,0 +1,312 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mqtt_posix.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+static bool MQTT_PosixSetNonBlock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/* 等待套接字就绪，返回 >0 就绪; 0 超时; <0 出错 */
+static int MQTT_PosixWait(int fd, short events, uint32_t timeoutMs)
+{
+    struct pollfd pfd = {fd, events, 0};
+    int ret;
+
+    do
+    {
+        ret = poll(&pfd, 1, (int)timeoutMs);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret > 0 && (pfd.revents & (POLLERR | POLLNVAL)))
+        return -1;
+    return ret;
+}
+
+/* 等待套接字可读或等待者被通知，返回 >0 可读; 0 超时或被通知; <0 出错 */
+static int MQTT_PosixWaitReadable(MQTT_PosixSocket *sock, uint32_t timeoutMs)
+{
+    if (!sock->wake || sock->wake->fd < 0)
+        return MQTT_PosixWait(sock->fd, POLLIN, timeoutMs);
+
+    struct pollfd pfd[2] = {{sock->fd, POLLIN, 0}, {sock->wake->fd, POLLIN, 0}};
+    int ret;
+
+    do
+    {
+        ret = poll(pfd, 2, (int)timeoutMs);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret > 0 && (pfd[0].revents & (POLLERR | POLLNVAL)))
+        return -1;
+    if (ret > 0 && (pfd[1].revents & POLLIN))
+    {
+        /* 清零计数，本次接收按超时返回，由调用者处理新提交的命令 */
+        uint64_t value;
+        ssize_t n = read(sock->wake->fd, &value, sizeof(value));
+        (void)n;
+        if (!(pfd[0].revents & POLLIN))
+            return 0;
+    }
+    return ret > 0 ? 1 : ret;
+}
+
+/* 把 iov 全部写出：内核发送缓冲区满时等待可写，写出一部分时调整数据段继续写 */
+static bool MQTT_PosixWriteAll(MQTT_PosixSocket *sock, struct iovec *iov, int cnt)
+{
+    while (cnt > 0)
+    {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)cnt;
+
+        ssize_t n = sendmsg(sock->fd, &msg, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+                MQTT_PosixWait(sock->fd, POLLOUT, MQTT_POSIX_SEND_TIMEOUT_MS) > 0)
+                continue;
+            return false;
+        }
+
+        /* 跳过已写完的数据段 */
+        while (cnt > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return true;
+}
+
+/* --------------------------------------------------------------------------
+ * 传输层接口
+ * -------------------------------------------------------------------------- */
+
+static void MQTT_PosixSend(void *ctx, const uint8_t *buf, size_t len)
+{
+    MQTT_PosixSocket *sock = (MQTT_PosixSocket *)ctx;
+    struct iovec iov = {(void *)buf, len};
+
+    if (sock->fd < 0 || sock->failed)
+        return;
+
+    /* 业务线程与接收线程可能同时发送，整包写出期间持锁，避免报文交错 (锁可重入) */
+    HAL_MQTT_Lock();
+    if (!MQTT_PosixWriteAll(sock, &iov, 1))
+        sock->failed = true;
+    HAL_MQTT_Unlock();
+}
+
+static void MQTT_PosixSendV(void *ctx, const MQTT_IoVec *iov, size_t cnt)
+{
+    MQTT_PosixSocket *sock = (MQTT_PosixSocket *)ctx;
+    struct iovec vec[16];
+
+    if (sock->fd < 0 || sock->failed)
+        return;
+
+    /* MQTT_IoVec 与 struct iovec 布局一致，这里复制一份以便写出一部分时原地调整 */
+    HAL_MQTT_Lock();
+    while (cnt > 0)
+    {
+        int n = (cnt > 16) ? 16 : (int)cnt;
+        for (int i = 0; i < n; i++)
+        {
+            vec[i].iov_base = (void *)iov[i].base;
+            vec[i].iov_len = iov[i].len;
+        }
+        if (!MQTT_PosixWriteAll(sock, vec, n))
+        {
+            sock->failed = true;
+            break;
+        }
+        iov += n;
+        cnt -= (size_t)n;
+    }
+    HAL_MQTT_Unlock();
+}
+
+static int MQTT_PosixRecv(void *ctx, uint8_t *buf, size_t bufSize, uint32_t timeoutMs)
+{
+    MQTT_PosixSocket *sock = (MQTT_PosixSocket *)ctx;
+
+    if (sock->fd < 0 || sock->failed)
+        return -1;
+
+    for (;;)
+    {
+        ssize_t n = recv(sock->fd, buf, bufSize, 0);
+        if (n > 0)
+            return (int)n;
+        if (n == 0)
+        {
+            /* 对端关闭 */
+            sock->failed = true;
+            return -1;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            sock->failed = true;
+            return -1;
+        }
+
+        /* 暂无数据：等待可读或超时 */
+        int ret = MQTT_PosixWaitReadable(sock, timeoutMs);
+        if (ret == 0)
+            return 0;
+        if (ret < 0)
+        {
+            sock->failed = true;
+            return -1;
+        }
+        timeoutMs = 0;
+    }
+}
+
+const MQTT_Transport MQTT_PosixTransport = {
+    MQTT_PosixSend,
+    MQTT_PosixSendV,
+    MQTT_PosixRecv,
+};
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+bool MQTT_PosixConnectTcp(MQTT_PosixSocket *sock, const char *host, uint16_t port, uint32_t timeoutMs)
+{
+    if (!sock || !host)
+        return false;
+
+    sock->fd = -1;
+    sock->failed = false;
+    sock->wake = NULL;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+
+    struct addrinfo hints, *res, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &res) != 0)
+        return false;
+
+    for (ai = res; ai; ai = ai->ai_next)
+    {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        if (MQTT_PosixSetNonBlock(fd))
+        {
+            int ret = connect(fd, ai->ai_addr, ai->ai_addrlen);
+            if (ret != 0 && errno == EINPROGRESS && MQTT_PosixWait(fd, POLLOUT, timeoutMs) > 0)
+            {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+                    ret = 0;
+            }
+
+            if (ret == 0)
+            {
+                /* MQTT 报文小而频繁，关闭 Nagle 避免 ACK 被延迟合并 */
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                sock->fd = fd;
+                break;
+            }
+        }
+        close(fd);
+    }
+
+    freeaddrinfo(res);
+    return sock->fd >= 0;
+}
+
+bool MQTT_PosixConnectUnix(MQTT_PosixSocket *sock, const char *path)
+{
+    if (!sock || !path)
+        return false;
+
+    sock->fd = -1;
+    sock->failed = false;
+    sock->wake = NULL;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return false;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+
+    /* 本机连接立即完成，连接后再切换为非阻塞 */
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || !MQTT_PosixSetNonBlock(fd))
+    {
+        close(fd);
+        return false;
+    }
+
+    sock->fd = fd;
+    return true;
+}
+
+void MQTT_PosixClose(MQTT_PosixSocket *sock)
+{
+    if (!sock || sock->fd < 0)
+        return;
+
+    close(sock->fd);
+    sock->fd = -1;
+}
+
+bool MQTT_PosixWaiterInit(MQTT_PosixWaiter *waiter)
+{
+    if (!waiter)
+        return false;
+
+    waiter->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return waiter->fd >= 0;
+}
+
+void MQTT_PosixWaiterClose(MQTT_PosixWaiter *waiter)
+{
+    if (!waiter || waiter->fd < 0)
+        return;
+
+    close(waiter->fd);
+    waiter->fd = -1;
+}
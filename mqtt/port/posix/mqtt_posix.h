@@ -0,0 +1,66 @@
+#ifndef __MQTT_POSIX_H__
+#define __MQTT_POSIX_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "../../mqtt.h"
+
+/* ============================================================
+ * Linux / POSIX 移植层
+ * - 非阻塞 TCP / Unix 域套接字，poll 实现带超时的收发
+ * - MQTT_PosixTransport：按客户端设置的传输层，一个进程可运行多个客户端
+ * - mqtt_hal_posix.c：全局 HAL 的强定义 (时钟、延时、互斥锁、eventfd 唤醒，以及默认套接字上的收发)
+ * ============================================================ */
+
+/* 发送缓冲区满时等待可写的最长时间 (毫秒)，超时视为连接失效 */
+#ifndef MQTT_POSIX_SEND_TIMEOUT_MS
+#define MQTT_POSIX_SEND_TIMEOUT_MS 5000
+#endif
+
+/* 等待者 (eventfd)：作为 HAL_MQTT_Notify / HAL_MQTT_Wait 的 waiter 参数 (MQTT_Channel::waiter、client->ioWaiter) */
+typedef struct
+{
+    int fd; /* eventfd (-1 表示未初始化) */
+} MQTT_PosixWaiter;
+
+/* 套接字句柄 */
+typedef struct
+{
+    int fd;       /* 套接字 (-1 表示未连接) */
+    bool failed;  /* 收发出错或对端关闭，需要重新连接 */
+    MQTT_PosixWaiter *wake; /* 可选：接收等待期间该等待者被通知时提前返回 (连接后设置为 client->ioWaiter) */
+} MQTT_PosixSocket;
+
+/**
+ * @brief 连接 TCP 服务器 (非阻塞连接，带超时)
+ * @param host      主机名或 IP
+ * @param port      端口
+ * @param timeoutMs 连接超时
+ * @return true 成功; false 解析或连接失败
+ */
+bool MQTT_PosixConnectTcp(MQTT_PosixSocket *sock, const char *host, uint16_t port, uint32_t timeoutMs);
+
+/* 连接 Unix 域套接字 (本机压测时可避开 TCP 协议栈开销) */
+bool MQTT_PosixConnectUnix(MQTT_PosixSocket *sock, const char *path);
+
+/* 关闭套接字 */
+void MQTT_PosixClose(MQTT_PosixSocket *sock);
+
+/* 传输层实现：client.transport = &MQTT_PosixTransport; client.transportCtx = &sock; */
+extern const MQTT_Transport MQTT_PosixTransport;
+
+/* 创建 / 释放等待者 */
+bool MQTT_PosixWaiterInit(MQTT_PosixWaiter *waiter);
+void MQTT_PosixWaiterClose(MQTT_PosixWaiter *waiter);
+
+/* 全局 HAL (mqtt_hal_posix.c) 使用的默认套接字，单客户端程序设置后即可不使用 transport */
+void MQTT_PosixSetDefault(MQTT_PosixSocket *sock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_POSIX_H__ */
@@ -0,0 +1,79 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mqtt_store_mmap.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool MQTT_MmapWrite(MQTT_StoreDev *dev, uint32_t off, const void *buf, uint32_t len)
+{
+    memcpy(dev->map + off, buf, len);
+    return true;
+}
+
+static bool MQTT_MmapErase(MQTT_StoreDev *dev, uint32_t off)
+{
+    uint32_t start = off - off % dev->segSize;
+    memset(dev->map + start, 0xFF, dev->segSize);
+    return true;
+}
+
+static bool MQTT_MmapSync(MQTT_StoreDev *dev)
+{
+    return msync(dev->map, dev->size, MS_SYNC) == 0;
+}
+
+bool MQTT_StoreMmapOpen(MQTT_StoreDev *dev, const char *path, uint32_t size, uint32_t segSize)
+{
+    if (!dev || !path || segSize == 0 || size % segSize != 0)
+        return false;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    /* 新文件：扩展到指定大小，映射后整体填充为擦除状态 */
+    bool fresh = (st.st_size == 0);
+    if ((fresh && ftruncate(fd, (off_t)size) != 0) || (!fresh && st.st_size != (off_t)size))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    if (fresh)
+        memset(map, 0xFF, size);
+
+    memset(dev, 0, sizeof(MQTT_StoreDev));
+    dev->map = (uint8_t *)map;
+    dev->size = size;
+    dev->segSize = segSize;
+    dev->write = MQTT_MmapWrite;
+    dev->erase = MQTT_MmapErase;
+    dev->sync = MQTT_MmapSync;
+    dev->ctx = (void *)(intptr_t)fd;
+    return true;
+}
+
+void MQTT_StoreMmapClose(MQTT_StoreDev *dev)
+{
+    if (!dev || !dev->map)
+        return;
+
+    munmap(dev->map, dev->size);
+    close((int)(intptr_t)dev->ctx);
+    dev->map = NULL;
+}
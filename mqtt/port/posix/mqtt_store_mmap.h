@@ -0,0 +1,35 @@
+#ifndef __MQTT_STORE_MMAP_H__
+#define __MQTT_STORE_MMAP_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "../../mqtt_store.h"
+
+/* ============================================================
+ * 离线队列的 Linux 后端：把日志文件 mmap 到内存 (MAP_SHARED)
+ * 读取直接访问映射区 (零拷贝)；进程崩溃时已写入的数据由内核保留，
+ * 需要抵御掉电时调用 MQTT_StoreSync (msync)。
+ * 会话日志 (mqtt_session) 使用同一设备接口，用另一个文件打开即可。
+ * ============================================================ */
+
+/**
+ * @brief 打开 (或创建) 日志文件并映射
+ * @param dev     设备描述 (由本函数填写)
+ * @param path    文件路径
+ * @param size    文件大小 (segSize 的整数倍；已有文件大小不一致时返回失败)
+ * @param segSize 段大小 (建议为页大小的整数倍，如 64KB)
+ * @return true 成功; false 打开/映射失败
+ */
+bool MQTT_StoreMmapOpen(MQTT_StoreDev *dev, const char *path, uint32_t size, uint32_t segSize);
+
+/* 解除映射并关闭文件 */
+void MQTT_StoreMmapClose(MQTT_StoreDev *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_STORE_MMAP_H__ */
@@ -0,0 +1,1219 @@
+/* ============================================================
+ * mqtt_bench：基于 MQTT_Client 的压测工具 (Linux)
+ * 启动 N 个客户端线程，各自按设定速率发布到 bench/<序号>，并可订阅自己的 Topic，
+ * 统计 发布->确认、发布->收到 的延迟分布 (微秒) 以及消息/字节吞吐。
+ * -w 设置每个客户端的 QoS 1/2 在途窗口 (默认 64)，配合 -r 0 与 -L 观察吞吐随窗口的变化。
+ * -5 使用 MQTT 5 并启用主题别名，报告别名节省的上行字节 (可配合 -T 模拟长 Topic)。
+ * -B 为每个客户端启用上行令牌桶限速，报告等待令牌的时间与队列峰值。
+ * -E 只比较报文编码的 CPU 开销 (MQTT_BuildPublishPacket 与发布模板)，不建立连接。
+ * -P 比较遥测 Payload 的 JSON (snprintf) 与 CBOR 编码：大小、编码耗时与 CBOR 解码耗时，不建立连接。
+ * -Z 用几种样本数据测量 Payload 压缩 (mqtt_compress / lzss) 的压缩率与压缩、解压吞吐，不建立连接。
+ * -F 注册 1 万条订阅过滤器，比较订阅分发器 (mqtt_router) 与逐条匹配过滤器的每条消息耗时，不建立连接。
+ * 未指定服务器时在进程内启动 tools/mqtt_broker 作为服务器，可注入延迟和丢包。
+ *
+ * 编译 (在 mqtt 目录下)：
+ *   gcc -std=c99 -O2 -pthread -DMQTT_ENABLE_ROUTER=1 -DMQTT_ENABLE_COMPRESS=1 tools/mqtt_bench.c tools/mqtt_broker.c \
+ *       mqtt.c mqtt_hal.c mqtt_router.c mqtt_compress.c port/posix/mqtt_posix.c port/posix/mqtt_hal_posix.c \
+ *       ../CRC_Lib/CRC_Lib.c ../cbor/cbor.c ../lzss/lzss.c -o mqtt_bench
+ * ============================================================ */
+#define _POSIX_C_SOURCE 200809L
+#include "../mqtt.h"
+#include "../port/posix/mqtt_posix.h"
+#include "mqtt_broker.h"
+#include "../../cbor/cbor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* 每个客户端的 QoS 1/2 在途窗口：默认大小与上限 (-w，2 的幂) */
+#define BENCH_WINDOW 64
+#define BENCH_WINDOW_MAX 16384
+
+/* 最大 Payload (含 8 字节时间戳) */
+#define BENCH_PAYLOAD_MAX 16384
+
+/* 接收缓冲区：环形区 + 拼接区，能容纳最大 Payload 的报文 */
+#define BENCH_RX_SIZE (2 * 32768)
+
+/* Topic 最大长度 (-T) 与每个客户端的主题别名表大小 */
+#define BENCH_TOPIC_MAX 200
+#define BENCH_ALIASES 4
+
+typedef struct
+{
+    const char *host;    /* 服务器地址 (NULL 表示进程内 Broker) */
+    uint16_t port;       /* 服务器端口 */
+    const char *unixPath;
+    int clients;         /* 客户端数 */
+    uint32_t rate;       /* 每个客户端每秒发布数 (0 表示不限速，受在途窗口限制) */
+    uint32_t size;       /* Payload 大小 */
+    uint8_t qos;         /* 发布与订阅的 QoS */
+    bool subscribe;      /* 是否订阅自己的 Topic (统计发布->收到延迟) */
+    uint32_t seconds;    /* 压测时长 */
+    uint32_t window;     /* 每个客户端的在途窗口 (0 表示 BENCH_WINDOW) */
+    uint32_t latencyMs;  /* 进程内 Broker 的注入延迟 */
+    uint8_t lossPct;     /* 进程内 Broker 的丢包率 */
+    uint8_t reorderPct;  /* 进程内 Broker 的乱序率 */
+    uint16_t receiveMax; /* 进程内 Broker 声明的 Receive Maximum (MQTT 5，0 表示不声明) */
+    bool v5;             /* 使用 MQTT 5 并启用主题别名 */
+    uint32_t topicLen;   /* Topic 长度 (0 表示 bench/<序号>) */
+    uint32_t byteRate;   /* 每个客户端的上行限速 (字节/秒，0 表示不限) */
+    bool encodeOnly;     /* 只测报文编码耗时 */
+    bool payloadCodec;   /* 只比较 Payload 编码 (JSON / CBOR) */
+    bool compress;       /* 只测 Payload 压缩率与吞吐 */
+    bool router;         /* 只测订阅分发器的匹配耗时 */
+} BenchConfig;
+
+/* 在途发布的时间戳槽：Payload 前 8 字节直接引用 stampUs，
+ * 数据段数组也放在槽里 (QoS > 0 或限速排队时库会保存 iov 指针，需保持有效直到回调) */
+typedef struct
+{
+    uint64_t stampUs;
+    MQTT_IoVec iov[2];
+    int16_t next; /* 空闲链表 */
+} BenchSlot;
+
+typedef struct
+{
+    int id;
+    pthread_t thread;
+    MQTT_Client client;
+    MQTT_PosixSocket sock;
+    MQTT_Router router;
+    uint8_t routerArena[MQTT_ROUTER_ARENA_SIZE(4, BENCH_TOPIC_MAX + 8)];
+    MQTT_Request *inflight; /* 在途窗口 (window 项) */
+    MQTT_TopicAlias aliases[BENCH_ALIASES];
+    BenchSlot *slots;       /* 与在途窗口同样多的时间戳槽 */
+    int16_t freeSlot;
+    char topic[BENCH_TOPIC_MAX + 1];
+    char clientId[24];
+    uint8_t txBuf[512];
+    uint8_t rxBuf[BENCH_RX_SIZE];
+    uint8_t topicBuf[BENCH_TOPIC_MAX + 1];
+    char payloadBuf[BENCH_PAYLOAD_MAX + 1];
+    bool ok; /* 连接与订阅成功 */
+
+    uint64_t sent;
+    uint64_t acked;
+    uint64_t failed;
+    uint64_t received;
+    uint64_t pubUs; /* 发布阶段耗时 (不含结束后的等待) */
+    MQTT_Histogram ackHist;  /* 发布->确认 (微秒) */
+    MQTT_Histogram recvHist; /* 发布->收到 (微秒) */
+} BenchClient;
+
+static BenchConfig g_cfg = {.port = 1883, .clients = 4, .rate = 1000, .size = 64, .qos = 1, .subscribe = true, .seconds = 5};
+static uint8_t g_pad[BENCH_PAYLOAD_MAX];
+static volatile bool g_stop;
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+static uint64_t BenchNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void BenchHistMerge(MQTT_Histogram *dst, const MQTT_Histogram *src)
+{
+    if (src->total == 0)
+        return;
+    for (uint32_t i = 0; i < MQTT_HIST_BUCKETS; i++)
+        dst->counts[i] += src->counts[i];
+    if (dst->total == 0 || src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+static void BenchHistPrint(const char *name, const MQTT_Histogram *h)
+{
+    if (h->total == 0)
+    {
+        printf("  %-14s no samples\n", name);
+        return;
+    }
+    printf("  %-14s n=%-9u min=%-7u avg=%-7llu p50=%-7u p99=%-7u p999=%-7u max=%u (us)\n", name,
+           (unsigned)h->total, (unsigned)h->min, (unsigned long long)(h->sum / h->total),
+           (unsigned)MQTT_HistogramPercentile(h, 5000), (unsigned)MQTT_HistogramPercentile(h, 9900),
+           (unsigned)MQTT_HistogramPercentile(h, 9990), (unsigned)h->max);
+}
+
+/* 发布完成回调：ctx 为时间戳槽 */
+static void BenchOnPublished(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx)
+{
+    BenchClient *bc = (BenchClient *)((uint8_t *)client - offsetof(BenchClient, client));
+    BenchSlot *slot = (BenchSlot *)ctx;
+    (void)op;
+
+    if (result == MQTT_RESULT_OK)
+    {
+        bc->acked++;
+        MQTT_HistogramRecord(&bc->ackHist, (uint32_t)(BenchNowUs() - slot->stampUs));
+    }
+    else
+    {
+        bc->failed++;
+    }
+
+    slot->next = bc->freeSlot;
+    bc->freeSlot = (int16_t)(slot - bc->slots);
+}
+
+/* 收到自己发布的消息：Payload 前 8 字节为发送时刻 */
+static void BenchOnMessage(MQTT_Client *client, const char *topic, const char *payload, size_t len, void *ctx)
+{
+    BenchClient *bc = (BenchClient *)ctx;
+    uint64_t stamp;
+    (void)client;
+    (void)topic;
+
+    if (len < sizeof(stamp))
+        return;
+    memcpy(&stamp, payload, sizeof(stamp));
+    bc->received++;
+    MQTT_HistogramRecord(&bc->recvHist, (uint32_t)(BenchNowUs() - stamp));
+}
+
+static void BenchOnDone(MQTT_Client *client, MQTT_Operation op, MQTT_Result result, void *ctx)
+{
+    (void)client;
+    (void)op;
+    *(volatile int *)ctx = (int)result;
+}
+
+/* 提交一个操作并驱动 ProcessLoop 直到完成 (本线程就是接收线程，不能用 MQTT_TryOperation) */
+static bool BenchRun(BenchClient *bc, MQTT_Operation op)
+{
+    volatile int result = -1;
+    if (!MQTT_Submit(&bc->client, op, BenchOnDone, (void *)&result))
+        return false;
+    while (result < 0)
+        MQTT_ProcessLoop(&bc->client);
+    return result == MQTT_RESULT_OK;
+}
+
+static bool BenchConnect(BenchClient *bc, uint16_t port)
+{
+    if (g_cfg.unixPath)
+        return MQTT_PosixConnectUnix(&bc->sock, g_cfg.unixPath);
+    return MQTT_PosixConnectTcp(&bc->sock, g_cfg.host ? g_cfg.host : "127.0.0.1", port, 3000);
+}
+
+static void *BenchThread(void *arg)
+{
+    BenchClient *bc = (BenchClient *)arg;
+    MQTT_Client *c = &bc->client;
+    uint32_t payloadLen = g_cfg.size < 8 ? 8 : g_cfg.size;
+
+    for (uint32_t i = 0; i < g_cfg.window; i++)
+        bc->slots[i].next = (int16_t)(i + 1 < g_cfg.window ? (int32_t)i + 1 : -1);
+    bc->freeSlot = 0;
+
+    if (!BenchRun(bc, MQTT_OP_CONNECT))
+        return NULL;
+    if (g_cfg.subscribe)
+    {
+        c->subTopic = bc->topic;
+        c->qos = g_cfg.qos;
+        if (!BenchRun(bc, MQTT_OP_SUBSCRIBE))
+            return NULL;
+    }
+    bc->ok = true;
+
+    c->qos = g_cfg.qos;
+    uint64_t start = BenchNowUs();
+    uint64_t end = start + (uint64_t)g_cfg.seconds * 1000000u;
+
+    while (!g_stop)
+    {
+        uint64_t now = BenchNowUs();
+        if (now >= end)
+            break;
+
+        /* 按速率补齐到当前时刻应发布的数量；不限速时填满在途窗口 */
+        uint64_t due = g_cfg.rate ? (now - start) * g_cfg.rate / 1000000u + 1 : UINT64_MAX;
+        while (bc->sent < due)
+        {
+            BenchSlot local;
+            BenchSlot *slot = &local;
+            bool tracked = g_cfg.qos > 0 || g_cfg.byteRate > 0;
+            if (tracked)
+            {
+                if (bc->freeSlot < 0)
+                    break;
+                slot = &bc->slots[bc->freeSlot];
+            }
+
+            slot->stampUs = BenchNowUs();
+            slot->iov[0].base = &slot->stampUs;
+            slot->iov[0].len = 8;
+            slot->iov[1].base = g_pad;
+            slot->iov[1].len = payloadLen - 8;
+            if (!MQTT_SubmitPublishV(c, bc->topic, (uint16_t)strlen(bc->topic), slot->iov, 2,
+                                     tracked ? BenchOnPublished : NULL, slot))
+                break;
+
+            if (tracked)
+                bc->freeSlot = slot->next;
+            bc->sent++;
+        }
+
+        MQTT_ProcessLoop(c);
+    }
+
+    bc->pubUs = BenchNowUs() - start;
+
+    /* 等待剩余的确认和消息 (最多 2 秒) */
+    uint64_t drain = BenchNowUs() + 2000000u;
+    while (BenchNowUs() < drain && ((g_cfg.qos > 0 && bc->acked + bc->failed < bc->sent) ||
+                                    (g_cfg.subscribe && bc->received < bc->sent)))
+        MQTT_ProcessLoop(c);
+
+    return NULL;
+}
+
+/* 编码耗时：同一 Topic 反复构建 PUBLISH，比较逐次编码与发布模板 (-s / -q / -T 生效，持续约 -t 秒) */
+static int BenchEncode(void)
+{
+    static uint8_t txBuf[BENCH_PAYLOAD_MAX + BENCH_TOPIC_MAX + 16];
+    static uint8_t tplBuf[MQTT_TEMPLATE_BUF_SIZE(BENCH_TOPIC_MAX, BENCH_PAYLOAD_MAX)];
+    static char msg[BENCH_PAYLOAD_MAX + 1];
+    char topic[BENCH_TOPIC_MAX + 1];
+    MQTT_PublishTemplate tpl;
+    volatile uint32_t sink = 0;
+
+    /* Topic 与 Payload 的内容与网络压测相同 (MQTT_BuildPublishPacket 需要以 0 结尾的 Payload) */
+    snprintf(topic, sizeof(topic), "bench/0");
+    if (g_cfg.topicLen > strlen(topic))
+    {
+        memset(topic + 7, 'x', g_cfg.topicLen - 7);
+        topic[7] = '/';
+        topic[g_cfg.topicLen] = '\0';
+    }
+    memset(msg, 'x', g_cfg.size);
+    msg[g_cfg.size] = '\0';
+    if (!MQTT_PreparePublishTemplate(&tpl, tplBuf, sizeof(tplBuf), topic, g_cfg.qos, 0))
+        return 1;
+
+    /* 两种方式交替运行多轮，每轮 2^16 次，取各自的最小耗时 */
+    double best[2] = {1e30, 1e30};
+    uint64_t deadline = BenchNowUs() + (uint64_t)(g_cfg.seconds ? g_cfg.seconds : 1) * 1000000u;
+    uint32_t rounds = 0;
+    uint16_t pid = 0;
+    while (BenchNowUs() < deadline || rounds < 2)
+    {
+        for (int mode = 0; mode < 2; mode++)
+        {
+            uint64_t t0 = BenchNowUs();
+            for (uint32_t i = 0; i < 65536; i++)
+            {
+                if (++pid == 0)
+                    pid = 1;
+                if (mode == 0)
+                {
+                    sink += MQTT_BuildPublishPacket(txBuf, sizeof(txBuf), topic, msg, pid, 0, g_cfg.qos, 0);
+                }
+                else
+                {
+                    const uint8_t *pkt;
+                    sink += MQTT_BuildPublishFromTemplate(&tpl, msg, g_cfg.size, pid, 0, &pkt);
+                }
+            }
+            double ns = (double)(BenchNowUs() - t0) * 1000.0 / 65536;
+            if (ns < best[mode])
+                best[mode] = ns;
+        }
+        rounds++;
+    }
+
+    printf("encode qos=%u topic=%u size=%u rounds=%u\n", g_cfg.qos, (unsigned)strlen(topic), g_cfg.size, rounds);
+    printf("  MQTT_BuildPublishPacket       %8.1f ns/publish\n", best[0]);
+    printf("  MQTT_BuildPublishFromTemplate %8.1f ns/publish (%.2fx)\n", best[1], best[0] / best[1]);
+    return sink ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------
+ * Payload 编码对比 (-P)：几种典型遥测消息分别用 snprintf 生成 JSON、用 cbor 模块生成 CBOR
+ * -------------------------------------------------------------------------- */
+
+/* 解码结果 (每种消息只用到其中一部分字段) */
+typedef struct
+{
+    char id[16];
+    int64_t ts;
+    int64_t dt;
+    int64_t up;
+    int64_t rssi;
+    int64_t err;
+    double temp;
+    double hum;
+    double pres;
+    double bat;
+    bool ok;
+    char fw[16];
+    int16_t v[16];
+    uint32_t vCount;
+} BenchSample;
+
+/* 第 i 条消息的传感器读数 (随 i 变化，避免编译器把编码结果当作常量) */
+static float BenchTemp(uint32_t i) { return 20.0f + (float)(i % 100) * 0.1f; }
+static float BenchHum(uint32_t i) { return 40.0f + (float)(i % 500) * 0.1f; }
+static int16_t BenchAdc(uint32_t i, uint32_t k) { return (int16_t)((i * 37u + k * 251u) & 0x0FFF); }
+
+/* 1. 单个温度值 */
+static int BenchJsonTemp(char *buf, size_t size, uint32_t i)
+{
+    return snprintf(buf, size, "{\"t\":%.1f}", BenchTemp(i));
+}
+
+static void BenchCborTemp(cbor_writer_t *w, uint32_t i)
+{
+    cbor_put_map(w, 1);
+    cbor_put_str(w, "t");
+    cbor_put_float(w, BenchTemp(i));
+}
+
+/* 2. 环境传感器：设备 ID、时间戳、4 个浮点读数、状态 */
+static int BenchJsonEnv(char *buf, size_t size, uint32_t i)
+{
+    return snprintf(buf, size, "{\"id\":\"dev-0042\",\"ts\":%u,\"temp\":%.1f,\"hum\":%.1f,\"pres\":%.2f,\"bat\":%.2f,\"ok\":%s}",
+                    1718000000u + i, BenchTemp(i), BenchHum(i), 1013.25f + (float)(i % 8), 3.71f, (i & 1) ? "true" : "false");
+}
+
+static void BenchCborEnv(cbor_writer_t *w, uint32_t i)
+{
+    cbor_put_map(w, 7);
+    cbor_put_str(w, "id");
+    cbor_put_str(w, "dev-0042");
+    cbor_put_str(w, "ts");
+    cbor_put_uint(w, 1718000000u + i);
+    cbor_put_str(w, "temp");
+    cbor_put_float(w, BenchTemp(i));
+    cbor_put_str(w, "hum");
+    cbor_put_float(w, BenchHum(i));
+    cbor_put_str(w, "pres");
+    cbor_put_float(w, 1013.25f + (float)(i % 8));
+    cbor_put_str(w, "bat");
+    cbor_put_float(w, 3.71f);
+    cbor_put_str(w, "ok");
+    cbor_put_bool(w, (i & 1) != 0);
+}
+
+/* 2b. 同一消息使用整数键 (双方约定键号，省去键名) */
+enum
+{
+    BENCH_KEY_ID,
+    BENCH_KEY_TS,
+    BENCH_KEY_TEMP,
+    BENCH_KEY_HUM,
+    BENCH_KEY_PRES,
+    BENCH_KEY_BAT,
+    BENCH_KEY_OK
+};
+
+static void BenchCborEnvKeys(cbor_writer_t *w, uint32_t i)
+{
+    cbor_put_map(w, 7);
+    cbor_put_uint(w, BENCH_KEY_ID);
+    cbor_put_str(w, "dev-0042");
+    cbor_put_uint(w, BENCH_KEY_TS);
+    cbor_put_uint(w, 1718000000u + i);
+    cbor_put_uint(w, BENCH_KEY_TEMP);
+    cbor_put_float(w, BenchTemp(i));
+    cbor_put_uint(w, BENCH_KEY_HUM);
+    cbor_put_float(w, BenchHum(i));
+    cbor_put_uint(w, BENCH_KEY_PRES);
+    cbor_put_float(w, 1013.25f + (float)(i % 8));
+    cbor_put_uint(w, BENCH_KEY_BAT);
+    cbor_put_float(w, 3.71f);
+    cbor_put_uint(w, BENCH_KEY_OK);
+    cbor_put_bool(w, (i & 1) != 0);
+}
+
+/* 3. 采样序列：16 个 12 位 ADC 值 */
+static int BenchJsonSeries(char *buf, size_t size, uint32_t i)
+{
+    int n = snprintf(buf, size, "{\"id\":\"dev-0042\",\"ts\":%u,\"dt\":100,\"v\":[", 1718000000u + i);
+    for (uint32_t k = 0; k < 16 && n > 0 && (size_t)n < size; k++)
+        n += snprintf(buf + n, size - (size_t)n, k ? ",%d" : "%d", BenchAdc(i, k));
+    if (n > 0 && (size_t)n < size)
+        n += snprintf(buf + n, size - (size_t)n, "]}");
+    return n;
+}
+
+static void BenchCborSeries(cbor_writer_t *w, uint32_t i)
+{
+    cbor_put_map(w, 4);
+    cbor_put_str(w, "id");
+    cbor_put_str(w, "dev-0042");
+    cbor_put_str(w, "ts");
+    cbor_put_uint(w, 1718000000u + i);
+    cbor_put_str(w, "dt");
+    cbor_put_uint(w, 100);
+    cbor_put_str(w, "v");
+    cbor_put_array(w, 16);
+    for (uint32_t k = 0; k < 16; k++)
+        cbor_put_int(w, BenchAdc(i, k));
+}
+
+/* 4. 网关状态：整数与字符串为主 */
+static int BenchJsonStatus(char *buf, size_t size, uint32_t i)
+{
+    return snprintf(buf, size, "{\"id\":\"gw-01\",\"up\":%u,\"rssi\":%d,\"fw\":\"1.4.2\",\"err\":%u}",
+                    864000u + i, -40 - (int)(i % 50), i % 3);
+}
+
+static void BenchCborStatus(cbor_writer_t *w, uint32_t i)
+{
+    cbor_put_map(w, 5);
+    cbor_put_str(w, "id");
+    cbor_put_str(w, "gw-01");
+    cbor_put_str(w, "up");
+    cbor_put_uint(w, 864000u + i);
+    cbor_put_str(w, "rssi");
+    cbor_put_int(w, -40 - (int)(i % 50));
+    cbor_put_str(w, "fw");
+    cbor_put_str(w, "1.4.2");
+    cbor_put_str(w, "err");
+    cbor_put_uint(w, i % 3);
+}
+
+/* 复制字符串值到定长字段 */
+static void BenchCopyText(char *dst, size_t size, const cbor_item_t *item)
+{
+    size_t n = (item->value < size - 1) ? (size_t)item->value : size - 1;
+    memcpy(dst, item->data, n);
+    dst[n] = '\0';
+}
+
+/* 通用解码：按游标遍历顶层映射，按键名写入 BenchSample (应用中的典型写法)，返回 false 表示格式错误 */
+static bool BenchCborDecode(const uint8_t *buf, size_t len, BenchSample *s)
+{
+    cbor_reader_t r;
+    cbor_item_t map, key, val;
+    cbor_reader_init(&r, buf, len);
+    if (cbor_next(&r, &map) != CBOR_OK || map.type != CBOR_TYPE_MAP)
+        return false;
+
+    for (uint64_t n = 0; n < map.value; n++)
+    {
+        if (cbor_next(&r, &key) != CBOR_OK || cbor_next(&r, &val) != CBOR_OK)
+            return false;
+
+        /* 整数键 (BenchCborEnvKeys) 换成对应的键名处理 */
+        static const char *const names[] = {"id", "ts", "temp", "hum", "pres", "bat", "ok"};
+        cbor_item_t named;
+        if (key.type == CBOR_TYPE_UINT && key.value < sizeof(names) / sizeof(names[0]))
+        {
+            named.type = CBOR_TYPE_TEXT;
+            named.data = (const uint8_t *)names[key.value];
+            named.value = strlen(names[key.value]);
+            key = named;
+        }
+        if (key.type != CBOR_TYPE_TEXT)
+            return false;
+
+        const char *k = (const char *)key.data;
+        bool known = true;
+        if (key.value == 1 && k[0] == 't')
+            known = cbor_get_double(&val, &s->temp);
+        else if (key.value == 1 && k[0] == 'v' && val.type == CBOR_TYPE_ARRAY)
+        {
+            s->vCount = 0;
+            for (uint64_t j = 0; j < val.value; j++)
+            {
+                cbor_item_t e;
+                int64_t x;
+                if (cbor_next(&r, &e) != CBOR_OK || !cbor_get_int(&e, &x))
+                    return false;
+                if (s->vCount < 16)
+                    s->v[s->vCount++] = (int16_t)x;
+            }
+        }
+        else if (cbor_text_equals(&key, "id") && val.type == CBOR_TYPE_TEXT)
+            BenchCopyText(s->id, sizeof(s->id), &val);
+        else if (cbor_text_equals(&key, "fw") && val.type == CBOR_TYPE_TEXT)
+            BenchCopyText(s->fw, sizeof(s->fw), &val);
+        else if (cbor_text_equals(&key, "ts"))
+            known = cbor_get_int(&val, &s->ts);
+        else if (cbor_text_equals(&key, "dt"))
+            known = cbor_get_int(&val, &s->dt);
+        else if (cbor_text_equals(&key, "up"))
+            known = cbor_get_int(&val, &s->up);
+        else if (cbor_text_equals(&key, "rssi"))
+            known = cbor_get_int(&val, &s->rssi);
+        else if (cbor_text_equals(&key, "err"))
+            known = cbor_get_int(&val, &s->err);
+        else if (cbor_text_equals(&key, "temp"))
+            known = cbor_get_double(&val, &s->temp);
+        else if (cbor_text_equals(&key, "hum"))
+            known = cbor_get_double(&val, &s->hum);
+        else if (cbor_text_equals(&key, "pres"))
+            known = cbor_get_double(&val, &s->pres);
+        else if (cbor_text_equals(&key, "bat"))
+            known = cbor_get_double(&val, &s->bat);
+        else if (cbor_text_equals(&key, "ok") && val.type == CBOR_TYPE_BOOL)
+            s->ok = val.value != 0;
+        else
+            known = (cbor_skip(&r, &val) == CBOR_OK); /* 未知字段：连同子项一起跳过 */
+
+        if (!known)
+            return false;
+    }
+    return true;
+}
+
+typedef struct
+{
+    const char *name;
+    int (*json)(char *buf, size_t size, uint32_t i);
+    void (*cbor)(cbor_writer_t *w, uint32_t i);
+} BenchSchema;
+
+static const BenchSchema g_schemas[] = {
+    {"temp", BenchJsonTemp, BenchCborTemp},
+    {"env", BenchJsonEnv, BenchCborEnv},
+    {"env-keys", BenchJsonEnv, BenchCborEnvKeys},
+    {"series", BenchJsonSeries, BenchCborSeries},
+    {"status", BenchJsonStatus, BenchCborStatus},
+};
+
+/* 每种消息交替运行多轮 JSON 编码、CBOR 编码 (直接写入发布模板的 Payload 区并构建报文)、CBOR 解码，
+ * 每轮 2^16 条，取各自的最小耗时；大小为 2^16 条的平均值 (持续约 -t 秒，-q / -T 生效) */
+static int BenchPayload(void)
+{
+    static char json[512];
+    static uint8_t tplBuf[MQTT_TEMPLATE_BUF_SIZE(BENCH_TOPIC_MAX, 512)];
+    char topic[BENCH_TOPIC_MAX + 1];
+    MQTT_PublishTemplate tpl;
+    volatile uint32_t sink = 0;
+
+    snprintf(topic, sizeof(topic), "factory/line1/dev-0042/telemetry");
+    if (g_cfg.topicLen > 0)
+    {
+        memset(topic, 'x', g_cfg.topicLen);
+        topic[g_cfg.topicLen] = '\0';
+    }
+    if (!MQTT_PreparePublishTemplate(&tpl, tplBuf, sizeof(tplBuf), topic, g_cfg.qos, 0))
+        return 1;
+
+    size_t cap;
+    uint8_t *payload = MQTT_PublishTemplatePayload(&tpl, &cap);
+    uint32_t seconds = g_cfg.seconds ? g_cfg.seconds : 1;
+    size_t schemas = sizeof(g_schemas) / sizeof(g_schemas[0]);
+
+    printf("payload codec qos=%u topic=%u (sizes are payload bytes; packet = MQTT PUBLISH incl. header and topic)\n",
+           g_cfg.qos, (unsigned)strlen(topic));
+    printf("  %-8s %6s %6s %6s %7s %7s | %10s %10s %7s | %10s\n", "schema", "json", "cbor", "ratio", "pkt-js", "pkt-cb",
+           "json ns", "cbor ns", "speedup", "decode ns");
+
+    for (size_t si = 0; si < schemas; si++)
+    {
+        const BenchSchema *sc = &g_schemas[si];
+        double best[3] = {1e30, 1e30, 1e30};
+        uint64_t jsonBytes = 0, cborBytes = 0, jsonPkt = 0, cborPkt = 0;
+        uint64_t deadline = BenchNowUs() + (uint64_t)seconds * 1000000u / schemas;
+        uint32_t rounds = 0;
+        uint16_t pid = 0;
+
+        while (BenchNowUs() < deadline || rounds < 2)
+        {
+            for (int mode = 0; mode < 3; mode++)
+            {
+                /* 解码：先在 Payload 区编码一条，再反复解码它 */
+                BenchSample sample;
+                size_t decodeLen = 0;
+                memset(&sample, 0, sizeof(sample));
+                if (mode == 2)
+                {
+                    cbor_writer_t w;
+                    cbor_writer_init(&w, payload, cap);
+                    sc->cbor(&w, rounds);
+                    decodeLen = w.len;
+                }
+
+                uint64_t t0 = BenchNowUs();
+                for (uint32_t i = 0; i < 65536; i++)
+                {
+                    const uint8_t *pkt;
+                    if (++pid == 0)
+                        pid = 1;
+                    if (mode == 0)
+                    {
+                        /* JSON：snprintf 生成后由模板复制到 Payload 区 */
+                        int n = sc->json(json, sizeof(json), i);
+                        uint32_t len = MQTT_BuildPublishFromTemplate(&tpl, json, (size_t)n, pid, 0, &pkt);
+                        sink += len;
+                        if (rounds == 0)
+                        {
+                            jsonBytes += (uint64_t)n;
+                            jsonPkt += len;
+                        }
+                    }
+                    else if (mode == 1)
+                    {
+                        /* CBOR：直接编码到模板的 Payload 区，构建时不复制 */
+                        cbor_writer_t w;
+                        cbor_writer_init(&w, payload, cap);
+                        sc->cbor(&w, i);
+                        uint32_t len = w.overflow ? 0 : MQTT_BuildPublishFromTemplate(&tpl, payload, w.len, pid, 0, &pkt);
+                        sink += len;
+                        if (rounds == 0)
+                        {
+                            cborBytes += w.len;
+                            cborPkt += len;
+                        }
+                    }
+                    else
+                    {
+                        sink += BenchCborDecode(payload, decodeLen, &sample) ? 1u : 0u;
+                    }
+                }
+                double ns = (double)(BenchNowUs() - t0) * 1000.0 / 65536;
+                if (ns < best[mode])
+                    best[mode] = ns;
+            }
+            rounds++;
+        }
+
+        printf("  %-8s %6.1f %6.1f %5.0f%% %7.1f %7.1f | %10.1f %10.1f %6.2fx | %10.1f\n", sc->name,
+               jsonBytes / 65536.0, cborBytes / 65536.0, 100.0 * (double)cborBytes / (double)jsonBytes,
+               jsonPkt / 65536.0, cborPkt / 65536.0, best[0], best[1], best[0] / best[1], best[2]);
+    }
+    return sink ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------
+ * Payload 压缩 (-Z)：样本数据经 MQTT_CompressPayload 编码为压缩帧、经 MQTT_DecompressPayload 还原
+ * -------------------------------------------------------------------------- */
+
+#define BENCH_SAMPLE_MAX 2048
+
+/* 样本：单条遥测、16 条遥测合并为一条、CBOR 批量、设备日志、随机数据 (不可压缩，原样发出) */
+static size_t BenchCompressSample(int kind, uint8_t *buf, size_t size)
+{
+    size_t n = 0;
+    if (kind == 0)
+        return (size_t)BenchJsonEnv((char *)buf, size, 7);
+    if (kind == 1)
+        return (size_t)BenchJsonSeries((char *)buf, size, 7);
+    if (kind == 2)
+    {
+        buf[n++] = '[';
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            n += (size_t)BenchJsonEnv((char *)buf + n, size - n, i * 13);
+            buf[n++] = (i < 15) ? ',' : ']';
+        }
+        return n;
+    }
+    if (kind == 3)
+    {
+        cbor_writer_t w;
+        cbor_writer_init(&w, buf, size);
+        cbor_put_array(&w, 16);
+        for (uint32_t i = 0; i < 16; i++)
+            BenchCborEnv(&w, i * 13);
+        return w.overflow ? 0 : w.len;
+    }
+    if (kind == 4)
+    {
+        static const char *const msgs[] = {"wifi: rssi=-61 dBm, reconnect ok", "mqtt: publish id=%u queued",
+                                           "sensor: read ok, temp=23.5 hum=61.2", "ota: no update available"};
+        for (uint32_t i = 0; n + 96 < size && i < 24; i++)
+        {
+            n += (size_t)snprintf((char *)buf + n, size - n, "[%10u] I (%s) ", 1718000000u + i * 250u,
+                                  (i % 3) ? "main" : "net");
+            n += (size_t)snprintf((char *)buf + n, size - n, msgs[i % 4], 1000 + i);
+            buf[n++] = '\n';
+        }
+        return n;
+    }
+    uint32_t x = 2463534242u;
+    for (n = 0; n < 512; n++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[n] = (uint8_t)x;
+    }
+    return n;
+}
+
+/* 每种样本、每组窗口参数交替运行压缩与解压，取最小耗时 (持续约 -t 秒)；
+ * 单条消息另测一次预置字典 (字典为同类型、不同数值的另一条消息) */
+static int BenchCompress(void)
+{
+    static const char *const names[] = {"json-1", "series-1", "json-16", "cbor-16", "log", "random"};
+    static const uint8_t params[][2] = {{8, 4}, {10, 4}, {12, 5}};
+    static uint16_t work[LZSS_ENC_WORK_SIZE(LZSS_WINDOW_MAX) / 2];
+    static uint8_t sample[BENCH_SAMPLE_MAX], frame[MQTT_COMPRESS_OUT_SIZE(BENCH_SAMPLE_MAX)], out[BENCH_SAMPLE_MAX + 1];
+    static char dict[BENCH_SAMPLE_MAX];
+    size_t kinds = sizeof(names) / sizeof(names[0]);
+    size_t sets = sizeof(params) / sizeof(params[0]);
+    uint32_t seconds = g_cfg.seconds ? g_cfg.seconds : 1;
+    volatile uint32_t sink = 0;
+
+    printf("payload compression (ratio = frame bytes incl. header / raw bytes; MB/s of raw data)\n");
+    printf("  %-9s %5s | %-6s %7s %6s %9s %9s\n", "sample", "raw", "window", "frame", "ratio", "comp MB/s", "dec MB/s");
+
+    for (size_t k = 0; k < kinds; k++)
+    {
+        size_t rawLen = BenchCompressSample((int)k, sample, sizeof(sample));
+        MQTT_IoVec iov = {sample, rawLen};
+        size_t dictLen = 0;
+        if (k == 0)
+            dictLen = (size_t)BenchJsonEnv(dict, sizeof(dict), 1);
+        else if (k == 1)
+            dictLen = (size_t)BenchJsonSeries(dict, sizeof(dict), 1);
+
+        for (size_t ps = 0; ps < sets * (dictLen ? 2 : 1); ps++)
+        {
+            MQTT_Compress cz;
+            const uint8_t *param = params[ps % sets];
+            if (!MQTT_CompressInit(&cz, work, sizeof(work), param[0], param[1], out, sizeof(out)))
+                return 1;
+            if (ps >= sets)
+                MQTT_CompressSetDict(&cz, dict, dictLen);
+
+            size_t frameLen = MQTT_CompressPayload(&cz, &iov, 1, frame, sizeof(frame));
+            size_t outLen = 0;
+            const uint8_t *dec = MQTT_DecompressPayload(&cz, frame, frameLen, &outLen);
+            if (!dec || outLen != rawLen || memcmp(dec, sample, rawLen) != 0)
+            {
+                printf("round trip failed: %s\n", names[k]);
+                return 1;
+            }
+
+            /* 每轮处理约 4 MB 原始数据 */
+            uint32_t reps = (uint32_t)(4u * 1024 * 1024 / rawLen);
+            double best[2] = {1e30, 1e30};
+            uint64_t deadline = BenchNowUs() + (uint64_t)seconds * 1000000u / ((kinds + 2) * sets);
+            for (uint32_t round = 0; BenchNowUs() < deadline || round < 2; round++)
+            {
+                for (int mode = 0; mode < 2; mode++)
+                {
+                    uint64_t t0 = BenchNowUs();
+                    for (uint32_t i = 0; i < reps; i++)
+                    {
+                        if (mode == 0)
+                            sink += (uint32_t)MQTT_CompressPayload(&cz, &iov, 1, frame, sizeof(frame));
+                        else
+                            sink += MQTT_DecompressPayload(&cz, frame, frameLen, &outLen)[0];
+                    }
+                    double sec = (double)(BenchNowUs() - t0) / 1e6;
+                    if (sec < best[mode])
+                        best[mode] = sec;
+                }
+            }
+
+            /* 原样发出的帧解压只是去掉帧头，不列出速度 */
+            double mb = (double)rawLen * reps / (1024.0 * 1024.0);
+            char decRate[16] = "-";
+            if (cz.stats.packed > 0)
+                snprintf(decRate, sizeof(decRate), "%.1f", mb / best[1]);
+            printf("  %-9s %5u | 2^%-2u%-2s %7u %5.0f%% %9.1f %9s\n", ps ? "" : names[k], (unsigned)rawLen, param[0],
+                   (ps >= sets) ? "+d" : "", (unsigned)frameLen, 100.0 * (double)frameLen / (double)rawLen, mb / best[0],
+                   decRate);
+        }
+    }
+    return sink ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------
+ * 订阅分发器 (-F)：BENCH_FILTERS 条过滤器 (70% 精确、20% 含 +、10% 以 # 结尾)，
+ * 用同一组 Topic 比较 MQTT_RouterDispatch 与逐条匹配全部过滤器，两者的命中数必须一致
+ * -------------------------------------------------------------------------- */
+
+#define BENCH_FILTERS 10000
+#define BENCH_ROUTER_NODES 24576
+#define BENCH_ROUTER_TOPICS 4096
+
+/* 逐条匹配的参照实现：f 为过滤器，t 为 Topic (规则同 mqtt_router) */
+static bool BenchFilterMatch(const char *f, const char *t)
+{
+    if (t[0] == '$' && (f[0] == '+' || f[0] == '#'))
+        return false;
+    for (;;)
+    {
+        if (f[0] == '#')
+            return true;
+        if (f[0] == '+')
+        {
+            f++;
+            while (*t && *t != '/')
+                t++;
+        }
+        else
+        {
+            while (*f && *f != '/')
+            {
+                if (*f++ != *t++)
+                    return false;
+            }
+            if (*t && *t != '/')
+                return false;
+        }
+
+        /* 两边都到了层级末尾："a/#" 也匹配 "a" */
+        if (!*f && !*t)
+            return true;
+        if (!*f || !*t)
+            return !*t && f[0] == '/' && f[1] == '#' && f[2] == '\0';
+        f++;
+        t++;
+    }
+}
+
+static void BenchOnRouted(MQTT_Client *client, const char *topic, const char *payload, size_t len, void *ctx)
+{
+    (void)client;
+    (void)topic;
+    (void)payload;
+    (void)len;
+    (*(uint32_t *)ctx)++;
+}
+
+static int BenchRouter(void)
+{
+    static uint8_t arena[MQTT_ROUTER_ARENA_SIZE(BENCH_ROUTER_NODES, 256 * 1024)];
+    static char filters[BENCH_FILTERS][40];
+    static char topics[BENCH_ROUTER_TOPICS][48];
+    static MQTT_Router router;
+    uint32_t seconds = g_cfg.seconds ? g_cfg.seconds : 1;
+    uint32_t hits = 0;
+
+    if (!MQTT_RouterInit(&router, arena, sizeof(arena), BENCH_ROUTER_NODES))
+        return 1;
+    for (uint32_t i = 0; i < BENCH_FILTERS; i++)
+    {
+        if (i % 10 < 7)
+            snprintf(filters[i], sizeof(filters[i]), "site/%u/dev/%u/temp", i / 100, i);
+        else if (i % 10 < 9)
+            snprintf(filters[i], sizeof(filters[i]), "site/%u/+/%u/status", i / 100, i);
+        else
+            snprintf(filters[i], sizeof(filters[i]), "site/%u/alarm/%u/#", i / 100, i);
+        if (!MQTT_RouterAdd(&router, filters[i], BenchOnRouted, &hits))
+        {
+            printf("router full at filter %u\n", i);
+            return 1;
+        }
+    }
+
+    /* Topic：精确、+、# 三种形式与不命中的 Topic 各占 1/4 (编号随机，编号对应的过滤器属于同一形式时才命中) */
+    uint32_t seed = 12345;
+    for (uint32_t k = 0; k < BENCH_ROUTER_TOPICS; k++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t i = (seed >> 8) % BENCH_FILTERS;
+        static const char *const fmt[] = {"site/%u/dev/%u/temp", "site/%u/gw/%u/status", "site/%u/alarm/%u/smoke/high",
+                                          "site/%u/dev/%u/hum"};
+        snprintf(topics[k], sizeof(topics[k]), fmt[k % 4], i / 100, i);
+    }
+
+    /* 先核对两种方式的命中数，再交替计时，取各自的最小耗时 */
+    uint32_t linearHits = 0;
+    for (uint32_t k = 0; k < BENCH_ROUTER_TOPICS; k++)
+    {
+        MQTT_RouterDispatch(&router, NULL, topics[k], "", 0);
+        for (uint32_t i = 0; i < BENCH_FILTERS; i++)
+            linearHits += BenchFilterMatch(filters[i], topics[k]);
+    }
+    if (hits != linearHits)
+    {
+        printf("router mismatch: trie=%u linear=%u\n", hits, linearHits);
+        return 1;
+    }
+
+    uint32_t matched = hits;
+    double best[2] = {1e30, 1e30};
+    volatile uint32_t sink = 0;
+    uint64_t deadline = BenchNowUs() + (uint64_t)seconds * 1000000u;
+    uint32_t rounds = 0;
+    while (BenchNowUs() < deadline || rounds < 2)
+    {
+        uint64_t t0 = BenchNowUs();
+        for (uint32_t rep = 0; rep < 64; rep++)
+            for (uint32_t k = 0; k < BENCH_ROUTER_TOPICS; k++)
+                sink += (uint32_t)MQTT_RouterDispatch(&router, NULL, topics[k], "", 0);
+        double ns = (double)(BenchNowUs() - t0) * 1000.0 / (64.0 * BENCH_ROUTER_TOPICS);
+        if (ns < best[0])
+            best[0] = ns;
+
+        /* 逐条匹配每条 Topic 要扫描全部过滤器，每轮只取 1/16 的 Topic */
+        t0 = BenchNowUs();
+        for (uint32_t k = rounds % 16; k < BENCH_ROUTER_TOPICS; k += 16)
+            for (uint32_t i = 0; i < BENCH_FILTERS; i++)
+                sink += BenchFilterMatch(filters[i], topics[k]);
+        ns = (double)(BenchNowUs() - t0) * 1000.0 / (BENCH_ROUTER_TOPICS / 16);
+        if (ns < best[1])
+            best[1] = ns;
+        rounds++;
+    }
+
+    printf("router filters=%u nodes=%u names=%u bytes topics=%u matches=%u rounds=%u\n", BENCH_FILTERS,
+           (unsigned)router.nodeCount, (unsigned)router.namesUsed, BENCH_ROUTER_TOPICS, matched, rounds);
+    printf("  MQTT_RouterDispatch   %10.1f ns/topic\n", best[0]);
+    printf("  linear filter match   %10.1f ns/topic (%.0fx)\n", best[1], best[1] / best[0]);
+    return sink ? 0 : 1;
+}
+
+static void BenchUsage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -H host     broker host (default: in-process broker)\n"
+           "  -p port     broker port (default 1883)\n"
+           "  -U path     connect via unix socket\n"
+           "  -c n        clients (default 4)\n"
+           "  -r n        publishes per second per client, 0 = unlimited (default 1000)\n"
+           "  -s n        payload size in bytes, 8..%d (default 64)\n"
+           "  -q n        QoS 0/1/2 (default 1)\n"
+           "  -n          do not subscribe (publish only)\n"
+           "  -t n        duration in seconds (default 5)\n"
+           "  -w n        QoS 1/2 in-flight window per client, power of 2 up to %d (default %d)\n"
+           "  -L ms       in-process broker latency (default 0)\n"
+           "  -l pct      in-process broker loss percent (default 0)\n"
+           "  -R pct      in-process broker reorder percent, swaps adjacent queued packets (default 0)\n"
+           "  -M n        in-process broker Receive Maximum for MQTT 5 clients (default: not sent)\n"
+           "  -5          use MQTT 5 with topic aliases\n"
+           "  -T n        topic length in bytes, up to %d (default: bench/<id>)\n"
+           "  -B n        per-client upstream rate limit in bytes/s, burst = n/10 (default: unlimited)\n"
+           "  -E          encode-only: compare MQTT_BuildPublishPacket with a publish template\n"
+           "  -P          payload codec: compare JSON (snprintf) with CBOR for sample telemetry schemas\n"
+           "  -Z          compression: ratio and throughput of LZSS payload compression on sample data\n"
+           "  -F          router: dispatch time with %d filters, topic trie vs matching each filter\n",
+           prog, BENCH_PAYLOAD_MAX, BENCH_WINDOW_MAX, BENCH_WINDOW, BENCH_TOPIC_MAX, BENCH_FILTERS);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:U:c:r:s:q:nt:w:L:l:R:M:5T:B:EPZFh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H': g_cfg.host = optarg; break;
+        case 'p': g_cfg.port = (uint16_t)atoi(optarg); break;
+        case 'U': g_cfg.unixPath = optarg; break;
+        case 'c': g_cfg.clients = atoi(optarg); break;
+        case 'r': g_cfg.rate = (uint32_t)atoi(optarg); break;
+        case 's': g_cfg.size = (uint32_t)atoi(optarg); break;
+        case 'q': g_cfg.qos = (uint8_t)atoi(optarg); break;
+        case 'n': g_cfg.subscribe = false; break;
+        case 't': g_cfg.seconds = (uint32_t)atoi(optarg); break;
+        case 'w': g_cfg.window = (uint32_t)atoi(optarg); break;
+        case 'L': g_cfg.latencyMs = (uint32_t)atoi(optarg); break;
+        case 'l': g_cfg.lossPct = (uint8_t)atoi(optarg); break;
+        case 'R': g_cfg.reorderPct = (uint8_t)atoi(optarg); break;
+        case 'M': g_cfg.receiveMax = (uint16_t)atoi(optarg); break;
+        case '5': g_cfg.v5 = true; break;
+        case 'T': g_cfg.topicLen = (uint32_t)atoi(optarg); break;
+        case 'B': g_cfg.byteRate = (uint32_t)atoi(optarg); break;
+        case 'E': g_cfg.encodeOnly = true; break;
+        case 'P': g_cfg.payloadCodec = true; break;
+        case 'Z': g_cfg.compress = true; break;
+        case 'F': g_cfg.router = true; break;
+        default: BenchUsage(argv[0]); return 1;
+        }
+    }
+    if (!g_cfg.window)
+        g_cfg.window = BENCH_WINDOW;
+    if (g_cfg.clients < 1 || g_cfg.qos > 2 || g_cfg.size > BENCH_PAYLOAD_MAX || g_cfg.topicLen > BENCH_TOPIC_MAX ||
+        g_cfg.window > BENCH_WINDOW_MAX || (g_cfg.window & (g_cfg.window - 1)))
+    {
+        BenchUsage(argv[0]);
+        return 1;
+    }
+    if (g_cfg.encodeOnly)
+        return BenchEncode();
+    if (g_cfg.payloadCodec)
+        return BenchPayload();
+    if (g_cfg.compress)
+        return BenchCompress();
+    if (g_cfg.router)
+        return BenchRouter();
+
+    /* 1. 服务器：未指定时启动进程内 Broker */
+    static MQTT_Broker broker;
+    bool local = !g_cfg.host && !g_cfg.unixPath;
+    uint16_t port = g_cfg.port;
+    if (local)
+    {
+        MQTT_BrokerConfig bcfg = {.latencyMs = g_cfg.latencyMs, .lossPct = g_cfg.lossPct, .seed = 1,
+                                  .receiveMax = g_cfg.receiveMax, .reorderPct = g_cfg.reorderPct};
+        if (g_cfg.clients > MQTT_BROKER_MAX_CLIENTS || !MQTT_BrokerStart(&broker, &bcfg))
+        {
+            printf("failed to start in-process broker\n");
+            return 1;
+        }
+        port = broker.port;
+    }
+
+    /* 2. 客户端 */
+    BenchClient *clients = calloc((size_t)g_cfg.clients, sizeof(BenchClient));
+    if (!clients)
+        return 1;
+    memset(g_pad, 'x', sizeof(g_pad));
+
+    for (int i = 0; i < g_cfg.clients; i++)
+    {
+        BenchClient *bc = &clients[i];
+        MQTT_Client *c = &bc->client;
+        bc->id = i;
+        bc->inflight = calloc(g_cfg.window, sizeof(MQTT_Request));
+        bc->slots = calloc(g_cfg.window, sizeof(BenchSlot));
+        if (!bc->inflight || !bc->slots)
+            return 1;
+        snprintf(bc->topic, sizeof(bc->topic), "bench/%d", i);
+        if (g_cfg.topicLen)
+        {
+            /* 长 Topic：bench/<序号>/ 之后用 'x' 补齐 (客户端 ID 取前缀) */
+            size_t n = strlen(bc->topic);
+            memset(bc->topic + n, 'x', sizeof(bc->topic) - 1 - n);
+            bc->topic[n] = '/';
+            bc->topic[g_cfg.topicLen > n ? g_cfg.topicLen : n] = '\0';
+        }
+
+        if (!BenchConnect(bc, port))
+        {
+            printf("client %d: connect failed\n", i);
+            return 1;
+        }
+
+        c->txBuf = bc->txBuf;
+        c->txBufSize = sizeof(bc->txBuf);
+        c->rxBuf = bc->rxBuf;
+        c->rxBufSize = sizeof(bc->rxBuf);
+        c->msgTopicBuf = bc->topicBuf;
+        c->msgTopicBufSize = sizeof(bc->topicBuf);
+        c->msgPayloadBuf = bc->payloadBuf;
+        c->msgPayloadBufSize = sizeof(bc->payloadBuf);
+        c->transport = &MQTT_PosixTransport;
+        c->transportCtx = &bc->sock;
+        c->keepAlive = 60;
+        c->cleanSession = 1;
+        c->retryIntervalMs = 1000 + 4 * g_cfg.latencyMs;
+        c->maxRetrys = 3;
+        c->inflight = bc->inflight;
+        c->inflightSize = (uint16_t)g_cfg.window;
+        c->clientId = bc->clientId;
+        snprintf(bc->clientId, sizeof(bc->clientId), "bench-%d", i);
+        if (g_cfg.v5)
+        {
+            c->protocolVersion = MQTT_VERSION_5;
+            c->topicAliases = bc->aliases;
+            c->topicAliasCount = BENCH_ALIASES;
+        }
+        if (g_cfg.byteRate)
+        {
+            c->rateBytesPerSec = g_cfg.byteRate;
+            c->rateBurst = g_cfg.byteRate / 10 ? g_cfg.byteRate / 10 : 1;
+        }
+
+        MQTT_RouterInit(&bc->router, bc->routerArena, sizeof(bc->routerArena), 4);
+        MQTT_RouterAdd(&bc->router, bc->topic, BenchOnMessage, bc);
+        c->router = &bc->router;
+    }
+
+    for (int i = 0; i < g_cfg.clients; i++)
+        pthread_create(&clients[i].thread, NULL, BenchThread, &clients[i]);
+    for (int i = 0; i < g_cfg.clients; i++)
+        pthread_join(clients[i].thread, NULL);
+
+    /* 3. 汇总 */
+    static MQTT_Histogram ackHist, recvHist;
+    MQTT_Stats total;
+    memset(&total, 0, sizeof(total));
+    uint64_t sent = 0, acked = 0, failed = 0, received = 0;
+    int ready = 0;
+    uint64_t pubUs = 1;
+
+    for (int i = 0; i < g_cfg.clients; i++)
+    {
+        BenchClient *bc = &clients[i];
+        const MQTT_Stats *s = &bc->client.stats;
+        ready += bc->ok;
+        sent += bc->sent;
+        acked += bc->acked;
+        failed += bc->failed;
+        received += bc->received;
+        if (bc->pubUs > pubUs)
+            pubUs = bc->pubUs;
+        BenchHistMerge(&ackHist, &bc->ackHist);
+        BenchHistMerge(&recvHist, &bc->recvHist);
+
+        total.bytesOut += s->bytesOut;
+        total.bytesIn += s->bytesIn;
+        total.retries += s->retries;
+        total.timeouts += s->timeouts;
+        total.dupsDropped += s->dupsDropped;
+        total.parseFailures += s->parseFailures;
+        total.oversized += s->oversized;
+        total.aliasHits += s->aliasHits;
+        total.aliasBytesSaved += s->aliasBytesSaved;
+        total.throttledMs += s->throttledMs;
+        if (s->queuePeak[MQTT_PRIO_TELEMETRY] > total.queuePeak[MQTT_PRIO_TELEMETRY])
+            total.queuePeak[MQTT_PRIO_TELEMETRY] = s->queuePeak[MQTT_PRIO_TELEMETRY];
+        MQTT_PosixClose(&bc->sock);
+    }
+
+    double elapsed = (double)pubUs / 1e6;
+    printf("clients=%d ready=%d mqtt=%s qos=%u size=%u topic=%u rate=%u/s window=%u duration=%.2fs\n", g_cfg.clients,
+           ready, g_cfg.v5 ? "5.0" : "3.1.1", g_cfg.qos, g_cfg.size, (unsigned)strlen(clients[0].topic),
+           g_cfg.rate, (unsigned)g_cfg.window, elapsed);
+    printf("  published      %llu (%.0f msg/s, %.2f MB/s payload)\n", (unsigned long long)sent,
+           sent / elapsed, sent * (double)g_cfg.size / elapsed / 1e6);
+    if (g_cfg.qos > 0)
+        printf("  acked          %llu, failed %llu\n", (unsigned long long)acked, (unsigned long long)failed);
+    if (g_cfg.subscribe)
+        printf("  received       %llu (%.0f msg/s)\n", (unsigned long long)received, received / elapsed);
+    printf("  wire           out %.2f MB/s, in %.2f MB/s\n", total.bytesOut / elapsed / 1e6,
+           total.bytesIn / elapsed / 1e6);
+    if (g_cfg.v5)
+    {
+        /* 节省比例：相对于不使用别名时的上行字节数 */
+        double base = (double)total.bytesOut + total.aliasBytesSaved;
+        printf("  topic alias    hits=%u saved %u bytes (%.1f%% of upstream, %.1f bytes/msg)\n",
+               (unsigned)total.aliasHits, (unsigned)total.aliasBytesSaved,
+               base > 0 ? 100.0 * total.aliasBytesSaved / base : 0.0,
+               sent ? (double)total.aliasBytesSaved / sent : 0.0);
+    }
+    if (g_cfg.byteRate)
+        printf("  rate limit     %u B/s per client, throttled %.2fs per client on average, peak queue %u\n",
+               (unsigned)g_cfg.byteRate, total.throttledMs / 1000.0 / g_cfg.clients,
+               (unsigned)total.queuePeak[MQTT_PRIO_TELEMETRY]);
+    printf("  client stats   retries=%u timeouts=%u dupsDropped=%u parseFailures=%u oversized=%u\n",
+           (unsigned)total.retries, (unsigned)total.timeouts, (unsigned)total.dupsDropped,
+           (unsigned)total.parseFailures, (unsigned)total.oversized);
+    if (g_cfg.qos > 0)
+        BenchHistPrint("publish->ack", &ackHist);
+    if (g_cfg.subscribe)
+        BenchHistPrint("publish->recv", &recvHist);
+
+    if (local)
+    {
+        MQTT_BrokerStop(&broker);
+        printf("  broker         in=%llu out=%llu dropped=%llu reordered=%llu overflow=%llu held=%llu flowViolations=%llu\n",
+               (unsigned long long)broker.stats.packetsIn, (unsigned long long)broker.stats.packetsOut,
+               (unsigned long long)broker.stats.dropped, (unsigned long long)broker.stats.reordered,
+               (unsigned long long)broker.stats.overflow, (unsigned long long)broker.stats.held,
+               (unsigned long long)broker.stats.flowViolations);
+    }
+
+    for (int i = 0; i < g_cfg.clients; i++)
+    {
+        free(clients[i].inflight);
+        free(clients[i].slots);
+    }
+    free(clients);
+    return 0;
+}
@@ -0,0 +1,902 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mqtt_broker.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* --------------------------------------------------------------------------
+ * 内部辅助函数
+ * -------------------------------------------------------------------------- */
+
+static uint32_t MQTT_BrokerNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/* xorshift32：丢包与乱序注入用的随机数，按 pct (0~100) 的概率返回 true */
+static bool MQTT_BrokerChance(MQTT_Broker *broker, uint8_t pct)
+{
+    if (pct == 0)
+        return false;
+
+    uint32_t x = broker->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    broker->rng = x;
+    return x % 100 < pct;
+}
+
+static bool MQTT_BrokerLose(MQTT_Broker *broker)
+{
+    if (!MQTT_BrokerChance(broker, broker->cfg.lossPct))
+        return false;
+
+    broker->stats.dropped++;
+    return true;
+}
+
+static uint8_t MQTT_BrokerEncodeLength(uint32_t length, uint8_t *out)
+{
+    uint8_t n = 0;
+    do
+    {
+        out[n] = length % 128;
+        length /= 128;
+        if (length > 0)
+            out[n] |= 0x80;
+        n++;
+    } while (length > 0 && n < 4);
+    return n;
+}
+
+/* 解码变长整数，返回占用的字节数 (0 表示数据不足或格式错误) */
+static uint32_t MQTT_BrokerDecodeLength(const uint8_t *p, uint32_t len, uint32_t *value)
+{
+    uint32_t mul = 1;
+    *value = 0;
+    for (uint32_t i = 0; i < 4 && i < len; i++)
+    {
+        *value += (p[i] & 0x7F) * mul;
+        mul *= 128;
+        if (!(p[i] & 0x80))
+            return i + 1;
+    }
+    return 0;
+}
+
+/* * MQTT 5 属性区：p 指向属性长度字段，取出 Topic Alias (没有则为 0)
+ * 返回值: 属性区总长度 (含长度字段)，0 表示格式错误
+ */
+static uint32_t MQTT_BrokerProps(const uint8_t *p, uint32_t len, uint16_t *alias, uint32_t *maxPacket,
+                                 uint16_t *receiveMax)
+{
+    uint32_t propsLen;
+    uint32_t n = MQTT_BrokerDecodeLength(p, len, &propsLen);
+    if (n == 0 || n + propsLen > len)
+        return 0;
+
+    const uint8_t *q = p + n;
+    const uint8_t *end = q + propsLen;
+    while (q < end)
+    {
+        uint32_t left = (uint32_t)(end - q);
+        uint32_t size;
+        switch (q[0])
+        {
+        case 0x01: case 0x17: case 0x19: /* 单字节 */
+            size = 2;
+            break;
+        case 0x21: case 0x22: case 0x23: /* 双字节 */
+            size = 3;
+            if (left >= 3 && q[0] == 0x23 && alias)
+                *alias = (uint16_t)((q[1] << 8) | q[2]);
+            if (left >= 3 && q[0] == 0x21 && receiveMax)
+                *receiveMax = (uint16_t)((q[1] << 8) | q[2]);
+            break;
+        case 0x02: case 0x11: case 0x18: case 0x27: /* 四字节 */
+            size = 5;
+            if (left >= 5 && q[0] == 0x27 && maxPacket)
+                *maxPacket = ((uint32_t)q[1] << 24) | ((uint32_t)q[2] << 16) | ((uint32_t)q[3] << 8) | q[4];
+            break;
+        case 0x0B: /* 变长整数 */
+        {
+            uint32_t v;
+            uint32_t m = MQTT_BrokerDecodeLength(q + 1, left - 1, &v);
+            if (m == 0)
+                return 0;
+            size = 1 + m;
+            break;
+        }
+        case 0x03: case 0x08: case 0x09: case 0x15: case 0x16: /* 字符串 / 二进制 */
+            size = (left >= 3) ? 3u + (uint32_t)((q[1] << 8) | q[2]) : left + 1;
+            break;
+        case 0x26: /* 字符串对 */
+            size = (left >= 3) ? 3u + (uint32_t)((q[1] << 8) | q[2]) : left + 1;
+            size = (left >= size + 2) ? size + 2u + (uint32_t)((q[size] << 8) | q[size + 1]) : left + 1;
+            break;
+        default:
+            return 0;
+        }
+        if (size > left)
+            return 0;
+        q += size;
+    }
+    return n + propsLen;
+}
+
+static void MQTT_BrokerClose(MQTT_Broker *broker, MQTT_BrokerConn *conn)
+{
+    (void)broker;
+    if (conn->fd >= 0)
+        close(conn->fd);
+    conn->fd = -1;
+}
+
+/* 在发送队列中预留一个报文的空间，返回报文写入位置 (NULL 表示丢包或队列已满) */
+static uint8_t *MQTT_BrokerReserve(MQTT_Broker *broker, MQTT_BrokerConn *conn, uint32_t len)
+{
+    if (MQTT_BrokerLose(broker))
+        return NULL;
+
+    uint32_t need = 8 + len;
+    if (conn->txEnd + need > MQTT_BROKER_TX_SIZE && conn->txStart > 0)
+    {
+        /* 队尾空间不足：把未发送的记录移到缓冲区开头 */
+        memmove(conn->tx, conn->tx + conn->txStart, conn->txEnd - conn->txStart);
+        if (conn->txLast != MQTT_BROKER_TX_NONE)
+            conn->txLast = (conn->txLast >= conn->txStart) ? conn->txLast - conn->txStart : MQTT_BROKER_TX_NONE;
+        conn->txEnd -= conn->txStart;
+        conn->txStart = 0;
+    }
+    if (conn->txEnd + need > MQTT_BROKER_TX_SIZE)
+    {
+        broker->stats.overflow++;
+        return NULL;
+    }
+
+    /* 乱序注入：新报文插到队尾报文之前 (队尾报文尚未开始写出时)，两者交换发送顺序 */
+    uint32_t at = conn->txEnd;
+    bool movable = conn->txLast != MQTT_BROKER_TX_NONE && conn->txLast >= conn->txStart &&
+                   !(conn->txLast == conn->txStart && conn->txOff > 0);
+    if (movable && MQTT_BrokerChance(broker, broker->cfg.reorderPct))
+    {
+        at = conn->txLast;
+        memmove(conn->tx + at + need, conn->tx + at, conn->txEnd - at);
+        conn->txLast = at + need;
+        broker->stats.reordered++;
+    }
+    else
+    {
+        conn->txLast = at;
+    }
+
+    uint32_t due = MQTT_BrokerNow() + broker->cfg.latencyMs;
+    memcpy(conn->tx + at, &due, 4);
+    memcpy(conn->tx + at + 4, &len, 4);
+    conn->txEnd += need;
+    return conn->tx + at + 8;
+}
+
+/* 发送 [类型][2][PacketID] 形式的应答 */
+static void MQTT_BrokerSendAck(MQTT_Broker *broker, MQTT_BrokerConn *conn, uint8_t type, uint16_t pid)
+{
+    uint8_t *p = MQTT_BrokerReserve(broker, conn, 4);
+    if (!p)
+        return;
+    p[0] = type;
+    p[1] = 2;
+    p[2] = (uint8_t)(pid >> 8);
+    p[3] = (uint8_t)pid;
+}
+
+/* 在暂缓队列中预留一个报文的空间 (超出客户端 Receive Maximum 的转发)，返回 NULL 表示队列已满 */
+static uint8_t *MQTT_BrokerHold(MQTT_Broker *broker, MQTT_BrokerConn *conn, uint32_t len)
+{
+    uint32_t need = 4 + len;
+    if (conn->heldEnd + need > MQTT_BROKER_HELD_SIZE && conn->heldStart > 0)
+    {
+        memmove(conn->held, conn->held + conn->heldStart, conn->heldEnd - conn->heldStart);
+        conn->heldEnd -= conn->heldStart;
+        conn->heldStart = 0;
+    }
+    if (conn->heldEnd + need > MQTT_BROKER_HELD_SIZE)
+    {
+        broker->stats.overflow++;
+        return NULL;
+    }
+
+    broker->stats.held++;
+    memcpy(conn->held + conn->heldEnd, &len, 4);
+    uint8_t *p = conn->held + conn->heldEnd + 4;
+    conn->heldEnd += need;
+    return p;
+}
+
+/* 客户端确认了一条转发的 QoS > 0 消息 (PUBACK / PUBCOMP)：归还配额，按顺序放行暂缓的报文 */
+static void MQTT_BrokerAcked(MQTT_Broker *broker, MQTT_BrokerConn *conn)
+{
+    if (conn->unacked > 0)
+        conn->unacked--;
+
+    while (conn->unacked < conn->receiveMax && conn->heldStart < conn->heldEnd)
+    {
+        uint32_t len;
+        memcpy(&len, conn->held + conn->heldStart, 4);
+        uint8_t *p = MQTT_BrokerReserve(broker, conn, len);
+        if (p)
+        {
+            memcpy(p, conn->held + conn->heldStart + 4, len);
+            conn->unacked++;
+        }
+        conn->heldStart += 4 + len;
+    }
+    if (conn->heldStart == conn->heldEnd)
+        conn->heldStart = conn->heldEnd = 0;
+}
+
+/* 写出已到期的报文 */
+static void MQTT_BrokerFlush(MQTT_Broker *broker, MQTT_BrokerConn *conn, uint32_t now)
+{
+    while (conn->fd >= 0 && conn->txStart < conn->txEnd)
+    {
+        uint32_t due, len;
+        memcpy(&due, conn->tx + conn->txStart, 4);
+        memcpy(&len, conn->tx + conn->txStart + 4, 4);
+        if ((int32_t)(now - due) < 0)
+            break;
+
+        ssize_t n = send(conn->fd, conn->tx + conn->txStart + 8 + conn->txOff, len - conn->txOff,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                MQTT_BrokerClose(broker, conn);
+            break;
+        }
+
+        broker->stats.bytesOut += (uint64_t)n;
+        conn->txOff += (uint32_t)n;
+        if (conn->txOff < len)
+            break;
+
+        broker->stats.packetsOut++;
+        conn->txStart += 8 + len;
+        conn->txOff = 0;
+    }
+
+    if (conn->txStart == conn->txEnd)
+    {
+        conn->txStart = conn->txEnd = 0;
+        conn->txLast = MQTT_BROKER_TX_NONE;
+    }
+}
+
+/* 队首报文是否已到期 (决定是否关注 POLLOUT)，并返回距到期的时间 */
+static bool MQTT_BrokerTxDue(MQTT_BrokerConn *conn, uint32_t now, uint32_t *wait)
+{
+    if (conn->txStart == conn->txEnd)
+        return false;
+
+    uint32_t due;
+    memcpy(&due, conn->tx + conn->txStart, 4);
+    int32_t remain = (int32_t)(due - now);
+    if (remain <= 0)
+        return true;
+    if ((uint32_t)remain < *wait)
+        *wait = (uint32_t)remain;
+    return false;
+}
+
+/* 转发 PUBLISH 给所有订阅者 (每个连接只投递一次，QoS 取匹配订阅的最大值与发布 QoS 的较小者)
+ * QoS > 0 的未确认转发达到客户端的 Receive Maximum 时，报文 (已分配 PacketID) 进入暂缓队列 */
+static void MQTT_BrokerForward(MQTT_Broker *broker, const uint8_t *topic, uint16_t topicLen,
+                               const uint8_t *payload, uint32_t payloadLen, uint8_t qos)
+{
+    for (int i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+    {
+        MQTT_BrokerConn *conn = &broker->conns[i];
+        if (conn->fd < 0)
+            continue;
+
+        int granted = -1;
+        for (uint8_t s = 0; s < conn->subCount; s++)
+        {
+            if (conn->subs[s].qos > granted &&
+                MQTT_BrokerTopicMatch(conn->subs[s].filter, (const char *)topic, topicLen))
+                granted = conn->subs[s].qos;
+        }
+        if (granted < 0)
+            continue;
+
+        /* v5 订阅者：PacketID 之后带一个空属性区 (转发时不使用别名) */
+        uint8_t q = (qos < granted) ? qos : (uint8_t)granted;
+        bool v5 = (conn->version == 5);
+        uint32_t rl = 2 + topicLen + (q ? 2 : 0) + (v5 ? 1 : 0) + payloadLen;
+        uint8_t lenBuf[4];
+        uint8_t ll = MQTT_BrokerEncodeLength(rl, lenBuf);
+        if (conn->maxPacket && 1 + ll + rl > conn->maxPacket)
+            continue;
+
+        bool hold = q > 0 && (conn->unacked >= conn->receiveMax || conn->heldStart < conn->heldEnd);
+        uint8_t *p = hold ? MQTT_BrokerHold(broker, conn, 1 + ll + rl) : MQTT_BrokerReserve(broker, conn, 1 + ll + rl);
+        if (!p)
+            continue;
+        if (q > 0 && !hold)
+            conn->unacked++;
+
+        *p++ = (uint8_t)(0x30 | (q << 1));
+        memcpy(p, lenBuf, ll);
+        p += ll;
+        *p++ = (uint8_t)(topicLen >> 8);
+        *p++ = (uint8_t)topicLen;
+        memcpy(p, topic, topicLen);
+        p += topicLen;
+        if (q)
+        {
+            if (++conn->nextPid == 0)
+                conn->nextPid = 1;
+            *p++ = (uint8_t)(conn->nextPid >> 8);
+            *p++ = (uint8_t)conn->nextPid;
+        }
+        if (v5)
+            *p++ = 0x00;
+        memcpy(p, payload, payloadLen);
+    }
+}
+
+/* 处理 SUBSCRIBE / UNSUBSCRIBE */
+static bool MQTT_BrokerSubscribe(MQTT_Broker *broker, MQTT_BrokerConn *conn,
+                                 const uint8_t *body, uint32_t len, bool unsubscribe)
+{
+    if (len < 2)
+        return false;
+
+    uint16_t pid = (uint16_t)((body[0] << 8) | body[1]);
+    uint8_t codes[MQTT_BROKER_MAX_SUBS];
+    uint8_t n = 0;
+    uint32_t pos = 2;
+    bool v5 = (conn->version == 5);
+
+    /* v5：PacketID 之后是属性区 */
+    if (v5)
+    {
+        uint32_t skip = MQTT_BrokerProps(body + pos, len - pos, NULL, NULL, NULL);
+        if (skip == 0)
+            return false;
+        pos += skip;
+    }
+
+    while (pos + 2 <= len)
+    {
+        uint16_t flen = (uint16_t)((body[pos] << 8) | body[pos + 1]);
+        pos += 2;
+        if (pos + flen + (unsubscribe ? 0 : 1) > len)
+            return false;
+
+        char filter[MQTT_BROKER_FILTER_MAX];
+        bool fits = flen < sizeof(filter);
+        if (fits)
+        {
+            memcpy(filter, body + pos, flen);
+            filter[flen] = '\0';
+        }
+        pos += flen;
+
+        /* 查找已有的相同过滤器 */
+        int idx = -1;
+        for (uint8_t s = 0; fits && s < conn->subCount; s++)
+        {
+            if (strcmp(conn->subs[s].filter, filter) == 0)
+                idx = s;
+        }
+
+        if (unsubscribe)
+        {
+            if (idx >= 0)
+                conn->subs[idx] = conn->subs[--conn->subCount];
+            if (n < MQTT_BROKER_MAX_SUBS)
+                codes[n++] = (idx >= 0) ? 0x00 : 0x11; /* v5 UNSUBACK 原因码：0x11 没有该订阅 */
+            continue;
+        }
+
+        uint8_t qos = body[pos++] & 0x03;
+        if (idx < 0 && fits && conn->subCount < MQTT_BROKER_MAX_SUBS)
+        {
+            idx = conn->subCount++;
+            strcpy(conn->subs[idx].filter, filter);
+        }
+        if (idx >= 0)
+            conn->subs[idx].qos = qos;
+        if (n < MQTT_BROKER_MAX_SUBS)
+            codes[n++] = (idx >= 0) ? qos : 0x80;
+    }
+
+    if (unsubscribe && !v5)
+    {
+        MQTT_BrokerSendAck(broker, conn, 0xB0, pid);
+        return true;
+    }
+
+    /* SUBACK / v5 UNSUBACK：[PacketID][空属性区 (v5)][各过滤器的返回码] */
+    uint8_t hl = v5 ? 5 : 4;
+    uint8_t *p = MQTT_BrokerReserve(broker, conn, hl + n);
+    if (p)
+    {
+        p[0] = unsubscribe ? 0xB0 : 0x90;
+        p[1] = (uint8_t)(hl - 2 + n);
+        p[2] = (uint8_t)(pid >> 8);
+        p[3] = (uint8_t)pid;
+        if (v5)
+            p[4] = 0x00;
+        memcpy(p + hl, codes, n);
+    }
+    return true;
+}
+
+/* 处理一个完整报文，返回 false 表示需要断开连接 */
+static bool MQTT_BrokerHandle(MQTT_Broker *broker, MQTT_BrokerConn *conn,
+                              const uint8_t *pkt, uint32_t hdrLen, uint32_t bodyLen)
+{
+    const uint8_t *body = pkt + hdrLen;
+    uint8_t type = pkt[0] & 0xF0;
+
+    broker->stats.packetsIn++;
+
+    /* 丢包注入。MQTT 5 PUBLISH 中的主题别名约定照常记录：TCP 上字节不会丢失，
+     * 这里模拟的是报文的处理结果丢失，否则之后只带别名的报文会被误判为协议错误 */
+    bool lost = MQTT_BrokerLose(broker);
+    if (lost && !(type == 0x30 && conn->version == 5))
+        return true;
+
+    switch (type)
+    {
+    case 0x10: /* CONNECT：[00 04 "MQTT"][版本][标志][心跳 2B][属性区 (v5)]... */
+    {
+        broker->stats.connects++;
+        conn->subCount = 0;
+        conn->version = (bodyLen >= 7) ? body[6] : 4;
+        conn->maxPacket = 0;
+        conn->receiveMax = 0;
+        conn->unacked = 0;
+        conn->heldStart = conn->heldEnd = 0;
+        conn->rxQos2Count = 0;
+        memset(conn->aliases, 0, sizeof(conn->aliases));
+        memset(conn->rxQos2, 0, sizeof(conn->rxQos2));
+
+        if (conn->version != 5)
+        {
+            uint8_t *p = MQTT_BrokerReserve(broker, conn, 4);
+            if (p)
+            {
+                p[0] = 0x20;
+                p[1] = 2;
+                p[2] = 0;
+                p[3] = 0;
+            }
+            conn->receiveMax = 0xFFFF;
+            return true;
+        }
+
+        if (bodyLen < 10 || MQTT_BrokerProps(body + 10, bodyLen - 10, NULL, &conn->maxPacket, &conn->receiveMax) == 0)
+            return false;
+        if (conn->receiveMax == 0)
+            conn->receiveMax = 0xFFFF; /* 未声明 (0 本身是协议错误，同样按不限处理) */
+
+        /* v5 CONNACK：[标志][原因码][属性：Topic Alias Maximum, Receive Maximum] */
+        uint8_t propsLen = broker->cfg.receiveMax ? 6 : 3;
+        uint8_t *p = MQTT_BrokerReserve(broker, conn, 5 + propsLen);
+        if (p)
+        {
+            p[0] = 0x20;
+            p[1] = (uint8_t)(3 + propsLen);
+            p[2] = 0;
+            p[3] = 0;
+            p[4] = propsLen;
+            p[5] = 0x22;
+            p[6] = (uint8_t)(MQTT_BROKER_ALIAS_MAX >> 8);
+            p[7] = (uint8_t)MQTT_BROKER_ALIAS_MAX;
+            if (broker->cfg.receiveMax)
+            {
+                p[8] = 0x21;
+                p[9] = (uint8_t)(broker->cfg.receiveMax >> 8);
+                p[10] = (uint8_t)broker->cfg.receiveMax;
+            }
+        }
+        return true;
+    }
+    case 0x30: /* PUBLISH */
+    {
+        uint8_t qos = (pkt[0] >> 1) & 0x03;
+        if (bodyLen < 2)
+            return false;
+        uint16_t topicLen = (uint16_t)((body[0] << 8) | body[1]);
+        const uint8_t *topic = body + 2;
+        uint32_t pos = 2 + topicLen;
+        uint16_t pid = 0;
+        if (qos > 0)
+        {
+            if (pos + 2 > bodyLen)
+                return false;
+            pid = (uint16_t)((body[pos] << 8) | body[pos + 1]);
+            pos += 2;
+        }
+        if (pos > bodyLen || qos == 3)
+            return false;
+
+        /* v5：属性区中的主题别名。带 Topic 时建立 (或更新) 约定，Topic 为空时按别名查找 */
+        if (conn->version == 5)
+        {
+            uint16_t alias = 0;
+            uint32_t skip = MQTT_BrokerProps(body + pos, bodyLen - pos, &alias, NULL, NULL);
+            if (skip == 0 || alias > MQTT_BROKER_ALIAS_MAX || (topicLen == 0 && alias == 0))
+                return false;
+            pos += skip;
+
+            if (alias && topicLen > 0)
+            {
+                if (topicLen > MQTT_BROKER_TOPIC_MAX)
+                    return false;
+                memcpy(conn->aliases[alias - 1].topic, topic, topicLen);
+                conn->aliases[alias - 1].len = topicLen;
+            }
+            else if (alias)
+            {
+                MQTT_BrokerAlias *a = &conn->aliases[alias - 1];
+                if (a->len == 0)
+                    return false; /* 未约定的别名：协议错误 */
+                topic = (const uint8_t *)a->topic;
+                topicLen = a->len;
+                broker->stats.aliasHits++;
+            }
+            if (lost)
+                return true;
+        }
+
+        if (qos == 1)
+        {
+            MQTT_BrokerSendAck(broker, conn, 0x40, pid);
+        }
+        else if (qos == 2)
+        {
+            /* 等待 PUBREL 的 PacketID 再次出现是重发：只回复 PUBREC，不重复转发 */
+            uint8_t bit = (uint8_t)(1u << (pid & 7));
+            MQTT_BrokerSendAck(broker, conn, 0x50, pid);
+            if (conn->rxQos2[pid >> 3] & bit)
+                return true;
+
+            /* QoS 1 立即确认，客户端一侧未确认的 QoS 2 消息不少于这里的计数 */
+            if (broker->cfg.receiveMax && conn->rxQos2Count >= broker->cfg.receiveMax)
+                broker->stats.flowViolations++;
+            conn->rxQos2[pid >> 3] |= bit;
+            conn->rxQos2Count++;
+        }
+
+        MQTT_BrokerForward(broker, topic, topicLen, body + pos, bodyLen - pos, qos);
+        return true;
+    }
+    case 0x50: /* PUBREC (转发的 QoS 2 消息) -> PUBREL */
+        if (bodyLen >= 2)
+            MQTT_BrokerSendAck(broker, conn, 0x62, (uint16_t)((body[0] << 8) | body[1]));
+        return true;
+    case 0x60: /* PUBREL -> PUBCOMP */
+        if (bodyLen >= 2)
+        {
+            uint16_t pid = (uint16_t)((body[0] << 8) | body[1]);
+            uint8_t bit = (uint8_t)(1u << (pid & 7));
+            if (conn->rxQos2[pid >> 3] & bit)
+            {
+                conn->rxQos2[pid >> 3] &= (uint8_t)~bit;
+                conn->rxQos2Count--;
+            }
+            MQTT_BrokerSendAck(broker, conn, 0x70, pid);
+        }
+        return true;
+    case 0x40: /* PUBACK / PUBCOMP：不重发，只归还客户端的 Receive Maximum 配额 */
+    case 0x70:
+        MQTT_BrokerAcked(broker, conn);
+        return true;
+    case 0x80: /* SUBSCRIBE */
+        return MQTT_BrokerSubscribe(broker, conn, body, bodyLen, false);
+    case 0xA0: /* UNSUBSCRIBE */
+        return MQTT_BrokerSubscribe(broker, conn, body, bodyLen, true);
+    case 0xC0: /* PINGREQ */
+    {
+        uint8_t *p = MQTT_BrokerReserve(broker, conn, 2);
+        if (p)
+        {
+            p[0] = 0xD0;
+            p[1] = 0;
+        }
+        return true;
+    }
+    case 0xE0: /* DISCONNECT */
+    default:
+        return false;
+    }
+}
+
+/* 读取数据并处理其中所有完整报文 */
+static void MQTT_BrokerRead(MQTT_Broker *broker, MQTT_BrokerConn *conn)
+{
+    ssize_t n = recv(conn->fd, conn->rx + conn->rxLen, MQTT_BROKER_RX_SIZE - conn->rxLen, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        MQTT_BrokerClose(broker, conn);
+        return;
+    }
+    if (n < 0)
+        return;
+
+    broker->stats.bytesIn += (uint64_t)n;
+    conn->rxLen += (uint32_t)n;
+
+    uint32_t pos = 0;
+    while (conn->rxLen - pos >= 2)
+    {
+        /* 解码剩余长度 */
+        uint32_t rl = 0, mul = 1, i = 1;
+        bool complete = false;
+        while (i < 5 && pos + i < conn->rxLen)
+        {
+            uint8_t b = conn->rx[pos + i];
+            rl += (b & 0x7F) * mul;
+            mul *= 128;
+            i++;
+            if (!(b & 0x80))
+            {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete)
+        {
+            if (i == 5)
+                MQTT_BrokerClose(broker, conn);
+            break;
+        }
+
+        if (i + rl > MQTT_BROKER_RX_SIZE)
+        {
+            MQTT_BrokerClose(broker, conn);
+            return;
+        }
+        if (pos + i + rl > conn->rxLen)
+            break;
+
+        if (!MQTT_BrokerHandle(broker, conn, conn->rx + pos, i, rl))
+        {
+            MQTT_BrokerClose(broker, conn);
+            return;
+        }
+        pos += i + rl;
+    }
+
+    if (conn->fd >= 0 && pos > 0)
+    {
+        memmove(conn->rx, conn->rx + pos, conn->rxLen - pos);
+        conn->rxLen -= pos;
+    }
+}
+
+static void MQTT_BrokerAccept(MQTT_Broker *broker)
+{
+    for (;;)
+    {
+        int fd = accept(broker->listenFd, NULL, NULL);
+        if (fd < 0)
+            return;
+
+        MQTT_BrokerConn *conn = NULL;
+        for (int i = 0; i < MQTT_BROKER_MAX_CLIENTS && !conn; i++)
+        {
+            if (broker->conns[i].fd < 0)
+                conn = &broker->conns[i];
+        }
+        if (!conn)
+        {
+            close(fd);
+            continue;
+        }
+
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        if (!broker->cfg.unixPath)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        conn->fd = fd;
+        conn->rxLen = 0;
+        conn->txStart = conn->txEnd = conn->txOff = 0;
+        conn->txLast = MQTT_BROKER_TX_NONE;
+        conn->heldStart = conn->heldEnd = 0;
+        conn->unacked = 0;
+        conn->receiveMax = 0xFFFF;
+        conn->subCount = 0;
+        conn->nextPid = 0;
+        conn->version = 4;
+        conn->maxPacket = 0;
+    }
+}
+
+static void *MQTT_BrokerThread(void *arg)
+{
+    MQTT_Broker *broker = (MQTT_Broker *)arg;
+    struct pollfd pfds[MQTT_BROKER_MAX_CLIENTS + 1];
+    int map[MQTT_BROKER_MAX_CLIENTS + 1];
+
+    while (broker->running)
+    {
+        uint32_t now = MQTT_BrokerNow();
+        uint32_t wait = 10; /* 最长等待 10ms，及时响应停止请求 */
+        int n = 0;
+
+        pfds[n].fd = broker->listenFd;
+        pfds[n].events = POLLIN;
+        map[n++] = -1;
+        for (int i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+        {
+            MQTT_BrokerConn *conn = &broker->conns[i];
+            if (conn->fd < 0)
+                continue;
+            pfds[n].fd = conn->fd;
+            pfds[n].events = POLLIN;
+            if (MQTT_BrokerTxDue(conn, now, &wait))
+                pfds[n].events |= POLLOUT;
+            map[n++] = i;
+        }
+
+        if (poll(pfds, (nfds_t)n, (int)wait) < 0 && errno != EINTR)
+            break;
+
+        if (pfds[0].revents & POLLIN)
+            MQTT_BrokerAccept(broker);
+
+        for (int k = 1; k < n; k++)
+        {
+            MQTT_BrokerConn *conn = &broker->conns[map[k]];
+            if (pfds[k].revents & (POLLERR | POLLHUP | POLLNVAL))
+                MQTT_BrokerClose(broker, conn);
+            else if (pfds[k].revents & POLLIN)
+                MQTT_BrokerRead(broker, conn);
+        }
+
+        /* 处理读取时新产生的应答和转发 (延迟为 0 时立即发出) */
+        now = MQTT_BrokerNow();
+        for (int i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+        {
+            if (broker->conns[i].fd >= 0)
+                MQTT_BrokerFlush(broker, &broker->conns[i], now);
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================
+ * 对外接口
+ * ============================================================ */
+
+bool MQTT_BrokerTopicMatch(const char *filter, const char *topic, size_t topicLen)
+{
+    /* 以 '$' 开头的 Topic 不参与首层通配符匹配 */
+    if (topicLen > 0 && topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+        return false;
+
+    const char *fp = filter;
+    size_t ti = 0;
+    for (;;)
+    {
+        const char *fe = strchr(fp, '/');
+        size_t fl = fe ? (size_t)(fe - fp) : strlen(fp);
+
+        size_t ts = ti;
+        while (ti < topicLen && topic[ti] != '/')
+            ti++;
+        bool more = ti < topicLen;
+
+        if (fl == 1 && fp[0] == '#')
+            return true;
+        if (!(fl == 1 && fp[0] == '+') && (fl != ti - ts || memcmp(fp, topic + ts, fl) != 0))
+            return false;
+
+        if (!fe)
+            return !more;
+        if (!more)
+            return strcmp(fe + 1, "#") == 0; /* "a/#" 匹配 "a" */
+
+        fp = fe + 1;
+        ti++;
+    }
+}
+
+bool MQTT_BrokerStart(MQTT_Broker *broker, const MQTT_BrokerConfig *cfg)
+{
+    if (!broker || !cfg)
+        return false;
+
+    memset(&broker->stats, 0, sizeof(broker->stats));
+    broker->cfg = *cfg;
+    broker->rng = cfg->seed ? cfg->seed : 0x9E3779B9u;
+    for (int i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+        broker->conns[i].fd = -1;
+
+    int fd;
+    if (cfg->unixPath)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(cfg->unixPath) >= sizeof(addr.sun_path))
+            return false;
+        strcpy(addr.sun_path, cfg->unixPath);
+        unlink(cfg->unixPath);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+            goto fail;
+        broker->port = 0;
+    }
+    else
+    {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg->port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+            bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+            goto fail;
+
+        socklen_t len = sizeof(addr);
+        getsockname(fd, (struct sockaddr *)&addr, &len);
+        broker->port = ntohs(addr.sin_port);
+    }
+
+    if (listen(fd, 128) != 0)
+        goto fail;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    broker->listenFd = fd;
+    broker->running = true;
+    if (pthread_create(&broker->thread, NULL, MQTT_BrokerThread, broker) != 0)
+    {
+        broker->running = false;
+        goto fail;
+    }
+    return true;
+
+fail:
+    if (fd >= 0)
+        close(fd);
+    return false;
+}
+
+void MQTT_BrokerStop(MQTT_Broker *broker)
+{
+    if (!broker || !broker->running)
+        return;
+
+    broker->running = false;
+    pthread_join(broker->thread, NULL);
+
+    for (int i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+        MQTT_BrokerClose(broker, &broker->conns[i]);
+    close(broker->listenFd);
+    if (broker->cfg.unixPath)
+        unlink(broker->cfg.unixPath);
+}
@@ -0,0 +1,156 @@
+#ifndef __MQTT_BROKER_H__
+#define __MQTT_BROKER_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* ============================================================
+ * 进程内 MQTT Broker 替身 (仅用于测试与压测，Linux)
+ * 单线程 poll 循环，支持 CONNECT / SUBSCRIBE / UNSUBSCRIBE / PUBLISH (QoS 0/1/2) / PING。
+ * 支持 MQTT 3.1.1 与 5.0 (主题别名、Receive Maximum、属性区)，不同版本的客户端可以互相订阅。
+ * 转发给 MQTT 5 客户端的 QoS > 0 消息遵守客户端声明的 Receive Maximum，超出的部分暂缓到有确认归还配额
+ * (Broker 不重发，丢包注入丢掉的确认不会归还配额)；
+ * 客户端发来的 QoS 2 消息超出 cfg.receiveMax 时计入 stats.flowViolations。
+ * 不保存会话、不重发、不处理 Retain；可注入固定延迟、随机丢包与相邻报文乱序。
+ * ============================================================ */
+
+#ifndef MQTT_BROKER_MAX_CLIENTS
+#define MQTT_BROKER_MAX_CLIENTS 64
+#endif
+
+/* 每个连接的订阅数上限与过滤器最大长度 */
+#ifndef MQTT_BROKER_MAX_SUBS
+#define MQTT_BROKER_MAX_SUBS 16
+#endif
+#ifndef MQTT_BROKER_FILTER_MAX
+#define MQTT_BROKER_FILTER_MAX 128
+#endif
+
+/* MQTT 5：每个连接可用的主题别名数 (CONNACK 中的 Topic Alias Maximum) 与别名对应主题的最大长度 */
+#ifndef MQTT_BROKER_ALIAS_MAX
+#define MQTT_BROKER_ALIAS_MAX 16
+#endif
+#ifndef MQTT_BROKER_TOPIC_MAX
+#define MQTT_BROKER_TOPIC_MAX 256
+#endif
+
+/* 每个连接的接收/发送缓冲区大小 (接收缓冲区决定可接收的最大报文) */
+#ifndef MQTT_BROKER_RX_SIZE
+#define MQTT_BROKER_RX_SIZE (64 * 1024)
+#endif
+#ifndef MQTT_BROKER_TX_SIZE
+#define MQTT_BROKER_TX_SIZE (256 * 1024)
+#endif
+
+#define MQTT_BROKER_TX_NONE 0xFFFFFFFFu
+
+/* 每个连接暂缓转发队列的大小 (超出客户端 Receive Maximum 的 QoS > 0 消息) */
+#ifndef MQTT_BROKER_HELD_SIZE
+#define MQTT_BROKER_HELD_SIZE (64 * 1024)
+#endif
+
+/* 启动参数 */
+typedef struct
+{
+    const char *unixPath; /* 非 NULL 时监听 Unix 域套接字，否则监听 127.0.0.1:port */
+    uint16_t port;        /* TCP 端口 (0 表示由系统分配，启动后从 MQTT_Broker::port 读取) */
+    uint32_t latencyMs;   /* 发出的每个报文延迟该时间后才写入套接字 (模拟网络 RTT 的一半) */
+    uint8_t lossPct;      /* 收到和发出的报文各自按该概率 (0~100) 丢弃 */
+    uint32_t seed;        /* 丢包随机数种子 */
+    uint16_t receiveMax;  /* MQTT 5：CONNACK 中声明的 Receive Maximum (0 表示不声明，即 65535) */
+    uint8_t reorderPct;   /* 发出的报文按该概率 (0~100) 与发送队列中的前一个报文交换顺序 (需有报文排队，配合延迟使用) */
+} MQTT_BrokerConfig;
+
+/* MQTT 5 主题别名 */
+typedef struct
+{
+    uint16_t len; /* 0 表示未约定 */
+    char topic[MQTT_BROKER_TOPIC_MAX];
+} MQTT_BrokerAlias;
+
+/* 订阅 */
+typedef struct
+{
+    char filter[MQTT_BROKER_FILTER_MAX];
+    uint8_t qos;
+} MQTT_BrokerSub;
+
+/* 客户端连接 */
+typedef struct
+{
+    int fd;                          /* -1 表示空闲 */
+    uint8_t rx[MQTT_BROKER_RX_SIZE]; /* 未处理完的接收数据 */
+    uint32_t rxLen;
+    uint8_t tx[MQTT_BROKER_TX_SIZE]; /* 待发送队列：[到期时刻 4B][长度 4B][报文] 依次排列 */
+    uint32_t txStart;                /* 队首记录位置 */
+    uint32_t txEnd;                  /* 队尾 */
+    uint32_t txOff;                  /* 队首报文已写出的字节数 */
+    uint32_t txLast;                 /* 最后放入队列的记录位置 (乱序注入用，MQTT_BROKER_TX_NONE 表示没有) */
+    MQTT_BrokerSub subs[MQTT_BROKER_MAX_SUBS];
+    uint8_t subCount;
+    uint16_t nextPid;                /* 转发时使用的 PacketID */
+    uint8_t version;                 /* CONNECT 中的协议版本 (4 或 5) */
+    uint32_t maxPacket;              /* MQTT 5：客户端声明的最大报文 (0 表示不限，超过的转发被丢弃) */
+    MQTT_BrokerAlias aliases[MQTT_BROKER_ALIAS_MAX]; /* 客户端发来的主题别名 */
+    uint16_t receiveMax;             /* 客户端的 Receive Maximum (MQTT 5 CONNECT 属性，未声明或 v3 为 65535) */
+    uint16_t unacked;                /* 已转发、尚未收到 PUBACK / PUBCOMP 的 QoS > 0 消息数 */
+    uint8_t held[MQTT_BROKER_HELD_SIZE]; /* 暂缓转发队列：[长度 4B][报文] 依次排列 */
+    uint32_t heldStart;
+    uint32_t heldEnd;
+    uint8_t rxQos2[8192];            /* 客户端发来、等待 PUBREL 的 QoS 2 PacketID (位图) */
+    uint16_t rxQos2Count;
+} MQTT_BrokerConn;
+
+/* 统计 (Broker 线程写，读取时为近似值) */
+typedef struct
+{
+    uint64_t connects;
+    uint64_t packetsIn;
+    uint64_t packetsOut;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t dropped;  /* 丢包注入丢弃的报文 */
+    uint64_t overflow; /* 发送队列已满丢弃的报文 */
+    uint64_t aliasHits; /* 只带主题别名的 PUBLISH */
+    uint64_t reordered; /* 乱序注入交换顺序的报文 */
+    uint64_t held;      /* 因客户端 Receive Maximum 暂缓转发的报文 */
+    uint64_t flowViolations; /* 客户端等待 PUBREL 的 QoS 2 消息超出 cfg.receiveMax 的次数 */
+} MQTT_BrokerStats;
+
+/* Broker 控制块 (体积较大，请静态分配) */
+typedef struct
+{
+    MQTT_BrokerConfig cfg;
+    int listenFd;
+    uint16_t port; /* 实际监听的 TCP 端口 */
+    pthread_t thread;
+    volatile bool running;
+    uint32_t rng;
+    MQTT_BrokerStats stats;
+    MQTT_BrokerConn conns[MQTT_BROKER_MAX_CLIENTS];
+} MQTT_Broker;
+
+/**
+ * @brief 创建监听套接字并启动 Broker 线程
+ * @return true 成功; false 监听失败
+ */
+bool MQTT_BrokerStart(MQTT_Broker *broker, const MQTT_BrokerConfig *cfg);
+
+/* 停止 Broker 线程并关闭所有连接 */
+void MQTT_BrokerStop(MQTT_Broker *broker);
+
+/* 过滤器匹配 ('+' 单层，'#' 多层) */
+bool MQTT_BrokerTopicMatch(const char *filter, const char *topic, size_t topicLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_BROKER_H__ */
@@ -0,0 +1,1121 @@
+/* ============================================================
+ * mqtt_fuzz：报文解析的模糊测试与往返性质测试
+ * 被测对象为处理服务器字节流的全部入口：MQTT_ParsePublishMessage、MQTT_Check*Ack，
+ * 以及客户端接收路径 (环形区分帧 -> 剩余长度解码 -> ACK 匹配 / QoS 2 状态，MQTT 3.1.1 与 5)。
+ * MQTT_DecodeLength 为内部函数，由这些入口覆盖，并与本文件的参考解码器逐个输入比较。
+ * 按开启的可选功能 (MQTT_ENABLE_*) 同时覆盖订阅分发与流式交付 (ROUTER)、最新值缓存 (CACHE)
+ * 与 MQTT_DecompressPayload (COMPRESS)。
+ *
+ * 输入格式：第 1 字节为配置 (见 FUZZ_CFG_*)，其余为服务器发来的字节流。
+ *
+ * 用法：
+ *   mqtt_fuzz -g dir                    由报文构建函数生成种子语料
+ *   mqtt_fuzz [-r n] file|dir ...       逐个回放输入 (崩溃复现、AFL)，-r 重复 n 遍并输出解析吞吐
+ *   mqtt_fuzz -p n [-S seed]            随机往返性质测试：构建 -> 解析 -> 比较，共 n 轮
+ *   mqtt_fuzz -q n [-S seed]            QoS 2 接收测试：服务器一次发来大量 QoS 2 消息，双向丢包并乱序，共 n 轮
+ *
+ * 编译 (在 mqtt 目录下，不需要 port/posix)：
+ *   回放与性质测试 (gcc / clang)，只测报文解析与客户端核心：
+ *     gcc -std=c99 -O1 -g -fsanitize=address,undefined tools/mqtt_fuzz.c mqtt.c mqtt_hal.c -o mqtt_fuzz
+ *   同时覆盖订阅分发、流式交付、缓存与解压：
+ *     gcc -std=c99 -O1 -g -fsanitize=address,undefined -DMQTT_ENABLE_ROUTER=1 -DMQTT_ENABLE_CACHE=1 \
+ *         -DMQTT_ENABLE_COMPRESS=1 tools/mqtt_fuzz.c mqtt.c mqtt_hal.c mqtt_router.c mqtt_cache.c mqtt_compress.c \
+ *         ../mem_pool/mem_pool.c ../lzss/lzss.c ../CRC_Lib/CRC_Lib.c -o mqtt_fuzz
+ *   libFuzzer (不含 main，直接使用上面生成的种子)：
+ *     clang -O1 -g -fsanitize=fuzzer,address,undefined -DMQTT_FUZZ_LIBFUZZER tools/mqtt_fuzz.c <同上源文件> -o mqtt_fuzz_lf
+ *     ./mqtt_fuzz -g corpus && ./mqtt_fuzz_lf -max_len=4096 corpus
+ *   AFL++：
+ *     用 afl-clang-fast 按 gcc 命令编译，afl-fuzz -i corpus -o findings -- ./mqtt_fuzz @@
+ * ============================================================ */
+#define _POSIX_C_SOURCE 200809L
+#include "../mqtt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef MQTT_FUZZ_LIBFUZZER
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/* 配置字节 */
+#define FUZZ_CFG_V5 0x01        /* 使用 MQTT 5 */
+#define FUZZ_CFG_STREAM 0x02    /* 注册流式过滤器 s/# (MQTT_ENABLE_ROUTER) */
+#define FUZZ_CFG_SMALL_RX 0x04  /* 接收区只有 64 字节 (覆盖回绕拼接、超长丢弃) */
+#define FUZZ_CFG_PAUSE 0x08     /* 流式处理函数每次只处理一半 (覆盖背压) */
+#define FUZZ_CFG_CHUNK_SHIFT 4  /* 高 4 位：每次 recv 返回的最大字节数 (见 g_chunks) */
+
+/* 单个输入的最大长度 (更长的部分被忽略) */
+#define FUZZ_MAX_INPUT 65536
+
+/* 性质测试的最大 Payload：覆盖 3 字节剩余长度 */
+#define FUZZ_PAYLOAD_MAX 70000
+#define FUZZ_TOPIC_MAX 300
+
+/* 接收区：性质测试中能整包容纳最大的 PUBLISH */
+#define FUZZ_RX_SIZE (2 * (FUZZ_PAYLOAD_MAX + FUZZ_TOPIC_MAX + 16))
+
+/* 断言失败时直接 abort，libFuzzer / AFL 按崩溃记录该输入 */
+#define FUZZ_CHECK(cond)                                                              \
+    do                                                                                \
+    {                                                                                 \
+        if (!(cond))                                                                  \
+        {                                                                             \
+            fprintf(stderr, "mqtt_fuzz: check failed at line %d: %s\n", __LINE__, #cond); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+static const uint32_t g_chunks[16] = {1, 2, 3, 5, 7, 13, 16, 31, 64, 100, 127, 256, 1000, 4096, 65536, 0xFFFFFFFF};
+
+typedef struct
+{
+    MQTT_Client client;
+    MQTT_TopicAlias aliases[2];
+#if MQTT_ENABLE_ROUTER
+    MQTT_Router router;
+    uint8_t routerArena[MQTT_ROUTER_ARENA_SIZE(8, 32)];
+#endif
+#if MQTT_ENABLE_CACHE
+    MQTT_Cache cache;
+    uint8_t cacheArena[MQTT_CACHE_ARENA_SIZE(4)];
+    mem_pool_t cachePool;
+    uint8_t cachePoolArena[MP_ARENA_SIZE(MP_CLASS_BYTES(64, 3) + MP_CLASS_BYTES(1024, 1))];
+#endif
+
+    /* 传输层：从输入读取，发出的报文记录在 out 中 */
+    const uint8_t *in;
+    size_t inLen;
+    size_t inPos;
+    uint32_t chunk;
+    uint8_t out[4096];
+    size_t outLen;
+    bool pause;
+
+    /* 交付给应用的消息 */
+    uint32_t messages;
+    size_t lastLen;
+    uint32_t streamBegins;
+    uint32_t streamEnds;
+    size_t streamLen;
+    bool streamOpen;
+    uint8_t *seen; /* 非 NULL 时按 Payload 前 2 字节 (消息序号) 统计每条消息的交付次数 */
+
+    uint8_t txBuf[512];
+    uint8_t rxBuf[FUZZ_RX_SIZE];
+    uint8_t topicBuf[FUZZ_TOPIC_MAX + 1];
+    char payloadBuf[FUZZ_PAYLOAD_MAX + 1];
+    uint8_t lastTopic[FUZZ_TOPIC_MAX + 1];
+    uint8_t last[FUZZ_PAYLOAD_MAX];
+} FuzzCtx;
+
+static FuzzCtx g_ctx;
+static uint32_t g_tick;
+
+/* --------------------------------------------------------------------------
+ * HAL 与传输层
+ * -------------------------------------------------------------------------- */
+
+/* 虚拟时钟：每轮 MQTT_ProcessLoop 前进固定步长，重发与超时路径可复现 */
+uint32_t HAL_MQTT_GetTick(void)
+{
+    return g_tick;
+}
+
+static void FuzzSend(void *ctx, const uint8_t *buf, size_t len)
+{
+    FuzzCtx *f = ctx;
+    size_t n = (len < sizeof(f->out) - f->outLen) ? len : sizeof(f->out) - f->outLen;
+    memcpy(&f->out[f->outLen], buf, n);
+    f->outLen += n;
+}
+
+static int FuzzRecv(void *ctx, uint8_t *buf, size_t bufSize, uint32_t timeoutMs)
+{
+    FuzzCtx *f = ctx;
+    (void)timeoutMs;
+    size_t n = f->inLen - f->inPos;
+    if (n > bufSize)
+        n = bufSize;
+    if (n > f->chunk)
+        n = f->chunk;
+    memcpy(buf, &f->in[f->inPos], n);
+    f->inPos += n;
+    return (int)n;
+}
+
+static const MQTT_Transport g_fuzzTransport = {FuzzSend, NULL, FuzzRecv};
+
+static void FuzzOnMessage(MQTT_Client *client, const char *topic, const char *payload, size_t len, void *ctx)
+{
+    FuzzCtx *f = ctx;
+    FUZZ_CHECK(len <= client->msgPayloadBufSize && strlen(topic) < client->msgTopicBufSize);
+    f->messages++;
+    if (f->seen && len >= 2)
+        f->seen[((uint8_t)payload[0] << 8) | (uint8_t)payload[1]]++;
+    f->lastLen = len;
+    strcpy((char *)f->lastTopic, topic);
+    memcpy(f->last, payload, len);
+}
+
+/* 没有订阅分发器 (或没有匹配的过滤器) 时的全局回调 */
+void HAL_MQTT_OnPublishReceived(const char *topic, const char *payload, size_t len)
+{
+    FuzzOnMessage(&g_ctx.client, topic, payload, len, &g_ctx);
+}
+
+#if MQTT_ENABLE_CACHE
+/* 遍历缓存：累计条目数与 Topic + Payload 字节数 */
+static bool FuzzCacheVisit(const char *topic, const uint8_t *payload, size_t len, uint32_t tick, void *ctx)
+{
+    uint32_t *sum = ctx;
+    (void)payload;
+    (void)tick;
+    sum[0]++;
+    sum[1] += (uint32_t)(strlen(topic) + len);
+    return true;
+}
+#endif
+
+#if MQTT_ENABLE_ROUTER
+static int32_t FuzzOnStream(MQTT_Client *client, MQTT_StreamEvent event, const MQTT_StreamChunk *chunk, void *ctx)
+{
+    FuzzCtx *f = ctx;
+    (void)client;
+    switch (event)
+    {
+    case MQTT_STREAM_BEGIN:
+        FUZZ_CHECK(!f->streamOpen);
+        f->streamOpen = true;
+        f->streamBegins++;
+        f->streamLen = 0;
+        strncpy((char *)f->lastTopic, chunk->topic, FUZZ_TOPIC_MAX);
+        return 0;
+    case MQTT_STREAM_DATA:
+    {
+        FUZZ_CHECK(f->streamOpen && chunk->len > 0 && chunk->offset == f->streamLen);
+        FUZZ_CHECK(chunk->offset + chunk->len <= chunk->totalLen);
+        uint32_t n = f->pause ? (chunk->len + 1) / 2 : chunk->len;
+        if (f->streamLen + n <= sizeof(f->last))
+            memcpy(&f->last[f->streamLen], chunk->data, n);
+        f->streamLen += n;
+        return (int32_t)n;
+    }
+    case MQTT_STREAM_END:
+        FUZZ_CHECK(f->streamOpen && f->streamLen == chunk->totalLen);
+        f->streamOpen = false;
+        f->streamEnds++;
+        return 0;
+    default:
+        FUZZ_CHECK(f->streamOpen);
+        f->streamOpen = false;
+        return 0;
+    }
+}
+#endif
+
+/* 建立一个已提交 CONNECT、SUBSCRIBE(1)、PUBLISH QoS1(2)、PUBLISH QoS2(3)、UNSUBSCRIBE(4) 的客户端，
+ * 服务器字节流中的 ACK 可以匹配到这些请求 */
+static void FuzzClientInit(FuzzCtx *f, uint8_t cfg, size_t rxSize)
+{
+    memset(&f->client, 0, sizeof(f->client));
+    f->outLen = 0;
+    f->messages = 0;
+    f->lastLen = 0;
+    f->streamBegins = f->streamEnds = 0;
+    f->streamOpen = false;
+    f->seen = NULL;
+    f->pause = (cfg & FUZZ_CFG_PAUSE) != 0;
+    f->chunk = g_chunks[cfg >> FUZZ_CFG_CHUNK_SHIFT];
+
+    MQTT_Client *c = &f->client;
+    c->txBuf = f->txBuf;
+    c->txBufSize = sizeof(f->txBuf);
+    c->rxBuf = f->rxBuf;
+    c->rxBufSize = (cfg & FUZZ_CFG_SMALL_RX) ? 64 : rxSize;
+    c->msgTopicBuf = f->topicBuf;
+    c->msgTopicBufSize = sizeof(f->topicBuf);
+    c->msgPayloadBuf = f->payloadBuf;
+    c->msgPayloadBufSize = sizeof(f->payloadBuf);
+    c->clientId = "fuzz";
+    c->keepAlive = 1;
+    c->retryIntervalMs = 20;
+    c->maxRetrys = 2;
+    c->transport = &g_fuzzTransport;
+    c->transportCtx = f;
+    if (cfg & FUZZ_CFG_V5)
+    {
+        c->protocolVersion = MQTT_VERSION_5;
+        c->topicAliases = f->aliases;
+        c->topicAliasCount = 2;
+    }
+
+#if MQTT_ENABLE_ROUTER
+    MQTT_RouterInit(&f->router, f->routerArena, sizeof(f->routerArena), 8);
+    MQTT_RouterAdd(&f->router, "#", FuzzOnMessage, f);
+    if (cfg & FUZZ_CFG_STREAM)
+        MQTT_RouterAddStream(&f->router, "s/#", FuzzOnStream, f);
+    c->router = &f->router;
+#endif
+
+#if MQTT_ENABLE_CACHE
+    /* 小容量缓存：表项、字节预算与内存池都会触发淘汰 */
+    mp_init(&f->cachePool, f->cachePoolArena, sizeof(f->cachePoolArena));
+    mp_add_class(&f->cachePool, 64, 3);
+    mp_add_class(&f->cachePool, 1024, 1);
+    MQTT_CacheInit(&f->cache, f->cacheArena, sizeof(f->cacheArena), 4, &f->cachePool, 1500);
+    c->cache = &f->cache;
+#endif
+
+    g_tick = 1000;
+    MQTT_Submit(c, MQTT_OP_CONNECT, NULL, NULL);
+    c->isConnected = true;
+    c->subTopic = "s/#";
+    c->qos = 1;
+    MQTT_Submit(c, MQTT_OP_SUBSCRIBE, NULL, NULL);
+    c->pubTopic = "t/a";
+    c->pubMsg = "x";
+    MQTT_Submit(c, MQTT_OP_PUBLISH, NULL, NULL);
+    c->qos = 2;
+    MQTT_Submit(c, MQTT_OP_PUBLISH, NULL, NULL);
+    MQTT_Submit(c, MQTT_OP_UNSUBSCRIBE, NULL, NULL);
+}
+
+/* 把字节流交给客户端，直到全部读完且接收区不再变化 */
+static void FuzzClientRun(FuzzCtx *f, const uint8_t *data, size_t len)
+{
+    f->in = data;
+    f->inLen = len;
+    f->inPos = 0;
+
+    uint32_t idle = 0;
+    for (size_t i = 0; i < len + 64 && idle < 4; i++)
+    {
+        size_t before = f->inPos;
+        MQTT_ProcessLoop(&f->client);
+        g_tick += 7;
+        idle = (f->inPos == before && f->inPos == len) ? idle + 1 : 0;
+
+        /* 接收区读写位置不越界；QoS 2 状态表不超出容量；缓存不超出容量与预算 */
+        const MQTT_Ring *rb = &f->client.rxRing;
+        FUZZ_CHECK(!rb->buffer || (rb->head <= rb->mask && rb->tail <= rb->mask));
+        FUZZ_CHECK(f->client.rxQos2Count <= MQTT_RX_QOS2_MAX);
+#if MQTT_ENABLE_CACHE
+        uint32_t sum[2] = {0, 0};
+        MQTT_CacheForEach(&f->cache, NULL, FuzzCacheVisit, sum);
+        FUZZ_CHECK(f->cache.count <= f->cache.cap && f->cache.used <= f->cache.budget);
+        FUZZ_CHECK(sum[0] == f->cache.count && sum[1] == f->cache.used);
+#endif
+    }
+
+    /* QoS 2 状态表中没有 PacketID 0，也没有重复项 */
+    for (uint16_t k = 0; k < f->client.rxQos2Count; k++)
+    {
+        FUZZ_CHECK(f->client.rxQos2[k] != 0);
+        for (uint16_t j = 0; j < k; j++)
+            FUZZ_CHECK(f->client.rxQos2[j] != f->client.rxQos2[k]);
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * 无状态解析函数
+ * -------------------------------------------------------------------------- */
+
+/* 参考实现：按协议解码剩余长度，返回报文总长度，格式错误或数据不足返回 0 */
+static size_t FuzzPacketLength(const uint8_t *d, size_t n)
+{
+    uint32_t value = 0;
+    for (size_t i = 1; i < n && i <= 4; i++)
+    {
+        value |= (uint32_t)(d[i] & 0x7F) << (7 * (i - 1));
+        if ((d[i] & 0x80) == 0)
+            return 1 + i + value;
+    }
+    return 0;
+}
+
+static void FuzzDecoders(const uint8_t *d, size_t n)
+{
+    static uint8_t topic[FUZZ_MAX_INPUT + 1];
+    static char payload[FUZZ_MAX_INPUT + 1];
+    uint16_t packetId = 0;
+
+    int ret = MQTT_ParsePublishMessage(d, n, topic, sizeof(topic), payload, sizeof(payload), &packetId);
+    size_t total = FuzzPacketLength(d, n);
+    if (ret >= 0)
+    {
+        /* 成功时报文必须完整，Payload 是报文的最后 ret 字节 */
+        FUZZ_CHECK(total > 0 && total <= n && (d[0] & 0xF0) == 0x30);
+        FUZZ_CHECK((size_t)ret + 4 <= total && memcmp(payload, &d[total - ret], ret) == 0 && payload[ret] == 0);
+    }
+    else if (total > 0 && total <= n && (d[0] & 0xF0) == 0x30)
+    {
+        /* 完整的 PUBLISH 只会因格式错误失败 */
+        FUZZ_CHECK(ret == -3);
+    }
+
+    /* 小缓冲区：Topic 截断、Payload 放不下 */
+    MQTT_ParsePublishMessage(d, n, topic, 1, payload, 1, &packetId);
+    MQTT_ParsePublishMessage(d, n, topic, 8, payload, 16, &packetId);
+
+    uint16_t id = (n >= 4) ? (uint16_t)((d[2] << 8) | d[3]) : 0;
+    bool ok = MQTT_CheckPubAck(d, n, id);
+    FUZZ_CHECK(!ok || (n >= 4 && d[0] == 0x40));
+    ok = MQTT_CheckSubAck(d, n, id, 2);
+    FUZZ_CHECK(!ok || (n >= 5 && d[0] == 0x90 && d[4] <= 2));
+    MQTT_CheckConnAck(d, n);
+    MQTT_CheckUnsubAck(d, n, id);
+    MQTT_CheckPingResp(d, n);
+
+#if MQTT_ENABLE_COMPRESS
+    /* 整个输入作为 Payload 解压：不是压缩帧时原样返回，还原结果不超过 rxBuf */
+    static uint8_t unpacked[4096];
+    static MQTT_Compress cz;
+    static const char dict[] = "{\"temp\":23.5,\"hum\":61.2}";
+    if (!cz.rxBuf)
+    {
+        MQTT_CompressInit(&cz, NULL, 0, LZSS_WINDOW_MAX, LZSS_LOOKAHEAD_MIN, unpacked, sizeof(unpacked));
+        MQTT_CompressSetDict(&cz, dict, sizeof(dict) - 1);
+    }
+    size_t outLen = 0;
+    const uint8_t *out = MQTT_DecompressPayload(&cz, d, n, &outLen);
+    FUZZ_CHECK(out == NULL || (out >= d && out + outLen == d + n) || (out == unpacked && outLen < sizeof(unpacked)));
+#endif
+}
+
+/* 模糊测试入口 (libFuzzer 约定) */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    /* 首字节选择客户端配置，之后至少要有 1 字节报文数据 */
+    if (size <= 1)
+        return 0;
+    if (size > FUZZ_MAX_INPUT)
+        size = FUZZ_MAX_INPUT;
+
+    /* 拷贝到精确大小的堆内存，越界读由 ASan 报告 */
+    uint8_t *body = malloc(size - 1);
+    if (!body)
+        return 0;
+    memcpy(body, data + 1, size - 1);
+
+    FuzzDecoders(body, size - 1);
+    FuzzClientInit(&g_ctx, data[0], 1024);
+    FuzzClientRun(&g_ctx, body, size - 1);
+
+    free(body);
+    return 0;
+}
+
+#ifndef MQTT_FUZZ_LIBFUZZER
+
+/* --------------------------------------------------------------------------
+ * 种子语料
+ * -------------------------------------------------------------------------- */
+
+typedef struct
+{
+    uint8_t buf[8192];
+    size_t len;
+} FuzzSeed;
+
+static void SeedPut(FuzzSeed *s, const void *data, size_t len)
+{
+    if (len > sizeof(s->buf) - s->len)
+        len = sizeof(s->buf) - s->len;
+    memcpy(&s->buf[s->len], data, len);
+    s->len += len;
+}
+
+static void SeedPublish(FuzzSeed *s, const char *topic, size_t payloadLen, uint16_t packetId, uint8_t qos)
+{
+    uint8_t hdr[MQTT_PUBLISH_HDR_MAX];
+    uint8_t pid[2] = {(uint8_t)(packetId >> 8), (uint8_t)packetId};
+    size_t topicLen = strlen(topic);
+    uint32_t n = MQTT_BuildPublishHeader(hdr, sizeof(hdr), (uint16_t)topicLen, payloadLen, 0, qos, 0);
+    SeedPut(s, hdr, n);
+    SeedPut(s, topic, topicLen);
+    if (qos > 0)
+        SeedPut(s, pid, 2);
+    for (size_t i = 0; i < payloadLen; i++)
+    {
+        uint8_t b = (uint8_t)('a' + i % 26);
+        SeedPut(s, &b, 1);
+    }
+}
+
+static void SeedAck(FuzzSeed *s, uint8_t type, uint16_t packetId)
+{
+    uint8_t ack[4];
+    SeedPut(s, ack, MQTT_BuildAckPacket(ack, sizeof(ack), type, packetId));
+}
+
+static bool SeedWrite(const char *dir, unsigned *index, uint8_t cfg, const FuzzSeed *s)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/seed-%03u", dir, (*index)++);
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(&cfg, 1, 1, fp) == 1 && fwrite(s->buf, 1, s->len, fp) == s->len;
+    return (fclose(fp) == 0) && ok;
+}
+
+static int FuzzGenerate(const char *dir)
+{
+    static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    static const uint8_t suback[] = {0x90, 0x03, 0x00, 0x01, 0x01};
+    static const uint8_t unsuback[] = {0xB0, 0x02, 0x00, 0x04};
+    static const uint8_t pingresp[] = {0xD0, 0x00};
+    /* MQTT 5：CONNACK 带 Receive Maximum、Maximum Packet Size、Topic Alias Maximum */
+    static const uint8_t connack5[] = {0x20, 0x0F, 0x00, 0x00, 0x0C, 0x21, 0x00, 0x02,
+                                       0x27, 0x00, 0x00, 0x10, 0x00, 0x22, 0x00, 0x02};
+    static const uint8_t suback5[] = {0x90, 0x04, 0x00, 0x01, 0x00, 0x01};
+    static const uint8_t puback5[] = {0x40, 0x04, 0x00, 0x02, 0x10, 0x00};
+    static const uint8_t pubrec5[] = {0x50, 0x03, 0x00, 0x03, 0x00};
+    static const uint8_t pubcomp5[] = {0x70, 0x02, 0x00, 0x03};
+    static const uint8_t unsuback5[] = {0xB0, 0x04, 0x00, 0x04, 0x00, 0x11};
+    static const uint8_t publish5[] = {0x32, 0x0B, 0x00, 0x03, 't', '/', 'v', 0x00, 0x07, 0x02, 0x01, 0x01, 'z'};
+    static const uint8_t disconnect5[] = {0xE0, 0x01, 0x8E};
+    /* 格式错误：5 字节剩余长度、Topic 长度越界、空 PUBLISH */
+    static const uint8_t badLength[] = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    static const uint8_t badTopic[] = {0x30, 0x04, 0x00, 0x09, 'a', 'b'};
+    static const uint8_t emptyPublish[] = {0x30, 0x00};
+
+    FuzzSeed s;
+    unsigned index = 0;
+    bool ok = true;
+
+    /* 1. 单个报文 (无状态解析函数的输入) */
+    const struct
+    {
+        const uint8_t *data;
+        size_t len;
+    } singles[] = {{connack, sizeof(connack)}, {suback, sizeof(suback)},       {unsuback, sizeof(unsuback)},
+                   {pingresp, sizeof(pingresp)}, {badLength, sizeof(badLength)}, {badTopic, sizeof(badTopic)},
+                   {emptyPublish, sizeof(emptyPublish)}};
+    for (size_t i = 0; i < sizeof(singles) / sizeof(singles[0]); i++)
+    {
+        s.len = 0;
+        SeedPut(&s, singles[i].data, singles[i].len);
+        ok &= SeedWrite(dir, &index, 0, &s);
+    }
+    for (uint8_t qos = 0; qos <= 2; qos++)
+    {
+        s.len = 0;
+        SeedPublish(&s, "t/x", 20, 7, qos);
+        ok &= SeedWrite(dir, &index, 0, &s);
+    }
+    for (uint8_t type = 0x40; type <= 0x70; type += 0x10)
+    {
+        s.len = 0;
+        SeedAck(&s, type, 2);
+        ok &= SeedWrite(dir, &index, 0, &s);
+    }
+
+    /* 2. 完整会话：所有 ACK + 三种 QoS 的 PUBLISH + PUBREL，分别用整包和逐字节到达 */
+    s.len = 0;
+    SeedPut(&s, connack, sizeof(connack));
+    SeedPut(&s, suback, sizeof(suback));
+    SeedAck(&s, 0x40, 2);
+    SeedAck(&s, 0x50, 3);
+    SeedAck(&s, 0x70, 3);
+    SeedPut(&s, unsuback, sizeof(unsuback));
+    SeedPut(&s, pingresp, sizeof(pingresp));
+    SeedPublish(&s, "a/b", 10, 0, 0);
+    SeedPublish(&s, "a/b", 30, 11, 1);
+    SeedPublish(&s, "a/b", 30, 11, 1);
+    SeedPublish(&s, "a/c", 50, 12, 2);
+    SeedAck(&s, 0x60, 12);
+    ok &= SeedWrite(dir, &index, 0xF0, &s);
+    ok &= SeedWrite(dir, &index, 0x00, &s);
+    ok &= SeedWrite(dir, &index, 0x54, &s);
+
+    /* 3. 流式接收：大消息分段到达、背压、小接收区，以及超过接收区的普通消息 */
+    s.len = 0;
+    SeedPut(&s, connack, sizeof(connack));
+    SeedPublish(&s, "s/big", 3000, 21, 1);
+    SeedPublish(&s, "s/two", 200, 22, 2);
+    SeedAck(&s, 0x60, 22);
+    SeedPublish(&s, "t/oversized", 2000, 23, 1);
+    SeedPublish(&s, "t/after", 5, 0, 0);
+    ok &= SeedWrite(dir, &index, 0xF2, &s);
+    ok &= SeedWrite(dir, &index, 0x8A, &s);
+    ok &= SeedWrite(dir, &index, 0x36, &s);
+
+    /* 4. MQTT 5：属性区、原因码、服务器 DISCONNECT */
+    s.len = 0;
+    SeedPut(&s, connack5, sizeof(connack5));
+    SeedPut(&s, suback5, sizeof(suback5));
+    SeedPut(&s, puback5, sizeof(puback5));
+    SeedPut(&s, pubrec5, sizeof(pubrec5));
+    SeedPut(&s, pubcomp5, sizeof(pubcomp5));
+    SeedPut(&s, unsuback5, sizeof(unsuback5));
+    SeedPut(&s, publish5, sizeof(publish5));
+    SeedPut(&s, disconnect5, sizeof(disconnect5));
+    ok &= SeedWrite(dir, &index, 0xF1, &s);
+    ok &= SeedWrite(dir, &index, 0x33, &s);
+
+    /* 5. 格式错误后的字节流 (含 PacketID 为 0 的 PUBREL) */
+    s.len = 0;
+    SeedPut(&s, connack, sizeof(connack));
+    SeedAck(&s, 0x60, 0);
+    SeedPublish(&s, "a/q2", 5, 31, 2);
+    SeedPut(&s, badTopic, sizeof(badTopic));
+    SeedPublish(&s, "a/b", 5, 0, 0);
+    SeedPut(&s, badLength, sizeof(badLength));
+    SeedPublish(&s, "a/b", 5, 0, 0);
+    ok &= SeedWrite(dir, &index, 0xF0, &s);
+    ok &= SeedWrite(dir, &index, 0x21, &s);
+
+    if (!ok)
+    {
+        fprintf(stderr, "mqtt_fuzz: cannot write seeds to %s\n", dir);
+        return 1;
+    }
+    printf("wrote %u seeds to %s\n", index, dir);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * 回放驱动
+ * -------------------------------------------------------------------------- */
+
+typedef struct
+{
+    uint8_t *data;
+    size_t len;
+} FuzzInput;
+
+static FuzzInput *g_inputs;
+static size_t g_inputCount;
+static size_t g_inputCap;
+
+static bool FuzzLoadFile(const char *path)
+{
+    FILE *fp = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!fp)
+        return false;
+
+    uint8_t *data = malloc(FUZZ_MAX_INPUT);
+    size_t len = data ? fread(data, 1, FUZZ_MAX_INPUT, fp) : 0;
+    if (fp != stdin)
+        fclose(fp);
+    if (!data)
+        return false;
+
+    if (g_inputCount == g_inputCap)
+    {
+        size_t cap = g_inputCap ? g_inputCap * 2 : 64;
+        FuzzInput *p = realloc(g_inputs, cap * sizeof(FuzzInput));
+        if (!p)
+        {
+            free(data);
+            return false;
+        }
+        g_inputs = p;
+        g_inputCap = cap;
+    }
+    g_inputs[g_inputCount].data = data;
+    g_inputs[g_inputCount].len = len;
+    g_inputCount++;
+    return true;
+}
+
+static bool FuzzLoadPath(const char *path)
+{
+    struct stat st;
+    if (strcmp(path, "-") == 0 || (stat(path, &st) == 0 && !S_ISDIR(st.st_mode)))
+        return FuzzLoadFile(path);
+
+    DIR *dir = opendir(path);
+    if (!dir)
+        return false;
+    struct dirent *e;
+    bool ok = true;
+    while ((e = readdir(dir)) != NULL && ok)
+    {
+        char file[1024];
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        if (stat(file, &st) == 0 && S_ISREG(st.st_mode))
+            ok = FuzzLoadFile(file);
+    }
+    closedir(dir);
+    return ok;
+}
+
+static uint64_t FuzzNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* 回放所有输入 rounds 遍，并单独统计无状态解析函数的吞吐 */
+static int FuzzReplay(uint32_t rounds)
+{
+    static uint8_t topic[FUZZ_MAX_INPUT + 1];
+    static char payload[FUZZ_MAX_INPUT + 1];
+    uint64_t bytes = 0;
+
+    for (size_t i = 0; i < g_inputCount; i++)
+        bytes += g_inputs[i].len;
+
+    uint64_t t0 = FuzzNowUs();
+    for (uint32_t r = 0; r < rounds; r++)
+        for (size_t i = 0; i < g_inputCount; i++)
+            LLVMFuzzerTestOneInput(g_inputs[i].data, g_inputs[i].len);
+    uint64_t t1 = FuzzNowUs();
+
+    /* 只计 MQTT_ParsePublishMessage：对每个输入从每个报文边界开始解析 */
+    uint64_t parsed = 0;
+    volatile int sink = 0;
+    uint64_t t2 = FuzzNowUs();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < g_inputCount; i++)
+        {
+            const uint8_t *d = g_inputs[i].data + 1;
+            size_t n = g_inputs[i].len ? g_inputs[i].len - 1 : 0;
+            for (size_t off = 0; off < n;)
+            {
+                uint16_t packetId;
+                size_t total = FuzzPacketLength(&d[off], n - off);
+                sink += MQTT_ParsePublishMessage(&d[off], n - off, topic, sizeof(topic), payload, sizeof(payload), &packetId);
+                parsed += (total && total <= n - off) ? total : n - off;
+                off += (total && total <= n - off) ? total : n - off;
+            }
+        }
+    }
+    uint64_t t3 = FuzzNowUs();
+    (void)sink;
+
+    double us = (double)(t1 - t0 ? t1 - t0 : 1);
+    printf("replayed %zu inputs x %u (%llu bytes each round) in %.1f ms: %.0f inputs/s, %.1f MB/s through the client\n",
+           g_inputCount, rounds, (unsigned long long)bytes, us / 1000.0, (double)g_inputCount * rounds * 1e6 / us,
+           (double)bytes * rounds / us);
+    us = (double)(t3 - t2 ? t3 - t2 : 1);
+    printf("MQTT_ParsePublishMessage: %.1f MB/s on the same inputs\n", (double)parsed / us);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * 往返性质测试
+ * -------------------------------------------------------------------------- */
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t FuzzRand(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (uint32_t)(g_rng >> 16);
+}
+
+/* Payload 长度：偏向剩余长度编码的边界 (1/2/3 字节) */
+static size_t FuzzRandPayloadLen(size_t overhead)
+{
+    static const size_t edges[] = {127, 128, 16383, 16384, 65535};
+    switch (FuzzRand() % 8)
+    {
+    case 0:
+        return 0;
+    case 1:
+    {
+        size_t edge = edges[FuzzRand() % 5];
+        size_t len = (edge > overhead) ? edge - overhead : 0;
+        return len + FuzzRand() % 3 - (len > 0 ? 1 : 0);
+    }
+    case 2:
+        return FuzzRand() % FUZZ_PAYLOAD_MAX;
+    default:
+        return FuzzRand() % 300;
+    }
+}
+
+/* 客户端是否发出过该报文 (之后可能还有心跳与重发) */
+static bool FuzzSent(const FuzzCtx *f, const uint8_t *pkt, size_t len)
+{
+    for (size_t i = 0; i + len <= f->outLen; i++)
+    {
+        if (memcmp(&f->out[i], pkt, len) == 0)
+            return true;
+    }
+    return false;
+}
+
+static int FuzzProperties(uint32_t rounds)
+{
+    static uint8_t packet[FUZZ_PAYLOAD_MAX + FUZZ_TOPIC_MAX + 16];
+    static uint8_t legacy[FUZZ_PAYLOAD_MAX + FUZZ_TOPIC_MAX + 16];
+    static uint8_t wire[4 + FUZZ_PAYLOAD_MAX + FUZZ_TOPIC_MAX + 16];
+    static uint8_t tplBuf[MQTT_TEMPLATE_BUF_SIZE(FUZZ_TOPIC_MAX, FUZZ_PAYLOAD_MAX)];
+    static uint8_t payload[FUZZ_PAYLOAD_MAX + 1];
+    static uint8_t topicOut[FUZZ_TOPIC_MAX + 1];
+    static char payloadOut[FUZZ_PAYLOAD_MAX + 1];
+    char topic[FUZZ_TOPIC_MAX + 1];
+    uint32_t streamed = 0, delivered = 0, oversized = 0;
+
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        /* 1. 随机 PUBLISH：可打印 Topic (不含通配符与 $ 开头)，二进制或文本 Payload */
+        uint8_t qos = FuzzRand() % 3;
+        uint8_t dup = FuzzRand() & 1;
+        uint8_t retain = FuzzRand() & 1;
+        uint16_t packetId = (qos > 0) ? (uint16_t)(1 + FuzzRand() % 0xFFFF) : 0;
+        size_t topicLen = 1 + ((FuzzRand() % 8) ? FuzzRand() % 40 : FuzzRand() % FUZZ_TOPIC_MAX);
+        bool stream = FuzzRand() % 3 == 0 && MQTT_ENABLE_ROUTER;
+        if (stream && topicLen < 2)
+            topicLen = 2;
+        for (size_t i = 0; i < topicLen; i++)
+        {
+            char ch = (char)('!' + FuzzRand() % 94);
+            if (ch == '+' || ch == '#' || ch == '/' || (i == 0 && ch == '$'))
+                ch = '_';
+            topic[i] = (i % 24 == 23) ? '/' : ch; /* 层级数 (含 s/ 前缀) 不超过 MQTT_ROUTER_MAX_LEVELS */
+        }
+        if (stream)
+            memcpy(topic, "s/", 2);
+        else if (topic[0] == 's')
+            topic[0] = '_'; /* "s" 本身也匹配 s/# */
+        topic[topicLen] = '\0';
+        size_t payloadLen = FuzzRandPayloadLen(topicLen + 4);
+        if (payloadLen > FUZZ_PAYLOAD_MAX)
+            payloadLen = FUZZ_PAYLOAD_MAX;
+        bool text = FuzzRand() & 1;
+        for (size_t i = 0; i < payloadLen; i++)
+            payload[i] = text ? (uint8_t)('a' + FuzzRand() % 26) : (uint8_t)FuzzRand();
+        payload[payloadLen] = 0;
+
+        /* 2. 三种构建方式结果一致：分段报头、发布模板、(文本 Payload) MQTT_BuildPublishPacket */
+        uint8_t hdr[MQTT_PUBLISH_HDR_MAX];
+        uint32_t hdrLen = MQTT_BuildPublishHeader(hdr, sizeof(hdr), (uint16_t)topicLen, payloadLen, dup, qos, retain);
+        FUZZ_CHECK(hdrLen > 0);
+        size_t total = 0;
+        memcpy(&packet[total], hdr, hdrLen);
+        total += hdrLen;
+        memcpy(&packet[total], topic, topicLen);
+        total += topicLen;
+        if (qos > 0)
+        {
+            packet[total++] = (uint8_t)(packetId >> 8);
+            packet[total++] = (uint8_t)packetId;
+        }
+        memcpy(&packet[total], payload, payloadLen);
+        total += payloadLen;
+        FUZZ_CHECK(FuzzPacketLength(packet, total) == total);
+
+        MQTT_PublishTemplate tpl;
+        const uint8_t *tplPacket;
+        FUZZ_CHECK(MQTT_PreparePublishTemplate(&tpl, tplBuf, sizeof(tplBuf), topic, qos, retain));
+        FUZZ_CHECK(MQTT_BuildPublishFromTemplate(&tpl, payload, payloadLen, packetId, dup, &tplPacket) == total);
+        FUZZ_CHECK(memcmp(tplPacket, packet, total) == 0);
+        if (text)
+        {
+            FUZZ_CHECK(MQTT_BuildPublishPacket(legacy, sizeof(legacy), topic, (const char *)payload, packetId, dup, qos, retain) == total);
+            FUZZ_CHECK(memcmp(legacy, packet, total) == 0);
+        }
+
+        /* 3. 解析还原：Topic、PacketID、Payload 相同；缓冲区恰好不够时返回 -4；任意截断都失败 */
+        uint16_t parsedId = 0xFFFF;
+        int ret = MQTT_ParsePublishMessage(packet, total, topicOut, topicLen + 1, payloadOut, payloadLen + 1, &parsedId);
+        FUZZ_CHECK(ret == (int)payloadLen);
+        FUZZ_CHECK(memcmp(topicOut, topic, topicLen + 1) == 0 && memcmp(payloadOut, payload, payloadLen) == 0);
+        FUZZ_CHECK(parsedId == packetId);
+        FUZZ_CHECK(MQTT_ParsePublishMessage(packet, total, topicOut, topicLen + 1, payloadOut, payloadLen, &parsedId) == -4);
+        for (int k = 0; k < 4; k++)
+        {
+            size_t cut = FuzzRand() % total;
+            FUZZ_CHECK(MQTT_ParsePublishMessage(packet, cut, topicOut, topicLen + 1, payloadOut, payloadLen + 1, &parsedId) < 0);
+        }
+
+        /* 4. 客户端接收路径：随机分段到达，交付内容与回复的 ACK 与构建时一致 */
+        uint8_t cfg = (uint8_t)((FuzzRand() % 16) << FUZZ_CFG_CHUNK_SHIFT) | (stream ? FUZZ_CFG_STREAM : 0) |
+                      ((FuzzRand() & 1) ? FUZZ_CFG_PAUSE : 0);
+        static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+        memcpy(wire, connack, sizeof(connack)); /* 先确认 CONNECT，否则 CONNECT 重发会中止流式接收 */
+        memcpy(&wire[sizeof(connack)], packet, total);
+        FuzzClientInit(&g_ctx, cfg, FUZZ_RX_SIZE);
+        FuzzClientRun(&g_ctx, wire, sizeof(connack) + total);
+        if (stream)
+        {
+            FUZZ_CHECK(g_ctx.streamBegins == 1 && g_ctx.streamEnds == 1 && g_ctx.streamLen == payloadLen);
+            FUZZ_CHECK(g_ctx.messages == 0);
+            streamed++;
+        }
+        else if (total > g_ctx.client.rxMaxPacket)
+        {
+            /* 放不进接收区的普通消息被丢弃，只计入 oversized */
+            FUZZ_CHECK(g_ctx.messages == 0 && g_ctx.client.stats.oversized == 1);
+            oversized++;
+            continue;
+        }
+        else
+        {
+            FUZZ_CHECK(g_ctx.messages == 1 && g_ctx.lastLen == payloadLen);
+            FUZZ_CHECK(strcmp((char *)g_ctx.lastTopic, topic) == 0);
+            delivered++;
+        }
+        FUZZ_CHECK(memcmp(g_ctx.last, payload, payloadLen) == 0);
+        if (qos > 0)
+        {
+            uint8_t ack[4];
+            MQTT_BuildAckPacket(ack, sizeof(ack), qos == 1 ? 0x40 : 0x50, packetId);
+            FUZZ_CHECK(FuzzSent(&g_ctx, ack, sizeof(ack)));
+        }
+
+        /* 5. ACK 构建与校验互逆 */
+        uint8_t ack[4];
+        uint16_t id = (uint16_t)(1 + FuzzRand() % 0xFFFF);
+        MQTT_BuildAckPacket(ack, sizeof(ack), 0x40, id);
+        FUZZ_CHECK(MQTT_CheckPubAck(ack, 4, id) && !MQTT_CheckPubAck(ack, 4, (uint16_t)(id + 1)) && !MQTT_CheckPubAck(ack, 3, id));
+        MQTT_BuildAckPacket(ack, sizeof(ack), 0xB0, id);
+        FUZZ_CHECK(MQTT_CheckUnsubAck(ack, 4, id) && !MQTT_CheckUnsubAck(ack, 4, (uint16_t)(id ^ 0x8000)));
+    }
+
+    printf("properties: %u rounds ok (%u delivered, %u streamed, %u oversized)\n", rounds, delivered, streamed, oversized);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+ * QoS 2 接收：服务器同时有大量消息等待 PUBREL，双向丢包、同一批报文相邻乱序
+ * 客户端必须对到达的每个 PUBLISH / PUBREL 立即回复 PUBREC / PUBCOMP (服务器只在重连后重发，
+ * 暂缓确认等同于丢消息)。替身服务器在下一轮重发丢失的报文：未收到 PUBREC 的重发 PUBLISH (DUP)，
+ * 未收到 PUBCOMP 的重发 PUBREL，同一条消息的 PUBLISH 不会出现在它的 PUBREL 之后。
+ * 替身服务器遵守客户端的 Receive Maximum：未收到 PUBCOMP 的消息不超过 MQTT_RX_QOS2_MAX 条
+ * (MQTT 5 的 CONNECT 必须声明该值)。每条消息必须恰好交付一次，结束时不留 QoS 2 状态。
+ * 最后检查 MQTT 3.1.1 服务器超出状态表容量时淘汰最早的 PacketID，以及重连时按 Session Present 保留或清空状态。
+ * -------------------------------------------------------------------------- */
+
+#define FUZZ_QOS2_MSGS 256
+
+static int FuzzQos2(uint32_t rounds)
+{
+    static uint8_t batch[FUZZ_QOS2_MSGS][16];
+    static uint8_t wire[FUZZ_QOS2_MSGS * 16 + 4];
+    static uint8_t seen[FUZZ_QOS2_MSGS];
+    uint8_t state[FUZZ_QOS2_MSGS]; /* 0 等待 PUBREC，1 等待 PUBCOMP，2 完成 */
+    uint16_t ids[FUZZ_QOS2_MSGS];
+    uint8_t lens[FUZZ_QOS2_MSGS];
+    uint16_t sentIds[FUZZ_QOS2_MSGS];
+    uint8_t sentTypes[FUZZ_QOS2_MSGS];
+    uint32_t steps = 0, peak = 0;
+
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        bool v5 = FuzzRand() & 1;
+        uint32_t count = 16 + FuzzRand() % (FUZZ_QOS2_MSGS - 15);
+        uint32_t lossPct = FuzzRand() % 31;
+        uint32_t reorderPct = FuzzRand() % 51;
+        uint16_t base = (uint16_t)FuzzRand(); /* PacketID 连续分配，可能越过 65535 回绕 (跳过 0) */
+
+        uint8_t cfg = (uint8_t)((FuzzRand() % 16) << FUZZ_CFG_CHUNK_SHIFT) | (v5 ? FUZZ_CFG_V5 : 0);
+        static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+        FuzzClientInit(&g_ctx, cfg, FUZZ_RX_SIZE);
+        FuzzClientRun(&g_ctx, connack, sizeof(connack));
+        g_ctx.client.keepAlive = 0; /* 服务器替身不回复 PINGREQ */
+        if (v5)
+        {
+            static const uint8_t receiveMax[] = {MQTT_PROP_RECEIVE_MAX, MQTT_RX_QOS2_MAX >> 8, MQTT_RX_QOS2_MAX & 0xFF};
+            FUZZ_CHECK(FuzzSent(&g_ctx, receiveMax, sizeof(receiveMax)));
+        }
+        memset(seen, 0, sizeof(seen));
+        g_ctx.seen = seen;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (++base == 0)
+                base = 1;
+            ids[i] = base;
+            state[i] = 0;
+        }
+
+        uint32_t done = 0;
+        for (uint32_t step = 0; done < count; step++)
+        {
+            FUZZ_CHECK(step < 4000);
+            steps++;
+
+            /* 1. 服务器发出本轮报文 (PUBLISH 或 PUBREL)，按概率丢弃，再按概率与前一个交换；
+             *    只发送最早的 MQTT_RX_QOS2_MAX 条未完成消息 */
+            uint32_t n = 0, open = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint8_t *p = batch[n];
+                if (state[i] < 2 && open++ >= MQTT_RX_QOS2_MAX)
+                    break;
+                if (state[i] == 0)
+                {
+                    uint8_t v5Len = v5 ? 1 : 0;
+                    p[0] = (uint8_t)(0x34 | (step > 0 ? 0x08 : 0));
+                    p[1] = (uint8_t)(3 + 2 + v5Len + 2);
+                    memcpy(&p[2], "\x00\x01q", 3);
+                    p[5] = (uint8_t)(ids[i] >> 8);
+                    p[6] = (uint8_t)ids[i];
+                    if (v5)
+                        p[7] = 0x00;
+                    p[7 + v5Len] = (uint8_t)(i >> 8);
+                    p[8 + v5Len] = (uint8_t)i;
+                    lens[n] = (uint8_t)(9 + v5Len);
+                }
+                else if (state[i] == 1)
+                {
+                    MQTT_BuildAckPacket(p, 4, 0x62, ids[i]);
+                    lens[n] = 4;
+                }
+                else
+                {
+                    continue;
+                }
+                if (FuzzRand() % 100 < lossPct)
+                    continue;
+                sentIds[n] = ids[i];
+                sentTypes[n] = state[i] ? 0x70 : 0x50;
+                if (n > 0 && FuzzRand() % 100 < reorderPct)
+                {
+                    uint8_t tmp[16], tmpLen = lens[n];
+                    memcpy(tmp, batch[n], sizeof(tmp));
+                    memcpy(batch[n], batch[n - 1], sizeof(tmp));
+                    memcpy(batch[n - 1], tmp, sizeof(tmp));
+                    lens[n] = lens[n - 1];
+                    lens[n - 1] = tmpLen;
+                }
+                n++;
+            }
+
+            size_t wireLen = 0;
+            for (uint32_t k = 0; k < n; k++)
+            {
+                memcpy(&wire[wireLen], batch[k], lens[k]);
+                wireLen += lens[k];
+            }
+            g_ctx.outLen = 0;
+            FuzzClientRun(&g_ctx, wire, wireLen);
+            FUZZ_CHECK(g_ctx.client.isConnected);
+            if (g_ctx.client.rxQos2Count > peak)
+                peak = g_ctx.client.rxQos2Count;
+            for (uint32_t k = 0; k < n; k++)
+            {
+                uint8_t ack[4];
+                MQTT_BuildAckPacket(ack, sizeof(ack), sentTypes[k], sentIds[k]);
+                FUZZ_CHECK(FuzzSent(&g_ctx, ack, sizeof(ack)));
+            }
+
+            /* 2. 客户端的 PUBREC / PUBCOMP 同样按概率丢弃 */
+            FUZZ_CHECK(g_ctx.outLen < sizeof(g_ctx.out));
+            for (size_t off = 0; off + 4 <= g_ctx.outLen; off += 2 + g_ctx.out[off + 1])
+            {
+                uint8_t type = g_ctx.out[off] & 0xF0;
+                uint16_t id = (uint16_t)((g_ctx.out[off + 2] << 8) | g_ctx.out[off + 3]);
+                if ((type != 0x50 && type != 0x70) || FuzzRand() % 100 < lossPct)
+                    continue;
+                uint32_t i = (uint16_t)(id - ids[0]) - (id < ids[0] ? 1 : 0); /* 回绕时跳过了 0 */
+                if (i >= count || ids[i] != id)
+                    continue;
+                if (type == 0x50 && state[i] == 0)
+                    state[i] = 1;
+                else if (type == 0x70 && state[i] == 1)
+                {
+                    state[i] = 2;
+                    done++;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+            FUZZ_CHECK(seen[i] == 1);
+        FUZZ_CHECK(g_ctx.client.rxQos2Count == 0);
+        FUZZ_CHECK(g_ctx.client.stats.rxQos2Evicted == 0);
+    }
+
+    /* MQTT 3.1.1 服务器不受 Receive Maximum 约束：超出容量时淘汰最早的 PacketID，其余仍能识别重发 */
+    static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    FuzzClientInit(&g_ctx, 0, FUZZ_RX_SIZE);
+    FuzzClientRun(&g_ctx, connack, sizeof(connack));
+    g_ctx.client.keepAlive = 0;
+    for (uint32_t i = 1; i <= MQTT_RX_QOS2_MAX + 1u; i++)
+    {
+        uint8_t p[9] = {0x34, 7, 0x00, 0x01, 'q', (uint8_t)(i >> 8), (uint8_t)i, 0, 0};
+        FuzzClientRun(&g_ctx, p, sizeof(p));
+    }
+    FUZZ_CHECK(g_ctx.client.rxQos2Count == MQTT_RX_QOS2_MAX && g_ctx.client.stats.rxQos2Evicted == 1);
+    FUZZ_CHECK(g_ctx.client.rxQos2[0] == 2 && g_ctx.client.rxQos2[MQTT_RX_QOS2_MAX - 1] == MQTT_RX_QOS2_MAX + 1);
+    uint32_t before = g_ctx.client.stats.dupsDropped;
+    uint8_t again[9] = {0x3C, 7, 0x00, 0x01, 'q', 0, 2, 0, 0};
+    FuzzClientRun(&g_ctx, again, sizeof(again));
+    FUZZ_CHECK(g_ctx.client.stats.dupsDropped == before + 1);
+
+    /* Clean Session = 0 且没有会话对象：Session Present = 1 保留状态，= 0 (服务器丢弃了旧会话) 清空 */
+    static const uint8_t resumed[] = {0x20, 0x02, 0x01, 0x00};
+    MQTT_Submit(&g_ctx.client, MQTT_OP_CONNECT, NULL, NULL);
+    FuzzClientRun(&g_ctx, resumed, sizeof(resumed));
+    FUZZ_CHECK(g_ctx.client.rxQos2Count == MQTT_RX_QOS2_MAX);
+    MQTT_Submit(&g_ctx.client, MQTT_OP_CONNECT, NULL, NULL);
+    FuzzClientRun(&g_ctx, connack, sizeof(connack));
+    FUZZ_CHECK(g_ctx.client.rxQos2Count == 0);
+
+    printf("qos2: %u rounds ok (%u steps, peak %u awaiting PUBREL)\n", rounds, steps, peak);
+    return 0;
+}
+
+static void FuzzUsage(const char *prog)
+{
+    printf("usage: %s -g dir | [-r rounds] file|dir ... | -p rounds [-S seed] | -q rounds [-S seed]\n"
+           "  -g dir      write a seed corpus generated by the packet builders\n"
+           "  -r n        replay every input n times and report parse throughput (default: 1)\n"
+           "  -p n        run n randomized build -> parse -> compare rounds\n"
+           "  -q n        run n QoS 2 receive rounds with loss and reordering in both directions\n"
+           "  -S seed     random seed for -p / -q\n",
+           prog);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = 1;
+    uint32_t props = 0;
+    uint32_t qos2 = 0;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+    {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+            return FuzzGenerate(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rounds = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            props = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+            qos2 = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+            g_rng ^= (uint64_t)strtoull(argv[++i], NULL, 0) * 0xD1B54A32D192ED03ull;
+        else
+        {
+            FuzzUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (props > 0)
+        return FuzzProperties(props);
+    if (qos2 > 0)
+        return FuzzQos2(qos2);
+
+    if (i >= argc)
+    {
+        FuzzUsage(argv[0]);
+        return 1;
+    }
+    for (; i < argc; i++)
+    {
+        if (!FuzzLoadPath(argv[i]))
+        {
+            fprintf(stderr, "mqtt_fuzz: cannot read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    return FuzzReplay(rounds ? rounds : 1);
+}
+
+#endif /* MQTT_FUZZ_LIBFUZZER */
@@ -182,6 +182,48 @@ void rb_skip(ring_buffer_t *rb, uint32_t len)
     rb->tail = (rb->tail + len) & rb->mask;
 }
 
+uint8_t *rb_write_continuous(ring_buffer_t *rb, uint32_t *len)
+{
+    // 1. DMA 模式下写指针由硬件维护，不允许软件写入
+    uint32_t space = 0;
+    if (rb->mode != RB_MODE_DMA_CIRCULAR)
+    {
+        // 2. 剩余可用空间 (同样保留 1 字节)
+        space = (rb->size - 1) - rb_get_count(rb);
+    }
+
+    if (space == 0)
+    {
+        if (len)
+            *len = 0;
+        return NULL;
+    }
+
+    // 3. 只返回 Head 到缓冲区末尾的那一段
+    uint32_t head = rb->head;
+    uint32_t to_end = rb->size - head;
+
+    if (len)
+        *len = (space < to_end) ? space : to_end;
+
+    return &rb->buffer[head];
+}
+
+void rb_commit(ring_buffer_t *rb, uint32_t len)
+{
+    // 1. DMA 模式下不允许软件推进写指针
+    if (rb->mode == RB_MODE_DMA_CIRCULAR)
+        return;
+
+    // 2. 边界保护：不能超过剩余空间
+    uint32_t space = (rb->size - 1) - rb_get_count(rb);
+    if (len > space)
+        len = space;
+
+    // 3. 更新写指针 (位运算回绕)
+    rb->head = (rb->head + len) & rb->mask;
+}
+
 uint32_t rb_read(ring_buffer_t *rb, uint8_t *dest, uint32_t max_len)
 {
     // 1. 参数检查：目标指针为空或长度为0，直接返回
@@ -106,6 +106,24 @@ uint8_t *rb_peek_continuous(ring_buffer_t *rb, uint32_t *len);
  */
 void rb_skip(ring_buffer_t *rb, uint32_t len);
 
+/**
+ * @brief [软件模式][零拷贝] 获取一段连续的可写内存指针
+ * @note 用于让外设/驱动直接把数据收进缓冲区 (如 recv 到该指针)，写完后调用 rb_commit。
+ *       如果空闲空间跨越了缓冲区末尾，此函数只返回 Head 到末尾的那一段。
+ * @param rb 句柄
+ * @param len [出参] 输出这段连续空闲内存的长度 (如果为 NULL 则不输出)
+ * @return 指向空闲段的指针 (已满或 DMA 模式返回 NULL)
+ */
+uint8_t *rb_write_continuous(ring_buffer_t *rb, uint32_t *len);
+
+/**
+ * @brief [软件模式] 提交已写入的数据 (配合 rb_write_continuous 使用)
+ * @note 包含边界检查，防止提交超过剩余空间的长度
+ * @param rb 句柄
+ * @param len 实际写入的字节数
+ */
+void rb_commit(ring_buffer_t *rb, uint32_t len);
+
 #ifdef __cplusplus
 }
 #endif
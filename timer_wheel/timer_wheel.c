@@ -0,0 +1,211 @@
+/**
+ * @file timer_wheel.c
+ * @brief 哈希时间轮逻辑实现
+ */
+
+#include "timer_wheel.h"
+#include <string.h> /* 用于 memset */
+
+/* 宏：检查 x 是否为 2 的幂。原理：(x & (x-1)) == 0 表示只有一位是1 */
+#define IS_POWER_OF_TWO(x) ((x) != 0 && (((x) & ((x) - 1)) == 0))
+
+/**
+ * @brief 内部函数：取得定时器所在链表的表头
+ */
+static inline tw_timer_t **_tw_head(timer_wheel_t *tw, const tw_timer_t *timer)
+{
+    return (timer->slot == tw->size) ? &tw->firing : &tw->slots[timer->slot];
+}
+
+/**
+ * @brief 内部函数：把定时器从所在链表中摘下 (不修改 active/count)
+ */
+static void _tw_unlink(timer_wheel_t *tw, tw_timer_t *timer)
+{
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        *_tw_head(tw, timer) = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+/**
+ * @brief 内部函数：头插到指定链表
+ */
+static void _tw_link(timer_wheel_t *tw, tw_timer_t *timer, uint32_t slot)
+{
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *_tw_head(tw, timer);
+    if (timer->next)
+        timer->next->prev = timer;
+    *_tw_head(tw, timer) = timer;
+}
+
+/* ==========================================
+ * 接口实现
+ * ========================================== */
+
+int tw_init(timer_wheel_t *tw, tw_timer_t **slots, uint32_t size, uint32_t now)
+{
+    // 1. 基础参数空指针检查
+    if (!tw || !slots)
+        return -1;
+
+    // 2. 槽数必须是 2 的幂，槽下标用位运算计算
+    if (!IS_POWER_OF_TWO(size))
+        return -1;
+
+    memset(tw, 0, sizeof(timer_wheel_t));
+    memset(slots, 0, sizeof(tw_timer_t *) * size);
+    tw->slots = slots;
+    tw->size = size;
+    tw->mask = size - 1;
+    tw->tick = now;
+    return 0;
+}
+
+void tw_timer_init(tw_timer_t *timer, tw_callback_t cb, void *ctx)
+{
+    if (!timer)
+        return;
+
+    memset(timer, 0, sizeof(tw_timer_t));
+    timer->cb = cb;
+    timer->ctx = ctx;
+}
+
+void tw_start(timer_wheel_t *tw, tw_timer_t *timer, uint32_t expire)
+{
+    if (!tw || !timer)
+        return;
+
+    tw_stop(tw, timer);
+
+    // 已处理过的时刻不会再被扫描，最早排到下一个 Tick
+    if ((int32_t)(expire - tw->tick) <= 0)
+        expire = tw->tick + 1;
+
+    timer->expire = expire;
+    timer->active = true;
+    _tw_link(tw, timer, expire & tw->mask);
+
+    // 维护最早到期时刻的下界：只会变小，停止定时器时不做调整
+    if (tw->count++ == 0 || (tw->hintValid && (int32_t)(expire - tw->hint) < 0))
+    {
+        tw->hint = expire;
+        tw->hintValid = true;
+    }
+}
+
+void tw_stop(timer_wheel_t *tw, tw_timer_t *timer)
+{
+    if (!tw || !timer || !timer->active)
+        return;
+
+    _tw_unlink(tw, timer);
+    timer->active = false;
+    tw->count--;
+}
+
+uint32_t tw_advance(timer_wheel_t *tw, uint32_t now)
+{
+    uint32_t fired = 0;
+
+    if (!tw || !tw->slots || (int32_t)(now - tw->tick) <= 0)
+        return 0;
+
+    // 落后超过一圈：只需把最近一圈的每个槽扫描一次
+    if (now - tw->tick > tw->size)
+        tw->tick = now - tw->size;
+
+    while (tw->tick != now)
+    {
+        tw->tick++;
+        uint32_t slot = tw->tick & tw->mask;
+
+        // 1. 把本槽到期的定时器移到待触发链表 (未到期的属于后面的圈数，留在槽内)
+        tw_timer_t *t = tw->slots[slot];
+        while (t)
+        {
+            tw_timer_t *next = t->next;
+            if ((int32_t)(t->expire - now) <= 0)
+            {
+                _tw_unlink(tw, t);
+                _tw_link(tw, t, tw->size);
+            }
+            t = next;
+        }
+
+        // 2. 逐个触发：回调中可能停止待触发链表中的其他定时器，每次都从表头重新取
+        while (tw->firing)
+        {
+            t = tw->firing;
+            _tw_unlink(tw, t);
+            t->active = false;
+            tw->count--;
+            fired++;
+            if (t->cb)
+                t->cb(tw, t, t->ctx);
+        }
+    }
+
+    return fired;
+}
+
+bool tw_next_expire(timer_wheel_t *tw, uint32_t *expire)
+{
+    if (!tw || tw->count == 0)
+        return false;
+
+    // 下界尚未被推进越过，直接使用
+    if (tw->hintValid && (int32_t)(tw->hint - tw->tick) > 0)
+    {
+        if (expire)
+            *expire = tw->hint;
+        return true;
+    }
+
+    // 重新计算：从下一个 Tick 开始逐槽查找，槽内恰好在本圈到期的即为最早；
+    // 一圈内都没有则取所有定时器到期时刻的最小值
+    uint32_t best = 0;
+    bool found = false;
+    for (uint32_t d = 1; d <= tw->size; d++)
+    {
+        uint32_t at = tw->tick + d;
+        for (tw_timer_t *t = tw->slots[at & tw->mask]; t; t = t->next)
+        {
+            if (t->expire == at)
+            {
+                best = at;
+                found = true;
+                d = tw->size; /* 结束外层循环 */
+                break;
+            }
+            if (!found || (int32_t)(t->expire - best) < 0)
+            {
+                best = t->expire;
+                found = true;
+            }
+        }
+    }
+
+    tw->hint = best;
+    tw->hintValid = found;
+    if (expire)
+        *expire = best;
+    return found;
+}
+
+uint32_t tw_next_delay(timer_wheel_t *tw, uint32_t now)
+{
+    uint32_t expire;
+    if (!tw_next_expire(tw, &expire))
+        return UINT32_MAX;
+
+    int32_t remain = (int32_t)(expire - now);
+    return (remain <= 0) ? 0 : (uint32_t)remain;
+}
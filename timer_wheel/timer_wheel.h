@@ -0,0 +1,142 @@
+/**
+ * @file timer_wheel.h
+ * @brief 哈希时间轮对外接口头文件 (C99标准)
+ * @details 核心特性：
+ * 1. 槽数为 2 的幂，槽 = 到期时刻 & (槽数 - 1)，槽内为双向链表，启动/取消 O(1)。
+ * 2. 定时器节点嵌入在用户结构体中 (侵入式)，时间轮本身不分配内存。
+ * 3. 推进时只扫描经过的槽，每次推进的开销与到期的定时器数量成正比，与定时器总数无关。
+ * 4. 时刻为 uint32_t (通常为毫秒 Tick)，按有符号差值比较，自动处理回绕。
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>  // 包含 uint32_t 等类型
+#include <stdbool.h> // 包含 bool 类型
+#include <stddef.h>  // 包含 NULL 定义
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================
+ * 类型定义
+ * ========================================== */
+
+struct tw_timer;
+struct timer_wheel;
+
+/**
+ * @brief 到期回调
+ * @note 在 tw_advance 中调用，此时定时器已停止，可在回调中重新启动它，
+ *       也可以启动/停止同一时间轮中的其他定时器
+ */
+typedef void (*tw_callback_t)(struct timer_wheel *tw, struct tw_timer *timer, void *ctx);
+
+/**
+ * @brief 定时器节点 (嵌入在用户结构体中，用 tw_timer_init 初始化)
+ */
+typedef struct tw_timer
+{
+    struct tw_timer *prev; /* 槽内双向链表 */
+    struct tw_timer *next;
+    uint32_t expire;       /* 到期时刻 */
+    uint32_t slot;         /* 所在槽 (等于槽数时表示位于本轮待触发链表) */
+    bool active;           /* 是否已启动 */
+    tw_callback_t cb;      /* 到期回调 */
+    void *ctx;             /* 回调用户参数 */
+} tw_timer_t;
+
+/**
+ * @brief 时间轮控制块
+ */
+typedef struct timer_wheel
+{
+    tw_timer_t **slots; /* 各槽链表头数组 (由用户提供) */
+    uint32_t size;      /* 槽数 (必须是 2 的幂) */
+    uint32_t mask;      /* 掩码 (size - 1) */
+    uint32_t tick;      /* 已处理到的时刻 */
+    uint32_t count;     /* 已启动的定时器数量 */
+    uint32_t hint;      /* 最早到期时刻的下界 (用于 tw_next_expire 免扫描) */
+    bool hintValid;
+    tw_timer_t *firing; /* 推进过程中本槽已到期、等待回调的定时器 */
+} timer_wheel_t;
+
+/* ==========================================
+ * 函数声明
+ * ========================================== */
+
+/**
+ * @brief 初始化时间轮
+ * @param tw [出参] 控制块指针
+ * @param slots [入参] 槽链表头数组 (内容会被清零)
+ * @param size [入参] 槽数 (警告：必须是 2 的幂，如 64, 1024)
+ * @param now [入参] 当前时刻
+ * @return 0: 成功, -1: 参数错误 (如 size 不是 2 的幂)
+ */
+int tw_init(timer_wheel_t *tw, tw_timer_t **slots, uint32_t size, uint32_t now);
+
+/**
+ * @brief 初始化定时器节点 (不能对已启动的定时器调用)
+ * @param timer 定时器
+ * @param cb 到期回调
+ * @param ctx 回调用户参数
+ */
+void tw_timer_init(tw_timer_t *timer, tw_callback_t cb, void *ctx);
+
+/**
+ * @brief 启动定时器 (已启动则先停止再按新时刻启动)
+ * @note 早于等于已处理时刻的 expire 会推迟到下一个 Tick，即下一次 tw_advance 时触发
+ * @param tw 时间轮
+ * @param timer 定时器
+ * @param expire 到期时刻 (绝对时刻，不是间隔)
+ */
+void tw_start(timer_wheel_t *tw, tw_timer_t *timer, uint32_t expire);
+
+/**
+ * @brief 停止定时器 (未启动则忽略)
+ * @param tw 时间轮
+ * @param timer 定时器
+ */
+void tw_stop(timer_wheel_t *tw, tw_timer_t *timer);
+
+/**
+ * @brief 定时器是否已启动
+ */
+static inline bool tw_is_active(const tw_timer_t *timer)
+{
+    return timer->active;
+}
+
+/**
+ * @brief 推进时间轮到 now，依次触发所有到期的定时器
+ * @note 落后超过一圈时每个槽只扫描一次
+ * @param tw 时间轮
+ * @param now 当前时刻
+ * @return 本次触发的定时器数量
+ */
+uint32_t tw_advance(timer_wheel_t *tw, uint32_t now);
+
+/**
+ * @brief 查询最早的到期时刻
+ * @note 被停止的定时器不会立即从下界中剔除，因此结果可能偏早 (到时推进一次即会重新计算)，不会偏晚
+ * @param tw 时间轮
+ * @param expire [出参] 最早到期时刻
+ * @return true: 有已启动的定时器; false: 时间轮为空
+ */
+bool tw_next_expire(timer_wheel_t *tw, uint32_t *expire);
+
+/**
+ * @brief 距离最早到期时刻的时间
+ * @param tw 时间轮
+ * @param now 当前时刻
+ * @return 等待时间 (已到期返回 0，时间轮为空返回 UINT32_MAX)
+ */
+uint32_t tw_next_delay(timer_wheel_t *tw, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_WHEEL_H